@@ -0,0 +1,264 @@
+/*
+ *  ======== echoConfig.h ========
+ *  Ranging and echo detection settings shared by rfEchoTx.c and rfEchoRx.c
+ *  and by the host tools. Both projects have common/ on their include path,
+ *  so there is one copy; the other modules it includes are found in each
+ *  project's root.
+ *
+ *  The listen window is range gated: the ADC buffer length, the number of
+ *  buffers, the bin cutoff and the window length all follow from
+ *  ECHO_MAX_RANGE_MM and the speed of sound, so the ADC only samples (and
+ *  adcBufCallback only processes) as long as an echo from the farthest
+ *  responder of interest can still start, plus one burst length.
+ *
+ *  The RF trigger arrives instantly, so the time of flight is the one-way
+ *  distance over the speed of sound. host/echoConfigCheck.c checks the
+ *  geometry.
+ */
+
+#ifndef ECHO_CONFIG_H
+#define ECHO_CONFIG_H
+
+#include "bandpass.h"
+#include "cfar.h"
+#include "goertzel.h"
+#include "rangingPacket.h"
+
+/***** Ranging geometry *****/
+/* Farthest responder that should sound the buzzer (~6.5 feet) */
+#ifndef ECHO_MAX_RANGE_MM
+#define ECHO_MAX_RANGE_MM           (2000)
+#endif
+/* Speed of sound in air at 20C in mm/ms (i.e. m/s) */
+#define ECHO_SPEED_OF_SOUND_MM_MS   (343)
+/* Length of the 40kHz burst */
+#define ECHO_BURST_US               (1000)
+
+/* 50 samples at 200kHz = 250us per bin (~8.5cm of round trip) */
+#ifndef ECHO_DETECT_BIN_SIZE
+#define ECHO_DETECT_BIN_SIZE        (50)
+#endif
+/* Most bins in one ADC buffer */
+#ifndef ECHO_DETECT_MAX_BINS
+#define ECHO_DETECT_MAX_BINS        (10)
+#endif
+
+/* Sample the 40kHz channel at 32kHz so the carrier aliases to an 8kHz IF
+ * (bandpass sampling, see bandpass.h) instead of oversampling it at
+ * 200kHz. Bins stay 250us long, with 8 samples instead of 50. Replaces the
+ * bin energy detector and the matched filter; the echo time is reported to
+ * the bin. */
+//#define ECHO_BANDPASS_SAMPLING
+
+#ifdef ECHO_BANDPASS_SAMPLING
+#define ECHO_SAMPLE_RATE_HZ         (BANDPASS_SAMPLE_RATE_HZ)
+#define ECHO_BIN_SIZE               (8)
+#else
+#define ECHO_SAMPLE_RATE_HZ         (200000)
+#define ECHO_BIN_SIZE               (ECHO_DETECT_BIN_SIZE)
+#endif // ECHO_BANDPASS_SAMPLING
+/* Bin length in microseconds */
+#define ECHO_BIN_US     (ECHO_BIN_SIZE * 1000 / (ECHO_SAMPLE_RATE_HZ / 1000))
+/* Buffers in a listen window; the window is split evenly over them */
+#define ECHO_WINDOW_BUFFERS         (4)
+
+/* One-way time of flight to rangeMm, rounded up to the next microsecond */
+#define ECHO_TOF_US(rangeMm) \
+    (((rangeMm) * 1000 + ECHO_SPEED_OF_SOUND_MM_MS - 1) / \
+     ECHO_SPEED_OF_SOUND_MM_MS)
+/* Samples in us microseconds, rounded up */
+#define ECHO_US_TO_SAMPLES(us) \
+    (((us) * (ECHO_SAMPLE_RATE_HZ / 1000) + 999) / 1000)
+/* Bin holding the first sample of an echo from rangeMm */
+#define ECHO_LAST_BIN(rangeMm) \
+    (ECHO_US_TO_SAMPLES(ECHO_TOF_US(rangeMm)) / ECHO_BIN_SIZE)
+/* Bins to listen for: up to the last bin and one whole burst after it */
+#define ECHO_LISTEN_BINS(rangeMm) \
+    (ECHO_LAST_BIN(rangeMm) + 1 + \
+     (ECHO_US_TO_SAMPLES(ECHO_BURST_US) + ECHO_BIN_SIZE - 1) / \
+     ECHO_BIN_SIZE)
+/* Bins in each of the ECHO_WINDOW_BUFFERS ADC buffers */
+#define ECHO_BUFFER_BINS(rangeMm) \
+    ((ECHO_LISTEN_BINS(rangeMm) + ECHO_WINDOW_BUFFERS - 1) / \
+     ECHO_WINDOW_BUFFERS)
+
+/* Geometry for ECHO_MAX_RANGE_MM: 2m gives bins 0..23 (6ms) and a window
+ * of 4 x 350 samples (7ms), or 4 x 56 with ECHO_BANDPASS_SAMPLING */
+#define ECHO_MAX_BIN            ECHO_LAST_BIN(ECHO_MAX_RANGE_MM)
+#define ECHO_BUFFER_SAMPLES \
+    (ECHO_BUFFER_BINS(ECHO_MAX_RANGE_MM) * ECHO_BIN_SIZE)
+#define ECHO_WINDOW_SAMPLES     (ECHO_WINDOW_BUFFERS * ECHO_BUFFER_SAMPLES)
+
+#if ECHO_BUFFER_BINS(ECHO_MAX_RANGE_MM) > ECHO_DETECT_MAX_BINS
+#error "ECHO_MAX_RANGE_MM needs more bins per buffer than ECHO_DETECT_MAX_BINS"
+#endif
+
+/***** Echo detection *****/
+/* Buzzer goes high when a bin stands out from the running noise floor by
+ * ECHO_CFAR_SCALE_Q4 / 16 median absolute deviations (CFAR threshold)... */
+#define ECHO_CFAR_SCALE_Q4       (96)
+/* Noise floor estimates move by 1/64 of the spread per bin */
+#define ECHO_CFAR_AVERAGE_SHIFT  (6)
+
+/* Use the 40kHz tone power of each bin (Goertzel) instead of the broadband
+ * bin energy for the buzzer decision */
+//#define ECHO_DETECT_TONE
+
+/* Use the rectified envelope of the ADC codes instead of the bins. It gives
+ * the crossing to the sample, only range-checks quiet stretches and stops
+ * working on a buffer as soon as the echo is confirmed. */
+//#define ECHO_DETECT_ENVELOPE
+/* Envelope level above the DC level that counts as an echo, converted to
+ * ADC codes with ECHO_UV_TO_CODES... */
+#define ECHO_ENVELOPE_THRESHOLD_UV   (10000)
+/* ...and how long it has to stay there (5 carrier periods) */
+#define ECHO_ENVELOPE_CONFIRM        (25)
+
+/* Adjusted ADC codes convert to microvolts with the fixed 4.3V full scale
+ * (input scaling on), so levels can be converted to codes at compile time
+ * (nearest code) */
+#define ECHO_ADC_FULL_SCALE_UV   (4300000)
+#define ECHO_UV_TO_CODES(uv) \
+    ((uint32_t)(((uint64_t)(uv) * 4095 + ECHO_ADC_FULL_SCALE_UV / 2) / \
+                ECHO_ADC_FULL_SCALE_UV))
+
+#if defined(ECHO_DETECT_TONE)
+/* Smallest echo: a 40kHz carrier of 2 ADC codes above the noise floor */
+#define ECHO_CFAR_MIN_MARGIN     GOERTZEL_TONE_POWER(2, ECHO_DETECT_BIN_SIZE)
+#elif defined(ECHO_BANDPASS_SAMPLING)
+/* Same for the 8kHz alias of the carrier */
+#define ECHO_CFAR_MIN_MARGIN     BANDPASS_TONE_POWER(2, ECHO_BIN_SIZE)
+#else
+/* Smallest echo: 2mV on the mean of a bin above the noise floor (bin
+ * energies are in ADC codes) */
+#define ECHO_CFAR_MIN_MARGIN_UV  (2000 * ECHO_DETECT_BIN_SIZE)
+#define ECHO_CFAR_MIN_MARGIN     ECHO_UV_TO_CODES(ECHO_CFAR_MIN_MARGIN_UV)
+/* Fixed echo level of each side: the mean sample of a bin also has to be
+ * above it, whatever the noise floor (the original firmwares' only test:
+ * 50000 and 15000 on a tenth of the bin mean). The initiator hears its own
+ * burst ringing in the transducer and needs the higher one. Compiled into
+ * the bin detector (echoDetectTemplate.h) of each firmware. */
+#define ECHO_TX_ECHO_LEVEL_UV    (500000)
+#define ECHO_RX_ECHO_LEVEL_UV    (150000)
+#endif // ECHO_DETECT_TONE
+
+/* The 32-bit CFAR (cfar.h) tracks bin energies exactly; tone powers of
+ * strong echoes saturate its estimates */
+#if !defined(ECHO_DETECT_TONE) && !defined(ECHO_BANDPASS_SAMPLING) && \
+    ECHO_DETECT_BIN_SIZE * 4095 > CFAR_MAX_VALUE
+#error "Bin energies of ECHO_DETECT_BIN_SIZE exceed CFAR_MAX_VALUE"
+#endif
+
+#if defined(ECHO_BANDPASS_SAMPLING) && \
+    (defined(ECHO_DETECT_TONE) || defined(ECHO_DETECT_ENVELOPE))
+#error "ECHO_BANDPASS_SAMPLING has its own detector; it needs 200kHz for the others"
+#endif
+
+/***** Telemetry *****/
+/* Send the codes of the telemetry frame delta coded (deltaCodec.h) instead
+ * of raw; comment out for raw TELEMETRY_TYPE_ECHO_REPORT frames */
+#define ECHO_TELEMETRY_DELTA
+
+/* Start in summary mode (telemetryMode.h): a fixed-size cycle summary every
+ * listen window, and the report with codes only every
+ * ECHO_TELEMETRY_RAW_EVERY windows or after an anomaly. Comment out to
+ * start with the report and codes every window. The host can switch at run
+ * time either way (host/telemetrySetMode.c). */
+//#define ECHO_TELEMETRY_SUMMARY
+#define ECHO_TELEMETRY_RAW_EVERY    (64)
+
+/***** Radio *****/
+/* Responder: chain the echo TX to the RX command in the RF core, which
+ * starts it ECHO_RF_TURNAROUND_US after the end of the received packet,
+ * instead of returning to the task and re-arming the TX at the packet time
+ * stamp plus 100ms. The turnaround then no longer depends on task
+ * scheduling; the radio trace has the packet time stamp and the end of the
+ * echo (host/radioTraceHist.c). */
+//#define ECHO_RF_CHAINED_ECHO
+/* Leaves the initiator time to switch its chained RX on */
+#define ECHO_RF_TURNAROUND_US       (500)
+/* Initiator's ID in its ranging packets (rangingPacket.h); the responder
+ * echoes it back */
+#define ECHO_DEVICE_ID              (1)
+/* Responder: the initiator it answers. Its RX command checks the first
+ * byte of every packet against this ID and the RF core drops the others
+ * before the echo, so the responders of other pairs in range neither echo
+ * a packet that is not theirs nor start a listen window on it */
+#define ECHO_PAIR_ID                (ECHO_DEVICE_ID)
+/* Air time of a packet of n payload bytes (smartrf_settings.c): 4 preamble
+ * bytes, 32-bit sync word, length byte and CRC at 250 kbps, 32us a byte */
+#define ECHO_RF_AIR_US(n)           (((n) + 4 + 4 + 1 + 2) * 32)
+
+/***** Slotted schedule *****/
+/* Several initiators in one space: initiators range in their own slot of a
+ * frame that starts with a beacon from initiator 0 (tdmaSchedule.h)
+ * instead of every second on their own clock, so the RF packets and bursts
+ * of different pairs do not overlap. Give every initiator its own
+ * ECHO_DEVICE_ID below ECHO_TDMA_SLOTS, one of them 0, and its responder
+ * that ID as ECHO_PAIR_ID: every responder hears every slot, and without
+ * its address filter would echo the other pairs' packets too (collisions
+ * on air, bursts in the wrong listen windows; host/tdmaSim.c). Responders
+ * also need ECHO_RF_CHAINED_ECHO for a turnaround that fits the slot. */
+//#define ECHO_TDMA
+/* Slots per frame */
+#define ECHO_TDMA_SLOTS             (16)
+/* Quiet time at the end of every slot for the bursts to die down: sound
+ * from a pair about 3.5m farther away than ECHO_MAX_RANGE_MM is still on
+ * its way */
+#define ECHO_TDMA_GUARD_US          (10000)
+/* Listen window length */
+#define ECHO_WINDOW_US \
+    (ECHO_WINDOW_SAMPLES * 1000 / (ECHO_SAMPLE_RATE_HZ / 1000))
+/* The initiator's RX waits this long for the echo: turnaround, the echo
+ * and a margin for the responder's clock */
+#define ECHO_TDMA_ECHO_WAIT_US \
+    (ECHO_RF_TURNAROUND_US + ECHO_RF_AIR_US(RANGING_ECHO_SIZE) + 500)
+/* A slot: the initiator's burst, its packet, the wait for the echo, the
+ * responder's burst and the listen window, then the guard (21.3ms with
+ * the defaults, 0.34s frames with ECHO_TDMA_SLOTS) */
+#define ECHO_TDMA_SLOT_US \
+    (ECHO_BURST_US + ECHO_RF_AIR_US(RANGING_PACKET_SIZE) + \
+     ECHO_TDMA_ECHO_WAIT_US + ECHO_BURST_US + ECHO_WINDOW_US + \
+     ECHO_TDMA_GUARD_US)
+
+#if defined(ECHO_TDMA) && !defined(ECHO_RF_CHAINED_ECHO)
+#error "ECHO_TDMA needs the fixed turnaround of ECHO_RF_CHAINED_ECHO"
+#endif
+
+/***** Listen before talk *****/
+/* Initiators sense the channel (CMD_PROP_CS) before every burst and back
+ * off for a random, exponentially growing time while it is busy
+ * (csmaBackoff.h), instead of sending blindly once a second. The sense is
+ * chained ahead of the TX in the RF core, which sends the packet a burst
+ * after a clear sense without waiting for the CPU. Only the RF of another
+ * pair's exchange can be sensed, so a short sense misses the exchanges that
+ * are past their packet and echo; an exchange without a valid echo moves
+ * the initiator's next cycle by a random backoff instead, so that pairs
+ * settle on phases of the 1s cycle that do not overlap. Meant for up to
+ * about 20 pairs in earshot (csmaSim: under 5% of the exchanges collide);
+ * ECHO_TDMA for more. */
+//#define ECHO_LBT
+/* RSSI at or above this is a busy channel */
+#define ECHO_LBT_RSSI_DBM           (-90)
+/* A few RSSI samples, as long as a ranging packet: long enough to catch a
+ * packet or echo already on the air */
+#define ECHO_LBT_SENSE_US           (ECHO_RF_AIR_US(RANGING_PACKET_SIZE))
+/* From posting the sense to its start, and from the end of the burst to the
+ * packet */
+#define ECHO_LBT_MARGIN_US          (100)
+/* Backoff unit, about one exchange; the window doubles up to
+ * 2^ECHO_LBT_MAX_EXPONENT units, and the cycle is given up after
+ * ECHO_LBT_MAX_ATTEMPTS backoffs. A collision moves the next cycle by 1 ..
+ * 2^ECHO_LBT_MAX_EXPONENT units. */
+#define ECHO_LBT_BACKOFF_US         (20000)
+#define ECHO_LBT_MAX_EXPONENT       (5)
+#define ECHO_LBT_MAX_ATTEMPTS       (6)
+
+#if defined(ECHO_LBT) && defined(ECHO_TDMA)
+#error "ECHO_LBT and ECHO_TDMA are alternatives"
+#endif
+#if (ECHO_LBT_BACKOFF_US << ECHO_LBT_MAX_EXPONENT) >= 1000000
+#error "Longest backoff has to be below a second (usleep)"
+#endif
+
+#endif /* ECHO_CONFIG_H */
@@ -0,0 +1,323 @@
+/*
+ *  ======== bandpassSim.c ========
+ *  Host simulation of the bandpass sampling mode (ECHO_BANDPASS_SAMPLING):
+ *  the 40kHz channel sampled at 32kHz and detected on its 8kHz alias
+ *  (bandpass.c), against 200kHz sampling with the 40kHz Goertzel detector
+ *  (goertzel.c), over the same range-gated listen window.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o bandpassSim host/bandpassSim.c \
+ *        host/echoSynth.c rfEchoTxFinal/bandpass.c rfEchoTxFinal/goertzel.c -lm
+ *
+ *  Both rates sample the same receiver output: the DC bias, an echo burst
+ *  starting anywhere up to the range cutoff, front-end noise and ADC noise.
+ *  Front-end noise is either narrowband (38-42kHz, what a resonant
+ *  transducer passes) or white up to 100kHz, the worst case for
+ *  undersampling since all of it folds into the 0-16kHz band. The statistic
+ *  is the largest bin power up to ECHO_MAX_BIN; its threshold is set for a
+ *  1% false alarm rate per window on echo-free windows.
+ *
+ *  Exits with 1 if the bandpass detector loses more than 5 points of
+ *  detection rate against 200kHz in a scenario marked as required.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bandpass.h"
+#include "echoConfig.h"
+#include "echoSynth.h"
+#include "goertzel.h"
+#include "hostCycles.h"
+
+#define FULL_RATE_HZ        (200000)
+#define FULL_BIN_SIZE       (50)
+#define BANDPASS_BIN_SIZE   (8)
+
+/* Listen window and cutoff of the range gate (250us bins at both rates) */
+#define WINDOW_US           (ECHO_WINDOW_SAMPLES * 1000 / (ECHO_SAMPLE_RATE_HZ / 1000))
+#define FULL_SAMPLES        (WINDOW_US * (FULL_RATE_HZ / 1000) / 1000)
+#define BANDPASS_SAMPLES    (WINDOW_US * (BANDPASS_SAMPLE_RATE_HZ / 1000) / 1000)
+#define NUM_BINS            (FULL_SAMPLES / FULL_BIN_SIZE)
+
+#define NUM_TRIALS          (2000)
+#define NUM_TONES           (16)
+#define NUM_REPEATS         (2000)
+
+typedef struct Scenario {
+    const char *name;
+    uint32_t    narrowbandUv;   /* RMS of the 38-42kHz front-end noise */
+    uint32_t    whiteUv;        /* RMS of the white noise */
+    uint32_t    interferenceUv; /* Peak of a 5kHz interferer */
+    bool        required;       /* Bandpass has to keep up with 200kHz */
+} Scenario;
+
+static const Scenario scenarios[] = {
+    { "narrowband",   4000,  1000,      0, true  },
+    { "narrowband+",  8000,  1000,      0, true  },
+    { "white",           0,  4000,      0, false },
+    { "5kHz audio",   4000,  1000, 200000, false },
+};
+#define NUM_SCENARIOS   (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static const uint32_t echoUv[] = { 4000, 8000, 16000, 32000 };
+#define NUM_ECHOES      (sizeof(echoUv) / sizeof(echoUv[0]))
+
+/* Narrowband front-end noise as a sum of random tones in 38-42kHz, so both
+ * rates can sample the same waveform */
+typedef struct Tones {
+    double hz[NUM_TONES];
+    double phase[NUM_TONES];
+    double amplitude;
+} Tones;
+
+static volatile uint32_t sink;
+
+/*
+ *  ======== compareUint32 ========
+ */
+static int compareUint32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return ((x > y) - (x < y));
+}
+
+/*
+ *  ======== makeTones ========
+ */
+static void makeTones(Tones *tones, uint32_t rmsUv, uint32_t *seed)
+{
+    int k;
+
+    for (k = 0; k < NUM_TONES; k++) {
+        tones->hz[k] = 38000.0 + 4000.0 * EchoSynth_uniform(seed);
+        tones->phase[k] = 2.0 * M_PI * EchoSynth_uniform(seed);
+    }
+    tones->amplitude = rmsUv * sqrt(2.0 / NUM_TONES);
+}
+
+/*
+ *  ======== sample ========
+ *  ADC codes of one listen window at sampleRateHz. The echo starts at
+ *  echoStartUs (no echo if echo is 0).
+ */
+static void sample(const Scenario *scenario, const Tones *tones,
+                   uint32_t echo, double echoStartUs, uint32_t sampleRateHz,
+                   uint32_t *seed, uint16_t *codes, uint32_t numSamples)
+{
+    static uint32_t microVolts[FULL_SAMPLES];
+    EchoSynth_Params params;
+    uint32_t n;
+    int k;
+
+    EchoSynth_Params_init(&params);
+    params.sampleRateHz = sampleRateHz;
+    params.biasUv = 1000000;
+    params.noiseUv = scenario->whiteUv;
+    params.interferenceHz = 5000;
+    params.interferenceUv = scenario->interferenceUv;
+    params.rampUs = 200;
+    params.echoUv = echo;
+    params.echoStart = echoStartUs * 1e-6 * sampleRateHz;
+    EchoSynth_microVolts(&params, seed, microVolts, numSamples);
+
+    for (n = 0; n < numSamples; n++) {
+        double t = (double)n / sampleRateHz;
+        double v = microVolts[n];
+
+        for (k = 0; k < NUM_TONES; k++) {
+            v += tones->amplitude * sin(2.0 * M_PI * tones->hz[k] * t +
+                                        tones->phase[k]);
+        }
+        codes[n] = EchoSynth_microVoltsToCode(v < 0.0 ? 0 : (uint32_t)v);
+    }
+}
+
+/*
+ *  ======== peakFull ========
+ *  Largest 200kHz Goertzel bin power up to ECHO_MAX_BIN.
+ */
+static uint32_t peakFull(const uint16_t *codes)
+{
+    uint32_t powers[NUM_BINS];
+    Goertzel_Object goertzel;
+    uint32_t peak = 0;
+    uint16_t numBins;
+    uint16_t i;
+
+    Goertzel_init(&goertzel, FULL_BIN_SIZE);
+    numBins = Goertzel_process(&goertzel, codes, FULL_SAMPLES, powers,
+                               NUM_BINS);
+    for (i = 0; i < numBins && i <= ECHO_MAX_BIN; i++) {
+        if (powers[i] > peak) {
+            peak = powers[i];
+        }
+    }
+
+    return (peak);
+}
+
+/*
+ *  ======== peakBandpass ========
+ *  Largest 32kHz bandpass bin power up to ECHO_MAX_BIN.
+ */
+static uint32_t peakBandpass(const uint16_t *codes)
+{
+    uint32_t powers[NUM_BINS];
+    uint32_t peak = 0;
+    uint16_t numBins;
+    uint16_t i;
+
+    numBins = Bandpass_process(codes, BANDPASS_SAMPLES, BANDPASS_BIN_SIZE,
+                               powers, NUM_BINS);
+    for (i = 0; i < numBins && i <= ECHO_MAX_BIN; i++) {
+        if (powers[i] > peak) {
+            peak = powers[i];
+        }
+    }
+
+    return (peak);
+}
+
+/*
+ *  ======== detection ========
+ *  Detection rate at 1% false alarms of both rates; returns false if a
+ *  required scenario lost more than 5 points.
+ */
+static bool detection(const Scenario *scenario)
+{
+    static uint16_t full[FULL_SAMPLES];
+    static uint16_t bandpass[BANDPASS_SAMPLES];
+    static uint32_t noiseFull[NUM_TRIALS];
+    static uint32_t noiseBandpass[NUM_TRIALS];
+    uint32_t fullThreshold;
+    uint32_t bandpassThreshold;
+    uint32_t seed = 0xC0FFEE;
+    bool ok = true;
+    Tones tones;
+    int trial;
+    size_t e;
+
+    for (trial = 0; trial < NUM_TRIALS; trial++) {
+        makeTones(&tones, scenario->narrowbandUv, &seed);
+        sample(scenario, &tones, 0, 0.0, FULL_RATE_HZ, &seed, full,
+               FULL_SAMPLES);
+        sample(scenario, &tones, 0, 0.0, BANDPASS_SAMPLE_RATE_HZ, &seed,
+               bandpass, BANDPASS_SAMPLES);
+        noiseFull[trial] = peakFull(full);
+        noiseBandpass[trial] = peakBandpass(bandpass);
+    }
+    qsort(noiseFull, NUM_TRIALS, sizeof(uint32_t), compareUint32);
+    qsort(noiseBandpass, NUM_TRIALS, sizeof(uint32_t), compareUint32);
+    fullThreshold = noiseFull[NUM_TRIALS * 99 / 100];
+    bandpassThreshold = noiseBandpass[NUM_TRIALS * 99 / 100];
+
+    for (e = 0; e < NUM_ECHOES; e++) {
+        int fullHits = 0;
+        int bandpassHits = 0;
+        double fullRate;
+        double bandpassRate;
+
+        for (trial = 0; trial < NUM_TRIALS; trial++) {
+            double startUs = EchoSynth_uniform(&seed) *
+                ECHO_TOF_US(ECHO_MAX_RANGE_MM);
+
+            makeTones(&tones, scenario->narrowbandUv, &seed);
+            sample(scenario, &tones, echoUv[e], startUs, FULL_RATE_HZ, &seed,
+                   full, FULL_SAMPLES);
+            sample(scenario, &tones, echoUv[e], startUs,
+                   BANDPASS_SAMPLE_RATE_HZ, &seed, bandpass,
+                   BANDPASS_SAMPLES);
+            fullHits += peakFull(full) > fullThreshold;
+            bandpassHits += peakBandpass(bandpass) > bandpassThreshold;
+        }
+
+        fullRate = 100.0 * fullHits / NUM_TRIALS;
+        bandpassRate = 100.0 * bandpassHits / NUM_TRIALS;
+        if (scenario->required && bandpassRate < fullRate - 5.0) {
+            ok = false;
+        }
+        printf("%-12s %7u %7u %7u %6u uV %9.1f%% %9.1f%%%s\n",
+               scenario->name, scenario->narrowbandUv, scenario->whiteUv,
+               scenario->interferenceUv, echoUv[e], fullRate, bandpassRate,
+               (scenario->required && bandpassRate < fullRate - 5.0) ?
+                   "  FAIL" : "");
+    }
+
+    return (ok);
+}
+
+/*
+ *  ======== cost ========
+ *  Cycles per listen window of each detector.
+ */
+static void cost(void)
+{
+    static uint16_t full[FULL_SAMPLES];
+    static uint16_t bandpass[BANDPASS_SAMPLES];
+    const Scenario *scenario = &scenarios[0];
+    uint32_t seed = 11;
+    uint64_t fullCycles;
+    uint64_t bandpassCycles;
+    uint64_t start;
+    Tones tones;
+    int rep;
+
+    makeTones(&tones, scenario->narrowbandUv, &seed);
+    sample(scenario, &tones, 8000, 3000.0, FULL_RATE_HZ, &seed, full,
+           FULL_SAMPLES);
+    sample(scenario, &tones, 8000, 3000.0, BANDPASS_SAMPLE_RATE_HZ, &seed,
+           bandpass, BANDPASS_SAMPLES);
+
+    start = HostCycles_now();
+    for (rep = 0; rep < NUM_REPEATS; rep++) {
+        sink += peakFull(full);
+    }
+    fullCycles = HostCycles_now() - start;
+
+    start = HostCycles_now();
+    for (rep = 0; rep < NUM_REPEATS; rep++) {
+        sink += peakBandpass(bandpass);
+    }
+    bandpassCycles = HostCycles_now() - start;
+
+    printf("%-24s %10s %10s\n", "per listen window", "200kHz", "32kHz");
+    printf("%-24s %10u %10u\n", "samples", FULL_SAMPLES, BANDPASS_SAMPLES);
+    printf("%-24s %10u %10u\n", "ADC buffer RAM (bytes)",
+           2 * FULL_SAMPLES / ECHO_WINDOW_BUFFERS *
+               (uint32_t)sizeof(uint16_t),
+           2 * BANDPASS_SAMPLES / ECHO_WINDOW_BUFFERS *
+               (uint32_t)sizeof(uint16_t));
+    printf("%-24s %10.0f %10.0f\n", "detector " HOST_CYCLES_UNIT,
+           (double)fullCycles / NUM_REPEATS,
+           (double)bandpassCycles / NUM_REPEATS);
+}
+
+int main(void)
+{
+    bool ok = true;
+    size_t s;
+
+    cost();
+
+    printf("\ndetection rate at 1%% false alarms per %u us window, "
+           "echo within %u bins\n", WINDOW_US, ECHO_MAX_BIN + 1);
+    printf("%-12s %7s %7s %7s %9s %10s %10s\n", "scenario", "nb uV",
+           "white", "5kHz", "echo", "200kHz", "32kHz");
+    for (s = 0; s < NUM_SCENARIOS; s++) {
+        ok = detection(&scenarios[s]) && ok;
+    }
+
+    if (!ok) {
+        printf("bandpass sampling lost detections\n");
+        return (1);
+    }
+
+    return (0);
+}
@@ -0,0 +1,185 @@
+/*
+ *  ======== bufferQueueStress.c ========
+ *  Host stress test of the lock-free SPSC buffer queue (bufferQueue.c)
+ *  with the producer and the consumer on separate threads.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -pthread -Ihost -IrfEchoTxFinal -o bufferQueueStress \
+ *        host/bufferQueueStress.c rfEchoTxFinal/bufferQueue.c
+ *
+ *  Usage: bufferQueueStress [handoffs]
+ *
+ *  Works like the firmware: the producer (adcBufCallback) fills a sample
+ *  buffer and puts it in one queue, the consumer (analysisThread) takes it,
+ *  checks it and returns it through a second queue. Every handoff carries
+ *  a sequence number in the entry fields and in every sample of the
+ *  buffer. The consumer fails the test on any torn entry (fields from
+ *  different handoffs), any buffer whose samples do not match its entry
+ *  (contents not yet visible or overwritten), and any lost, repeated or
+ *  reordered handoff. Exits with 1 on a failure.
+ *
+ *  Both threads yield when they have to wait, so the test also interleaves
+ *  on a single core (like the firmware, where the callback preempts the
+ *  task); with more cores they run truly in parallel.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bufferQueue.h"
+#include "hostCycles.h"
+
+#define BUFFER_SAMPLES      (350)
+#define NUM_BUFFERS         (BUFFER_QUEUE_LENGTH)
+
+static uint16_t buffers[NUM_BUFFERS][BUFFER_SAMPLES];
+
+static BufferQueue_Object filledBuffers;   /* Producer -> consumer */
+static BufferQueue_Object freeBuffers;     /* Consumer -> producer */
+
+static uint32_t numHandoffs = 5000000;
+
+typedef struct Counters {
+    uint64_t fullRetries;       /* Producer found the queue full */
+    uint64_t emptyPolls;        /* Consumer found the queue empty */
+    uint64_t torn;
+    uint64_t badSamples;
+    uint64_t outOfOrder;
+} Counters;
+
+static Counters producerCounters;
+static Counters consumerCounters;
+
+/*
+ *  ======== producer ========
+ */
+static void *producer(void *arg)
+{
+    BufferQueue_Entry entry;
+    uint32_t seq;
+    int i;
+
+    (void)arg;
+
+    for (seq = 0; seq < numHandoffs; seq++) {
+        while (!BufferQueue_get(&freeBuffers, &entry)) {
+            sched_yield();
+        }
+
+        /* Sequence number in the samples and spread over the fields */
+        for (i = 0; i < BUFFER_SAMPLES; i++) {
+            entry.samples[i] = (uint16_t)(seq + i);
+        }
+        entry.position = (uint16_t)seq;
+        entry.window = (uint16_t)(seq >> 16) ^
+            (uint16_t)(entry.samples - buffers[0]);
+
+        while (!BufferQueue_put(&filledBuffers, &entry)) {
+            producerCounters.fullRetries++;
+            sched_yield();
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== consumer ========
+ */
+static void *consumer(void *arg)
+{
+    BufferQueue_Entry entry;
+    uint32_t expected = 0;
+    uint32_t seq;
+    int i;
+
+    (void)arg;
+
+    while (expected < numHandoffs) {
+        if (!BufferQueue_get(&filledBuffers, &entry)) {
+            consumerCounters.emptyPolls++;
+            sched_yield();
+            continue;
+        }
+
+        seq = entry.position | ((uint32_t)(entry.window ^
+            (uint16_t)(entry.samples - buffers[0])) << 16);
+        if ((uint16_t)seq != entry.samples[0]) {
+            consumerCounters.torn++;
+        }
+        for (i = 0; i < BUFFER_SAMPLES; i++) {
+            if (entry.samples[i] != (uint16_t)(seq + i)) {
+                consumerCounters.badSamples++;
+                break;
+            }
+        }
+        if (seq != expected) {
+            consumerCounters.outOfOrder++;
+        }
+        expected = seq + 1;
+
+        /* The free queue holds every buffer at most once, never full */
+        BufferQueue_put(&freeBuffers, &entry);
+    }
+
+    return (NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    BufferQueue_Entry entry;
+    pthread_t producerThread;
+    pthread_t consumerThread;
+    double seconds;
+    int b;
+
+    if (argc > 1) {
+        numHandoffs = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+    BufferQueue_init(&filledBuffers);
+    BufferQueue_init(&freeBuffers);
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        entry.samples = buffers[b];
+        entry.position = 0;
+        entry.window = 0;
+        BufferQueue_put(&freeBuffers, &entry);
+    }
+
+    seconds = HostCycles_seconds();
+    if (pthread_create(&consumerThread, NULL, consumer, NULL) != 0 ||
+        pthread_create(&producerThread, NULL, producer, NULL) != 0) {
+        printf("pthread_create failed\n");
+        return (1);
+    }
+    pthread_join(producerThread, NULL);
+    pthread_join(consumerThread, NULL);
+    seconds = HostCycles_seconds() - seconds;
+
+    printf("handoffs          %u of %u-sample buffers in %.2f s "
+           "(%.1f M/s)\n", numHandoffs, BUFFER_SAMPLES, seconds,
+           numHandoffs / seconds * 1e-6);
+    printf("queue full        %llu producer retries\n",
+           (unsigned long long)producerCounters.fullRetries);
+    printf("queue empty       %llu consumer polls\n",
+           (unsigned long long)consumerCounters.emptyPolls);
+    printf("torn entries      %llu\n",
+           (unsigned long long)consumerCounters.torn);
+    printf("bad buffers       %llu\n",
+           (unsigned long long)consumerCounters.badSamples);
+    printf("lost / reordered  %llu\n",
+           (unsigned long long)consumerCounters.outOfOrder);
+
+    if (consumerCounters.torn != 0 || consumerCounters.badSamples != 0 ||
+        consumerCounters.outOfOrder != 0) {
+        printf("FAIL\n");
+        return (1);
+    }
+    printf("OK\n");
+
+    return (0);
+}
@@ -0,0 +1,97 @@
+/*
+ *  ======== captureFile.c ========
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "captureFile.h"
+
+/*
+ *  ======== parseLine ========
+ *  Parses up to max comma separated values, returns how many were found.
+ */
+static uint32_t parseLine(const char *line, uint32_t *out, uint32_t max)
+{
+    const char *marker = strstr(line, "Microvolts:");
+    const char *p = (marker != NULL) ? marker + strlen("Microvolts:") : line;
+    uint32_t count = 0;
+
+    while (*p != '\0' && count < max) {
+        char *end;
+        unsigned long value;
+
+        while (*p == ' ' || *p == ',' || *p == '\t') {
+            p++;
+        }
+        if (*p < '0' || *p > '9') {
+            break;
+        }
+
+        value = strtoul(p, &end, 10);
+        out[count++] = (uint32_t)value;
+        p = end;
+    }
+
+    return (count);
+}
+
+/*
+ *  ======== CaptureFile_load ========
+ */
+int CaptureFile_load(const char *path, uint32_t samplesPerBuffer,
+                     CaptureFile *capture)
+{
+    FILE *file = fopen(path, "r");
+    char *line = NULL;
+    size_t lineCap = 0;
+    size_t capacity = 0;
+
+    memset(capture, 0, sizeof(*capture));
+    capture->samplesPerBuffer = samplesPerBuffer;
+
+    if (file == NULL) {
+        return (-1);
+    }
+
+    while (getline(&line, &lineCap, file) != -1) {
+        uint32_t count;
+
+        if (capture->numBuffers == capacity) {
+            size_t newCapacity = (capacity == 0) ? 64 : capacity * 2;
+            uint32_t *grown = realloc(capture->samples, newCapacity *
+                samplesPerBuffer * sizeof(uint32_t));
+
+            if (grown == NULL) {
+                break;
+            }
+            capture->samples = grown;
+            capacity = newCapacity;
+        }
+
+        count = parseLine(line, capture->samples +
+            capture->numBuffers * samplesPerBuffer, samplesPerBuffer);
+
+        if (count == samplesPerBuffer) {
+            capture->numBuffers++;
+        }
+        else if (count != 0) {
+            capture->numSkipped++;
+        }
+    }
+
+    free(line);
+    fclose(file);
+
+    return (0);
+}
+
+/*
+ *  ======== CaptureFile_free ========
+ */
+void CaptureFile_free(CaptureFile *capture)
+{
+    free(capture->samples);
+    memset(capture, 0, sizeof(*capture));
+}
@@ -0,0 +1,30 @@
+/*
+ *  ======== captureFile.h ========
+ *  Loader for ADC buffers captured from the firmware's UART output.
+ *
+ *  Each "Microvolts: v0,v1,...," dump (or a bare line of comma separated
+ *  values) becomes one buffer. Dumps with fewer than samplesPerBuffer values,
+ *  such as the ones truncated by the 500-byte uartTxBuffer, are skipped and
+ *  counted in numSkipped.
+ */
+
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct CaptureFile {
+    uint32_t *samples;          /* numBuffers * samplesPerBuffer microvolts */
+    size_t    numBuffers;
+    size_t    numSkipped;
+    uint32_t  samplesPerBuffer;
+} CaptureFile;
+
+/* Returns 0 on success, -1 if the file cannot be read */
+extern int CaptureFile_load(const char *path, uint32_t samplesPerBuffer,
+                            CaptureFile *capture);
+
+extern void CaptureFile_free(CaptureFile *capture);
+
+#endif /* CAPTURE_FILE_H */
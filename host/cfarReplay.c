@@ -0,0 +1,372 @@
+/*
+ *  ======== cfarReplay.c ========
+ *  Replays ADC buffers through the code-domain bin energy kernel and the
+ *  CFAR threshold (cfar.c) the way adcBufCallback runs them, and compares
+ *  the result with the old fixed 50000uV / 15000uV thresholds of rfEchoTx.c
+ *  / rfEchoRx.c.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o cfarReplay host/cfarReplay.c \
+ *        host/echoSynth.c host/captureFile.c rfEchoTxFinal/cfar.c \
+ *        host/echoDetect.c -lm
+ *
+ *  Usage: cfarReplay [capture.txt]
+ *  With a capture file the buffers are replayed in order and the number of
+ *  buffers each detector flags is printed. Without one, synthetic "rooms"
+ *  with different bias and noise levels are replayed back to back (an echo
+ *  in every other buffer) and the detection / false alarm rate of each
+ *  detector is printed per room. Runtime per buffer is printed in both
+ *  cases.
+ *
+ *  Every bin also goes through a copy of the former int64_t Cfar_update,
+ *  and so does a sweep of tone powers up to CFAR_MAX_VALUE (with echoes
+ *  beyond it): the 32-bit cfar.c has to give the same threshold and
+ *  decision on each bin, apart from the bins where the deviation saturates
+ *  (counted and printed). Exits with 1 on a mismatch.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "captureFile.h"
+#include "cfar.h"
+#include "echoConfig.h"
+#include "echoDetect.h"
+#include "echoSynth.h"
+#include "goertzel.h"
+#include "hostCycles.h"
+
+#define ADCBUFFERSIZE       (500)
+#define BUFFERS_PER_ROOM    (4000)
+#define SWEEP_BINS          (200000)
+
+/* Former fixed thresholds of rfEchoTx.c and rfEchoRx.c */
+static const uint32_t thresholds[] = { 50000, 15000 };
+#define NUM_FIXED   (sizeof(thresholds) / sizeof(thresholds[0]))
+
+typedef struct Room {
+    const char *name;
+    uint32_t    biasUv;
+    uint32_t    noiseUv;
+    uint32_t    echoUv;
+} Room;
+
+static const Room rooms[] = {
+    { "quiet",        0,  2000,  20000 },
+    { "noisy",        0, 20000,  80000 },
+    { "biased",   30000,  5000, 100000 },
+    { "quiet again",  0,  2000,  20000 },
+};
+
+typedef struct Counts {
+    unsigned int cfar;
+    unsigned int fixed[NUM_FIXED];
+} Counts;
+
+/* State of the former int64_t Cfar_update, the bit-exact reference */
+typedef struct Cfar64 {
+    int64_t  floor;
+    int64_t  deviation;
+    uint32_t threshold;
+    uint16_t training;
+    bool     started;
+} Cfar64;
+
+typedef struct Exactness {
+    unsigned long bins;
+    unsigned long saturated;
+    unsigned long mismatches;
+} Exactness;
+
+static Cfar_Object cfar;
+static Cfar64 reference;
+static Exactness exactness;
+static uint64_t kernelCycles;
+static uint64_t cfarCycles;
+static unsigned long numProcessed;
+
+/*
+ *  ======== cfar64Init ========
+ */
+static void cfar64Init(Cfar64 *ref, const Cfar_Object *cfar)
+{
+    ref->floor = 0;
+    ref->deviation = 0;
+    ref->threshold = UINT32_MAX;
+    ref->training = cfar->training;
+    ref->started = false;
+}
+
+/*
+ *  ======== cfar64Update ========
+ *  Cfar_update as it was with int64_t estimates, with the parameters of
+ *  cfar.
+ */
+static bool cfar64Update(Cfar64 *ref, const Cfar_Object *cfar,
+                         uint32_t value)
+{
+    int64_t sample = (int64_t)value << CFAR_FRAC_BITS;
+    int64_t minMargin = (int64_t)cfar->minMargin << CFAR_FRAC_BITS;
+    bool detected = false;
+    int64_t error;
+    int64_t margin;
+    int64_t step;
+    int64_t threshold;
+
+    if (!ref->started) {
+        ref->floor = sample;
+        ref->started = true;
+    }
+
+    if (ref->training != 0) {
+        ref->training--;
+    }
+    else {
+        detected = value > ref->threshold;
+    }
+
+    step = ((ref->deviation > minMargin) ? ref->deviation : minMargin) >>
+        cfar->averageShift;
+    error = sample - ref->floor;
+    if (error > 0) {
+        ref->floor += step;
+    }
+    else if (error < 0) {
+        ref->floor -= step;
+        error = -error;
+    }
+    if (error > ref->deviation) {
+        ref->deviation += step;
+    }
+    else {
+        ref->deviation = (ref->deviation > step) ?
+            ref->deviation - step : 0;
+    }
+
+    margin = (ref->deviation * cfar->scaleQ4) >> 4;
+    if (margin < minMargin) {
+        margin = minMargin;
+    }
+    threshold = (ref->floor + margin) >> CFAR_FRAC_BITS;
+    ref->threshold = (threshold > UINT32_MAX) ?
+        UINT32_MAX : (uint32_t)threshold;
+
+    return (detected);
+}
+
+/*
+ *  ======== compare ========
+ *  Runs value through the reference and checks the decision and the
+ *  threshold cfar gave for it.
+ */
+static void compare(Cfar64 *ref, const Cfar_Object *cfar, uint32_t value,
+                    bool detected, uint32_t threshold)
+{
+    bool expected = cfar64Update(ref, cfar, value);
+
+    exactness.bins++;
+    if (ref->deviation > (int64_t)cfar->maxDeviation) {
+        exactness.saturated++;
+    }
+    else if (detected != expected || threshold != ref->threshold) {
+        exactness.mismatches++;
+    }
+}
+
+/*
+ *  ======== detect ========
+ *  The decisions adcBufCallback makes for one buffer: CFAR on the ADC codes
+ *  and, for comparison, the old fixed thresholds on the microvolt average.
+ */
+static void detect(const uint32_t *microVolts, Counts *counts)
+{
+    uint16_t codes[ADCBUFFERSIZE];
+    EchoDetect_Result result;
+    EchoDetect_Result legacy;
+    bool decisions[ECHO_DETECT_MAX_BINS];
+    uint32_t binThresholds[ECHO_DETECT_MAX_BINS];
+    bool detected = false;
+    uint64_t start;
+    uint64_t middle;
+    uint16_t i;
+    size_t t;
+
+    for (i = 0; i < ADCBUFFERSIZE; i++) {
+        codes[i] = EchoSynth_microVoltsToCode(microVolts[i]);
+    }
+
+    start = HostCycles_now();
+    EchoDetect_processCodes(codes, ADCBUFFERSIZE, &result);
+    middle = HostCycles_now();
+    for (i = 0; i < result.numBins; i++) {
+        decisions[i] = Cfar_update(&cfar, result.binEnergy[i]);
+        binThresholds[i] = cfar.threshold;
+        if (decisions[i] && i <= ECHO_MAX_BIN) {
+            detected = true;
+        }
+    }
+    cfarCycles += HostCycles_now() - middle;
+    kernelCycles += middle - start;
+    numProcessed++;
+
+    for (i = 0; i < result.numBins; i++) {
+        compare(&reference, &cfar, result.binEnergy[i], decisions[i],
+                binThresholds[i]);
+    }
+
+    EchoDetect_processMicroVolts(microVolts, ADCBUFFERSIZE, &legacy);
+    counts->cfar += detected;
+    for (t = 0; t < NUM_FIXED; t++) {
+        counts->fixed[t] += legacy.average > thresholds[t];
+    }
+}
+
+/*
+ *  ======== replayCapture ========
+ */
+static int replayCapture(const char *path)
+{
+    CaptureFile capture;
+    Counts counts = { 0 };
+    size_t b;
+    size_t t;
+
+    if (CaptureFile_load(path, ADCBUFFERSIZE, &capture) != 0) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return (1);
+    }
+
+    for (b = 0; b < capture.numBuffers; b++) {
+        detect(capture.samples + b * ADCBUFFERSIZE, &counts);
+    }
+
+    printf("%zu buffers (%zu skipped)\n", capture.numBuffers,
+           capture.numSkipped);
+    printf("  CFAR          flags %u\n", counts.cfar);
+    for (t = 0; t < NUM_FIXED; t++) {
+        printf("  fixed %6u  flags %u\n", thresholds[t], counts.fixed[t]);
+    }
+
+    CaptureFile_free(&capture);
+
+    return (0);
+}
+
+/*
+ *  ======== replayRooms ========
+ */
+static void replayRooms(void)
+{
+    uint32_t microVolts[ADCBUFFERSIZE];
+    EchoSynth_Params params;
+    uint32_t seed = 0x5EED;
+    size_t r;
+    size_t t;
+    int b;
+
+    printf("%-12s %21s", "room", "CFAR det/false");
+    for (t = 0; t < NUM_FIXED; t++) {
+        printf("   fixed %6u det/false", thresholds[t]);
+    }
+    printf("\n");
+
+    EchoSynth_Params_init(&params);
+    for (r = 0; r < sizeof(rooms) / sizeof(rooms[0]); r++) {
+        Counts hits = { 0 };
+        Counts falseAlarms = { 0 };
+
+        params.biasUv = rooms[r].biasUv;
+        params.noiseUv = rooms[r].noiseUv;
+
+        for (b = 0; b < BUFFERS_PER_ROOM; b++) {
+            bool echo = (b & 1) != 0;
+
+            params.echoUv = echo ? rooms[r].echoUv : 0;
+            params.echoStart = EchoSynth_uniform(&seed) *
+                (ADCBUFFERSIZE - 200);
+            EchoSynth_microVolts(&params, &seed, microVolts, ADCBUFFERSIZE);
+            detect(microVolts, echo ? &hits : &falseAlarms);
+        }
+
+        printf("%-12s %9.1f%% %9.2f%%", rooms[r].name,
+               200.0 * hits.cfar / BUFFERS_PER_ROOM,
+               200.0 * falseAlarms.cfar / BUFFERS_PER_ROOM);
+        for (t = 0; t < NUM_FIXED; t++) {
+            printf("   %12.1f%% %9.2f%%",
+                   200.0 * hits.fixed[t] / BUFFERS_PER_ROOM,
+                   200.0 * falseAlarms.fixed[t] / BUFFERS_PER_ROOM);
+        }
+        printf("\n");
+    }
+}
+
+/*
+ *  ======== sweepTonePowers ========
+ *  Tone powers (ECHO_DETECT_TONE) on a floor rising from 16 to
+ *  CFAR_MAX_VALUE, noise of up to the floor itself, and an echo up to 2^12
+ *  times the floor in every 16th bin.
+ */
+static void sweepTonePowers(void)
+{
+    Cfar_Object tone;
+    Cfar64 ref;
+    uint32_t seed = 0x70E;
+    uint32_t value;
+    double level;
+    bool detected;
+    long b;
+
+    Cfar_init(&tone, ECHO_CFAR_SCALE_Q4, ECHO_CFAR_AVERAGE_SHIFT,
+              GOERTZEL_TONE_POWER(2, ECHO_DETECT_BIN_SIZE));
+    cfar64Init(&ref, &tone);
+
+    for (b = 0; b < SWEEP_BINS; b++) {
+        level = 16.0 * pow(CFAR_MAX_VALUE / 16.0, (double)b / SWEEP_BINS);
+        level *= 1.0 + EchoSynth_uniform(&seed);
+        if ((b & 15) == 0) {
+            level *= 1.0 + 4095.0 * EchoSynth_uniform(&seed);
+        }
+        value = (level < UINT32_MAX) ? (uint32_t)level : UINT32_MAX;
+
+        detected = Cfar_update(&tone, value);
+        compare(&ref, &tone, value, detected, tone.threshold);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int status = 0;
+
+    Cfar_init(&cfar, ECHO_CFAR_SCALE_Q4, ECHO_CFAR_AVERAGE_SHIFT,
+              EchoSynth_microVoltsToCode(ECHO_CFAR_MIN_MARGIN_UV));
+    cfar64Init(&reference, &cfar);
+
+    if (argc > 1) {
+        status = replayCapture(argv[1]);
+    }
+    else {
+        replayRooms();
+    }
+
+    if (numProcessed != 0) {
+        printf("\nruntime per buffer: bin kernel %.1f %s, CFAR %.1f %s\n",
+               (double)kernelCycles / numProcessed, HOST_CYCLES_UNIT,
+               (double)cfarCycles / numProcessed, HOST_CYCLES_UNIT);
+    }
+
+    sweepTonePowers();
+    printf("int64_t reference: %lu bins, %lu saturated, %lu mismatches\n",
+           exactness.bins, exactness.saturated, exactness.mismatches);
+    if (exactness.mismatches != 0) {
+        printf("FAIL: 32-bit CFAR is not bit-exact\n");
+        status = 1;
+    }
+    else {
+        printf("bit-exact\n");
+    }
+
+    return (status);
+}
@@ -0,0 +1,295 @@
+/*
+ *  ======== columnStore.c ========
+ */
+
+/* mremap */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columnStore.h"
+
+/* Rows the files first grow to; they double after that */
+#define FIRST_CAPACITY  (4096)
+
+typedef struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t samplesPerRow;
+    uint32_t reserved2;
+    uint64_t numRows;
+} Header;
+
+typedef struct ColumnInfo {
+    const char *name;
+    size_t      size;           /* Bytes of one entry */
+    size_t      pointer;        /* offsetof the array in ColumnStore */
+    int         perSample;      /* samplesPerRow entries per row */
+} ColumnInfo;
+
+static const ColumnInfo columns[COLUMN_STORE_COLUMNS] = {
+    { "hostTimeNs",       8, offsetof(ColumnStore, hostTimeNs),       0 },
+    { "sequence",         2, offsetof(ColumnStore, sequence),         0 },
+    { "buffersCompleted", 4, offsetof(ColumnStore, buffersCompleted), 0 },
+    { "arrivalUs",        4, offsetof(ColumnStore, arrivalUs),        0 },
+    { "peakValue",        4, offsetof(ColumnStore, peakValue),        0 },
+    { "peakBin",          2, offsetof(ColumnStore, peakBin),          0 },
+    { "flags",            1, offsetof(ColumnStore, flags),            0 },
+    { "numSamples",       2, offsetof(ColumnStore, numSamples),       0 },
+    { "samples",          2, offsetof(ColumnStore, samples),          1 },
+};
+
+/*
+ *  ======== columnBytes ========
+ */
+static size_t columnBytes(const ColumnStore *store, int c, uint64_t rows)
+{
+    return ((size_t)rows * columns[c].size *
+            (columns[c].perSample ? store->samplesPerRow : 1));
+}
+
+/*
+ *  ======== setPointer ========
+ */
+static void setPointer(ColumnStore *store, int c, void *map)
+{
+    memcpy((char *)store + columns[c].pointer, &map, sizeof(map));
+}
+
+/*
+ *  ======== getPointer ========
+ */
+static void *getPointer(const ColumnStore *store, int c)
+{
+    void *map;
+
+    memcpy(&map, (const char *)store + columns[c].pointer, sizeof(map));
+
+    return (map);
+}
+
+/*
+ *  ======== openFiles ========
+ */
+static int openFiles(ColumnStore *store, const char *dir, int flags)
+{
+    char path[PATH_MAX];
+    int c;
+
+    snprintf(path, sizeof(path), "%s/header", dir);
+    store->headerFd = open(path, flags, 0666);
+    if (store->headerFd < 0) {
+        return (-1);
+    }
+
+    for (c = 0; c < COLUMN_STORE_COLUMNS; c++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, columns[c].name);
+        store->fds[c] = open(path, flags, 0666);
+        if (store->fds[c] < 0) {
+            return (-1);
+        }
+    }
+
+    return (0);
+}
+
+/*
+ *  ======== grow ========
+ *  Resizes and remaps every column file for capacity rows.
+ */
+static int grow(ColumnStore *store, uint64_t capacity)
+{
+    int c;
+
+    for (c = 0; c < COLUMN_STORE_COLUMNS; c++) {
+        size_t size = columnBytes(store, c, capacity);
+        void *map = getPointer(store, c);
+
+        if (ftruncate(store->fds[c], (off_t)size) != 0) {
+            return (-1);
+        }
+        map = (map == NULL) ?
+            mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 store->fds[c], 0) :
+            mremap(map, store->mapSizes[c], size, MREMAP_MAYMOVE);
+        if (map == MAP_FAILED) {
+            return (-1);
+        }
+        setPointer(store, c, map);
+        store->mapSizes[c] = size;
+    }
+    store->capacity = capacity;
+
+    return (0);
+}
+
+/*
+ *  ======== ColumnStore_create ========
+ */
+int ColumnStore_create(ColumnStore *store, const char *dir,
+                       uint32_t samplesPerRow)
+{
+    memset(store, 0, sizeof(*store));
+    memset(store->fds, -1, sizeof(store->fds));
+    store->headerFd = -1;
+    store->samplesPerRow = samplesPerRow;
+    store->writable = 1;
+
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        return (-1);
+    }
+    if (openFiles(store, dir, O_RDWR | O_CREAT | O_TRUNC) != 0 ||
+        ColumnStore_sync(store) != 0) {
+        ColumnStore_close(store);
+        return (-1);
+    }
+
+    return (0);
+}
+
+/*
+ *  ======== ColumnStore_open ========
+ */
+int ColumnStore_open(ColumnStore *store, const char *dir)
+{
+    Header header;
+    int c;
+
+    memset(store, 0, sizeof(*store));
+    memset(store->fds, -1, sizeof(store->fds));
+    store->headerFd = -1;
+
+    if (openFiles(store, dir, O_RDONLY) != 0) {
+        ColumnStore_close(store);
+        return (-1);
+    }
+    if (pread(store->headerFd, &header, sizeof(header), 0) !=
+            (ssize_t)sizeof(header) ||
+        header.magic != COLUMN_STORE_MAGIC ||
+        header.version != COLUMN_STORE_VERSION) {
+        ColumnStore_close(store);
+        errno = EINVAL;
+        return (-1);
+    }
+    store->samplesPerRow = header.samplesPerRow;
+    store->numRows = header.numRows;
+
+    for (c = 0; c < COLUMN_STORE_COLUMNS; c++) {
+        size_t size = columnBytes(store, c, store->numRows);
+        struct stat st;
+        void *map;
+
+        if (size == 0) {
+            continue;
+        }
+        if (fstat(store->fds[c], &st) != 0 || (size_t)st.st_size < size) {
+            ColumnStore_close(store);
+            errno = EINVAL;
+            return (-1);
+        }
+        map = mmap(NULL, size, PROT_READ, MAP_SHARED, store->fds[c], 0);
+        if (map == MAP_FAILED) {
+            ColumnStore_close(store);
+            return (-1);
+        }
+        setPointer(store, c, map);
+        store->mapSizes[c] = size;
+    }
+    store->capacity = store->numRows;
+
+    return (0);
+}
+
+/*
+ *  ======== ColumnStore_append ========
+ */
+int ColumnStore_append(ColumnStore *store, const Telemetry_EchoReport *report,
+                       uint16_t sequence, const uint16_t *codes,
+                       uint32_t numCodes, uint64_t hostTimeNs)
+{
+    uint64_t row = store->numRows;
+
+    if (row == store->capacity &&
+        grow(store, store->capacity ? 2 * store->capacity :
+                                      FIRST_CAPACITY) != 0) {
+        return (-1);
+    }
+
+    if (numCodes > store->samplesPerRow) {
+        numCodes = store->samplesPerRow;
+    }
+
+    store->hostTimeNs[row] = hostTimeNs;
+    store->sequence[row] = sequence;
+    store->buffersCompleted[row] = report->buffersCompleted;
+    store->arrivalUs[row] = report->arrivalUs;
+    store->peakValue[row] = report->peakValue;
+    store->peakBin[row] = report->peakBin;
+    store->flags[row] = report->flags;
+    store->numSamples[row] = (uint16_t)numCodes;
+    /* The rest of the row is still zero from growing the file */
+    memcpy(&store->samples[row * store->samplesPerRow], codes,
+           numCodes * sizeof(uint16_t));
+    store->numRows = row + 1;
+
+    return (0);
+}
+
+/*
+ *  ======== ColumnStore_sync ========
+ */
+int ColumnStore_sync(ColumnStore *store)
+{
+    Header header;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = COLUMN_STORE_MAGIC;
+    header.version = COLUMN_STORE_VERSION;
+    header.samplesPerRow = store->samplesPerRow;
+    header.numRows = store->numRows;
+
+    return ((pwrite(store->headerFd, &header, sizeof(header), 0) ==
+             (ssize_t)sizeof(header)) ? 0 : -1);
+}
+
+/*
+ *  ======== ColumnStore_close ========
+ */
+void ColumnStore_close(ColumnStore *store)
+{
+    int c;
+
+    if (store->writable && store->headerFd >= 0) {
+        ColumnStore_sync(store);
+    }
+
+    for (c = 0; c < COLUMN_STORE_COLUMNS; c++) {
+        void *map = getPointer(store, c);
+
+        if (map != NULL) {
+            munmap(map, store->mapSizes[c]);
+            setPointer(store, c, NULL);
+        }
+        if (store->fds[c] >= 0) {
+            if (store->writable &&
+                ftruncate(store->fds[c],
+                          (off_t)columnBytes(store, c, store->numRows)) != 0) {
+                perror(columns[c].name);
+            }
+            close(store->fds[c]);
+            store->fds[c] = -1;
+        }
+    }
+    if (store->headerFd >= 0) {
+        close(store->headerFd);
+        store->headerFd = -1;
+    }
+}
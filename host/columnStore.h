@@ -0,0 +1,97 @@
+/*
+ *  ======== columnStore.h ========
+ *  Memory-mapped columnar capture files for decoded telemetry.
+ *
+ *  A store is a directory with one file per column, each a plain
+ *  little-endian array with one entry per echo report (the samples column
+ *  has samplesPerRow codes per report), plus a "header" file with the row
+ *  count:
+ *
+ *    hostTimeNs        uint64  CLOCK_REALTIME when the bytes were read
+ *    sequence          uint16  telemetry frame sequence number
+ *    buffersCompleted  uint32  \
+ *    arrivalUs         uint32   |
+ *    peakValue         uint32   | Telemetry_EchoReport fields
+ *    peakBin           uint16   |
+ *    flags             uint8   /
+ *    numSamples        uint16  codes stored for the row (0 for a summary)
+ *    samples           uint16  samplesPerRow codes per row, zero padded
+ *
+ *  so a tool that needs the peak of every report maps 4 bytes per report
+ *  and never touches the samples. The writer grows the files in steps and
+ *  trims them on close; the header is rewritten on ColumnStore_sync, so a
+ *  reader sees every row up to the last sync while the capture runs.
+ */
+
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry.h"
+
+#define COLUMN_STORE_MAGIC      (0x4C4F4345u)   /* "ECOL" */
+#define COLUMN_STORE_VERSION    (1)
+
+typedef enum ColumnStore_Column {
+    COLUMN_STORE_HOST_TIME,
+    COLUMN_STORE_SEQUENCE,
+    COLUMN_STORE_BUFFERS_COMPLETED,
+    COLUMN_STORE_ARRIVAL,
+    COLUMN_STORE_PEAK_VALUE,
+    COLUMN_STORE_PEAK_BIN,
+    COLUMN_STORE_FLAGS,
+    COLUMN_STORE_NUM_SAMPLES,
+    COLUMN_STORE_SAMPLES,
+    COLUMN_STORE_COLUMNS
+} ColumnStore_Column;
+
+typedef struct ColumnStore {
+    /* Column arrays of numRows entries (samples: numRows * samplesPerRow) */
+    uint64_t *hostTimeNs;
+    uint16_t *sequence;
+    uint32_t *buffersCompleted;
+    uint32_t *arrivalUs;
+    uint32_t *peakValue;
+    uint16_t *peakBin;
+    uint8_t  *flags;
+    uint16_t *numSamples;
+    uint16_t *samples;
+
+    uint64_t  numRows;
+    uint32_t  samplesPerRow;
+
+    /* Private */
+    uint64_t  capacity;         /* Rows the files are sized for */
+    int       writable;
+    int       headerFd;
+    int       fds[COLUMN_STORE_COLUMNS];
+    size_t    mapSizes[COLUMN_STORE_COLUMNS];
+} ColumnStore;
+
+/* Creates the directory (or empties the store in it) for writing.
+ * Returns 0, or -1 with errno set. */
+extern int ColumnStore_create(ColumnStore *store, const char *dir,
+                              uint32_t samplesPerRow);
+
+/* Maps an existing store read-only, up to its last sync */
+extern int ColumnStore_open(ColumnStore *store, const char *dir);
+
+/*
+ *  ======== ColumnStore_append ========
+ *  Adds one echo report. Up to samplesPerRow of the numCodes codes are
+ *  stored. Returns 0, or -1 if the files cannot grow.
+ */
+extern int ColumnStore_append(ColumnStore *store,
+                              const Telemetry_EchoReport *report,
+                              uint16_t sequence, const uint16_t *codes,
+                              uint32_t numCodes, uint64_t hostTimeNs);
+
+/* Publishes the rows appended so far to readers */
+extern int ColumnStore_sync(ColumnStore *store);
+
+/* Syncs (writer), trims the files to numRows and unmaps everything */
+extern void ColumnStore_close(ColumnStore *store);
+
+#endif /* COLUMN_STORE_H */
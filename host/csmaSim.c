@@ -0,0 +1,406 @@
+/*
+ *  ======== csmaSim.c ========
+ *  Discrete-event simulation of many initiator / responder pairs in one
+ *  space: listen-before-talk with randomized backoff (csmaBackoff.c,
+ *  ECHO_LBT) against every initiator sending blindly once a second.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o csmaSim host/csmaSim.c \
+ *        host/eventQueue.c rfEchoTxFinal/csmaBackoff.c
+ *
+ *  Usage: csmaSim [-d seconds] [-r decayUs] [-u backoffUs]
+ *    -d  simulated time per run (default 300s, the first 10s not counted)
+ *    -r  how long the bursts of an exchange stay audible after its listen
+ *        window (default 5000us, half of ECHO_TDMA_GUARD_US)
+ *    -u  backoff unit (default ECHO_LBT_BACKOFF_US)
+ *
+ *  Everyone hears everyone: an exchange (burst, packet, echo, burst and
+ *  listen window, then the decay) fails when it overlaps another one. The
+ *  carrier sense only hears RF, i.e. the packet and the echo of an
+ *  exchange: it finds the channel busy as soon as one is on the air during
+ *  its ECHO_LBT_SENSE_US, and clear when none was; the exchange starts
+ *  right at the end of a clear sense (the RF core runs the chain). Every
+ *  initiator starts at a random time with a clock off by up to +-40ppm and
+ *  starts its next cycle a second after the exchange, as the firmware does;
+ *  with listen-before-talk the cycle begins with the sense and its
+ *  backoffs, and after a collision it starts later by the random shift of
+ *  CsmaBackoff_result.
+ *
+ *  Responders either filter on the ID of their initiator (ECHO_PAIR_ID,
+ *  "pair") or echo every ranging packet they hear ("any", without the
+ *  address filter): then all of them echo every packet at the same
+ *  turnaround, the echoes collide on air and the other responders' bursts
+ *  land in the listen window, whatever the initiators' channel access.
+ *  Echoes are one byte longer than packets and dropped by every
+ *  responder's length filter, so nobody echoes an echo.
+ *
+ *  For 10 .. 200 initiators prints the packets echoed per exchange, the
+ *  share of exchanges that collided,
+ *  the successful rangings per second of all of them together (goodput)
+ *  and, for listen-before-talk, the backoffs per exchange and the cycles
+ *  given up. Exits with 1 if listen-before-talk has more collisions than
+ *  sending blindly, or less goodput up to LBT_MAX_PAIRS, or if responders
+ *  echoing everything do not collide more than paired ones.
+ *
+ *  Acceptable: up to LBT_MAX_PAIRS pairs in earshot, at most
+ *  LBT_MAX_COLLIDED of the exchanges of paired listen-before-talk collide;
+ *  the check fails above it. Each exchange is audible for about 16ms, so 20
+ *  pairs ranging once a second keep the space busy a third of the time.
+ *  The sense only hears the first 2.5ms of an exchange, and past that load
+ *  the random shifts after collisions no longer find free phases of the
+ *  cycle: above LBT_MAX_PAIRS listen-before-talk only has to collide less
+ *  than sending blindly, and ECHO_TDMA is the mode to use.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "csmaBackoff.h"
+#include "echoConfig.h"
+#include "eventQueue.h"
+
+#define MAX_DEVICES         (256)
+#define MAX_EVENTS          (8 * MAX_DEVICES)
+#define WARMUP_US           (10e6)
+#define CYCLE_DELAY_US      (1e6)
+#define CLOCK_PPM           (40)
+/* Acceptable collisions, see above */
+#define LBT_MAX_PAIRS       (20)
+#define LBT_MAX_COLLIDED    (5.0)
+
+/* Packet and echo, from the start of the exchange (the initiator's burst) */
+#define PING_US             (ECHO_BURST_US)
+#define AIR_US              (ECHO_RF_AIR_US(RANGING_PACKET_SIZE))
+#define ECHO_AIR_US         (ECHO_RF_AIR_US(RANGING_ECHO_SIZE))
+#define ECHO_US             (PING_US + AIR_US + ECHO_RF_TURNAROUND_US)
+
+/* Event types */
+#define EV_SENSE            (0)     /* An initiator starts a carrier sense */
+#define EV_SENSE_END        (1)     /* ... which ends with a clear channel */
+#define EV_START            (2)     /* An exchange starts */
+#define EV_RF_ON            (3)     /* Its packet or echo goes on the air */
+#define EV_RF_OFF           (4)
+#define EV_END              (5)     /* ... and is no longer audible */
+
+typedef struct Device {
+    CsmaBackoff_Object backoff;
+    double   rate;                  /* Local us per true us */
+    double   start;                 /* Of the current exchange */
+    double   senseEnd;              /* Of the carrier sense running */
+    bool     sensing;
+    bool     active;                /* Exchange audible */
+    bool     hit;                   /* ... and overlapped */
+    uint32_t shiftUs;               /* Next cycle later after a collision */
+} Device;
+
+typedef struct Sim {
+    bool     lbt;
+    bool     paired;                /* Responders filter on their initiator */
+    uint16_t numDevices;
+    double   duration;
+    double   busyUs;                /* Audible part of an exchange */
+    uint32_t backoffUs;
+    Device   devices[MAX_DEVICES];
+    EventQueue_Event events[MAX_EVENTS];
+    EventQueue queue;
+    uint32_t numActive;
+    uint32_t numRf;                 /* Packets and echoes on the air */
+    uint32_t seed;
+    /* Counted after WARMUP_US */
+    uint32_t exchanges;
+    uint32_t echoes;
+    uint32_t collided;
+    uint32_t successes;
+    uint32_t deferrals;
+    uint32_t dropped;
+} Sim;
+
+/*
+ *  ======== uniform ========
+ *  xorshift32 in [0, 1)
+ */
+static double uniform(uint32_t *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+
+    return ((*seed >> 8) / 16777216.0);
+}
+
+/*
+ *  ======== nextCycle ========
+ *  The initiator waits a second (and its shift after a collision) on its
+ *  own clock, then senses (with listen-before-talk) or starts the exchange
+ *  right away.
+ */
+static void nextCycle(Sim *sim, uint16_t id, double now)
+{
+    Device *device = &sim->devices[id];
+
+    EventQueue_push(&sim->queue,
+                    now + (CYCLE_DELAY_US + device->shiftUs) / device->rate,
+                    sim->lbt ? EV_SENSE : EV_START, id);
+}
+
+/*
+ *  ======== busy ========
+ *  The initiator's carrier sense found the channel busy: it backs off and
+ *  senses again, or gives the cycle up.
+ */
+static void busy(Sim *sim, uint16_t id, double now)
+{
+    Device *device = &sim->devices[id];
+    uint32_t deferrals = device->backoff.deferrals;
+    uint32_t dropped = device->backoff.dropped;
+    uint32_t waitUs = CsmaBackoff_busy(&device->backoff);
+
+    device->sensing = false;
+    if (now >= WARMUP_US) {
+        sim->deferrals += device->backoff.deferrals - deferrals;
+        sim->dropped += device->backoff.dropped - dropped;
+    }
+    if (waitUs != 0) {
+        EventQueue_push(&sim->queue, now + waitUs / device->rate, EV_SENSE,
+                        id);
+    }
+    else {
+        nextCycle(sim, id, now);
+    }
+}
+
+/*
+ *  ======== run ========
+ */
+static void run(Sim *sim)
+{
+    EventQueue_Event event;
+    uint16_t id;
+
+    EventQueue_init(&sim->queue, sim->events, MAX_EVENTS);
+    sim->numActive = 0;
+    sim->numRf = 0;
+    sim->exchanges = 0;
+    sim->echoes = 0;
+    sim->collided = 0;
+    sim->successes = 0;
+    sim->deferrals = 0;
+    sim->dropped = 0;
+
+    for (id = 0; id < sim->numDevices; id++) {
+        Device *device = &sim->devices[id];
+
+        device->rate = 1 + (uniform(&sim->seed) * 2 - 1) * CLOCK_PPM * 1e-6;
+        device->sensing = false;
+        device->active = false;
+        device->shiftUs = 0;
+        /* As the firmware seeds it: device ID and RAT time */
+        CsmaBackoff_init(&device->backoff,
+                         (uint32_t)(uniform(&sim->seed) * 4294967296.0) ^
+                         ((uint32_t)id << 24), sim->backoffUs,
+                         ECHO_LBT_MAX_EXPONENT, ECHO_LBT_MAX_ATTEMPTS);
+        EventQueue_push(&sim->queue, uniform(&sim->seed) * 1e6,
+                        sim->lbt ? EV_SENSE : EV_START, id);
+    }
+
+    while (EventQueue_pop(&sim->queue, &event)) {
+        Device *device = &sim->devices[event.id];
+
+        if (event.time > sim->duration) {
+            break;
+        }
+        switch (event.type) {
+            case EV_SENSE:
+                if (sim->numRf != 0) {
+                    busy(sim, event.id, event.time);
+                    break;
+                }
+                device->sensing = true;
+                device->senseEnd = event.time +
+                                   ECHO_LBT_SENSE_US / device->rate;
+                EventQueue_push(&sim->queue, device->senseEnd, EV_SENSE_END,
+                                event.id);
+                break;
+
+            case EV_SENSE_END:
+                /* Already ended busy */
+                if (!device->sensing || event.time != device->senseEnd) {
+                    break;
+                }
+                device->sensing = false;
+                CsmaBackoff_clear(&device->backoff);
+                /* Falls through - the burst goes out right away */
+
+            case EV_START:
+                /* Overlaps everything still audible, and the echoes and
+                 * bursts of the other responders if they all answer */
+                device->hit = sim->numActive != 0 ||
+                              (!sim->paired && sim->numDevices > 1);
+                for (id = 0; id < sim->numDevices && sim->numActive != 0;
+                     id++) {
+                    if (sim->devices[id].active) {
+                        sim->devices[id].hit = true;
+                    }
+                }
+                device->active = true;
+                device->start = event.time;
+                sim->numActive++;
+                EventQueue_push(&sim->queue, event.time + PING_US, EV_RF_ON,
+                                event.id);
+                EventQueue_push(&sim->queue, event.time + PING_US + AIR_US,
+                                EV_RF_OFF, event.id);
+                EventQueue_push(&sim->queue, event.time + ECHO_US, EV_RF_ON,
+                                event.id);
+                EventQueue_push(&sim->queue,
+                                event.time + ECHO_US + ECHO_AIR_US,
+                                EV_RF_OFF, event.id);
+                EventQueue_push(&sim->queue, event.time + sim->busyUs,
+                                EV_END, event.id);
+                break;
+
+            case EV_RF_ON:
+                /* Heard by every carrier sense running */
+                sim->numRf++;
+                for (id = 0; id < sim->numDevices; id++) {
+                    if (sim->devices[id].sensing) {
+                        busy(sim, id, event.time);
+                    }
+                }
+                break;
+
+            case EV_RF_OFF:
+                sim->numRf--;
+                break;
+
+            case EV_END:
+                device->active = false;
+                sim->numActive--;
+                if (sim->lbt) {
+                    device->shiftUs = CsmaBackoff_result(&device->backoff,
+                                                         !device->hit);
+                }
+                if (device->start >= WARMUP_US) {
+                    sim->exchanges++;
+                    sim->echoes += sim->paired ? 1 : sim->numDevices;
+                    if (device->hit) {
+                        sim->collided++;
+                    }
+                    else {
+                        sim->successes++;
+                    }
+                }
+                nextCycle(sim, event.id, event.time);
+                break;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint16_t counts[] = {10, 20, 30, 50, 100, 150, 200};
+    static Sim sim;
+    double decayUs = ECHO_TDMA_GUARD_US / 2;
+    uint32_t failures = 0;
+    uint32_t c;
+    int opt;
+
+    sim.duration = 300e6;
+    sim.backoffUs = ECHO_LBT_BACKOFF_US;
+    while ((opt = getopt(argc, argv, "d:r:u:")) != -1) {
+        switch (opt) {
+            case 'd':
+                sim.duration = atof(optarg) * 1e6;
+                break;
+            case 'r':
+                decayUs = atof(optarg);
+                break;
+            case 'u':
+                sim.backoffUs = (uint32_t)atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-r decayUs] "
+                        "[-u backoffUs]\n", argv[0]);
+                return (2);
+        }
+    }
+    if (sim.duration <= WARMUP_US || sim.backoffUs == 0) {
+        fprintf(stderr, "need more than %.0fs and a backoff unit\n",
+                WARMUP_US / 1e6);
+        return (2);
+    }
+    sim.busyUs = ECHO_TDMA_SLOT_US - ECHO_TDMA_GUARD_US + decayUs;
+
+    printf("Exchange audible %.0fus (RF %uus), sense %uus, backoff %uus x "
+           "1 .. %u, %u attempts, %.0fs simulated\n", sim.busyUs,
+           AIR_US + ECHO_AIR_US, ECHO_LBT_SENSE_US, sim.backoffUs,
+           1u << ECHO_LBT_MAX_EXPONENT, ECHO_LBT_MAX_ATTEMPTS,
+           sim.duration / 1e6);
+    printf("%-6s %-8s %-5s %10s %7s %9s %10s %10s %9s\n", "pairs",
+           "access", "echo", "exchanges", "echoes", "collided", "ranging/s",
+           "backoffs", "dropped");
+
+    for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        double goodput[3];
+        double collided[3];
+        uint32_t mode;
+
+        /* Blind, listen-before-talk, the same with responders echoing all */
+        for (mode = 0; mode < 3; mode++) {
+            sim.lbt = mode != 0;
+            sim.paired = mode != 2;
+            sim.numDevices = counts[c];
+            sim.seed = 0x5eed + c;
+            run(&sim);
+
+            goodput[mode] = sim.successes /
+                            ((sim.duration - WARMUP_US) / 1e6);
+            collided[mode] = sim.exchanges ?
+                             100.0 * sim.collided / sim.exchanges : 0;
+            printf("%-6u %-8s %-5s %10u %7.1f %8.2f%% %10.2f ",
+                   sim.numDevices, sim.lbt ? "lbt" : "blind",
+                   sim.paired ? "pair" : "any", sim.exchanges,
+                   sim.exchanges ? (double)sim.echoes / sim.exchanges : 0,
+                   collided[mode], goodput[mode]);
+            /* Backoffs per exchange, and cycles given up */
+            if (sim.lbt) {
+                printf("%10.2f %9u\n", sim.exchanges ?
+                       (double)sim.deferrals / sim.exchanges : 0,
+                       sim.dropped);
+            }
+            else {
+                printf("%10s %9s\n", "-", "-");
+            }
+        }
+
+        if ((counts[c] <= LBT_MAX_PAIRS && goodput[1] < goodput[0]) ||
+            (collided[0] != 0 && collided[1] >= collided[0])) {
+            printf("FAIL: %u pairs: listen-before-talk %.2f/s, %.2f%% "
+                   "collided against blind %.2f/s, %.2f%%\n", counts[c],
+                   goodput[1], collided[1], goodput[0], collided[0]);
+            failures++;
+        }
+        if (counts[c] <= LBT_MAX_PAIRS && collided[1] > LBT_MAX_COLLIDED) {
+            printf("FAIL: %u pairs: listen-before-talk %.2f%% collided, "
+                   "more than %.0f%%\n", counts[c], collided[1],
+                   LBT_MAX_COLLIDED);
+            failures++;
+        }
+        if (collided[2] <= collided[1]) {
+            printf("FAIL: %u pairs: responders echoing everything collide "
+                   "%.2f%%, paired %.2f%%\n", counts[c], collided[2],
+                   collided[1]);
+            failures++;
+        }
+    }
+
+    if (failures != 0) {
+        printf("FAIL (%u)\n", failures);
+        return (1);
+    }
+    printf("OK\n");
+
+    return (0);
+}
@@ -0,0 +1,448 @@
+/*
+ *  ======== deltaCodecBench.c ========
+ *  Compression ratio and speed of the telemetry sample compression
+ *  (deltaCodec.c: delta, zigzag, bit-packed blocks) against the same
+ *  differences as per-value varints, and a lossless round trip check of
+ *  both.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o deltaCodecBench host/deltaCodecBench.c \
+ *        host/captureFile.c host/echoSynth.c host/telemetryDecode.c \
+ *        rfEchoTxFinal/deltaCodec.c rfEchoTxFinal/telemetry.c -lm
+ *
+ *  Usage: deltaCodecBench [-b] [capture...]
+ *  Captures are "Microvolts: ..." text dumps (telemetryDump output or the
+ *  old firmware text), or with -b the raw binary telemetry from the serial
+ *  port. Without captures, synthetic buffers for a few rooms are used,
+ *  plus full-scale white noise as the worst case.
+ *
+ *  Prints bytes per buffer, compression ratio, and encode / decode speed
+ *  in MB/s of raw samples and cycles per buffer. Exits with 1 if a buffer
+ *  does not come back bit-exact or the output exceeds DELTA_CODEC_MAX_SIZE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "captureFile.h"
+#include "deltaCodec.h"
+#include "echoConfig.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+#include "telemetryDecode.h"
+
+#define NUM_SAMPLES         (ECHO_BUFFER_SAMPLES)
+#define BUFFERS_PER_ROOM    (4000)
+/* Each buffer is coded this many times for the timing */
+#define REPEATS             (20)
+/* A varint takes up to 3 bytes for a 16-bit value */
+#define VARINT_MAX_SIZE     (2 + 3 * NUM_SAMPLES)
+#define BAUD_RATE           (115200)
+
+typedef struct Codec {
+    const char *name;
+    uint32_t  (*encode)(const uint16_t *samples, uint8_t *out);
+    int32_t   (*decode)(const uint8_t *in, uint32_t size, uint16_t *samples);
+    uint32_t    maxSize;
+} Codec;
+
+typedef struct Stats {
+    uint64_t bytes;
+    uint64_t encodeCycles;
+    uint64_t decodeCycles;
+    double   encodeSeconds;
+    double   decodeSeconds;
+    uint32_t largest;
+    uint32_t errors;
+} Stats;
+
+typedef struct Room {
+    const char *name;
+    uint32_t    biasUv;
+    uint32_t    noiseUv;
+    uint32_t    echoUv;
+} Room;
+
+static const Room rooms[] = {
+    { "quiet",   100000,   2000,  20000 },
+    { "noisy",   100000,  20000,  80000 },
+    { "loud",    500000,   5000, 800000 },
+};
+#define NUM_ROOMS   (sizeof(rooms) / sizeof(rooms[0]))
+
+static volatile uint32_t sink;
+
+/*
+ *  ======== rawEncode ========
+ */
+static uint32_t rawEncode(const uint16_t *samples, uint8_t *out)
+{
+    memcpy(out, samples, NUM_SAMPLES * sizeof(uint16_t));
+
+    return (NUM_SAMPLES * sizeof(uint16_t));
+}
+
+/*
+ *  ======== rawDecode ========
+ */
+static int32_t rawDecode(const uint8_t *in, uint32_t size, uint16_t *samples)
+{
+    if (size < NUM_SAMPLES * sizeof(uint16_t)) {
+        return (-1);
+    }
+    memcpy(samples, in, NUM_SAMPLES * sizeof(uint16_t));
+
+    return (NUM_SAMPLES * sizeof(uint16_t));
+}
+
+/*
+ *  ======== blockEncode ========
+ */
+static uint32_t blockEncode(const uint16_t *samples, uint8_t *out)
+{
+    return (DeltaCodec_encode(samples, NUM_SAMPLES, out));
+}
+
+/*
+ *  ======== blockDecode ========
+ */
+static int32_t blockDecode(const uint8_t *in, uint32_t size,
+                           uint16_t *samples)
+{
+    return (DeltaCodec_decode(in, size, samples, NUM_SAMPLES));
+}
+
+/*
+ *  ======== varintEncode ========
+ *  The same zigzag differences, 7 bits per byte with a continuation bit.
+ */
+static uint32_t varintEncode(const uint16_t *samples, uint8_t *out)
+{
+    uint8_t *start = out;
+    uint16_t previous = samples[0];
+    uint32_t i;
+
+    *out++ = (uint8_t)previous;
+    *out++ = (uint8_t)(previous >> 8);
+    for (i = 1; i < NUM_SAMPLES; i++) {
+        uint16_t delta = samples[i] - previous;
+        uint32_t zigzag = (uint16_t)(delta << 1) ^
+                          (uint16_t)(0 - (delta >> 15));
+
+        previous = samples[i];
+        while (zigzag >= 0x80) {
+            *out++ = (uint8_t)(zigzag | 0x80);
+            zigzag >>= 7;
+        }
+        *out++ = (uint8_t)zigzag;
+    }
+
+    return ((uint32_t)(out - start));
+}
+
+/*
+ *  ======== varintDecode ========
+ */
+static int32_t varintDecode(const uint8_t *in, uint32_t size,
+                            uint16_t *samples)
+{
+    uint32_t used = 2;
+    uint16_t previous;
+    uint32_t i;
+
+    if (size < 2) {
+        return (-1);
+    }
+    previous = (uint16_t)(in[0] | (in[1] << 8));
+    samples[0] = previous;
+    for (i = 1; i < NUM_SAMPLES; i++) {
+        uint32_t zigzag = 0;
+        uint32_t shift = 0;
+        uint8_t byte;
+
+        do {
+            if (used >= size || shift > 14) {
+                return (-1);
+            }
+            byte = in[used++];
+            zigzag |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        previous += (uint16_t)(zigzag >> 1) ^ (uint16_t)(0 - (zigzag & 1));
+        samples[i] = previous;
+    }
+
+    return ((int32_t)used);
+}
+
+static const Codec codecs[] = {
+    { "raw",               rawEncode,    rawDecode,
+      NUM_SAMPLES * sizeof(uint16_t) },
+    { "delta, 16-blocks",  blockEncode,  blockDecode,
+      DELTA_CODEC_MAX_SIZE(NUM_SAMPLES) },
+    { "delta, varint",     varintEncode, varintDecode, VARINT_MAX_SIZE },
+};
+#define NUM_CODECS  (sizeof(codecs) / sizeof(codecs[0]))
+
+/*
+ *  ======== measure ========
+ *  Codes every buffer with every codec and checks the round trip.
+ */
+static void measure(const uint16_t *buffers, size_t numBuffers,
+                    Stats *stats)
+{
+    static uint8_t coded[VARINT_MAX_SIZE];
+    static uint16_t decoded[NUM_SAMPLES];
+    size_t c;
+    size_t b;
+    int r;
+
+    memset(stats, 0, NUM_CODECS * sizeof(*stats));
+
+    for (c = 0; c < NUM_CODECS; c++) {
+        const Codec *codec = &codecs[c];
+        Stats *s = &stats[c];
+
+        for (b = 0; b < numBuffers; b++) {
+            const uint16_t *samples = &buffers[b * NUM_SAMPLES];
+            uint32_t size = 0;
+            int32_t used = 0;
+            uint64_t start;
+            double seconds;
+
+            seconds = HostCycles_seconds();
+            start = HostCycles_now();
+            for (r = 0; r < REPEATS; r++) {
+                size = codec->encode(samples, coded);
+                sink += coded[size / 2];
+            }
+            s->encodeCycles += HostCycles_now() - start;
+            s->encodeSeconds += HostCycles_seconds() - seconds;
+
+            seconds = HostCycles_seconds();
+            start = HostCycles_now();
+            for (r = 0; r < REPEATS; r++) {
+                used = codec->decode(coded, size, decoded);
+                sink += decoded[NUM_SAMPLES / 2];
+            }
+            s->decodeCycles += HostCycles_now() - start;
+            s->decodeSeconds += HostCycles_seconds() - seconds;
+
+            s->bytes += size;
+            if (size > s->largest) {
+                s->largest = size;
+            }
+            if (used != (int32_t)size || size > codec->maxSize ||
+                memcmp(decoded, samples, sizeof(decoded)) != 0) {
+                s->errors++;
+            }
+        }
+    }
+}
+
+/*
+ *  ======== report ========
+ *  Prints the table for one set of buffers; returns the number of errors.
+ */
+static uint32_t report(const char *name, const uint16_t *buffers,
+                       size_t numBuffers)
+{
+    Stats stats[NUM_CODECS];
+    double rawBytes = (double)numBuffers * NUM_SAMPLES * sizeof(uint16_t);
+    uint32_t errors = 0;
+    size_t c;
+
+    if (numBuffers == 0) {
+        printf("\n%s: no %u-sample buffers\n", name, NUM_SAMPLES);
+        return (0);
+    }
+
+    measure(buffers, numBuffers, stats);
+
+    printf("\n%s: %zu buffers of %u samples\n", name, numBuffers,
+           NUM_SAMPLES);
+    printf("%-18s %7s %7s %6s %6s %9s %9s %9s %9s %5s\n", "codec", "bytes",
+           "largest", "ratio", "link", "enc MB/s", "dec MB/s",
+           "enc " HOST_CYCLES_UNIT, "dec " HOST_CYCLES_UNIT, "bad");
+    for (c = 0; c < NUM_CODECS; c++) {
+        const Stats *s = &stats[c];
+        double perBuffer = (double)s->bytes / numBuffers;
+        double runs = (double)numBuffers * REPEATS;
+
+        /* Link time in ms at 8N1 */
+        printf("%-18s %7.1f %7u %6.2f %6.1f %9.0f %9.0f %9.0f %9.0f %5u\n",
+               codecs[c].name, perBuffer, s->largest,
+               rawBytes / s->bytes, perBuffer * 10 * 1000 / BAUD_RATE,
+               rawBytes * REPEATS / s->encodeSeconds * 1e-6,
+               rawBytes * REPEATS / s->decodeSeconds * 1e-6,
+               s->encodeCycles / runs, s->decodeCycles / runs, s->errors);
+        errors += s->errors;
+    }
+
+    return (errors);
+}
+
+/*
+ *  ======== loadText ========
+ */
+static size_t loadText(const char *path, uint16_t **buffers)
+{
+    CaptureFile capture;
+    size_t numBuffers;
+    size_t i;
+
+    if (CaptureFile_load(path, NUM_SAMPLES, &capture) != 0) {
+        perror(path);
+        return (0);
+    }
+
+    numBuffers = capture.numBuffers;
+    *buffers = malloc((numBuffers * NUM_SAMPLES + 1) * sizeof(uint16_t));
+    for (i = 0; *buffers != NULL && i < numBuffers * NUM_SAMPLES; i++) {
+        (*buffers)[i] = EchoSynth_microVoltsToCode(capture.samples[i]);
+    }
+    CaptureFile_free(&capture);
+
+    return ((*buffers != NULL) ? numBuffers : 0);
+}
+
+/*
+ *  ======== loadTelemetry ========
+ *  Codes of every echo report of NUM_SAMPLES codes in a binary capture.
+ */
+static size_t loadTelemetry(const char *path, uint16_t **buffers)
+{
+    static TelemetryDecode_Object decoder;
+    static uint8_t chunk[4096];
+    static uint16_t codes[TELEMETRY_MAX_PAYLOAD / 2];
+    FILE *input = fopen(path, "rb");
+    size_t numBuffers = 0;
+    size_t capacity = 0;
+    size_t chunkSize;
+
+    *buffers = NULL;
+    if (input == NULL) {
+        perror(path);
+        return (0);
+    }
+
+    TelemetryDecode_init(&decoder);
+    while ((chunkSize = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+        const uint8_t *data = chunk;
+        TelemetryDecode_Frame frame;
+
+        while (TelemetryDecode_next(&decoder, &data, &chunkSize, &frame)) {
+            Telemetry_EchoReport echoReport;
+
+            if (TelemetryDecode_echoReport(&frame, &echoReport, codes,
+                    TELEMETRY_MAX_PAYLOAD / 2) != NUM_SAMPLES) {
+                continue;
+            }
+            if (numBuffers == capacity) {
+                uint16_t *grown;
+
+                capacity = capacity ? 2 * capacity : 256;
+                grown = realloc(*buffers,
+                                capacity * NUM_SAMPLES * sizeof(uint16_t));
+                if (grown == NULL) {
+                    break;
+                }
+                *buffers = grown;
+            }
+            memcpy(&(*buffers)[numBuffers * NUM_SAMPLES], codes,
+                   NUM_SAMPLES * sizeof(uint16_t));
+            numBuffers++;
+        }
+    }
+    fclose(input);
+
+    return (numBuffers);
+}
+
+/*
+ *  ======== synthesize ========
+ *  An echo at a random place in every other buffer, or white noise over
+ *  the whole code range for room == NULL.
+ */
+static void synthesize(const Room *room, uint16_t *buffers, uint32_t *seed)
+{
+    EchoSynth_Params params;
+    uint32_t microVolts[NUM_SAMPLES];
+    size_t b;
+    size_t i;
+
+    EchoSynth_Params_init(&params);
+    for (b = 0; b < BUFFERS_PER_ROOM; b++) {
+        uint16_t *samples = &buffers[b * NUM_SAMPLES];
+
+        if (room == NULL) {
+            for (i = 0; i < NUM_SAMPLES; i++) {
+                samples[i] = (uint16_t)(EchoSynth_uniform(seed) *
+                                        (ECHO_SYNTH_CODE_MAX + 1));
+            }
+            continue;
+        }
+
+        params.biasUv = room->biasUv;
+        params.noiseUv = room->noiseUv;
+        params.echoUv = (b & 1) ? room->echoUv : 0;
+        params.echoStart = EchoSynth_uniform(seed) * NUM_SAMPLES;
+        EchoSynth_microVolts(&params, seed, microVolts, NUM_SAMPLES);
+        for (i = 0; i < NUM_SAMPLES; i++) {
+            samples[i] = EchoSynth_microVoltsToCode(microVolts[i]);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t errors = 0;
+    bool binary = false;
+    int first = 1;
+    int a;
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        binary = true;
+        first = 2;
+    }
+
+    printf("codecs: DeltaCodec blocks of %u differences, and the same "
+           "differences as varints\n", DELTA_CODEC_BLOCK_SIZE);
+
+    if (first < argc) {
+        for (a = first; a < argc; a++) {
+            uint16_t *buffers = NULL;
+            size_t numBuffers = binary ? loadTelemetry(argv[a], &buffers) :
+                                         loadText(argv[a], &buffers);
+
+            errors += report(argv[a], buffers, numBuffers);
+            free(buffers);
+        }
+    }
+    else {
+        static uint16_t buffers[BUFFERS_PER_ROOM * NUM_SAMPLES];
+        uint32_t seed = 0x13579bdf;
+        size_t r;
+
+        for (r = 0; r <= NUM_ROOMS; r++) {
+            const Room *room = (r < NUM_ROOMS) ? &rooms[r] : NULL;
+
+            synthesize(room, buffers, &seed);
+            errors += report(room ? room->name : "white noise, full scale",
+                             buffers, BUFFERS_PER_ROOM);
+        }
+    }
+
+    if (errors != 0) {
+        printf("\nFAIL: %u buffers did not round trip\n", errors);
+        return (1);
+    }
+    printf("\nOK\n");
+
+    return (0);
+}
@@ -0,0 +1,147 @@
+/*
+ *  ======== echoConfigCheck.c ========
+ *  Host check of the range-gated listen window geometry in echoConfig.h.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o echoConfigCheck host/echoConfigCheck.c -lm
+ *
+ *  Add -DECHO_BANDPASS_SAMPLING to check the 32kHz geometry.
+ *
+ *  Recomputes the geometry in floating point for every range up to the
+ *  longest one the detector supports and checks that:
+ *   - an echo from the range starts in a bin at or before the cutoff, and
+ *     the cutoff is at most one bin late (integer rounding)
+ *   - the window holds the cutoff bin plus a whole burst, wasting less than
+ *     one bin per buffer
+ *   - a buffer is a whole number of bins and of carrier (or alias) periods
+ *  and that the settings agree with matchedFilter.h / bandpass.h. Prints the
+ *  configured geometry and exits with 1 on any failure.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "echoConfig.h"
+#include "matchedFilter.h"
+
+/* Window of the firmware before the range gate: 4 buffers of 500 samples */
+#define FIXED_WINDOW_BUFFERS    (4)
+#define FIXED_BUFFER_SAMPLES    (500)
+
+#ifdef ECHO_BANDPASS_SAMPLING
+#define CARRIER_PERIOD          (BANDPASS_PERIOD)
+#else
+#define CARRIER_PERIOD          (MATCHED_FILTER_PERIOD)
+#endif // ECHO_BANDPASS_SAMPLING
+
+static int failures;
+
+/*
+ *  ======== check ========
+ */
+static void check(int ok, uint32_t rangeMm, const char *what)
+{
+    if (!ok) {
+        if (failures < 20) {
+            printf("FAIL %umm: %s\n", rangeMm, what);
+        }
+        failures++;
+    }
+}
+
+/*
+ *  ======== checkRange ========
+ *  Returns 1 when the cutoff bin is later than the exact one.
+ */
+static int checkRange(uint32_t rangeMm)
+{
+    double tofSamples = rangeMm * 1e-3 / ECHO_SPEED_OF_SOUND_MM_MS *
+        ECHO_SAMPLE_RATE_HZ;
+    double burstSamples = ECHO_BURST_US * 1e-6 * ECHO_SAMPLE_RATE_HZ;
+    uint32_t exactBin = (uint32_t)ceil(tofSamples) / ECHO_BIN_SIZE;
+    uint32_t lastBin = ECHO_LAST_BIN(rangeMm);
+    uint32_t listenBins = ECHO_LISTEN_BINS(rangeMm);
+    uint32_t bufferBins = ECHO_BUFFER_BINS(rangeMm);
+    uint32_t bufferSamples = bufferBins * ECHO_BIN_SIZE;
+
+    check(lastBin >= exactBin, rangeMm, "echo at the range is cut off");
+    check(lastBin <= exactBin + 1, rangeMm, "cutoff more than a bin late");
+    check(listenBins * ECHO_BIN_SIZE >=
+          (lastBin + 1) * ECHO_BIN_SIZE + burstSamples, rangeMm,
+          "window misses the end of the burst");
+    check((listenBins - 1) * ECHO_BIN_SIZE <
+          (lastBin + 1) * ECHO_BIN_SIZE + burstSamples, rangeMm,
+          "window longer than needed");
+    check(ECHO_WINDOW_BUFFERS * bufferBins >= listenBins, rangeMm,
+          "buffers shorter than the window");
+    check(ECHO_WINDOW_BUFFERS * bufferBins < listenBins + ECHO_WINDOW_BUFFERS,
+          rangeMm, "buffers waste a bin or more each");
+    check(bufferSamples % CARRIER_PERIOD == 0, rangeMm,
+          "buffer is not whole carrier periods");
+
+    return (lastBin > exactBin);
+}
+
+int main(void)
+{
+    uint32_t rangeMm;
+    uint32_t maxRangeMm = 0;
+    uint32_t late = 0;
+    uint32_t checked = 0;
+
+#ifdef ECHO_BANDPASS_SAMPLING
+    check(ECHO_SAMPLE_RATE_HZ == BANDPASS_SAMPLE_RATE_HZ, 0,
+          "sample rate differs from bandpass.h");
+    check(ECHO_BIN_SIZE <= BANDPASS_MAX_BIN_SIZE, 0,
+          "bin longer than BANDPASS_MAX_BIN_SIZE");
+#else
+    check(ECHO_SAMPLE_RATE_HZ == MATCHED_FILTER_SAMPLE_RATE_HZ, 0,
+          "sample rate differs from matchedFilter.h");
+#endif // ECHO_BANDPASS_SAMPLING
+    check(ECHO_BURST_US == MATCHED_FILTER_BURST_US, 0,
+          "burst length differs from matchedFilter.h");
+    check(ECHO_BIN_US * (ECHO_SAMPLE_RATE_HZ / 1000) ==
+          ECHO_BIN_SIZE * 1000, 0, "bin is not a whole number of us");
+    check(ECHO_MAX_BIN == ECHO_LAST_BIN(ECHO_MAX_RANGE_MM), 0,
+          "ECHO_MAX_BIN");
+    check(ECHO_WINDOW_SAMPLES == ECHO_WINDOW_BUFFERS * ECHO_BUFFER_SAMPLES, 0,
+          "ECHO_WINDOW_SAMPLES");
+
+    for (rangeMm = 10; ECHO_BUFFER_BINS(rangeMm) <= ECHO_DETECT_MAX_BINS;
+         rangeMm++) {
+        late += checkRange(rangeMm);
+        maxRangeMm = rangeMm;
+        checked++;
+    }
+
+    printf("max range         %u mm (one-way time of flight %u us)\n",
+           ECHO_MAX_RANGE_MM, ECHO_TOF_US(ECHO_MAX_RANGE_MM));
+    printf("sampling          %u Hz, %u samples per %u us bin\n",
+           ECHO_SAMPLE_RATE_HZ, ECHO_BIN_SIZE, ECHO_BIN_US);
+    printf("cutoff            bin %u (%u us)\n", ECHO_MAX_BIN,
+           (ECHO_MAX_BIN + 1) * ECHO_BIN_US);
+    printf("window            %u x %u samples (%u us), was %u x %u\n",
+           ECHO_WINDOW_BUFFERS, ECHO_BUFFER_SAMPLES,
+           ECHO_WINDOW_SAMPLES * 1000 / (ECHO_SAMPLE_RATE_HZ / 1000),
+           FIXED_WINDOW_BUFFERS, FIXED_BUFFER_SAMPLES);
+    printf("ADC buffer RAM    %u bytes, was %u\n",
+           2 * ECHO_BUFFER_SAMPLES * (uint32_t)sizeof(uint16_t),
+           2 * FIXED_BUFFER_SAMPLES * (uint32_t)sizeof(uint16_t));
+    printf("samples / window  %.0f%% of the fixed window\n",
+           100.0 * ECHO_WINDOW_SAMPLES /
+           (FIXED_WINDOW_BUFFERS * FIXED_BUFFER_SAMPLES));
+    printf("checked           %u ranges up to %u mm (longest that fits %u "
+           "bins per buffer), cutoff a bin late on %u\n", checked,
+           maxRangeMm, ECHO_DETECT_MAX_BINS, late);
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return (1);
+    }
+    printf("geometry OK\n");
+
+    return (0);
+}
@@ -0,0 +1,71 @@
+/*
+ *  ======== echoDetect.c ========
+ *  Both kernels run the firmware's bin loop (echoDetectTemplate.h), built
+ *  once per sample type; only the length handling is here.
+ */
+
+#include <stdint.h>
+
+#include "echoDetect.h"
+
+#define ECHO_DETECT_TEMPLATE_NAME       EchoDetectMicroVolts
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint32_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   ECHO_DETECT_BIN_SIZE
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   ECHO_DETECT_MAX_BINS
+#include "echoDetectTemplate.h"
+
+#define ECHO_DETECT_TEMPLATE_NAME       EchoDetectCodes
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint16_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   ECHO_DETECT_BIN_SIZE
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   ECHO_DETECT_MAX_BINS
+#include "echoDetectTemplate.h"
+
+/*
+ *  ======== numBinsOf ========
+ *  Full bins in numSamples, up to ECHO_DETECT_MAX_BINS.
+ */
+static uint_fast16_t numBinsOf(uint16_t numSamples)
+{
+    uint_fast16_t numBins = numSamples / ECHO_DETECT_BIN_SIZE;
+
+    return ((numBins > ECHO_DETECT_MAX_BINS) ? ECHO_DETECT_MAX_BINS : numBins);
+}
+
+/*
+ *  ======== finish ========
+ *  Bin count and average from the sum of the swept samples.
+ */
+static void finish(EchoDetect_Result *result, uint_fast16_t numBins,
+                   uint32_t total)
+{
+    result->numBins = numBins;
+    /* One 32-bit divide per buffer (UDIV on the M3) */
+    result->average = (numBins != 0) ?
+        total / (numBins * ECHO_DETECT_BIN_SIZE) : 0;
+}
+
+/*
+ *  ======== EchoDetect_processMicroVolts ========
+ */
+void EchoDetect_processMicroVolts(const uint32_t *samples, uint16_t numSamples,
+                                  EchoDetect_Result *result)
+{
+    uint_fast16_t numBins = numBinsOf(numSamples);
+
+    finish(result, numBins,
+           EchoDetectMicroVolts_sweep(samples, numBins, result->binEnergy,
+                                      &result->peakEnergy, &result->peakBin));
+}
+
+/*
+ *  ======== EchoDetect_processCodes ========
+ */
+void EchoDetect_processCodes(const uint16_t *samples, uint16_t numSamples,
+                             EchoDetect_Result *result)
+{
+    uint_fast16_t numBins = numBinsOf(numSamples);
+
+    finish(result, numBins,
+           EchoDetectCodes_sweep(samples, numBins, result->binEnergy,
+                                 &result->peakEnergy, &result->peakBin));
+}
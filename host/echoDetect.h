@@ -0,0 +1,56 @@
+/*
+ *  ======== echoDetect.h ========
+ *  Single-pass bin energy kernel for the ultrasonic echo detector, with the
+ *  buffer length given per call.
+ *
+ *  The firmware instantiates echoDetectTemplate.h for its buffer length;
+ *  these are the host tools' builds of the same bin loop for buffers of any
+ *  length, with ECHO_DETECT_BIN_SIZE samples per bin (echoConfig.h).
+ */
+
+#ifndef ECHO_DETECT_H
+#define ECHO_DETECT_H
+
+#include <stdint.h>
+
+#include "echoConfig.h"
+
+typedef struct EchoDetect_Result {
+    uint32_t binEnergy[ECHO_DETECT_MAX_BINS]; /* Sum of the samples in each bin */
+    uint32_t peakEnergy;                      /* Largest entry of binEnergy */
+    uint16_t peakBin;                         /* Index of peakEnergy */
+    uint16_t numBins;                         /* Valid entries in binEnergy */
+    uint32_t average;                         /* Mean sample value of the buffer */
+} EchoDetect_Result;
+
+/*
+ *  ======== EchoDetect_processMicroVolts ========
+ *  Computes every bin energy, the peak bin and the buffer average in one
+ *  sweep over the samples.
+ *
+ *  numSamples should be a multiple of ECHO_DETECT_BIN_SIZE; samples past the
+ *  last full bin (or past ECHO_DETECT_MAX_BINS bins) are ignored.
+ *
+ *  CC26xx ADC readings are below 4.3V, so the sum of up to 500 microvolt
+ *  samples fits in 32 bits and no 64-bit arithmetic is needed.
+ *
+ *  result->average equals the total_max value produced by the original
+ *  four-run loop in adcBufCallback (that loop never reset its running sum
+ *  between bins, so its largest "bin average" was always sum / 500).
+ */
+extern void EchoDetect_processMicroVolts(const uint32_t *samples,
+                                         uint16_t numSamples,
+                                         EchoDetect_Result *result);
+
+/*
+ *  ======== EchoDetect_processCodes ========
+ *  Same as EchoDetect_processMicroVolts but straight on the adjusted 12-bit
+ *  ADC codes, so no microvolt conversion pass is needed. Bin energies and
+ *  the average are in ADC codes; compare them against thresholds converted
+ *  to codes once at startup.
+ */
+extern void EchoDetect_processCodes(const uint16_t *samples,
+                                    uint16_t numSamples,
+                                    EchoDetect_Result *result);
+
+#endif /* ECHO_DETECT_H */
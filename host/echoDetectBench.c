@@ -0,0 +1,266 @@
+/*
+ *  ======== echoDetectBench.c ========
+ *  Host benchmark of EchoDetect_processMicroVolts against the original
+ *  four-run loop from adcBufCallback, and of the code-domain kernel
+ *  (EchoDetect_processCodes) against the microvolt pass plus kernel it
+ *  replaces.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o echoDetectBench host/echoDetectBench.c \
+ *        host/echoSynth.c host/captureFile.c host/echoDetect.c -lm
+ *
+ *  Usage: echoDetectBench [capture.txt]
+ *  Without a capture file, synthetic buffers (half of them with an echo) are
+ *  used. Exits non-zero if the kernel ever disagrees with the old loop on
+ *  total_max or on the buzzer decision.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "captureFile.h"
+#include "echoDetect.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+
+#define ADCBUFFERSIZE       (500)
+#define NUM_SYNTH_BUFFERS   (2000)
+#define NUM_REPEATS         (20)
+
+/* Thresholds of rfEchoTx.c and rfEchoRx.c */
+static const uint32_t thresholds[] = { 50000, 15000 };
+
+static volatile uint32_t sink;
+
+/*
+ *  ======== toMicroVolts ========
+ *  The per-sample math of ADCBuf_convertAdjustedToMicroVolts (driverlib
+ *  AUXADCValueToMicrovolts with the 4.3V fixed reference).
+ */
+static void toMicroVolts(const uint16_t *codes, uint32_t *microVolts)
+{
+    int i;
+
+    for (i = 0; i < ADCBUFFERSIZE; i++) {
+        microVolts[i] = ((codes[i] * (ECHO_SYNTH_FULL_SCALE_UV >> 4) + 2047) /
+                         4095) << 4;
+    }
+}
+
+/*
+ *  ======== legacyDetect ========
+ *  The bin loop of adcBufCallback before the single-pass kernel, unchanged
+ *  apart from taking the buffer as a parameter.
+ */
+static void legacyDetect(const uint32_t *microVoltBuffer, uint32_t *totalMaxOut,
+                         uint16_t *savedBinOut)
+{
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint64_t sum = 0;
+    uint32_t bin_average = 0;
+
+    uint16_t run_number = 0;
+    uint32_t run_max = 0;
+
+    uint16_t bin_number = 0;
+    uint16_t saved_bin_number = 0;
+    uint32_t total_max = 0;
+
+    while (run_number < 4) {
+        while (a < (ADCBUFFERSIZE/50)) {
+            while (b < (ADCBUFFERSIZE/10 + 50*a)) {
+                sum = sum + abs((int)microVoltBuffer[b]);
+                b++;
+            }
+            bin_average = sum / 500;
+            if (bin_average > run_max) {
+                run_max = bin_average;
+                saved_bin_number = bin_number;
+            }
+            a++;
+            bin_number++;
+        }
+        a = 0;
+        b = 0;
+        sum = 0;
+        bin_average = 0;
+        if (run_max > total_max) {
+            total_max = run_max;
+        }
+        run_number++;
+    }
+
+    *totalMaxOut = total_max;
+    *savedBinOut = saved_bin_number;
+}
+
+/*
+ *  ======== makeSynthetic ========
+ */
+static uint32_t *makeSynthetic(size_t numBuffers)
+{
+    uint32_t *samples = malloc(numBuffers * ADCBUFFERSIZE * sizeof(uint32_t));
+    EchoSynth_Params params;
+    uint32_t seed = 0x12345678;
+    size_t i;
+
+    if (samples == NULL) {
+        return (NULL);
+    }
+
+    EchoSynth_Params_init(&params);
+    params.noiseUv = 20000;
+
+    for (i = 0; i < numBuffers; i++) {
+        params.echoUv = (i & 1) ? 50000 + (uint32_t)(i % 7) * 40000 : 0;
+        params.echoStart = EchoSynth_uniform(&seed) * ADCBUFFERSIZE;
+        EchoSynth_microVolts(&params, &seed, samples + i * ADCBUFFERSIZE,
+                             ADCBUFFERSIZE);
+    }
+
+    return (samples);
+}
+
+int main(int argc, char *argv[])
+{
+    CaptureFile capture;
+    uint32_t *samples;
+    size_t numBuffers;
+    size_t i;
+    size_t t;
+    int rep;
+    size_t mismatches = 0;
+    size_t binDiffers = 0;
+    uint64_t legacyCycles = 0;
+    uint64_t kernelCycles = 0;
+    uint64_t microVoltCycles = 0;
+    uint64_t codeCycles = 0;
+    uint32_t microVolts[ADCBUFFERSIZE];
+    uint16_t *codes;
+    EchoDetect_Result result;
+
+    if (argc > 1) {
+        if (CaptureFile_load(argv[1], ADCBUFFERSIZE, &capture) != 0) {
+            fprintf(stderr, "cannot read %s\n", argv[1]);
+            return (1);
+        }
+        printf("%s: %zu buffers (%zu short dumps skipped)\n", argv[1],
+               capture.numBuffers, capture.numSkipped);
+        samples = capture.samples;
+        numBuffers = capture.numBuffers;
+    }
+    else {
+        samples = makeSynthetic(NUM_SYNTH_BUFFERS);
+        numBuffers = NUM_SYNTH_BUFFERS;
+        printf("synthetic: %zu buffers\n", numBuffers);
+    }
+
+    if (samples == NULL || numBuffers == 0) {
+        fprintf(stderr, "no buffers to run\n");
+        return (1);
+    }
+
+    codes = malloc(numBuffers * ADCBUFFERSIZE * sizeof(uint16_t));
+    if (codes == NULL) {
+        return (1);
+    }
+    for (i = 0; i < numBuffers * ADCBUFFERSIZE; i++) {
+        codes[i] = EchoSynth_microVoltsToCode(samples[i]);
+    }
+
+    /* Correctness: same total_max and same buzzer decision */
+    for (i = 0; i < numBuffers; i++) {
+        const uint32_t *buffer = samples + i * ADCBUFFERSIZE;
+        uint32_t totalMax;
+        uint16_t savedBin;
+
+        legacyDetect(buffer, &totalMax, &savedBin);
+        EchoDetect_processMicroVolts(buffer, ADCBUFFERSIZE, &result);
+
+        if (result.average != totalMax) {
+            mismatches++;
+        }
+        for (t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++) {
+            bool legacyOn = totalMax > thresholds[t] && savedBin <= 23;
+            bool kernelOn = result.average > thresholds[t] &&
+                result.peakBin <= 23;
+
+            if (legacyOn != kernelOn) {
+                mismatches++;
+            }
+        }
+        if (savedBin != result.peakBin) {
+            binDiffers++;
+        }
+    }
+
+    /* Runtime */
+    for (rep = 0; rep < NUM_REPEATS; rep++) {
+        uint64_t start = HostCycles_now();
+
+        for (i = 0; i < numBuffers; i++) {
+            uint32_t totalMax;
+            uint16_t savedBin;
+
+            legacyDetect(samples + i * ADCBUFFERSIZE, &totalMax, &savedBin);
+            sink += totalMax + savedBin;
+        }
+        legacyCycles += HostCycles_now() - start;
+
+        start = HostCycles_now();
+        for (i = 0; i < numBuffers; i++) {
+            EchoDetect_processMicroVolts(samples + i * ADCBUFFERSIZE,
+                                         ADCBUFFERSIZE, &result);
+            sink += result.average + result.peakBin;
+        }
+        kernelCycles += HostCycles_now() - start;
+
+        start = HostCycles_now();
+        for (i = 0; i < numBuffers; i++) {
+            toMicroVolts(codes + i * ADCBUFFERSIZE, microVolts);
+            EchoDetect_processMicroVolts(microVolts, ADCBUFFERSIZE, &result);
+            sink += result.average + result.peakBin;
+        }
+        microVoltCycles += HostCycles_now() - start;
+
+        start = HostCycles_now();
+        for (i = 0; i < numBuffers; i++) {
+            EchoDetect_processCodes(codes + i * ADCBUFFERSIZE, ADCBUFFERSIZE,
+                                    &result);
+            sink += result.average + result.peakBin;
+        }
+        codeCycles += HostCycles_now() - start;
+    }
+
+    printf("legacy loop : %8.1f %s/buffer\n",
+           (double)legacyCycles / (double)(numBuffers * NUM_REPEATS),
+           HOST_CYCLES_UNIT);
+    printf("single pass : %8.1f %s/buffer\n",
+           (double)kernelCycles / (double)(numBuffers * NUM_REPEATS),
+           HOST_CYCLES_UNIT);
+    printf("speedup     : %8.2fx\n",
+           (double)legacyCycles / (double)kernelCycles);
+    printf("uV + kernel : %8.1f %s/buffer\n",
+           (double)microVoltCycles / (double)(numBuffers * NUM_REPEATS),
+           HOST_CYCLES_UNIT);
+    printf("code domain : %8.1f %s/buffer\n",
+           (double)codeCycles / (double)(numBuffers * NUM_REPEATS),
+           HOST_CYCLES_UNIT);
+    printf("decision mismatches: %zu\n", mismatches);
+    printf("buffers where the old saved_bin_number != true peak bin: %zu\n",
+           binDiffers);
+
+    free(codes);
+    if (argc > 1) {
+        CaptureFile_free(&capture);
+    }
+    else {
+        free(samples);
+    }
+
+    return (mismatches == 0 ? 0 : 1);
+}
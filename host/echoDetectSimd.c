@@ -0,0 +1,182 @@
+/*
+ *  ======== echoDetectSimd.c ========
+ */
+
+#include <stdint.h>
+
+#include "echoDetect.h"
+#include "echoDetectSimd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* ECHO_DETECT_BIN_SIZE is 50: three 16-sample (AVX2) or six 8-sample (SSE2)
+ * loads and a two-sample tail */
+#define TAIL_START(width)   ((ECHO_DETECT_BIN_SIZE / (width)) * (width))
+
+/*
+ *  ======== finish ========
+ *  Peak, count and average from the bin energies, as the firmware does it.
+ */
+static void finish(EchoDetect_Result *result, uint_fast16_t numBins)
+{
+    uint32_t total = 0;
+    uint32_t peakEnergy = 0;
+    uint_fast16_t peakBin = 0;
+    uint_fast16_t bin;
+
+    for (bin = 0; bin < numBins; bin++) {
+        total += result->binEnergy[bin];
+        if (result->binEnergy[bin] > peakEnergy) {
+            peakEnergy = result->binEnergy[bin];
+            peakBin = bin;
+        }
+    }
+
+    result->peakEnergy = peakEnergy;
+    result->peakBin = peakBin;
+    result->numBins = numBins;
+    result->average = (numBins != 0) ?
+        total / (numBins * ECHO_DETECT_BIN_SIZE) : 0;
+}
+
+/*
+ *  ======== tail ========
+ */
+static uint32_t tail(const uint16_t *samples, uint_fast16_t start)
+{
+    uint32_t sum = 0;
+    uint_fast16_t i;
+
+    for (i = start; i < ECHO_DETECT_BIN_SIZE; i++) {
+        sum += samples[i];
+    }
+
+    return (sum);
+}
+
+/*
+ *  ======== processAvx2 ========
+ *  12-bit codes are positive as int16, so vpmaddwd against ones gives exact
+ *  32-bit pair sums.
+ */
+__attribute__((target("avx2")))
+static void processAvx2(const uint16_t *samples, uint_fast16_t numBins,
+                        EchoDetect_Result *result)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    uint_fast16_t bin;
+    uint_fast16_t i;
+
+    for (bin = 0; bin < numBins; bin++) {
+        __m256i acc = _mm256_setzero_si256();
+        __m128i sum;
+
+        for (i = 0; i < TAIL_START(16); i += 16) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(samples + i));
+
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(v, ones));
+        }
+        sum = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                            _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+        result->binEnergy[bin] = (uint32_t)_mm_cvtsi128_si32(sum) +
+            tail(samples, TAIL_START(16));
+        samples += ECHO_DETECT_BIN_SIZE;
+    }
+}
+
+/*
+ *  ======== processSse2 ========
+ */
+__attribute__((target("sse2")))
+static void processSse2(const uint16_t *samples, uint_fast16_t numBins,
+                        EchoDetect_Result *result)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    uint_fast16_t bin;
+    uint_fast16_t i;
+
+    for (bin = 0; bin < numBins; bin++) {
+        __m128i acc = _mm_setzero_si128();
+
+        for (i = 0; i < TAIL_START(8); i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(samples + i));
+
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(v, ones));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+
+        result->binEnergy[bin] = (uint32_t)_mm_cvtsi128_si32(acc) +
+            tail(samples, TAIL_START(8));
+        samples += ECHO_DETECT_BIN_SIZE;
+    }
+}
+
+/*
+ *  ======== hasAvx2 ========
+ */
+static int hasAvx2(void)
+{
+    static int cached = -1;
+
+    if (cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+
+    return (cached);
+}
+
+/*
+ *  ======== EchoDetectSimd_processCodes ========
+ */
+void EchoDetectSimd_processCodes(const uint16_t *samples, uint16_t numSamples,
+                                 EchoDetect_Result *result)
+{
+    uint_fast16_t numBins = numSamples / ECHO_DETECT_BIN_SIZE;
+
+    if (numBins > ECHO_DETECT_MAX_BINS) {
+        numBins = ECHO_DETECT_MAX_BINS;
+    }
+
+    if (hasAvx2()) {
+        processAvx2(samples, numBins, result);
+    }
+    else {
+        processSse2(samples, numBins, result);
+    }
+    finish(result, numBins);
+}
+
+/*
+ *  ======== EchoDetectSimd_isa ========
+ */
+const char *EchoDetectSimd_isa(void)
+{
+    return (hasAvx2() ? "avx2" : "sse2");
+}
+
+#else
+
+/*
+ *  ======== EchoDetectSimd_processCodes ========
+ */
+void EchoDetectSimd_processCodes(const uint16_t *samples, uint16_t numSamples,
+                                 EchoDetect_Result *result)
+{
+    EchoDetect_processCodes(samples, numSamples, result);
+}
+
+/*
+ *  ======== EchoDetectSimd_isa ========
+ */
+const char *EchoDetectSimd_isa(void)
+{
+    return ("scalar");
+}
+
+#endif
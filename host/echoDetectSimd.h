@@ -0,0 +1,27 @@
+/*
+ *  ======== echoDetectSimd.h ========
+ *  SSE2 / AVX2 builds of EchoDetect_processCodes for the host replay tools.
+ *
+ *  Results are bit-exact with EchoDetect_processCodes (host/echoDetect.c,
+ *  the firmware's bin loop): bin energies are integer sums, so the order
+ *  the vector lanes add them in does not matter. The widest instruction set
+ *  the CPU supports is picked at run time; other architectures use
+ *  EchoDetect_processCodes itself.
+ */
+
+#ifndef ECHO_DETECT_SIMD_H
+#define ECHO_DETECT_SIMD_H
+
+#include <stdint.h>
+
+#include "echoDetect.h"
+
+/* Drop-in replacement for EchoDetect_processCodes */
+extern void EchoDetectSimd_processCodes(const uint16_t *samples,
+                                        uint16_t numSamples,
+                                        EchoDetect_Result *result);
+
+/* "avx2", "sse2" or "scalar" */
+extern const char *EchoDetectSimd_isa(void);
+
+#endif /* ECHO_DETECT_SIMD_H */
@@ -0,0 +1,220 @@
+/*
+ *  ======== echoDetectTemplateBench.c ========
+ *  Host benchmark of the compile-time detector (echoDetectTemplate.h)
+ *  against the run-time length kernel it replaces in the firmware
+ *  (echoDetect.c), for several instantiations.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o echoDetectTemplateBench \
+ *        host/echoDetectTemplateBench.c host/echoDetect.c host/echoSynth.c \
+ *        -lm
+ *
+ *  Instantiations:
+ *    Firmware    ADC codes, 7 bins of 50 (the 2m listen window buffer)
+ *    Legacy      ADC codes, 10 bins of 50 (the old 500-sample buffer)
+ *    MicroVolts  microvolts, 10 bins of 50 (the old microvolt pass)
+ *    Fine        ADC codes, 32 bins of 10 (the most with a threshold)
+ *    Short       ADC codes, 7 bins of 8 (the bin length of the bandpass
+ *                sampling mode)
+ *  Each one runs on the same synthetic buffers (half of them with an echo)
+ *  as the run-time length kernel for its bin size (echoDetect.c for 50,
+ *  echoDetectVariant.h for the others). Both share the bin loop, so this
+ *  measures what the constant dimensions and the unrolled bin loop buy, and
+ *  checks the length and average handling and the bins flagged above the
+ *  threshold. Prints cycles per buffer of both and exits with 1 if any
+ *  result differs.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "echoConfig.h"
+#include "echoDetect.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+
+/* Echo level of every instantiation: the DC level of the synthetic buffers,
+ * so that the noise puts bins on both sides of it (the firmware levels,
+ * ECHO_TX_ECHO_LEVEL_UV and ECHO_RX_ECHO_LEVEL_UV, would flag none) */
+#define BENCH_LEVEL_UV      (100000)
+
+#define ECHO_DETECT_TEMPLATE_NAME       Firmware
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint16_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   50
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   7
+#define ECHO_DETECT_TEMPLATE_THRESHOLD \
+    ECHO_UV_TO_CODES(BENCH_LEVEL_UV * 50)
+#include "echoDetectTemplate.h"
+
+#define ECHO_DETECT_TEMPLATE_NAME       Legacy
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint16_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   50
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   10
+#define ECHO_DETECT_TEMPLATE_THRESHOLD \
+    ECHO_UV_TO_CODES(BENCH_LEVEL_UV * 50)
+#include "echoDetectTemplate.h"
+
+#define ECHO_DETECT_TEMPLATE_NAME       MicroVolts
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint32_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   50
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   10
+#define ECHO_DETECT_TEMPLATE_THRESHOLD  (BENCH_LEVEL_UV * 50)
+#include "echoDetectTemplate.h"
+
+#define ECHO_DETECT_TEMPLATE_NAME       Fine
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint16_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   10
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   32
+#define ECHO_DETECT_TEMPLATE_THRESHOLD  ECHO_UV_TO_CODES(BENCH_LEVEL_UV * 10)
+#include "echoDetectTemplate.h"
+
+#define ECHO_DETECT_TEMPLATE_NAME       Short
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint16_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   8
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   7
+#define ECHO_DETECT_TEMPLATE_THRESHOLD  ECHO_UV_TO_CODES(BENCH_LEVEL_UV * 8)
+#include "echoDetectTemplate.h"
+
+#define ECHO_DETECT_VARIANT_SIZE 8
+#include "echoDetectVariant.h"
+#define ECHO_DETECT_VARIANT_SIZE 10
+#include "echoDetectVariant.h"
+
+#define MAX_SAMPLES         (500)
+#define NUM_BUFFERS         (1000)
+#define NUM_REPEATS         (20)
+
+static uint16_t codes[NUM_BUFFERS][MAX_SAMPLES];
+static uint32_t microVolts[NUM_BUFFERS][MAX_SAMPLES];
+
+static int failures;
+
+/*
+ *  ======== BENCH ========
+ *  Defines bench<NAME>(), which checks the instantiation against the
+ *  run-time kernel on every buffer, then times both. Both results carry
+ *  binEnergy / peakEnergy / peakBin / numBins / average; the bins above the
+ *  threshold (overBins) are checked against the run-time bin energies.
+ */
+#define BENCH(NAME, buffers, RUNTIME, RUNTIME_RESULT, label)                  \
+static void bench##NAME(void)                                                 \
+{                                                                             \
+    RUNTIME_RESULT expected;                                                  \
+    NAME##_Result result;                                                     \
+    uint64_t runtimeCycles = ~0ull;                                           \
+    uint64_t templateCycles = ~0ull;                                          \
+    uint64_t start;                                                           \
+    uint64_t elapsed;                                                         \
+    uint32_t checksum = 0;                                                    \
+    uint32_t overBins;                                                        \
+    int flagged = 0;                                                          \
+    int mismatches = 0;                                                       \
+    int r;                                                                    \
+    int b;                                                                    \
+    int i;                                                                    \
+                                                                              \
+    for (b = 0; b < NUM_BUFFERS; b++) {                                       \
+        RUNTIME(buffers[b], NAME##_NUM_SAMPLES, &expected);                   \
+        NAME##_process(buffers[b], &result);                                  \
+        overBins = 0;                                                         \
+        for (i = 0; i < NAME##_NUM_BINS; i++) {                               \
+            if (expected.binEnergy[i] > (uint32_t)NAME##_THRESHOLD) {         \
+                overBins |= (uint32_t)1 << i;                                 \
+            }                                                                 \
+        }                                                                     \
+        flagged += (overBins != 0);                                           \
+        if (expected.numBins != result.numBins ||                             \
+            overBins != result.overBins ||                                    \
+            memcmp(expected.binEnergy, result.binEnergy,                      \
+                   NAME##_NUM_BINS * sizeof(uint32_t)) != 0 ||                \
+            expected.peakEnergy != result.peakEnergy ||                       \
+            expected.peakBin != result.peakBin ||                             \
+            expected.average != result.average) {                             \
+            mismatches++;                                                     \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    /* Best of NUM_REPEATS passes over all buffers */                         \
+    for (r = 0; r < NUM_REPEATS; r++) {                                       \
+        start = HostCycles_now();                                             \
+        for (b = 0; b < NUM_BUFFERS; b++) {                                   \
+            RUNTIME(buffers[b], NAME##_NUM_SAMPLES, &expected);               \
+            checksum += expected.average;                                     \
+        }                                                                     \
+        elapsed = HostCycles_now() - start;                                   \
+        if (elapsed < runtimeCycles) {                                        \
+            runtimeCycles = elapsed;                                          \
+        }                                                                     \
+                                                                              \
+        start = HostCycles_now();                                             \
+        for (b = 0; b < NUM_BUFFERS; b++) {                                   \
+            NAME##_process(buffers[b], &result);                              \
+            checksum += result.average;                                       \
+        }                                                                     \
+        elapsed = HostCycles_now() - start;                                   \
+        if (elapsed < templateCycles) {                                       \
+            templateCycles = elapsed;                                         \
+        }                                                                     \
+    }                                                                         \
+    sink = checksum;                                                          \
+                                                                              \
+    printf("%-11s %-10s %4d x %-3d %8.1f %9.1f %7.2fx %7d %8d\n", #NAME,     \
+           label, NAME##_NUM_BINS, NAME##_NUM_SAMPLES / NAME##_NUM_BINS,      \
+           (double)runtimeCycles / NUM_BUFFERS,                               \
+           (double)templateCycles / NUM_BUFFERS,                              \
+           (double)runtimeCycles / templateCycles, flagged, mismatches);      \
+    failures += mismatches;                                                   \
+}
+
+static volatile uint32_t sink;
+
+BENCH(Firmware, codes, EchoDetect_processCodes, EchoDetect_Result, "codes")
+BENCH(Legacy, codes, EchoDetect_processCodes, EchoDetect_Result, "codes")
+BENCH(MicroVolts, microVolts, EchoDetect_processMicroVolts,
+      EchoDetect_Result, "microvolts")
+BENCH(Fine, codes, echoDetectVariant_10, EchoDetectVariant_Result, "codes")
+BENCH(Short, codes, echoDetectVariant_8, EchoDetectVariant_Result, "codes")
+
+int main(void)
+{
+    EchoSynth_Params params;
+    uint32_t seed = 0x13579bdf;
+    int b;
+    int i;
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = BENCH_LEVEL_UV;
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        params.echoUv = (b & 1) ? 50000 : 0;
+        params.echoStart = EchoSynth_uniform(&seed) * (MAX_SAMPLES - 200);
+        EchoSynth_microVolts(&params, &seed, microVolts[b], MAX_SAMPLES);
+        for (i = 0; i < MAX_SAMPLES; i++) {
+            codes[b][i] = EchoSynth_microVoltsToCode(microVolts[b][i]);
+        }
+    }
+
+    printf("%d buffers, best of %d passes, %s per buffer\n", NUM_BUFFERS,
+           NUM_REPEATS, HOST_CYCLES_UNIT);
+    printf("%-11s %-10s %10s %8s %9s %8s %7s %8s\n", "instance", "samples",
+           "bins", "runtime", "template", "speedup", "flagged", "mismatch");
+    benchFirmware();
+    benchLegacy();
+    benchMicroVolts();
+    benchFine();
+    benchShort();
+
+    printf("thresholds  Firmware %d, Legacy %d, Fine %d, Short %d codes, "
+           "MicroVolts %d uV (per bin)\n", Firmware_THRESHOLD,
+           Legacy_THRESHOLD, Fine_THRESHOLD, Short_THRESHOLD,
+           MicroVolts_THRESHOLD);
+
+    if (failures != 0) {
+        printf("FAIL: %d buffers differ from echoDetect.c\n", failures);
+        return (1);
+    }
+    printf("all instantiations bit-exact with echoDetect.c\n");
+
+    return (0);
+}
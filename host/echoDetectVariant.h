@@ -0,0 +1,77 @@
+/*
+ *  ======== echoDetectVariant.h ========
+ *  Instantiates the firmware bin loop (echoDetectTemplate.h) as a run-time
+ *  length kernel for one bin size, so that several bin sizes can be
+ *  compared in one host binary.
+ *
+ *  Define ECHO_DETECT_VARIANT_SIZE (a plain even number dividing
+ *  ECHO_DETECT_VARIANT_SAMPLES) and include this file. It defines
+ *
+ *    static inline void echoDetectVariant_<size>(const uint16_t *codes,
+ *        uint16_t numSamples, EchoDetectVariant_Result *result);
+ *
+ *  which does what EchoDetect_processCodes does with that bin size. The
+ *  file may be included any number of times with different sizes; sizes
+ *  whose wrapper is not called cost nothing.
+ */
+
+#include <stdint.h>
+
+#ifndef ECHO_DETECT_VARIANT_SAMPLES
+#define ECHO_DETECT_VARIANT_SAMPLES     (500)
+#endif
+
+#ifndef ECHO_DETECT_VARIANT_RESULT
+#define ECHO_DETECT_VARIANT_RESULT
+
+/* Smallest supported bin size is 10 samples */
+#define ECHO_DETECT_VARIANT_MAX_BINS    (ECHO_DETECT_VARIANT_SAMPLES / 10)
+
+typedef struct EchoDetectVariant_Result {
+    uint32_t binEnergy[ECHO_DETECT_VARIANT_MAX_BINS];
+    uint32_t peakEnergy;
+    uint16_t peakBin;
+    uint16_t numBins;
+    uint32_t average;
+} EchoDetectVariant_Result;
+
+#define ECHO_DETECT_VARIANT_CAT2(a, b)  a##b
+#define ECHO_DETECT_VARIANT_CAT(a, b)   ECHO_DETECT_VARIANT_CAT2(a, b)
+
+#endif /* ECHO_DETECT_VARIANT_RESULT */
+
+#define ECHO_DETECT_VARIANT_NAME \
+    ECHO_DETECT_VARIANT_CAT(EchoDetectVariant, ECHO_DETECT_VARIANT_SIZE)
+
+#define ECHO_DETECT_TEMPLATE_NAME       ECHO_DETECT_VARIANT_NAME
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint16_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   ECHO_DETECT_VARIANT_SIZE
+#define ECHO_DETECT_TEMPLATE_NUM_BINS \
+    (ECHO_DETECT_VARIANT_SAMPLES / ECHO_DETECT_VARIANT_SIZE)
+#include "echoDetectTemplate.h"
+
+/*
+ *  ======== echoDetectVariant_<size> ========
+ */
+static inline void ECHO_DETECT_VARIANT_CAT(echoDetectVariant_,
+                                           ECHO_DETECT_VARIANT_SIZE)(
+    const uint16_t *codes, uint16_t numSamples,
+    EchoDetectVariant_Result *result)
+{
+    uint_fast16_t numBins = numSamples / ECHO_DETECT_VARIANT_SIZE;
+    uint32_t total;
+
+    if (numBins > ECHO_DETECT_VARIANT_SAMPLES / ECHO_DETECT_VARIANT_SIZE) {
+        numBins = ECHO_DETECT_VARIANT_SAMPLES / ECHO_DETECT_VARIANT_SIZE;
+    }
+
+    total = ECHO_DETECT_VARIANT_CAT(ECHO_DETECT_VARIANT_NAME, _sweep)(codes,
+        numBins, result->binEnergy, &result->peakEnergy, &result->peakBin);
+
+    result->numBins = numBins;
+    result->average = (numBins != 0) ?
+        total / (numBins * ECHO_DETECT_VARIANT_SIZE) : 0;
+}
+
+#undef ECHO_DETECT_VARIANT_NAME
+#undef ECHO_DETECT_VARIANT_SIZE
@@ -0,0 +1,438 @@
+/*
+ *  ======== echoReplay.c ========
+ *  Re-scores captured ADC buffers with the detection math of adcBufCallback:
+ *  code-domain bin energies (EchoDetect_processCodes) followed by the CFAR
+ *  threshold and the initiator's fixed echo level on every bin (cfar.c,
+ *  ECHO_TX_ECHO_LEVEL_UV), with the firmware settings.
+ *
+ *  Build (from the repository root):
+ *    gcc -O3 -pthread -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o echoReplay host/echoReplay.c \
+ *        host/echoDetectSimd.c host/echoSynth.c rfEchoTxFinal/cfar.c \
+ *        host/echoDetect.c -lm
+ *
+ *  Usage: echoReplay [-r] [-t threads] [-o decisions.csv] [-w codes.bin] [-v]
+ *                    capture...
+ *    -r  inputs are raw little-endian uint16 ADC codes, 500 per buffer (as
+ *        written by -w) instead of the UART "Microvolts:" text dumps
+ *    -t  worker threads (default: all online cores)
+ *    -o  per-buffer CSV: buffer,peakBin,peakEnergy,average,threshold,echo
+ *    -w  write the parsed buffers as raw codes, for faster re-runs with -r
+ *    -v  check every SIMD result against the firmware kernel; exits
+ *        non-zero on any difference
+ *
+ *  Files are mapped with mmap and split across the worker threads, which
+ *  parse and compute the bin energies (SSE2 or AVX2, see echoDetectSimd.c)
+ *  of their share. The CFAR threshold depends on every earlier bin, so it
+ *  then runs on one thread over the bins in file order; CFAR state carries
+ *  over from one input file to the next as it would on the device.
+ *
+ *  Text dumps are turned back into the adjusted ADC codes the firmware
+ *  detector saw with EchoSynth_microVoltsToCode, the exact inverse of
+ *  ADCBuf_convertAdjustedToMicroVolts. Each dump is scored as its own
+ *  listen window (bin 0 is the first bin of the dump). Lines are accepted
+ *  with the same rules as captureFile.c.
+ */
+
+/* memmem */
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cfar.h"
+#include "echoConfig.h"
+#include "echoDetect.h"
+#include "echoDetectSimd.h"
+#include "echoSynth.h"
+
+#define ADCBUFFERSIZE       (500)
+#define MAX_THREADS         (256)
+/* Smallest bin energy of an echo, as compiled into the initiator */
+#define ECHO_LEVEL \
+    ECHO_UV_TO_CODES(ECHO_TX_ECHO_LEVEL_UV * ECHO_BIN_SIZE)
+
+#define MARKER              "Microvolts:"
+
+typedef struct Worker {
+    pthread_t          thread;
+    const char        *begin;       /* Text mode: lines starting in here */
+    const char        *end;
+    const uint16_t    *raw;         /* Raw mode: buffers of this worker */
+    size_t             numRaw;
+    bool               keepCodes;
+    bool               verify;
+    EchoDetect_Result *results;
+    uint16_t          *codes;       /* Only with keepCodes */
+    size_t             numBuffers;
+    size_t             capacity;
+    size_t             numSkipped;
+    size_t             mismatches;
+} Worker;
+
+/*
+ *  ======== now ========
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((double)ts.tv_sec + (double)ts.tv_nsec * 1e-9);
+}
+
+/*
+ *  ======== parseLine ========
+ *  captureFile.c rules on a line that is not NUL terminated: values follow
+ *  "Microvolts:" if present, otherwise the line start; separators are
+ *  spaces, commas and tabs; parsing stops at anything else.
+ */
+static uint32_t parseLine(const char *p, const char *end, uint16_t *codes)
+{
+    const char *marker = memmem(p, end - p, MARKER, sizeof(MARKER) - 1);
+    uint32_t count = 0;
+
+    if (marker != NULL) {
+        p = marker + sizeof(MARKER) - 1;
+    }
+
+    while (p < end && count < ADCBUFFERSIZE) {
+        uint32_t value = 0;
+
+        while (p < end && (*p == ' ' || *p == ',' || *p == '\t')) {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            break;
+        }
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (uint32_t)(*p - '0');
+            p++;
+        }
+        codes[count++] = EchoSynth_microVoltsToCode(value);
+    }
+
+    return (count);
+}
+
+/*
+ *  ======== addBuffer ========
+ */
+static bool addBuffer(Worker *worker, const uint16_t *codes)
+{
+    EchoDetect_Result *result;
+
+    if (worker->numBuffers == worker->capacity) {
+        size_t capacity = (worker->capacity == 0) ? 1024 :
+            worker->capacity * 2;
+        EchoDetect_Result *results = realloc(worker->results,
+            capacity * sizeof(EchoDetect_Result));
+
+        if (results == NULL) {
+            return (false);
+        }
+        worker->results = results;
+
+        if (worker->keepCodes) {
+            uint16_t *grown = realloc(worker->codes,
+                capacity * ADCBUFFERSIZE * sizeof(uint16_t));
+
+            if (grown == NULL) {
+                return (false);
+            }
+            worker->codes = grown;
+        }
+        worker->capacity = capacity;
+    }
+
+    result = &worker->results[worker->numBuffers];
+    EchoDetectSimd_processCodes(codes, ADCBUFFERSIZE, result);
+
+    if (worker->verify) {
+        EchoDetect_Result reference;
+
+        EchoDetect_processCodes(codes, ADCBUFFERSIZE, &reference);
+        if (memcmp(&reference, result, sizeof(reference)) != 0) {
+            worker->mismatches++;
+        }
+    }
+
+    if (worker->keepCodes) {
+        memcpy(worker->codes + worker->numBuffers * ADCBUFFERSIZE, codes,
+               ADCBUFFERSIZE * sizeof(uint16_t));
+    }
+    worker->numBuffers++;
+
+    return (true);
+}
+
+/*
+ *  ======== workerMain ========
+ */
+static void *workerMain(void *arg)
+{
+    Worker *worker = arg;
+    uint16_t codes[ADCBUFFERSIZE];
+    size_t b;
+
+    if (worker->raw != NULL) {
+        for (b = 0; b < worker->numRaw; b++) {
+            if (!addBuffer(worker, worker->raw + b * ADCBUFFERSIZE)) {
+                break;
+            }
+        }
+    }
+    else {
+        const char *p = worker->begin;
+
+        while (p < worker->end) {
+            const char *eol = memchr(p, '\n', worker->end - p);
+            const char *lineEnd = (eol != NULL) ? eol : worker->end;
+            uint32_t count = parseLine(p, lineEnd, codes);
+
+            if (count == ADCBUFFERSIZE) {
+                if (!addBuffer(worker, codes)) {
+                    break;
+                }
+            }
+            else if (count != 0) {
+                worker->numSkipped++;
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== lineStart ========
+ *  First line start at or after offset.
+ */
+static size_t lineStart(const char *text, size_t size, size_t offset)
+{
+    const char *eol;
+
+    if (offset == 0 || offset >= size) {
+        return ((offset == 0) ? 0 : size);
+    }
+    if (text[offset - 1] == '\n') {
+        return (offset);
+    }
+    eol = memchr(text + offset, '\n', size - offset);
+
+    return ((eol != NULL) ? (size_t)(eol - text) + 1 : size);
+}
+
+int main(int argc, char *argv[])
+{
+    static Worker workers[MAX_THREADS];
+    const char *csvPath = NULL;
+    const char *codesPath = NULL;
+    FILE *csv = NULL;
+    FILE *codesFile = NULL;
+    Cfar_Object cfar;
+    bool raw = false;
+    bool verify = false;
+    long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t totalBytes = 0;
+    size_t totalBuffers = 0;
+    size_t totalSkipped = 0;
+    size_t totalMismatches = 0;
+    size_t totalEchoes = 0;
+    double parseSeconds = 0.0;
+    double cfarSeconds = 0.0;
+    int status = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "rt:o:w:v")) != -1) {
+        switch (opt) {
+            case 'r':
+                raw = true;
+                break;
+            case 't':
+                numThreads = atol(optarg);
+                break;
+            case 'o':
+                csvPath = optarg;
+                break;
+            case 'w':
+                codesPath = optarg;
+                break;
+            case 'v':
+                verify = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r] [-t threads] [-o decisions.csv]"
+                        " [-w codes.bin] [-v] capture...\n", argv[0]);
+                return (2);
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "no capture files given\n");
+        return (2);
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    if (numThreads > MAX_THREADS) {
+        numThreads = MAX_THREADS;
+    }
+
+    if (csvPath != NULL) {
+        csv = fopen(csvPath, "w");
+        if (csv == NULL) {
+            fprintf(stderr, "cannot write %s\n", csvPath);
+            return (1);
+        }
+        fprintf(csv, "buffer,peakBin,peakEnergy,average,threshold,echo\n");
+    }
+    if (codesPath != NULL) {
+        codesFile = fopen(codesPath, "wb");
+        if (codesFile == NULL) {
+            fprintf(stderr, "cannot write %s\n", codesPath);
+            return (1);
+        }
+    }
+
+    Cfar_init(&cfar, ECHO_CFAR_SCALE_Q4, ECHO_CFAR_AVERAGE_SHIFT,
+              EchoSynth_microVoltsToCode(ECHO_CFAR_MIN_MARGIN_UV));
+
+    for (; optind < argc; optind++) {
+        const char *path = argv[optind];
+        struct stat st;
+        const char *data;
+        double start;
+        long t;
+        int fd = open(path, O_RDONLY);
+
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            fprintf(stderr, "cannot read %s\n", path);
+            status = 1;
+            if (fd >= 0) {
+                close(fd);
+            }
+            continue;
+        }
+        if (st.st_size == 0) {
+            close(fd);
+            continue;
+        }
+
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "cannot map %s\n", path);
+            status = 1;
+            continue;
+        }
+        madvise((void *)data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+        /* Parse and compute the bins in parallel */
+        start = now();
+        for (t = 0; t < numThreads; t++) {
+            Worker *worker = &workers[t];
+
+            memset(worker, 0, sizeof(*worker));
+            worker->keepCodes = codesFile != NULL;
+            worker->verify = verify;
+
+            if (raw) {
+                size_t numRaw = (size_t)st.st_size /
+                    (ADCBUFFERSIZE * sizeof(uint16_t));
+                size_t first = numRaw * t / numThreads;
+
+                worker->raw = (const uint16_t *)data + first * ADCBUFFERSIZE;
+                worker->numRaw = numRaw * (t + 1) / numThreads - first;
+            }
+            else {
+                size_t size = (size_t)st.st_size;
+
+                worker->begin = data + lineStart(data, size,
+                                                 size * t / numThreads);
+                worker->end = data + lineStart(data, size,
+                                               size * (t + 1) / numThreads);
+            }
+            pthread_create(&worker->thread, NULL, workerMain, worker);
+        }
+        for (t = 0; t < numThreads; t++) {
+            pthread_join(workers[t].thread, NULL);
+        }
+        parseSeconds += now() - start;
+
+        /* CFAR over the bins in file order */
+        start = now();
+        for (t = 0; t < numThreads; t++) {
+            Worker *worker = &workers[t];
+            size_t b;
+
+            for (b = 0; b < worker->numBuffers; b++) {
+                const EchoDetect_Result *result = &worker->results[b];
+                uint32_t threshold = cfar.threshold;
+                bool echo = false;
+                uint16_t i;
+
+                for (i = 0; i < result->numBins; i++) {
+                    if (Cfar_update(&cfar, result->binEnergy[i]) &&
+                        result->binEnergy[i] > ECHO_LEVEL &&
+                        i <= ECHO_MAX_BIN) {
+                        echo = true;
+                    }
+                }
+                totalEchoes += echo;
+
+                if (csv != NULL) {
+                    fprintf(csv, "%zu,%u,%u,%u,%u,%d\n", totalBuffers + b,
+                            result->peakBin, result->peakEnergy,
+                            result->average, threshold, echo);
+                }
+            }
+            if (codesFile != NULL && worker->numBuffers != 0) {
+                fwrite(worker->codes, ADCBUFFERSIZE * sizeof(uint16_t),
+                       worker->numBuffers, codesFile);
+            }
+
+            totalBuffers += worker->numBuffers;
+            totalSkipped += worker->numSkipped;
+            totalMismatches += worker->mismatches;
+            free(worker->results);
+            free(worker->codes);
+        }
+        cfarSeconds += now() - start;
+        totalBytes += (size_t)st.st_size;
+
+        munmap((void *)data, (size_t)st.st_size);
+    }
+
+    if (csv != NULL) {
+        fclose(csv);
+    }
+    if (codesFile != NULL) {
+        fclose(codesFile);
+    }
+
+    printf("%zu buffers (%zu short dumps skipped), %zu with an echo\n",
+           totalBuffers, totalSkipped, totalEchoes);
+    printf("%ld threads, %s kernel: %.2f s parse + bins (%.2f GB/s, "
+           "%.2f Mbuffers/s), %.2f s CFAR\n", numThreads, EchoDetectSimd_isa(),
+           parseSeconds, totalBytes / parseSeconds * 1e-9,
+           totalBuffers / parseSeconds * 1e-6, cfarSeconds);
+    if (verify) {
+        printf("SIMD vs firmware kernel mismatches: %zu\n", totalMismatches);
+        if (totalMismatches != 0) {
+            status = 1;
+        }
+    }
+
+    return (status);
+}
@@ -0,0 +1,472 @@
+/*
+ *  ======== echoSweep.c ========
+ *  Sweeps the echo detector parameters over a labeled capture set and
+ *  prints detection / false alarm (ROC) points and runtime per
+ *  configuration.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -pthread -Ihost -IrfEchoTxFinal -o echoSweep host/echoSweep.c \
+ *        host/echoSynth.c host/captureFile.c rfEchoTxFinal/cfar.c -lm
+ *
+ *  Usage: echoSweep [-j threads] [-o roc.csv] [-p pd] [-f pfa]
+ *                   [echoes.txt noise.txt]
+ *    echoes.txt  capture whose buffers all contain an echo
+ *    noise.txt   capture whose buffers contain none
+ *    -j          worker threads (default: all online cores)
+ *    -o          write every configuration as CSV
+ *    -p / -f     accuracy target for the summary (default 0.95 / 0.01)
+ *  Without capture files a synthetic labeled set is used (rooms with random
+ *  noise levels, echoes 5-10x the noise at random positions).
+ *
+ *  Swept parameters:
+ *    bin size     10, 20, 50, 100 samples; the firmware bin loop
+ *                 (echoDetectTemplate.h) is built once per size, see
+ *                 echoDetectVariant.h
+ *    window       the first 200 ... 500 samples of each buffer
+ *    cutoff       bins starting before 1 ... 2.5ms count (the firmware uses
+ *                 bin <= 23 of 50 samples, i.e. 6ms of a 10ms window)
+ *    detector     CFAR (cfar.c) at 2 ... 12 deviations, or the old fixed
+ *                 threshold on the buffer average at 2 ... 60mV
+ *
+ *  Configurations are handed out to a pool of threads. Each one replays
+ *  the two sets through the firmware code, alternating echo and echo-free
+ *  buffers through its own CFAR state, and times itself. The summary lists the cheapest configurations (fewest samples,
+ *  then fewest cycles) that reach the target.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "captureFile.h"
+#include "cfar.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+
+#define ECHO_DETECT_VARIANT_SIZE 10
+#include "echoDetectVariant.h"
+#define ECHO_DETECT_VARIANT_SIZE 20
+#include "echoDetectVariant.h"
+#define ECHO_DETECT_VARIANT_SIZE 50
+#include "echoDetectVariant.h"
+#define ECHO_DETECT_VARIANT_SIZE 100
+#include "echoDetectVariant.h"
+
+#define ADCBUFFERSIZE       (500)
+#define SAMPLE_RATE_HZ      (200000)
+#define NUM_SYNTH_BUFFERS   (2000)
+#define MAX_THREADS         (256)
+
+/* Same CFAR settings as the firmware apart from the swept scale */
+#define ECHO_CFAR_AVERAGE_SHIFT (6)
+#define ECHO_CFAR_MARGIN_UV     (2000)
+
+typedef void (*Kernel)(const uint16_t *codes, uint16_t numSamples,
+                       EchoDetectVariant_Result *result);
+
+typedef enum Detector {
+    DETECTOR_CFAR,
+    DETECTOR_FIXED
+} Detector;
+
+typedef struct Config {
+    uint16_t binSize;
+    uint16_t windowSamples;
+    uint32_t cutoffUs;
+    Detector detector;
+    uint32_t param;         /* CFAR scale in Q4, or threshold in uV */
+    /* Results */
+    double   pd;
+    double   pfa;
+    double   cycles;        /* Per buffer */
+} Config;
+
+typedef struct LabeledSet {
+    uint16_t *codes;
+    size_t    numBuffers;
+} LabeledSet;
+
+static const uint16_t binSizes[] = { 10, 20, 50, 100 };
+static const Kernel kernels[] = {
+    echoDetectVariant_10, echoDetectVariant_20, echoDetectVariant_50,
+    echoDetectVariant_100
+};
+static const uint16_t windows[] = { 200, 300, 400, 500 };
+static const uint32_t cutoffsUs[] = { 1000, 1500, 2000, 2500 };
+static const uint32_t cfarScalesQ4[] = {
+    32, 48, 64, 80, 96, 112, 128, 160, 192
+};
+static const uint32_t fixedUv[] = {
+    2000, 5000, 10000, 15000, 20000, 30000, 40000, 50000, 60000
+};
+
+#define COUNT(a)    (sizeof(a) / sizeof((a)[0]))
+
+static LabeledSet echoSet;
+static LabeledSet noiseSet;
+static Config *configs;
+static size_t numConfigs;
+static size_t nextConfig;
+
+/*
+ *  ======== kernelFor ========
+ */
+static Kernel kernelFor(uint16_t binSize)
+{
+    size_t k;
+
+    for (k = 0; k < COUNT(binSizes); k++) {
+        if (binSizes[k] == binSize) {
+            return (kernels[k]);
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== detect ========
+ *  The decision adcBufCallback makes for one buffer.
+ */
+static bool detect(const Config *config, Kernel kernel, Cfar_Object *cfar,
+                   const uint16_t *codes, uint16_t lastBin, uint32_t fixedCode)
+{
+    EchoDetectVariant_Result result;
+    bool detected = false;
+    uint16_t i;
+
+    kernel(codes, config->windowSamples, &result);
+
+    if (config->detector == DETECTOR_CFAR) {
+        for (i = 0; i < result.numBins; i++) {
+            if (Cfar_update(cfar, result.binEnergy[i]) && i <= lastBin) {
+                detected = true;
+            }
+        }
+    }
+    else {
+        detected = result.average > fixedCode && result.peakBin <= lastBin;
+    }
+
+    return (detected);
+}
+
+/*
+ *  ======== replay ========
+ *  Runs both sets through a configuration, alternating echo and echo-free
+ *  buffers through one CFAR state the way successive listen windows would
+ *  reach it.
+ */
+static void replay(Config *config)
+{
+    Kernel kernel = kernelFor(config->binSize);
+    uint32_t cutoffSamples = config->cutoffUs * (SAMPLE_RATE_HZ / 1000) /
+        1000;
+    uint16_t lastBin = (uint16_t)((cutoffSamples + config->binSize - 1) /
+        config->binSize - 1);
+    uint32_t fixedCode = EchoSynth_microVoltsToCode(config->param);
+    size_t numBuffers = (echoSet.numBuffers > noiseSet.numBuffers) ?
+        echoSet.numBuffers : noiseSet.numBuffers;
+    size_t hits = 0;
+    size_t falseAlarms = 0;
+    uint64_t cycles = 0;
+    Cfar_Object cfar;
+    size_t b;
+
+    Cfar_init(&cfar, (uint16_t)config->param, ECHO_CFAR_AVERAGE_SHIFT,
+              EchoSynth_microVoltsToCode(ECHO_CFAR_MARGIN_UV *
+                                         config->binSize));
+
+    for (b = 0; b < numBuffers; b++) {
+        uint64_t start = HostCycles_now();
+
+        if (b < echoSet.numBuffers) {
+            hits += detect(config, kernel, &cfar,
+                           echoSet.codes + b * ADCBUFFERSIZE, lastBin,
+                           fixedCode);
+        }
+        if (b < noiseSet.numBuffers) {
+            falseAlarms += detect(config, kernel, &cfar,
+                                  noiseSet.codes + b * ADCBUFFERSIZE, lastBin,
+                                  fixedCode);
+        }
+        cycles += HostCycles_now() - start;
+    }
+
+    config->pd = (double)hits / echoSet.numBuffers;
+    config->pfa = (double)falseAlarms / noiseSet.numBuffers;
+    config->cycles = (double)cycles /
+        (echoSet.numBuffers + noiseSet.numBuffers);
+}
+
+/*
+ *  ======== workerMain ========
+ */
+static void *workerMain(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        size_t c = __atomic_fetch_add(&nextConfig, 1, __ATOMIC_RELAXED);
+
+        if (c >= numConfigs) {
+            break;
+        }
+        replay(&configs[c]);
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== loadSet ========
+ */
+static int loadSet(const char *path, LabeledSet *set)
+{
+    CaptureFile capture;
+    size_t i;
+
+    if (CaptureFile_load(path, ADCBUFFERSIZE, &capture) != 0 ||
+        capture.numBuffers == 0) {
+        fprintf(stderr, "no buffers in %s\n", path);
+        return (-1);
+    }
+
+    set->numBuffers = capture.numBuffers;
+    set->codes = malloc(capture.numBuffers * ADCBUFFERSIZE * sizeof(uint16_t));
+    if (set->codes == NULL) {
+        CaptureFile_free(&capture);
+        return (-1);
+    }
+    for (i = 0; i < capture.numBuffers * ADCBUFFERSIZE; i++) {
+        set->codes[i] = EchoSynth_microVoltsToCode(capture.samples[i]);
+    }
+
+    CaptureFile_free(&capture);
+
+    return (0);
+}
+
+/*
+ *  ======== makeSets ========
+ *  Both sets go through the same sequence of rooms, so buffer b of each
+ *  set has the same noise level.
+ */
+static int makeSets(void)
+{
+    uint32_t microVolts[ADCBUFFERSIZE];
+    EchoSynth_Params params;
+    uint32_t seed = 0xEC40;
+    size_t size = NUM_SYNTH_BUFFERS * ADCBUFFERSIZE * sizeof(uint16_t);
+    size_t b;
+    int n;
+
+    echoSet.numBuffers = NUM_SYNTH_BUFFERS;
+    echoSet.codes = malloc(size);
+    noiseSet.numBuffers = NUM_SYNTH_BUFFERS;
+    noiseSet.codes = malloc(size);
+    if (echoSet.codes == NULL || noiseSet.codes == NULL) {
+        return (-1);
+    }
+
+    EchoSynth_Params_init(&params);
+    for (b = 0; b < NUM_SYNTH_BUFFERS; b++) {
+        /* A new room every 500 buffers */
+        if (b % 500 == 0) {
+            params.noiseUv = 1000 + (uint32_t)(EchoSynth_uniform(&seed) *
+                19000.0);
+        }
+
+        params.echoUv = (uint32_t)(params.noiseUv *
+            (5.0 + 5.0 * EchoSynth_uniform(&seed)));
+        params.echoStart = EchoSynth_uniform(&seed) * 300.0;
+        EchoSynth_microVolts(&params, &seed, microVolts, ADCBUFFERSIZE);
+        for (n = 0; n < ADCBUFFERSIZE; n++) {
+            echoSet.codes[b * ADCBUFFERSIZE + n] =
+                EchoSynth_microVoltsToCode(microVolts[n]);
+        }
+
+        params.echoUv = 0;
+        EchoSynth_microVolts(&params, &seed, microVolts, ADCBUFFERSIZE);
+        for (n = 0; n < ADCBUFFERSIZE; n++) {
+            noiseSet.codes[b * ADCBUFFERSIZE + n] =
+                EchoSynth_microVoltsToCode(microVolts[n]);
+        }
+    }
+
+    return (0);
+}
+
+/*
+ *  ======== cheaper ========
+ *  qsort order for the summary: fewest samples, then fewest cycles.
+ */
+static int cheaper(const void *a, const void *b)
+{
+    const Config *x = *(const Config * const *)a;
+    const Config *y = *(const Config * const *)b;
+
+    if (x->windowSamples != y->windowSamples) {
+        return ((x->windowSamples > y->windowSamples) -
+                (x->windowSamples < y->windowSamples));
+    }
+
+    return ((x->cycles > y->cycles) - (x->cycles < y->cycles));
+}
+
+/*
+ *  ======== printConfig ========
+ */
+static void printConfig(FILE *out, const Config *config, bool csv)
+{
+    const char *name = (config->detector == DETECTOR_CFAR) ? "cfar" : "fixed";
+    double param = (config->detector == DETECTOR_CFAR) ?
+        config->param / 16.0 : (double)config->param;
+
+    if (csv) {
+        fprintf(out, "%u,%u,%u,%s,%g,%.4f,%.4f,%.1f\n", config->binSize,
+                config->windowSamples, config->cutoffUs, name, param,
+                config->pd, config->pfa, config->cycles);
+    }
+    else {
+        fprintf(out, "%5u %7u %7u %-6s %7g %6.1f%% %6.2f%% %9.1f\n",
+                config->binSize, config->windowSamples, config->cutoffUs,
+                name, param, 100.0 * config->pd, 100.0 * config->pfa,
+                config->cycles);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static pthread_t threads[MAX_THREADS];
+    const char *csvPath = NULL;
+    long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    double targetPd = 0.95;
+    double targetPfa = 0.01;
+    Config **ranked;
+    size_t numRanked = 0;
+    size_t s, w, k, d;
+    long t;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:o:p:f:")) != -1) {
+        switch (opt) {
+            case 'j':
+                numThreads = atol(optarg);
+                break;
+            case 'o':
+                csvPath = optarg;
+                break;
+            case 'p':
+                targetPd = atof(optarg);
+                break;
+            case 'f':
+                targetPfa = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-j threads] [-o roc.csv] [-p pd]"
+                        " [-f pfa] [echoes.txt noise.txt]\n", argv[0]);
+                return (2);
+        }
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    if (numThreads > MAX_THREADS) {
+        numThreads = MAX_THREADS;
+    }
+
+    if (argc - optind >= 2) {
+        if (loadSet(argv[optind], &echoSet) != 0 ||
+            loadSet(argv[optind + 1], &noiseSet) != 0) {
+            return (1);
+        }
+    }
+    else if (makeSets() != 0) {
+        return (1);
+    }
+
+    /* Every combination of the swept parameters */
+    numConfigs = COUNT(binSizes) * COUNT(windows) * COUNT(cutoffsUs) *
+        (COUNT(cfarScalesQ4) + COUNT(fixedUv));
+    configs = calloc(numConfigs, sizeof(Config));
+    ranked = calloc(numConfigs, sizeof(Config *));
+    if (configs == NULL || ranked == NULL) {
+        return (1);
+    }
+    numConfigs = 0;
+    for (s = 0; s < COUNT(binSizes); s++) {
+        for (w = 0; w < COUNT(windows); w++) {
+            for (k = 0; k < COUNT(cutoffsUs); k++) {
+                for (d = 0; d < COUNT(cfarScalesQ4) + COUNT(fixedUv); d++) {
+                    Config *config = &configs[numConfigs++];
+
+                    config->binSize = binSizes[s];
+                    config->windowSamples = windows[w];
+                    config->cutoffUs = cutoffsUs[k];
+                    if (d < COUNT(cfarScalesQ4)) {
+                        config->detector = DETECTOR_CFAR;
+                        config->param = cfarScalesQ4[d];
+                    }
+                    else {
+                        config->detector = DETECTOR_FIXED;
+                        config->param = fixedUv[d - COUNT(cfarScalesQ4)];
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%zu echo / %zu echo-free buffers, %zu configurations, "
+           "%ld threads\n", echoSet.numBuffers, noiseSet.numBuffers,
+           numConfigs, numThreads);
+
+    for (t = 0; t < numThreads; t++) {
+        pthread_create(&threads[t], NULL, workerMain, NULL);
+    }
+    for (t = 0; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    if (csvPath != NULL) {
+        FILE *csv = fopen(csvPath, "w");
+
+        if (csv == NULL) {
+            fprintf(stderr, "cannot write %s\n", csvPath);
+            return (1);
+        }
+        fprintf(csv, "binSize,windowSamples,cutoffUs,detector,param,pd,pfa,"
+                "cyclesPerBuffer\n");
+        for (s = 0; s < numConfigs; s++) {
+            printConfig(csv, &configs[s], true);
+        }
+        fclose(csv);
+    }
+
+    for (s = 0; s < numConfigs; s++) {
+        if (configs[s].pd >= targetPd && configs[s].pfa <= targetPfa) {
+            ranked[numRanked++] = &configs[s];
+        }
+    }
+    qsort(ranked, numRanked, sizeof(Config *), cheaper);
+
+    printf("\n%zu configurations reach %.1f%% detection at <= %.2f%% false "
+           "alarms; cheapest (%s per buffer):\n", numRanked, 100.0 * targetPd,
+           100.0 * targetPfa, HOST_CYCLES_UNIT);
+    printf("%5s %7s %7s %-6s %7s %7s %7s %9s\n", "bin", "window", "cutoff",
+           "det", "param", "Pd", "Pfa", "cycles");
+    for (s = 0; s < numRanked && s < 10; s++) {
+        printConfig(stdout, ranked[s], false);
+    }
+
+    free(ranked);
+    free(configs);
+    free(echoSet.codes);
+    free(noiseSet.codes);
+
+    return (0);
+}
@@ -0,0 +1,119 @@
+/*
+ *  ======== echoSynth.c ========
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "echoSynth.h"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+/*
+ *  ======== EchoSynth_Params_init ========
+ */
+void EchoSynth_Params_init(EchoSynth_Params *params)
+{
+    params->sampleRateHz = 200000;
+    params->toneHz = 40000;
+    params->burstUs = 1000;
+    params->rampUs = 0;
+    params->biasUv = 0;
+    params->noiseUv = 2000;
+    params->interferenceHz = 5000;
+    params->interferenceUv = 0;
+    params->echoUv = 0;
+    params->echoStart = 0.0;
+}
+
+/*
+ *  ======== EchoSynth_uniform ========
+ */
+double EchoSynth_uniform(uint32_t *seed)
+{
+    uint32_t x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+
+    return ((double)x / 4294967296.0);
+}
+
+/*
+ *  ======== gaussian ========
+ *  Box-Muller, one value per call.
+ */
+static double gaussian(uint32_t *seed)
+{
+    double u1 = EchoSynth_uniform(seed);
+    double u2 = EchoSynth_uniform(seed);
+
+    if (u1 < 1e-12) {
+        u1 = 1e-12;
+    }
+
+    return (sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2));
+}
+
+/*
+ *  ======== EchoSynth_microVolts ========
+ */
+void EchoSynth_microVolts(const EchoSynth_Params *params, uint32_t *seed,
+                          uint32_t *samples, uint32_t numSamples)
+{
+    double burstSamples = (double)params->burstUs * 1e-6 *
+        (double)params->sampleRateHz;
+    double rampSamples = (double)params->rampUs * 1e-6 *
+        (double)params->sampleRateHz;
+    double omega = 2.0 * M_PI * (double)params->toneHz /
+        (double)params->sampleRateHz;
+    double interferenceOmega = 2.0 * M_PI *
+        (double)params->interferenceHz / (double)params->sampleRateHz;
+    double interferencePhase = 2.0 * M_PI * EchoSynth_uniform(seed);
+    uint32_t n;
+
+    for (n = 0; n < numSamples; n++) {
+        double v = (double)params->biasUv +
+            (double)params->noiseUv * gaussian(seed) +
+            (double)params->interferenceUv *
+                sin(interferenceOmega * (double)n + interferencePhase);
+        double t = (double)n - params->echoStart;
+
+        if (params->echoUv != 0 && t >= 0.0 && t < burstSamples) {
+            double envelope = 1.0;
+
+            if (t < rampSamples) {
+                envelope = t / rampSamples;
+            }
+            else if (burstSamples - t < rampSamples) {
+                envelope = (burstSamples - t) / rampSamples;
+            }
+            v += (double)params->echoUv * envelope * sin(omega * t);
+        }
+
+        if (v < 0.0) {
+            v = 0.0;
+        }
+        else if (v > (double)ECHO_SYNTH_FULL_SCALE_UV) {
+            v = (double)ECHO_SYNTH_FULL_SCALE_UV;
+        }
+
+        samples[n] = (uint32_t)(v + 0.5);
+    }
+}
+
+/*
+ *  ======== EchoSynth_microVoltsToCode ========
+ */
+uint16_t EchoSynth_microVoltsToCode(uint32_t microVolts)
+{
+    uint64_t code = ((uint64_t)microVolts * ECHO_SYNTH_CODE_MAX +
+        ECHO_SYNTH_FULL_SCALE_UV / 2) / ECHO_SYNTH_FULL_SCALE_UV;
+
+    return ((code > ECHO_SYNTH_CODE_MAX) ?
+        (uint16_t)ECHO_SYNTH_CODE_MAX : (uint16_t)code);
+}
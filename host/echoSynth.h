@@ -0,0 +1,47 @@
+/*
+ *  ======== echoSynth.h ========
+ *  Synthetic ADC buffers for the host benchmarks.
+ *
+ *  A buffer is Gaussian noise around a DC bias, optionally with a 40kHz echo
+ *  burst starting at a (fractional) sample index. Values below zero are
+ *  clipped the same way the ADC clips them.
+ */
+
+#ifndef ECHO_SYNTH_H
+#define ECHO_SYNTH_H
+
+#include <stdint.h>
+
+/* Fixed 4.3V full scale of the CC26xx ADC with input scaling enabled */
+#define ECHO_SYNTH_FULL_SCALE_UV    (4300000u)
+#define ECHO_SYNTH_CODE_MAX         (4095u)
+
+typedef struct EchoSynth_Params {
+    uint32_t sampleRateHz;     /* ADC sampling frequency */
+    uint32_t toneHz;           /* Carrier of the ultrasonic burst */
+    uint32_t burstUs;          /* Length of the burst */
+    uint32_t rampUs;           /* Linear rise/fall time inside the burst */
+    uint32_t biasUv;           /* DC level of the receiver output */
+    uint32_t noiseUv;          /* RMS of the additive noise */
+    uint32_t interferenceHz;   /* Frequency of a continuous interferer */
+    uint32_t interferenceUv;   /* Its peak amplitude, 0 for none */
+    uint32_t echoUv;           /* Peak amplitude of the echo, 0 for none */
+    double   echoStart;        /* First echo sample, may be fractional */
+} EchoSynth_Params;
+
+/* 200kHz sampling, 40kHz 1ms burst with no ramp, 2mV noise, no
+ * interference and no echo */
+extern void EchoSynth_Params_init(EchoSynth_Params *params);
+
+/* Fills numSamples microvolt values. *seed is a xorshift32 state. */
+extern void EchoSynth_microVolts(const EchoSynth_Params *params,
+                                 uint32_t *seed, uint32_t *samples,
+                                 uint32_t numSamples);
+
+/* Inverse of ADCBuf_convertAdjustedToMicroVolts for a 12-bit code */
+extern uint16_t EchoSynth_microVoltsToCode(uint32_t microVolts);
+
+/* Uniform random number in [0, 1) from a xorshift32 state */
+extern double EchoSynth_uniform(uint32_t *seed);
+
+#endif /* ECHO_SYNTH_H */
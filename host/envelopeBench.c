@@ -0,0 +1,223 @@
+/*
+ *  ======== envelopeBench.c ========
+ *  Host benchmark of the rectify-and-envelope detector with early exit
+ *  (envelope.c) against the full bin kernel plus CFAR threshold that
+ *  adcBufCallback runs by default.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o envelopeBench host/envelopeBench.c \
+ *        host/echoSynth.c rfEchoTxFinal/envelope.c rfEchoTxFinal/cfar.c \
+ *        host/echoDetect.c -lm
+ *
+ *  Reports:
+ *   - detection and false alarm rate of the envelope, and the error of the
+ *     crossing index against the true echo start
+ *   - average-case and worst-case cycles per buffer of both detectors for
+ *     echo-free buffers (quiet blocks only), buffers with an echo at a
+ *     random position, and a load where every other buffer has an echo
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cfar.h"
+#include "echoConfig.h"
+#include "echoDetect.h"
+#include "echoSynth.h"
+#include "envelope.h"
+#include "hostCycles.h"
+
+#define ADCBUFFERSIZE       (500)
+#define NUM_BUFFERS         (4000)
+#define NUM_REPEATS         (10)
+
+static volatile uint32_t sink;
+
+/*
+ *  ======== compareUint64 ========
+ */
+static int compareUint64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return ((x > y) - (x < y));
+}
+
+/*
+ *  ======== makeBuffers ========
+ *  echoEvery: 0 for no echoes, 1 for an echo in every buffer, 2 for every
+ *  other buffer. Echo starts are written to starts[].
+ */
+static uint16_t *makeBuffers(int echoEvery, double *starts)
+{
+    uint16_t *codes = malloc(NUM_BUFFERS * ADCBUFFERSIZE * sizeof(uint16_t));
+    uint32_t microVolts[ADCBUFFERSIZE];
+    EchoSynth_Params params;
+    uint32_t seed = 0xC0FFEE;
+    int b;
+    int n;
+
+    if (codes == NULL) {
+        return (NULL);
+    }
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = 100000;
+    params.noiseUv = 2000;
+
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        bool echo = echoEvery != 0 && (b % echoEvery) == 0;
+
+        params.echoUv = echo ? 20000 : 0;
+        params.echoStart = EchoSynth_uniform(&seed) * (ADCBUFFERSIZE - 200);
+        starts[b] = echo ? params.echoStart : -1.0;
+        EchoSynth_microVolts(&params, &seed, microVolts, ADCBUFFERSIZE);
+        for (n = 0; n < ADCBUFFERSIZE; n++) {
+            codes[b * ADCBUFFERSIZE + n] =
+                EchoSynth_microVoltsToCode(microVolts[n]);
+        }
+    }
+
+    return (codes);
+}
+
+/*
+ *  ======== accuracy ========
+ */
+static void accuracy(void)
+{
+    static double starts[NUM_BUFFERS];
+    uint16_t *codes = makeBuffers(2, starts);
+    Envelope_Object env;
+    double errorSum = 0.0;
+    double errorSq = 0.0;
+    int hits = 0;
+    int falseAlarms = 0;
+    int b;
+
+    if (codes == NULL) {
+        return;
+    }
+
+    Envelope_init(&env, EchoSynth_microVoltsToCode(ECHO_ENVELOPE_THRESHOLD_UV),
+                  ECHO_ENVELOPE_CONFIRM);
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        bool confirmed;
+
+        Envelope_reset(&env);
+        confirmed = Envelope_process(&env, codes + b * ADCBUFFERSIZE,
+                                     ADCBUFFERSIZE, 0);
+        if (starts[b] < 0.0) {
+            falseAlarms += confirmed;
+        }
+        else if (confirmed) {
+            double error = (double)env.crossing - starts[b];
+
+            hits++;
+            errorSum += error;
+            errorSq += error * error;
+        }
+    }
+
+    printf("envelope: %.1f%% detected, %.2f%% false alarms, crossing "
+           "%.1f samples after the echo start (RMS %.1f)\n",
+           200.0 * hits / NUM_BUFFERS, 200.0 * falseAlarms / NUM_BUFFERS,
+           errorSum / hits, sqrt(errorSq / hits));
+
+    free(codes);
+}
+
+/*
+ *  ======== timing ========
+ *  Best-of-NUM_REPEATS cycles for each buffer, then average and worst case
+ *  over the buffers.
+ */
+static void timing(const char *name, int echoEvery)
+{
+    static double starts[NUM_BUFFERS];
+    static uint64_t envelopeCycles[NUM_BUFFERS];
+    static uint64_t binCycles[NUM_BUFFERS];
+    uint16_t *codes = makeBuffers(echoEvery, starts);
+    EchoDetect_Result result;
+    Envelope_Object env;
+    Cfar_Object cfar;
+    double envelopeSum = 0.0;
+    double binSum = 0.0;
+    int rep;
+    int b;
+
+    if (codes == NULL) {
+        return;
+    }
+
+    Envelope_init(&env, EchoSynth_microVoltsToCode(ECHO_ENVELOPE_THRESHOLD_UV),
+                  ECHO_ENVELOPE_CONFIRM);
+    Cfar_init(&cfar, ECHO_CFAR_SCALE_Q4, ECHO_CFAR_AVERAGE_SHIFT,
+              EchoSynth_microVoltsToCode(ECHO_CFAR_MIN_MARGIN_UV));
+
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        envelopeCycles[b] = UINT64_MAX;
+        binCycles[b] = UINT64_MAX;
+    }
+
+    for (rep = 0; rep < NUM_REPEATS; rep++) {
+        for (b = 0; b < NUM_BUFFERS; b++) {
+            const uint16_t *buffer = codes + b * ADCBUFFERSIZE;
+            uint64_t start;
+            uint64_t cycles;
+            uint16_t i;
+
+            start = HostCycles_now();
+            Envelope_reset(&env);
+            sink += Envelope_process(&env, buffer, ADCBUFFERSIZE, 0);
+            cycles = HostCycles_now() - start;
+            if (cycles < envelopeCycles[b]) {
+                envelopeCycles[b] = cycles;
+            }
+
+            start = HostCycles_now();
+            EchoDetect_processCodes(buffer, ADCBUFFERSIZE, &result);
+            for (i = 0; i < result.numBins; i++) {
+                sink += Cfar_update(&cfar, result.binEnergy[i]);
+            }
+            cycles = HostCycles_now() - start;
+            if (cycles < binCycles[b]) {
+                binCycles[b] = cycles;
+            }
+        }
+    }
+
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        envelopeSum += (double)envelopeCycles[b];
+        binSum += (double)binCycles[b];
+    }
+    qsort(envelopeCycles, NUM_BUFFERS, sizeof(uint64_t), compareUint64);
+    qsort(binCycles, NUM_BUFFERS, sizeof(uint64_t), compareUint64);
+
+    printf("%-22s %10.0f %10llu %10.0f %10llu\n", name,
+           envelopeSum / NUM_BUFFERS,
+           (unsigned long long)envelopeCycles[NUM_BUFFERS - 1],
+           binSum / NUM_BUFFERS,
+           (unsigned long long)binCycles[NUM_BUFFERS - 1]);
+
+    free(codes);
+}
+
+int main(void)
+{
+    accuracy();
+
+    printf("\n%s per %u-sample buffer\n", HOST_CYCLES_UNIT, ADCBUFFERSIZE);
+    printf("%-22s %10s %10s %10s %10s\n", "load", "env avg", "env worst",
+           "bins avg", "bins worst");
+    timing("no echo", 0);
+    timing("echo in every buffer", 1);
+    timing("echo every other", 2);
+
+    return (0);
+}
@@ -0,0 +1,77 @@
+/*
+ *  ======== eventQueue.c ========
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eventQueue.h"
+
+/*
+ *  ======== EventQueue_init ========
+ */
+void EventQueue_init(EventQueue *queue, EventQueue_Event *events,
+                     uint32_t capacity)
+{
+    queue->events = events;
+    queue->capacity = capacity;
+    queue->count = 0;
+}
+
+/*
+ *  ======== EventQueue_push ========
+ */
+void EventQueue_push(EventQueue *queue, double time, uint8_t type,
+                     uint16_t id)
+{
+    EventQueue_Event *events = queue->events;
+    uint32_t i = queue->count++;
+
+    if (i >= queue->capacity) {
+        fprintf(stderr, "event queue full (%u events)\n", queue->capacity);
+        exit(2);
+    }
+    while (i > 0 && events[(i - 1) / 2].time > time) {
+        events[i] = events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    events[i].time = time;
+    events[i].type = type;
+    events[i].id = id;
+}
+
+/*
+ *  ======== EventQueue_pop ========
+ */
+bool EventQueue_pop(EventQueue *queue, EventQueue_Event *event)
+{
+    EventQueue_Event *events = queue->events;
+    EventQueue_Event last;
+    uint32_t i = 0;
+
+    if (queue->count == 0) {
+        return (false);
+    }
+    *event = events[0];
+    last = events[--queue->count];
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+
+        if (child >= queue->count) {
+            break;
+        }
+        if (child + 1 < queue->count &&
+            events[child + 1].time < events[child].time) {
+            child++;
+        }
+        if (events[child].time >= last.time) {
+            break;
+        }
+        events[i] = events[child];
+        i = child;
+    }
+    events[i] = last;
+
+    return (true);
+}
@@ -0,0 +1,36 @@
+/*
+ *  ======== eventQueue.h ========
+ *  Time-ordered event queue (binary min-heap) for the discrete-event
+ *  simulations. The caller provides the storage.
+ */
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct EventQueue_Event {
+    double   time;              /* Simulated time in us */
+    uint8_t  type;              /* Meaning is up to the simulation */
+    uint16_t id;                /* Node the event belongs to */
+} EventQueue_Event;
+
+typedef struct EventQueue {
+    EventQueue_Event *events;
+    uint32_t          capacity;
+    uint32_t          count;
+} EventQueue;
+
+extern void EventQueue_init(EventQueue *queue, EventQueue_Event *events,
+                            uint32_t capacity);
+
+/* Exits if the queue is full */
+extern void EventQueue_push(EventQueue *queue, double time, uint8_t type,
+                            uint16_t id);
+
+/* Earliest event (the first pushed of equal times is not guaranteed);
+ * returns false if the queue is empty */
+extern bool EventQueue_pop(EventQueue *queue, EventQueue_Event *event);
+
+#endif /* EVENT_QUEUE_H */
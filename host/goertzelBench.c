@@ -0,0 +1,201 @@
+/*
+ *  ======== goertzelBench.c ========
+ *  Host benchmark of the streaming 40kHz Goertzel detector.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o goertzelBench host/goertzelBench.c \
+ *        host/echoSynth.c rfEchoTxFinal/goertzel.c host/echoDetect.c -lm
+ *
+ *  Reports:
+ *   - throughput of Goertzel_process fed in ping-pong halves
+ *   - detection rate at a 1% false alarm rate of the tone power against the
+ *     broadband buffer average used by adcBufCallback, with and without an
+ *     audio-band interferer, for full (500-sample) and shortened windows
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "echoDetect.h"
+#include "echoSynth.h"
+#include "goertzel.h"
+#include "hostCycles.h"
+
+#define ADCBUFFERSIZE   (500)
+#define WINDOW_LENGTH   (50)
+#define NUM_WINDOWS     (ADCBUFFERSIZE / WINDOW_LENGTH)
+#define NUM_TRIALS      (2000)
+#define NUM_BUFFERS     (1024)
+
+static volatile uint32_t sink;
+
+/*
+ *  ======== compareUint32 ========
+ */
+static int compareUint32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return ((x > y) - (x < y));
+}
+
+/*
+ *  ======== statistics ========
+ *  Tone statistic: largest window power in the first numSamples.
+ *  Broadband statistic: average of the first numSamples microvolts.
+ */
+static void statistics(const uint32_t *microVolts, uint16_t numSamples,
+                       uint32_t *tone, uint32_t *broadband)
+{
+    static uint16_t codes[ADCBUFFERSIZE];
+    uint32_t powers[NUM_WINDOWS];
+    Goertzel_Object goertzel;
+    EchoDetect_Result result;
+    uint16_t numPowers;
+    uint16_t i;
+
+    for (i = 0; i < numSamples; i++) {
+        codes[i] = EchoSynth_microVoltsToCode(microVolts[i]);
+    }
+
+    Goertzel_init(&goertzel, WINDOW_LENGTH);
+    numPowers = Goertzel_process(&goertzel, codes, numSamples, powers,
+                                 NUM_WINDOWS);
+    *tone = 0;
+    for (i = 0; i < numPowers; i++) {
+        if (powers[i] > *tone) {
+            *tone = powers[i];
+        }
+    }
+
+    EchoDetect_processMicroVolts(microVolts, numSamples, &result);
+    *broadband = result.average;
+}
+
+/*
+ *  ======== detection ========
+ */
+static void detection(uint32_t interferenceUv, uint16_t numSamples)
+{
+    static uint32_t noiseTone[NUM_TRIALS];
+    static uint32_t noiseBroadband[NUM_TRIALS];
+    uint32_t microVolts[ADCBUFFERSIZE];
+    EchoSynth_Params params;
+    uint32_t seed = 0xBEEF;
+    uint32_t toneThreshold;
+    uint32_t broadbandThreshold;
+    int toneHits = 0;
+    int broadbandHits = 0;
+    int trial;
+
+    EchoSynth_Params_init(&params);
+    params.noiseUv = 20000;
+    params.biasUv = 1000000;
+    params.interferenceUv = interferenceUv;
+
+    /* Thresholds for a 1% false alarm rate on echo-free buffers */
+    for (trial = 0; trial < NUM_TRIALS; trial++) {
+        EchoSynth_microVolts(&params, &seed, microVolts, numSamples);
+        statistics(microVolts, numSamples, &noiseTone[trial],
+                   &noiseBroadband[trial]);
+    }
+    qsort(noiseTone, NUM_TRIALS, sizeof(uint32_t), compareUint32);
+    qsort(noiseBroadband, NUM_TRIALS, sizeof(uint32_t), compareUint32);
+    toneThreshold = noiseTone[NUM_TRIALS * 99 / 100];
+    broadbandThreshold = noiseBroadband[NUM_TRIALS * 99 / 100];
+
+    params.echoUv = 15000;
+    for (trial = 0; trial < NUM_TRIALS; trial++) {
+        uint32_t tone;
+        uint32_t broadband;
+
+        params.echoStart = EchoSynth_uniform(&seed) *
+            (numSamples - WINDOW_LENGTH);
+        EchoSynth_microVolts(&params, &seed, microVolts, numSamples);
+        statistics(microVolts, numSamples, &tone, &broadband);
+
+        toneHits += tone > toneThreshold;
+        broadbandHits += broadband > broadbandThreshold;
+    }
+
+    printf("%8u uV %6u smp %13.1f%% %13.1f%%\n", interferenceUv, numSamples,
+           100.0 * toneHits / NUM_TRIALS, 100.0 * broadbandHits / NUM_TRIALS);
+}
+
+/*
+ *  ======== throughput ========
+ */
+static void throughput(void)
+{
+    uint16_t *codes = malloc(NUM_BUFFERS * ADCBUFFERSIZE * sizeof(uint16_t));
+    uint32_t microVolts[ADCBUFFERSIZE];
+    uint32_t powers[NUM_WINDOWS];
+    EchoSynth_Params params;
+    Goertzel_Object goertzel;
+    uint32_t seed = 7;
+    uint64_t start;
+    double seconds;
+    int rep;
+    int i;
+    int n;
+
+    if (codes == NULL) {
+        return;
+    }
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = 100000;
+    params.echoUv = 50000;
+    for (i = 0; i < NUM_BUFFERS; i++) {
+        params.echoStart = (double)(i % 300);
+        EchoSynth_microVolts(&params, &seed, microVolts, ADCBUFFERSIZE);
+        for (n = 0; n < ADCBUFFERSIZE; n++) {
+            codes[i * ADCBUFFERSIZE + n] =
+                EchoSynth_microVoltsToCode(microVolts[n]);
+        }
+    }
+
+    Goertzel_init(&goertzel, WINDOW_LENGTH);
+    seconds = HostCycles_seconds();
+    start = HostCycles_now();
+    for (rep = 0; rep < 20; rep++) {
+        for (i = 0; i < NUM_BUFFERS; i++) {
+            const uint16_t *buffer = codes + i * ADCBUFFERSIZE;
+            uint16_t count;
+
+            /* Two ping-pong halves per buffer */
+            count = Goertzel_process(&goertzel, buffer, ADCBUFFERSIZE / 2,
+                                     powers, NUM_WINDOWS);
+            count += Goertzel_process(&goertzel, buffer + ADCBUFFERSIZE / 2,
+                                      ADCBUFFERSIZE / 2, powers + count,
+                                      NUM_WINDOWS - count);
+            sink += powers[0] + count;
+        }
+    }
+    seconds = HostCycles_seconds() - seconds;
+
+    printf("throughput: %.1f %s per %u-sample buffer, %.1f Msamples/s\n",
+           (double)(HostCycles_now() - start) / (20.0 * NUM_BUFFERS),
+           HOST_CYCLES_UNIT, ADCBUFFERSIZE,
+           20.0 * NUM_BUFFERS * ADCBUFFERSIZE / seconds * 1e-6);
+
+    free(codes);
+}
+
+int main(void)
+{
+    throughput();
+
+    printf("\ndetection rate at 1%% false alarms, 15mV echo in 20mV RMS noise\n");
+    printf("%11s %10s %14s %14s\n", "5kHz tone", "window", "Goertzel",
+           "average");
+    detection(0, ADCBUFFERSIZE);
+    detection(200000, ADCBUFFERSIZE);
+    detection(0, ADCBUFFERSIZE / 2);
+    detection(200000, ADCBUFFERSIZE / 2);
+
+    return (0);
+}
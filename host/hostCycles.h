@@ -0,0 +1,44 @@
+/*
+ *  ======== hostCycles.h ========
+ *  Cycle/time stamps for the host benchmarks.
+ *
+ *  On x86 the TSC is used so results read as "cycles"; elsewhere the
+ *  monotonic clock is used and results are nanoseconds.
+ */
+
+#ifndef HOST_CYCLES_H
+#define HOST_CYCLES_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HOST_CYCLES_UNIT    "cycles"
+
+static inline uint64_t HostCycles_now(void)
+{
+    return (__rdtsc());
+}
+#else
+#define HOST_CYCLES_UNIT    "ns"
+
+static inline uint64_t HostCycles_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+#endif
+
+/* Wall-clock seconds, for throughput figures */
+static inline double HostCycles_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec + (double)ts.tv_nsec * 1e-9);
+}
+
+#endif /* HOST_CYCLES_H */
@@ -0,0 +1,203 @@
+/*
+ *  ======== matchedFilterBench.c ========
+ *  Host replay bench for the matched-filter time-of-flight estimator.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -IrfEchoTxFinal -o matchedFilterBench \
+ *        host/matchedFilterBench.c host/echoSynth.c host/captureFile.c \
+ *        rfEchoTxFinal/matchedFilter.c -lm
+ *
+ *  Usage: matchedFilterBench [capture.txt]
+ *  Without arguments, echoes with a known fractional start are synthesized
+ *  at several SNRs and the arrival error is reported. With a capture file
+ *  the recorded buffers are replayed and the estimated arrivals printed.
+ *  Runtime per 500-sample buffer is reported in both cases.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "captureFile.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+#include "matchedFilter.h"
+
+#define ADCBUFFERSIZE   (500)
+#define NUM_TRIALS      (2000)
+
+static volatile uint32_t sink;
+
+/*
+ *  ======== toCodes ========
+ */
+static void toCodes(const uint32_t *microVolts, uint16_t *codes, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        codes[i] = EchoSynth_microVoltsToCode(microVolts[i]);
+    }
+}
+
+/*
+ *  ======== runBuffer ========
+ *  Feeds one buffer as two halves, like the ADC ping-pong delivers it.
+ */
+static void runBuffer(MatchedFilter_Object *filter, const uint16_t *codes,
+                      MatchedFilter_Result *result)
+{
+    MatchedFilter_reset(filter);
+    MatchedFilter_process(filter, codes, ADCBUFFERSIZE / 2);
+    MatchedFilter_process(filter, codes + ADCBUFFERSIZE / 2,
+                          ADCBUFFERSIZE / 2);
+    MatchedFilter_getResult(filter, result);
+}
+
+/*
+ *  ======== accuracy ========
+ *  rampUs models the transducer ring-up; 0 is the ideal rectangular burst.
+ */
+static void accuracy(uint32_t rampUs)
+{
+    static const uint32_t echoLevels[] = { 400000, 100000, 40000, 20000 };
+    static MatchedFilter_Object filter;
+    EchoSynth_Params params;
+    uint32_t microVolts[ADCBUFFERSIZE];
+    uint16_t codes[ADCBUFFERSIZE];
+    uint32_t seed = 0xC0FFEE;
+    size_t level;
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = 1000000;
+    params.noiseUv = 20000;
+    params.rampUs = rampUs;
+
+    printf("echo ramp %u us\n", rampUs);
+    printf("%10s %8s %10s %10s %10s %8s\n", "echo uV", "SNR dB",
+           "bias smp", "rms smp", "max smp", "rms us");
+
+    for (level = 0; level < sizeof(echoLevels) / sizeof(echoLevels[0]);
+         level++) {
+        double sum = 0.0;
+        double sumSq = 0.0;
+        double worst = 0.0;
+        int trial;
+
+        params.echoUv = echoLevels[level];
+
+        for (trial = 0; trial < NUM_TRIALS; trial++) {
+            MatchedFilter_Result result;
+            double error;
+
+            params.echoStart = 20.0 + EchoSynth_uniform(&seed) *
+                (ADCBUFFERSIZE - MATCHED_FILTER_LENGTH - 40);
+            EchoSynth_microVolts(&params, &seed, microVolts, ADCBUFFERSIZE);
+            toCodes(microVolts, codes, ADCBUFFERSIZE);
+
+            runBuffer(&filter, codes, &result);
+
+            error = (double)result.arrival /
+                (double)(1 << MATCHED_FILTER_FRAC_BITS) - params.echoStart;
+            sum += error;
+            sumSq += error * error;
+            if (fabs(error) > worst) {
+                worst = fabs(error);
+            }
+        }
+
+        printf("%10u %8.1f %10.3f %10.3f %10.3f %8.2f\n", echoLevels[level],
+               20.0 * log10((double)echoLevels[level] / sqrt(2.0) /
+                            (double)params.noiseUv),
+               sum / NUM_TRIALS, sqrt(sumSq / NUM_TRIALS), worst,
+               sqrt(sumSq / NUM_TRIALS) * 1e6 / MATCHED_FILTER_SAMPLE_RATE_HZ);
+    }
+}
+
+/*
+ *  ======== runtime ========
+ */
+static void runtime(const uint16_t *codes, size_t numBuffers)
+{
+    static MatchedFilter_Object filter;
+    MatchedFilter_Result result;
+    uint64_t start;
+    size_t rep;
+    size_t i;
+    const size_t repeats = (numBuffers < 1000) ? 1000 / numBuffers + 1 : 1;
+
+    start = HostCycles_now();
+    for (rep = 0; rep < repeats; rep++) {
+        for (i = 0; i < numBuffers; i++) {
+            runBuffer(&filter, codes + i * ADCBUFFERSIZE, &result);
+            sink += result.arrival;
+        }
+    }
+
+    printf("runtime: %.1f %s per %u-sample buffer\n",
+           (double)(HostCycles_now() - start) / (double)(repeats * numBuffers),
+           HOST_CYCLES_UNIT, ADCBUFFERSIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    static MatchedFilter_Object filter;
+    uint16_t *codes;
+    size_t numBuffers;
+    size_t i;
+
+    if (argc > 1) {
+        CaptureFile capture;
+
+        if (CaptureFile_load(argv[1], ADCBUFFERSIZE, &capture) != 0 ||
+            capture.numBuffers == 0) {
+            fprintf(stderr, "no complete buffers in %s\n", argv[1]);
+            return (1);
+        }
+
+        numBuffers = capture.numBuffers;
+        codes = malloc(numBuffers * ADCBUFFERSIZE * sizeof(uint16_t));
+        if (codes == NULL) {
+            return (1);
+        }
+        toCodes(capture.samples, codes, numBuffers * ADCBUFFERSIZE);
+        CaptureFile_free(&capture);
+
+        printf("%8s %12s %14s\n", "buffer", "arrival us", "peak power");
+        for (i = 0; i < numBuffers; i++) {
+            MatchedFilter_Result result;
+
+            runBuffer(&filter, codes + i * ADCBUFFERSIZE, &result);
+            printf("%8zu %12u %14llu\n", i, result.arrivalUs,
+                   (unsigned long long)result.peakPower);
+        }
+    }
+    else {
+        EchoSynth_Params params;
+        uint32_t microVolts[ADCBUFFERSIZE];
+        uint32_t seed = 1;
+
+        accuracy(0);
+        accuracy(100);
+
+        numBuffers = 256;
+        codes = malloc(numBuffers * ADCBUFFERSIZE * sizeof(uint16_t));
+        if (codes == NULL) {
+            return (1);
+        }
+        EchoSynth_Params_init(&params);
+        params.biasUv = 1000000;
+        params.echoUv = 100000;
+        for (i = 0; i < numBuffers; i++) {
+            params.echoStart = (double)(i % 250);
+            EchoSynth_microVolts(&params, &seed, microVolts, ADCBUFFERSIZE);
+            toCodes(microVolts, codes + i * ADCBUFFERSIZE, ADCBUFFERSIZE);
+        }
+    }
+
+    runtime(codes, numBuffers);
+    free(codes);
+
+    return (0);
+}
@@ -0,0 +1,660 @@
+/*
+ *  ======== radioTraceHist.c ========
+ *  Latency histograms from the radio trace (rfEchoTxFinal/radioTrace.h)
+ *  in a capture of the binary UART telemetry.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -IrfEchoTxFinal -o radioTraceHist host/radioTraceHist.c \
+ *        host/telemetryDecode.c rfEchoTxFinal/radioTrace.c \
+ *        rfEchoTxFinal/telemetry.c rfEchoTxFinal/deltaCodec.c
+ *
+ *  Usage: radioTraceHist [-w binUs] [capture.bin]
+ *         radioTraceHist -t
+ *    -w  histogram bin width in microseconds (default: about 20 bins)
+ *    -t  self test: synthetic traces of both boards with known latencies
+ *        go through the firmware's ring, frames and this tool's analysis
+ *
+ *  The events are grouped by the cycle they were recorded in. On the
+ *  initiator (rfEchoTx) a cycle gives the round trip from the end of the
+ *  ping (CMD_PROP_TX done) to the echo (RX entry done); on the responder
+ *  (rfEchoRx) the turnaround from the received ping to the end of the echo
+ *  transmission: TX_DELAY, or ECHO_RF_CHAINED_ECHO's turnaround, plus the
+ *  rest of the packet and the echo on the air. Where the RF core's time
+ *  stamp of the packet was recorded (TELEMETRY_RADIO_PACKET) it replaces
+ *  the time of the callback. Cycles without both events are counted, as
+ *  are the final status of every radio command and the events the
+ *  firmware overwrote before they could be sent.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "radioTrace.h"
+#include "telemetryDecode.h"
+
+/* RF_EventMask bits (ti/drivers/rf/RF.h) */
+#define RF_EVENT_CMD_DONE           (1u << 0)
+#define RF_EVENT_LAST_CMD_DONE      (1u << 1)
+#define RF_EVENT_RX_ENTRY_DONE      (1u << 23)
+
+/* rf_prop_cmd.h / rf_prop_mailbox.h */
+#define CMD_PROP_TX                 (0x3801)
+#define CMD_PROP_RX                 (0x3802)
+#define CMD_PROP_CS                 (0x3805)
+#define PROP_DONE_OK                (0x3400)
+#define PROP_DONE_RXTIMEOUT         (0x3401)
+#define PROP_DONE_BUSY              (0x3408)
+#define PROP_DONE_IDLETIMEOUT       (0x3409)
+#define PROP_DONE_BUSYTIMEOUT       (0x340A)
+
+/* RAT ticks per microsecond */
+#define RAT_TICKS_PER_US            (4)
+
+#define MAX_STATUSES                (32)
+#define MAX_EVENTS \
+    ((TELEMETRY_MAX_PAYLOAD - TELEMETRY_RADIO_TRACE_SIZE) / \
+     TELEMETRY_RADIO_EVENT_SIZE)
+#define READ_SIZE                   (64 * 1024)
+
+typedef struct Latencies {
+    uint32_t *ticks;
+    size_t    count;
+    size_t    capacity;
+} Latencies;
+
+typedef struct StatusCount {
+    uint16_t commandNo;
+    uint16_t status;
+    uint64_t count;
+} StatusCount;
+
+typedef struct Analysis {
+    /* Cycle being collected */
+    bool      open;
+    uint16_t  cycle;
+    bool      haveTx;
+    bool      haveRx;
+    bool      havePacket;       /* rxTime is the packet's time stamp */
+    uint32_t  txTime;           /* RAT time of the end of the TX command */
+    uint32_t  rxTime;           /* RAT time of the received packet */
+
+    Latencies roundTrips;       /* Initiator: TX done to echo received */
+    Latencies turnarounds;      /* Responder: packet received to TX done */
+    uint64_t  cycles;
+    uint64_t  txOnly;           /* No packet received */
+    uint64_t  rxOnly;           /* Nothing sent */
+    uint64_t  neither;
+    uint64_t  events;
+    uint64_t  frames;
+    uint32_t  overwritten;      /* Of the last trace frame */
+    StatusCount statuses[MAX_STATUSES];
+    uint32_t  numStatuses;
+} Analysis;
+
+/*
+ *  ======== addLatency ========
+ */
+static void addLatency(Latencies *latencies, uint32_t ticks)
+{
+    if (latencies->count == latencies->capacity) {
+        latencies->capacity = latencies->capacity ? latencies->capacity * 2 :
+                              1024;
+        latencies->ticks = realloc(latencies->ticks,
+                                   latencies->capacity * sizeof(uint32_t));
+        if (latencies->ticks == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    latencies->ticks[latencies->count++] = ticks;
+}
+
+/*
+ *  ======== addStatus ========
+ */
+static void addStatus(Analysis *analysis, uint16_t commandNo,
+                      uint16_t status)
+{
+    uint32_t i;
+
+    for (i = 0; i < analysis->numStatuses; i++) {
+        if (analysis->statuses[i].commandNo == commandNo &&
+            analysis->statuses[i].status == status) {
+            analysis->statuses[i].count++;
+            return;
+        }
+    }
+    if (analysis->numStatuses < MAX_STATUSES) {
+        analysis->statuses[analysis->numStatuses].commandNo = commandNo;
+        analysis->statuses[analysis->numStatuses].status = status;
+        analysis->statuses[analysis->numStatuses].count = 1;
+        analysis->numStatuses++;
+    }
+}
+
+/*
+ *  ======== closeCycle ========
+ */
+static void closeCycle(Analysis *analysis)
+{
+    if (!analysis->open) {
+        return;
+    }
+    analysis->cycles++;
+    if (analysis->haveTx && analysis->haveRx) {
+        /* RAT times wrap; their distance decides the order */
+        int32_t distance = (int32_t)(analysis->rxTime - analysis->txTime);
+
+        if (distance >= 0) {
+            addLatency(&analysis->roundTrips, (uint32_t)distance);
+        }
+        else {
+            addLatency(&analysis->turnarounds, (uint32_t)-distance);
+        }
+    }
+    else if (analysis->haveTx) {
+        analysis->txOnly++;
+    }
+    else if (analysis->haveRx) {
+        analysis->rxOnly++;
+    }
+    else {
+        analysis->neither++;
+    }
+    analysis->open = false;
+}
+
+/*
+ *  ======== addEvent ========
+ *  Events arrive in the order they were recorded.
+ */
+static void addEvent(Analysis *analysis, const Telemetry_RadioEvent *event)
+{
+    analysis->events++;
+    if (!analysis->open || event->cycle != analysis->cycle) {
+        closeCycle(analysis);
+        analysis->open = true;
+        analysis->cycle = event->cycle;
+        analysis->haveTx = false;
+        analysis->haveRx = false;
+        analysis->havePacket = false;
+    }
+
+    if (event->source == TELEMETRY_RADIO_COMMAND) {
+        addStatus(analysis, event->commandNo, event->status);
+    }
+    /* The TX ends with a callback (the initiator's, or the responder's
+     * chained echo), or when RF_pendCmd returns (the responder's own TX
+     * command, which has no callback) */
+    if (!analysis->haveTx && event->commandNo == CMD_PROP_TX &&
+        (event->source == TELEMETRY_RADIO_COMMAND ||
+         (event->eventsLow & (RF_EVENT_CMD_DONE |
+                              RF_EVENT_LAST_CMD_DONE)))) {
+        analysis->haveTx = true;
+        analysis->txTime = event->ratTime;
+    }
+    if (!analysis->havePacket && event->source == TELEMETRY_RADIO_PACKET) {
+        analysis->haveRx = true;
+        analysis->havePacket = true;
+        analysis->rxTime = event->ratTime;
+    }
+    if (!analysis->haveRx && event->source == TELEMETRY_RADIO_CALLBACK &&
+        (event->eventsLow & RF_EVENT_RX_ENTRY_DONE)) {
+        analysis->haveRx = true;
+        analysis->rxTime = event->ratTime;
+    }
+}
+
+/*
+ *  ======== feed ========
+ */
+static void feed(Analysis *analysis, TelemetryDecode_Object *decoder,
+                 const uint8_t *data, size_t size)
+{
+    static Telemetry_RadioEvent events[MAX_EVENTS];
+    TelemetryDecode_Frame frame;
+
+    while (TelemetryDecode_next(decoder, &data, &size, &frame)) {
+        Telemetry_RadioTrace trace;
+        int numEvents;
+        int i;
+
+        numEvents = TelemetryDecode_radioTrace(&frame, &trace, events,
+                                               MAX_EVENTS);
+        if (numEvents < 0) {
+            continue;
+        }
+        analysis->frames++;
+        analysis->overwritten = trace.overwritten;
+        for (i = 0; i < numEvents; i++) {
+            addEvent(analysis, &events[i]);
+        }
+    }
+}
+
+/*
+ *  ======== compareTicks ========
+ */
+static int compareTicks(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return ((x > y) - (x < y));
+}
+
+/*
+ *  ======== niceWidth ========
+ *  1, 2 or 5 times a power of ten microseconds, about range / 20.
+ */
+static double niceWidth(double rangeUs)
+{
+    double width = 1.0;
+
+    while (width * 20 < rangeUs) {
+        if (width * 2 * 20 >= rangeUs) {
+            return (width * 2);
+        }
+        if (width * 5 * 20 >= rangeUs) {
+            return (width * 5);
+        }
+        width *= 10;
+    }
+
+    return (width);
+}
+
+/*
+ *  ======== printHistogram ========
+ *  Sorts the latencies.
+ */
+static void printHistogram(const char *name, Latencies *latencies,
+                           double widthUs)
+{
+    size_t n = latencies->count;
+    double minUs;
+    double maxUs;
+    double sum = 0;
+    uint64_t peak = 0;
+    uint64_t *bins;
+    size_t numBins;
+    double first;
+    size_t i;
+
+    if (n == 0) {
+        return;
+    }
+    qsort(latencies->ticks, n, sizeof(uint32_t), compareTicks);
+    for (i = 0; i < n; i++) {
+        sum += latencies->ticks[i];
+    }
+    minUs = (double)latencies->ticks[0] / RAT_TICKS_PER_US;
+    maxUs = (double)latencies->ticks[n - 1] / RAT_TICKS_PER_US;
+
+    printf("%s, %zu cycles (us): min %.2f  median %.2f  mean %.2f  "
+           "p99 %.2f  max %.2f\n", name, n, minUs,
+           (double)latencies->ticks[n / 2] / RAT_TICKS_PER_US,
+           sum / n / RAT_TICKS_PER_US,
+           (double)latencies->ticks[(n * 99) / 100] / RAT_TICKS_PER_US,
+           maxUs);
+
+    if (widthUs <= 0) {
+        widthUs = niceWidth(maxUs - minUs);
+    }
+    first = (double)(int64_t)(minUs / widthUs) * widthUs;
+    numBins = (size_t)((maxUs - first) / widthUs) + 1;
+    bins = calloc(numBins, sizeof(uint64_t));
+    if (bins == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0; i < n; i++) {
+        double us = (double)latencies->ticks[i] / RAT_TICKS_PER_US;
+        size_t bin = (size_t)((us - first) / widthUs);
+
+        if (bin >= numBins) {
+            bin = numBins - 1;
+        }
+        if (++bins[bin] > peak) {
+            peak = bins[bin];
+        }
+    }
+    for (i = 0; i < numBins; i++) {
+        int bar = (int)((bins[i] * 50 + peak - 1) / peak);
+
+        printf("  %10.2f .. %10.2f %8llu %.*s\n", first + i * widthUs,
+               first + (i + 1) * widthUs, (unsigned long long)bins[i], bar,
+               "##################################################");
+    }
+    free(bins);
+}
+
+/*
+ *  ======== commandName ========
+ */
+static const char *commandName(uint16_t commandNo)
+{
+    switch (commandNo) {
+        case CMD_PROP_TX:   return ("CMD_PROP_TX");
+        case CMD_PROP_RX:   return ("CMD_PROP_RX");
+        case CMD_PROP_CS:   return ("CMD_PROP_CS");
+        default:            return ("command");
+    }
+}
+
+/*
+ *  ======== statusName ========
+ *  The carrier sense ones count listen-before-talk's busy and clear
+ *  channels.
+ */
+static const char *statusName(uint16_t status)
+{
+    switch (status) {
+        case PROP_DONE_OK:          return (" (ok)");
+        case PROP_DONE_RXTIMEOUT:   return (" (rx timeout)");
+        case PROP_DONE_BUSY:
+        case PROP_DONE_BUSYTIMEOUT: return (" (busy)");
+        case PROP_DONE_IDLETIMEOUT: return (" (idle)");
+        default:                    return ("");
+    }
+}
+
+/*
+ *  ======== printReport ========
+ */
+static void printReport(Analysis *analysis, double widthUs)
+{
+    uint32_t i;
+
+    closeCycle(analysis);
+
+    printf("%llu trace frames, %llu events, %lu overwritten on the board\n",
+           (unsigned long long)analysis->frames,
+           (unsigned long long)analysis->events,
+           (unsigned long)analysis->overwritten);
+    printf("%llu cycles: %zu round trips, %zu turnarounds, %llu without a "
+           "packet received, %llu without a transmission, %llu with "
+           "neither\n", (unsigned long long)analysis->cycles,
+           analysis->roundTrips.count, analysis->turnarounds.count,
+           (unsigned long long)analysis->txOnly,
+           (unsigned long long)analysis->rxOnly,
+           (unsigned long long)analysis->neither);
+    for (i = 0; i < analysis->numStatuses; i++) {
+        const StatusCount *status = &analysis->statuses[i];
+
+        printf("  %-12s 0x%04X status 0x%04X%s: %llu\n",
+               commandName(status->commandNo), status->commandNo,
+               status->status, statusName(status->status),
+               (unsigned long long)status->count);
+    }
+
+    printHistogram("TX done to echo received", &analysis->roundTrips,
+                   widthUs);
+    printHistogram("Packet received to echo sent", &analysis->turnarounds,
+                   widthUs);
+}
+
+/*
+ *  ======== Sim ========
+ *  Self test: a board that records events into the firmware's ring and
+ *  drains it into frames, like sendRadioTrace.
+ */
+typedef struct Sim {
+    RadioTrace_Object trace;
+    Telemetry_Object  telemetry;
+    uint8_t          *stream;
+    size_t            size;
+    size_t            capacity;
+    uint32_t          recorded;
+} Sim;
+
+/*
+ *  ======== simRecord ========
+ */
+static void simRecord(Sim *sim, uint8_t source, uint32_t ratTime,
+                      uint32_t events, uint16_t commandNo, uint16_t status)
+{
+    RadioTrace_record(&sim->trace, source, ratTime, (int16_t)sim->recorded,
+                      events, commandNo, status);
+    sim->recorded++;
+}
+
+/*
+ *  ======== simDrain ========
+ */
+static void simDrain(Sim *sim, uint16_t maxEvents)
+{
+    uint8_t frame[TELEMETRY_FRAME_SIZE(TELEMETRY_MAX_PAYLOAD)];
+    Telemetry_RadioTrace header;
+    uint16_t size;
+
+    while (RadioTrace_pending(&sim->trace) != 0) {
+        header.overwritten = sim->trace.overwritten;
+        header.numEvents = RadioTrace_drain(&sim->trace,
+            &frame[TELEMETRY_HEADER_SIZE + TELEMETRY_RADIO_TRACE_SIZE],
+            maxEvents);
+        header.reserved = 0;
+        memcpy(&frame[TELEMETRY_HEADER_SIZE], &header, sizeof(header));
+        size = Telemetry_finish(&sim->telemetry, TELEMETRY_TYPE_RADIO_TRACE,
+            TELEMETRY_RADIO_TRACE_SIZE +
+            header.numEvents * TELEMETRY_RADIO_EVENT_SIZE, frame);
+
+        if (sim->size + size > sim->capacity) {
+            sim->capacity = (sim->capacity + size) * 2;
+            sim->stream = realloc(sim->stream, sim->capacity);
+            if (sim->stream == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        memcpy(&sim->stream[sim->size], frame, size);
+        sim->size += size;
+    }
+}
+
+/*
+ *  ======== selfTest ========
+ *  Runs numCycles cycles of one board with random latencies (and missed
+ *  packets) from a RAT time just before the wrap, then a stretch without
+ *  draining that overflows the ring. Returns the number of failed checks.
+ */
+static int selfTest(bool initiator, uint32_t numCycles)
+{
+    Sim sim;
+    Analysis analysis;
+    TelemetryDecode_Object decoder;
+    Latencies expected;
+    Latencies *measured;
+    uint32_t ratTime = 0xFFF00000u;
+    uint32_t missed = 0;
+    uint32_t stalled = 0;
+    int failures = 0;
+    uint32_t cycle;
+    size_t i;
+
+    memset(&sim, 0, sizeof(sim));
+    memset(&analysis, 0, sizeof(analysis));
+    memset(&expected, 0, sizeof(expected));
+    RadioTrace_init(&sim.trace);
+    Telemetry_init(&sim.telemetry);
+    srand(initiator ? 1 : 2);
+
+    for (cycle = 0; cycle < numCycles; cycle++) {
+        /* Round trip of a few ms, or TX_DELAY plus the packet */
+        uint32_t latency = initiator ?
+            (uint32_t)(6000 + rand() % 2000) :
+            (uint32_t)(400000 + 1000 + rand() % 200);
+        bool received = (rand() % 10) != 0;
+
+        RadioTrace_startCycle(&sim.trace);
+        ratTime += 4000000;
+        if (initiator) {
+            simRecord(&sim, TELEMETRY_RADIO_CALLBACK, ratTime,
+                      RF_EVENT_CMD_DONE, CMD_PROP_TX, PROP_DONE_OK);
+            if (received) {
+                simRecord(&sim, TELEMETRY_RADIO_CALLBACK, ratTime + latency,
+                          RF_EVENT_RX_ENTRY_DONE, CMD_PROP_RX, 0x0002);
+            }
+            simRecord(&sim, TELEMETRY_RADIO_CALLBACK, ratTime + latency + 40,
+                      RF_EVENT_LAST_CMD_DONE, CMD_PROP_RX,
+                      received ? PROP_DONE_OK : PROP_DONE_RXTIMEOUT);
+            simRecord(&sim, TELEMETRY_RADIO_COMMAND, ratTime + latency + 90,
+                      RF_EVENT_LAST_CMD_DONE, CMD_PROP_RX,
+                      received ? PROP_DONE_OK : PROP_DONE_RXTIMEOUT);
+        }
+        else {
+            simRecord(&sim, TELEMETRY_RADIO_CALLBACK, ratTime,
+                      received ? RF_EVENT_RX_ENTRY_DONE :
+                      RF_EVENT_LAST_CMD_DONE, CMD_PROP_RX, 0x0002);
+            /* The packet's time stamp comes first in the turnaround */
+            if (received) {
+                simRecord(&sim, TELEMETRY_RADIO_PACKET, ratTime - 700,
+                          RF_EVENT_RX_ENTRY_DONE, CMD_PROP_RX, 0x0002);
+            }
+            simRecord(&sim, TELEMETRY_RADIO_COMMAND, ratTime + 60,
+                      RF_EVENT_LAST_CMD_DONE, CMD_PROP_RX,
+                      received ? PROP_DONE_OK : PROP_DONE_RXTIMEOUT);
+            if (received) {
+                simRecord(&sim, TELEMETRY_RADIO_COMMAND, ratTime + latency,
+                          RF_EVENT_LAST_CMD_DONE, CMD_PROP_TX, PROP_DONE_OK);
+            }
+        }
+        if (received) {
+            addLatency(&expected, initiator ? latency : latency + 700);
+        }
+        else {
+            missed++;
+        }
+
+        /* The UART is sometimes busy for a few windows */
+        if (rand() % 4 != 0) {
+            simDrain(&sim, (uint16_t)(1 + rand() % 29));
+        }
+    }
+    simDrain(&sim, 29);
+
+    /* The link stalls: the ring overwrites the oldest events */
+    for (cycle = 0; cycle < 100; cycle++) {
+        RadioTrace_startCycle(&sim.trace);
+        ratTime += 4000000;
+        simRecord(&sim, TELEMETRY_RADIO_COMMAND, ratTime,
+                  RF_EVENT_LAST_CMD_DONE, CMD_PROP_RX, PROP_DONE_RXTIMEOUT);
+        stalled++;
+    }
+    simDrain(&sim, 29);
+
+    TelemetryDecode_init(&decoder);
+    /* Split the stream at odd places, like reads from a serial port */
+    for (i = 0; i < sim.size; i += 777) {
+        feed(&analysis, &decoder, &sim.stream[i],
+             sim.size - i < 777 ? sim.size - i : 777);
+    }
+    closeCycle(&analysis);
+
+    measured = initiator ? &analysis.roundTrips : &analysis.turnarounds;
+    qsort(expected.ticks, expected.count, sizeof(uint32_t), compareTicks);
+    qsort(measured->ticks, measured->count, sizeof(uint32_t), compareTicks);
+    if (measured->count != expected.count ||
+        memcmp(measured->ticks, expected.ticks,
+               expected.count * sizeof(uint32_t)) != 0) {
+        printf("FAIL: %zu latencies, %zu expected or values differ\n",
+               measured->count, expected.count);
+        failures++;
+    }
+    if ((initiator ? analysis.turnarounds.count : analysis.roundTrips.count)
+        != 0) {
+        printf("FAIL: latencies of the other board\n");
+        failures++;
+    }
+    if (analysis.events + analysis.overwritten != sim.recorded ||
+        analysis.overwritten != stalled - RADIO_TRACE_EVENTS) {
+        printf("FAIL: %llu events + %lu overwritten, %lu recorded\n",
+               (unsigned long long)analysis.events,
+               (unsigned long)analysis.overwritten,
+               (unsigned long)sim.recorded);
+        failures++;
+    }
+    /* Missed cycles, plus the stall's cycles that survived in the ring */
+    if ((initiator ? analysis.txOnly : analysis.neither) !=
+        missed + (initiator ? 0 : RADIO_TRACE_EVENTS) ||
+        analysis.cycles != numCycles + RADIO_TRACE_EVENTS) {
+        printf("FAIL: %llu cycles, %llu / %llu without a packet, %lu "
+               "missed\n", (unsigned long long)analysis.cycles,
+               (unsigned long long)analysis.txOnly,
+               (unsigned long long)analysis.neither,
+               (unsigned long)missed);
+        failures++;
+    }
+    if (decoder.lostFrames != 0 || decoder.crcErrors != 0) {
+        printf("FAIL: decoder lost frames\n");
+        failures++;
+    }
+
+    printf("%s: %lu cycles, %lu missed, %zu bytes of trace frames\n",
+           initiator ? "initiator" : "responder", (unsigned long)numCycles,
+           (unsigned long)missed, sim.size);
+    printReport(&analysis, 0);
+    printf("\n");
+
+    free(expected.ticks);
+    free(analysis.roundTrips.ticks);
+    free(analysis.turnarounds.ticks);
+    free(sim.stream);
+
+    return (failures);
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t buffer[READ_SIZE];
+    TelemetryDecode_Object decoder;
+    Analysis analysis;
+    FILE *input = stdin;
+    double widthUs = 0;
+    size_t got;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:t")) != -1) {
+        switch (opt) {
+            case 'w':
+                widthUs = strtod(optarg, NULL);
+                break;
+            case 't': {
+                int failures = selfTest(true, 5000) + selfTest(false, 5000);
+
+                printf("%s\n", failures ? "FAILED" : "PASSED");
+                return (failures ? 1 : 0);
+            }
+            default:
+                fprintf(stderr, "usage: %s [-w binUs] [capture.bin] | -t\n",
+                        argv[0]);
+                return (2);
+        }
+    }
+    if (optind < argc && (input = fopen(argv[optind], "rb")) == NULL) {
+        perror(argv[optind]);
+        return (1);
+    }
+
+    memset(&analysis, 0, sizeof(analysis));
+    TelemetryDecode_init(&decoder);
+    while ((got = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        feed(&analysis, &decoder, buffer, got);
+    }
+    printReport(&analysis, widthUs);
+    fprintf(stderr, "frames %llu, crc errors %llu, lost %llu, skipped %llu "
+            "bytes\n", (unsigned long long)decoder.frames,
+            (unsigned long long)decoder.crcErrors,
+            (unsigned long long)decoder.lostFrames,
+            (unsigned long long)decoder.skippedBytes);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    return (0);
+}
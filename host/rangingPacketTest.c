@@ -0,0 +1,270 @@
+/*
+ *  ======== rangingPacketTest.c ========
+ *  Host round trip of the ranging packet (rangingPacket.c) that the
+ *  initiator sends and the responder echoes.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -IrfEchoTxFinal -o rangingPacketTest \
+ *        host/rangingPacketTest.c rfEchoTxFinal/rangingPacket.c \
+ *        rfEchoTxFinal/telemetry.c
+ *
+ *  Usage: rangingPacketTest [packets]
+ *
+ *  Encodes random packets and decodes them again, as the request and as
+ *  the echo (one byte longer): every field and the direction must come
+ *  back, the device ID must be the first byte (the one the radio's address
+ *  filter checks), and the packet must be refused with every single and
+ *  double bit error, every error burst of up to 16 bits, every other
+ *  length and another version. Then prints the airtime per cycle (packet
+ *  and echo) against the old 30-byte payload at the data rate of
+ *  smartrf_settings.c, and the encode / check cycles against the old
+ *  random fill and memcmp. Exits with 1 on a failure.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostCycles.h"
+#include "rangingPacket.h"
+#include "telemetry.h"
+
+#define PACKET_BITS         (RANGING_PACKET_SIZE * 8)
+
+/* Air format of smartrf_settings.c: 4 preamble bytes, 32-bit sync word,
+ * length byte and 2 CRC bytes around the payload, at 250 kbps (symbol rate
+ * 24MHz / preScale 6 * rateWord 0x10000 / 2^20) */
+#define AIR_OVERHEAD_BYTES  (4 + 4 + 1 + 2)
+#define AIR_BITS_PER_SECOND (250000.0)
+#define OLD_PAYLOAD_LENGTH  (30)
+
+/*
+ *  ======== randomPacket ========
+ */
+static void randomPacket(RangingPacket *packet)
+{
+    packet->deviceId = (uint8_t)rand();
+    packet->sequence = (uint16_t)rand();
+    packet->ratTime = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+/*
+ *  ======== flipBit ========
+ *  Bits are numbered in the order they go on the air and into the CRC,
+ *  most significant bit of each byte first.
+ */
+static void flipBit(uint8_t *data, uint32_t bit)
+{
+    data[bit / 8] ^= (uint8_t)(0x80 >> (bit % 8));
+}
+
+/*
+ *  ======== checkRoundTrip ========
+ *  Returns the number of failed checks of one packet.
+ */
+static uint32_t checkRoundTrip(const RangingPacket *packet)
+{
+    uint8_t data[RANGING_ECHO_SIZE];
+    RangingPacket decoded;
+    uint32_t failures = 0;
+    uint8_t echo;
+    int8_t status;
+
+    RangingPacket_encode(packet, data);
+    if (data[0] != packet->deviceId) {
+        printf("FAIL: device ID %u is not the first byte\n",
+               packet->deviceId);
+        failures++;
+    }
+
+    /* The echo is the request and whatever byte follows it */
+    data[RANGING_PACKET_SIZE] = (uint8_t)rand();
+    for (echo = 0; echo <= 1; echo++) {
+        memset(&decoded, 0xFF, sizeof(decoded));
+        status = RangingPacket_decode(data, RANGING_PACKET_SIZE + echo,
+                                      &decoded);
+        if (status != RANGING_PACKET_OK ||
+            decoded.deviceId != packet->deviceId ||
+            decoded.sequence != packet->sequence ||
+            decoded.ratTime != packet->ratTime || decoded.echo != echo) {
+            printf("FAIL: %s %u / %u / 0x%08x came back as %d, %u / %u / "
+                   "0x%08x / echo %u\n", echo ? "echo" : "request",
+                   packet->deviceId, packet->sequence, packet->ratTime,
+                   status, decoded.deviceId, decoded.sequence,
+                   decoded.ratTime, decoded.echo);
+            failures++;
+        }
+    }
+
+    return (failures);
+}
+
+/*
+ *  ======== checkErrors ========
+ *  Flips every bit pattern of a packet that the CRC has to catch. Returns
+ *  the number of patterns that decoded anyway.
+ */
+static uint32_t checkErrors(const RangingPacket *packet, uint32_t *patterns)
+{
+    uint8_t data[RANGING_PACKET_SIZE];
+    uint8_t corrupted[RANGING_PACKET_SIZE];
+    RangingPacket decoded;
+    uint32_t failures = 0;
+    uint32_t first;
+    uint32_t second;
+    uint32_t burst;
+
+    RangingPacket_encode(packet, data);
+
+    /* Single and double bit errors */
+    for (first = 0; first < PACKET_BITS; first++) {
+        for (second = first; second < PACKET_BITS; second++) {
+            memcpy(corrupted, data, sizeof(data));
+            flipBit(corrupted, first);
+            if (second != first) {
+                flipBit(corrupted, second);
+            }
+            (*patterns)++;
+            if (RangingPacket_decode(corrupted, sizeof(corrupted),
+                                     &decoded) == RANGING_PACKET_OK) {
+                printf("FAIL: bits %u and %u flipped, still decoded\n",
+                       first, second);
+                failures++;
+            }
+        }
+    }
+
+    /* Bursts of up to 16 bits: both ends flipped, anything in between */
+    for (first = 0; first < PACKET_BITS; first++) {
+        for (burst = 0; burst < (1u << 14); burst++) {
+            uint32_t pattern = 1u | (burst << 1) | (1u << 15);
+            uint32_t bit;
+
+            memcpy(corrupted, data, sizeof(data));
+            for (bit = 0; bit < 16 && first + bit < PACKET_BITS; bit++) {
+                if (pattern & (1u << bit)) {
+                    flipBit(corrupted, first + bit);
+                }
+            }
+            (*patterns)++;
+            if (RangingPacket_decode(corrupted, sizeof(corrupted),
+                                     &decoded) == RANGING_PACKET_OK) {
+                printf("FAIL: burst 0x%04x at bit %u still decoded\n",
+                       pattern, first);
+                failures++;
+                return (failures);
+            }
+        }
+    }
+
+    return (failures);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t numPackets = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+    uint8_t data[256];
+    RangingPacket packet;
+    RangingPacket decoded;
+    uint32_t failures = 0;
+    uint32_t patterns = 0;
+    uint32_t length;
+    uint64_t start;
+    uint64_t newCycles;
+    uint64_t oldCycles;
+    volatile uint32_t sink = 0;
+    uint16_t crc;
+    uint32_t i;
+
+    /* Round trip, including the extremes of every field */
+    srand(1);
+    memset(&packet, 0xFF, sizeof(packet));
+    failures += checkRoundTrip(&packet);
+    memset(&packet, 0, sizeof(packet));
+    failures += checkRoundTrip(&packet);
+    for (i = 0; i < numPackets; i++) {
+        randomPacket(&packet);
+        failures += checkRoundTrip(&packet);
+    }
+    printf("Round trip: %u packets of %u bytes\n", numPackets + 2,
+           RANGING_PACKET_SIZE);
+
+    /* Corrupted packets */
+    for (i = 0; i < 8; i++) {
+        randomPacket(&packet);
+        failures += checkErrors(&packet, &patterns);
+    }
+    printf("Bit errors: %u patterns (single, double, bursts <= 16 bits), "
+           "all refused\n", patterns);
+
+    /* Other lengths: the radios accept up to RANGING_ECHO_SIZE, but a
+     * longer packet or a truncated one must not pass */
+    RangingPacket_encode(&packet, data);
+    memset(&data[RANGING_PACKET_SIZE], 0, sizeof(data) - RANGING_PACKET_SIZE);
+    for (length = 0; length < sizeof(data); length++) {
+        if (length != RANGING_PACKET_SIZE && length != RANGING_ECHO_SIZE &&
+            RangingPacket_decode(data, (uint16_t)length, &decoded) !=
+            RANGING_PACKET_E_LENGTH) {
+            printf("FAIL: %u bytes accepted\n", length);
+            failures++;
+        }
+    }
+
+    /* Another version with a valid CRC */
+    data[1] = RANGING_PACKET_VERSION + 1;
+    crc = Telemetry_crc16(0xFFFF, data, RANGING_PACKET_SIZE - 2);
+    data[RANGING_PACKET_SIZE - 2] = (uint8_t)(crc >> 8);
+    data[RANGING_PACKET_SIZE - 1] = (uint8_t)crc;
+    if (RangingPacket_decode(data, RANGING_PACKET_SIZE, &decoded) !=
+        RANGING_PACKET_E_VERSION) {
+        printf("FAIL: version %u accepted\n", RANGING_PACKET_VERSION + 1);
+        failures++;
+    }
+
+    /* Airtime of the packet and its echo */
+    printf("Airtime per cycle at %.0f kbps: %u + %u bytes, %.0f us "
+           "(30-byte payload: %u + %u bytes, %.0f us)\n",
+           AIR_BITS_PER_SECOND / 1000, RANGING_PACKET_SIZE,
+           RANGING_ECHO_SIZE,
+           (RANGING_PACKET_SIZE + RANGING_ECHO_SIZE +
+            2 * AIR_OVERHEAD_BYTES) * 8 * 1e6 / AIR_BITS_PER_SECOND,
+           OLD_PAYLOAD_LENGTH, OLD_PAYLOAD_LENGTH,
+           2 * (OLD_PAYLOAD_LENGTH + AIR_OVERHEAD_BYTES) * 8 * 1e6 /
+           AIR_BITS_PER_SECOND);
+
+    /* Encode and check of the echo, against the random fill and memcmp */
+    start = HostCycles_now();
+    for (i = 0; i < numPackets; i++) {
+        packet.sequence = (uint16_t)i;
+        RangingPacket_encode(&packet, data);
+        sink += (uint32_t)RangingPacket_decode(data, RANGING_PACKET_SIZE,
+                                               &decoded);
+        sink += decoded.sequence;
+    }
+    newCycles = HostCycles_now() - start;
+    start = HostCycles_now();
+    for (i = 0; i < numPackets; i++) {
+        uint32_t j;
+
+        data[0] = (uint8_t)(i >> 8);
+        data[1] = (uint8_t)i;
+        for (j = 2; j < OLD_PAYLOAD_LENGTH; j++) {
+            data[j] = (uint8_t)rand();
+        }
+        sink += (uint32_t)memcmp(data, &data[128], OLD_PAYLOAD_LENGTH);
+        memcpy(&data[128], data, OLD_PAYLOAD_LENGTH);
+    }
+    oldCycles = HostCycles_now() - start;
+    printf("Encode + check: %.1f %s per packet (random fill + memcmp: "
+           "%.1f)\n", (double)newCycles / numPackets, HOST_CYCLES_UNIT,
+           (double)oldCycles / numPackets);
+
+    if (failures != 0) {
+        printf("FAIL (%u)\n", failures);
+        return (1);
+    }
+    printf("OK\n");
+
+    return (0);
+}
@@ -0,0 +1,53 @@
+/*
+ *  ======== rfDataEntry.h ========
+ *  The data entry and queue structs of driverlib/rf_data_entry.h, so
+ *  RFQueue.c builds on a host (RFQueue.h includes this one there). On a
+ *  64-bit host the pointers make the entry header 12 bytes instead of 8;
+ *  RFQueue.h sizes entries with offsetof and sizeof, so the layout math
+ *  is the same.
+ */
+
+#ifndef RF_DATA_ENTRY_H
+#define RF_DATA_ENTRY_H
+
+#include <stdint.h>
+
+/* rfc_dataEntry_t.status */
+#define DATA_ENTRY_PENDING      (0)     /* Free for the RF core */
+#define DATA_ENTRY_ACTIVE       (1)     /* Being received into */
+#define DATA_ENTRY_BUSY         (2)
+#define DATA_ENTRY_FINISHED     (3)     /* Complete, for the application */
+#define DATA_ENTRY_UNFINISHED   (4)
+
+/* rfc_dataEntry_t.config.type */
+#define DATA_ENTRY_TYPE_GEN     (0)
+
+typedef struct {
+    uint8_t *pCurrEntry;
+    uint8_t *pLastEntry;
+} dataQueue_t;
+
+typedef struct {
+    uint8_t *pNextEntry;
+    uint8_t  status;
+    struct {
+        uint8_t type:2;
+        uint8_t lenSz:2;
+        uint8_t irqIntv:4;
+    } config;
+    uint16_t length;
+} rfc_dataEntry_t;
+
+typedef struct {
+    uint8_t *pNextEntry;
+    uint8_t  status;
+    struct {
+        uint8_t type:2;
+        uint8_t lenSz:2;
+        uint8_t irqIntv:4;
+    } config;
+    uint16_t length;
+    uint8_t  data;
+} rfc_dataEntryGeneral_t;
+
+#endif /* RF_DATA_ENTRY_H */
@@ -0,0 +1,329 @@
+/*
+ *  ======== rfQueueTest.c ========
+ *  Host test of the receive queues (RFQueue.c): the entry layout that
+ *  RFQueue_defineQueue builds, and the circular entry chain driven by a
+ *  model of the RF core with several queues in one image.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -IrfEchoTxFinal -o rfQueueTest host/rfQueueTest.c \
+ *        rfEchoTxFinal/RFQueue.c
+ *
+ *  Usage: rfQueueTest [packets]
+ *
+ *  The layout check defines every entry count (1 .. 32) and data length
+ *  (1 .. 300) in a buffer of exactly RF_QUEUE_DATA_ENTRY_BUFFER_SIZE bytes
+ *  and walks the chain: every entry must be aligned and where pNextEntry
+ *  of the one before says, must fit in the buffer without touching the
+ *  guard bytes behind it, and the last must point back to the first. One
+ *  byte less, a misaligned buffer or no entries must be refused.
+ *
+ *  The chain test runs a ranging and a control queue side by side. The
+ *  radio model fills the entry at pCurrEntry and moves on, or drops the
+ *  packet when that entry has not been handed back (nRxBufFull); the
+ *  application reads finished entries with RFQueue_getDataEntry /
+ *  RFQueue_nextEntry. Every packet must come out of its own queue once, in
+ *  order, and only packets that arrive with every entry unread may be
+ *  dropped. Exits with 1 on a failure.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RFQueue.h"
+#include "hostCycles.h"
+#include "rangingPacket.h"
+
+#define MAX_ENTRIES     (32)
+#define MAX_LENGTH      (300)
+#define GUARD_SIZE      (64)
+#define GUARD_BYTE      (0xEE)
+
+/* Model of the RF core filling one queue */
+typedef struct Radio {
+    RFQueue_Object queue;
+    uint8_t       *buffer;
+    uint16_t       length;          /* Data bytes of every entry */
+    uint32_t       sent;            /* Packets that arrived */
+    uint32_t       dropped;         /* No pending entry (nRxBufFull) */
+    uint32_t       read;            /* Packets the application got */
+    uint32_t       unread;          /* Entries finished and not read */
+    uint32_t       numbers[MAX_ENTRIES];   /* Packets in the entries */
+    uint32_t       failures;
+} Radio;
+
+/*
+ *  ======== alignedBuffer ========
+ *  size bytes aligned to RF_QUEUE_ENTRY_ALIGN, followed by guard bytes.
+ */
+static uint8_t *alignedBuffer(size_t size)
+{
+    size_t total = (size + GUARD_SIZE + 63) & ~(size_t)63;
+    uint8_t *buffer = aligned_alloc(64, total);
+
+    if (buffer == NULL) {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    memset(buffer, GUARD_BYTE, total);
+
+    return (buffer);
+}
+
+/*
+ *  ======== checkLayout ========
+ *  Returns the number of failed checks of one geometry.
+ */
+static uint32_t checkLayout(uint16_t numEntries, uint16_t length)
+{
+    RFQueue_Object queue;
+    size_t size = RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(numEntries, length, 0);
+    uint8_t *buffer = alignedBuffer(size);
+    uint8_t *entry;
+    uint32_t failures = 0;
+    uint16_t i;
+
+    if (RFQueue_defineQueue(&queue, buffer, (uint16_t)size - 1, numEntries,
+                            length) == 0) {
+        printf("FAIL: %u x %u accepted in %zu bytes\n", numEntries, length,
+               size - 1);
+        failures++;
+    }
+    if (RFQueue_defineQueue(&queue, buffer + 1, (uint16_t)size, numEntries,
+                            length) == 0) {
+        printf("FAIL: %u x %u accepted in a misaligned buffer\n",
+               numEntries, length);
+        failures++;
+    }
+    memset(buffer, GUARD_BYTE, size + GUARD_SIZE);
+    if (RFQueue_defineQueue(&queue, buffer, (uint16_t)size, numEntries,
+                            length) != 0) {
+        printf("FAIL: %u x %u refused in %zu bytes\n", numEntries, length,
+               size);
+        free(buffer);
+        return (failures + 1);
+    }
+
+    entry = queue.dataQueue.pCurrEntry;
+    if (entry != buffer || (uint8_t *)queue.readEntry != buffer ||
+        queue.dataQueue.pLastEntry != NULL) {
+        printf("FAIL: %u x %u queue does not start at the buffer\n",
+               numEntries, length);
+        failures++;
+    }
+    for (i = 0; i < numEntries; i++) {
+        rfc_dataEntryGeneral_t *general = (rfc_dataEntryGeneral_t *)entry;
+
+        if (entry != buffer + (size_t)i * queue.entrySize ||
+            ((uintptr_t)entry % RF_QUEUE_ENTRY_ALIGN) != 0 ||
+            &general->data + length > buffer + size ||
+            general->status != DATA_ENTRY_PENDING ||
+            general->config.type != DATA_ENTRY_TYPE_GEN ||
+            general->config.lenSz != 0 || general->length != length) {
+            printf("FAIL: %u x %u entry %u at offset %td\n", numEntries,
+                   length, i, entry - buffer);
+            failures++;
+            break;
+        }
+        entry = general->pNextEntry;
+    }
+    if (entry != buffer) {
+        printf("FAIL: %u x %u chain does not close\n", numEntries, length);
+        failures++;
+    }
+    for (i = 0; i < GUARD_SIZE; i++) {
+        if (buffer[size + i] != GUARD_BYTE) {
+            printf("FAIL: %u x %u wrote past the buffer\n", numEntries,
+                   length);
+            failures++;
+            break;
+        }
+    }
+
+    free(buffer);
+
+    return (failures);
+}
+
+/*
+ *  ======== radioInit ========
+ */
+static void radioInit(Radio *radio, uint16_t numEntries, uint16_t length)
+{
+    size_t size = RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(numEntries, length, 0);
+
+    memset(radio, 0, sizeof(*radio));
+    radio->buffer = alignedBuffer(size);
+    radio->length = length;
+    if (RFQueue_defineQueue(&radio->queue, radio->buffer, (uint16_t)size,
+                            numEntries, length) != 0) {
+        printf("FAIL: %u x %u queue refused\n", numEntries, length);
+        exit(1);
+    }
+}
+
+/*
+ *  ======== radioReceive ========
+ *  The RF core receives packet number radio->sent: a length byte and a
+ *  payload made from the packet number, like bIncludeHdr.
+ */
+static void radioReceive(Radio *radio)
+{
+    dataQueue_t *dataQueue = &radio->queue.dataQueue;
+    rfc_dataEntryGeneral_t *entry =
+        (rfc_dataEntryGeneral_t *)dataQueue->pCurrEntry;
+    uint32_t number = radio->sent++;
+    uint8_t *data = (uint8_t *)entry + RF_QUEUE_DATA_ENTRY_HEADER_SIZE;
+    uint16_t i;
+
+    if (entry->status != DATA_ENTRY_PENDING) {
+        if (radio->unread != radio->queue.numEntries) {
+            printf("FAIL: packet %u dropped with %u of %u entries unread\n",
+                   number, radio->unread, radio->queue.numEntries);
+            radio->failures++;
+        }
+        radio->dropped++;
+        return;
+    }
+
+    data[0] = (uint8_t)(radio->length - 1);
+    for (i = 1; i < radio->length; i++) {
+        data[i] = (uint8_t)(number * 7 + i);
+    }
+    entry->status = DATA_ENTRY_FINISHED;
+    dataQueue->pCurrEntry = entry->pNextEntry;
+    radio->numbers[(radio->read + radio->unread) % MAX_ENTRIES] = number;
+    radio->unread++;
+}
+
+/*
+ *  ======== appRead ========
+ *  Reads up to maxEntries finished entries, checking that they are the
+ *  packets that were not dropped, in order.
+ */
+static void appRead(Radio *radio, uint32_t maxEntries)
+{
+    while (maxEntries-- > 0) {
+        rfc_dataEntryGeneral_t *entry = RFQueue_getDataEntry(&radio->queue);
+        const uint8_t *data =
+            (const uint8_t *)entry + RF_QUEUE_DATA_ENTRY_HEADER_SIZE;
+        uint32_t number = radio->numbers[radio->read % MAX_ENTRIES];
+        uint16_t i;
+
+        if (entry->status != DATA_ENTRY_FINISHED) {
+            if (radio->unread != 0) {
+                printf("FAIL: %u entries unread, cursor on a free one\n",
+                       radio->unread);
+                radio->failures++;
+            }
+            return;
+        }
+        /* The oldest packet that was not dropped */
+        for (i = 1; i < radio->length; i++) {
+            if (data[i] != (uint8_t)(number * 7 + i)) {
+                break;
+            }
+        }
+        if (data[0] != (uint8_t)(radio->length - 1) || i != radio->length) {
+            printf("FAIL: entry %u has the wrong packet\n", radio->read);
+            radio->failures++;
+        }
+        radio->read++;
+        radio->unread--;
+        RFQueue_nextEntry(&radio->queue);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t numPackets = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000000;
+    uint32_t failures = 0;
+    uint32_t geometries = 0;
+    Radio ranging;
+    Radio control;
+    uint64_t start;
+    uint64_t cycles;
+    uint16_t numEntries;
+    uint16_t length;
+    uint32_t i;
+
+    /* Layout */
+    for (numEntries = 1; numEntries <= MAX_ENTRIES; numEntries++) {
+        for (length = 1; length <= MAX_LENGTH; length++) {
+            failures += checkLayout(numEntries, length);
+            geometries++;
+        }
+    }
+    {
+        RFQueue_Object queue;
+        uint8_t *buffer = alignedBuffer(64);
+
+        if (RFQueue_defineQueue(&queue, buffer, 64, 0, 32) == 0) {
+            printf("FAIL: queue without entries accepted\n");
+            failures++;
+        }
+        free(buffer);
+    }
+    printf("Layout: %u geometries, entry header %zu bytes, aligned to %zu\n",
+           geometries, (size_t)RF_QUEUE_DATA_ENTRY_HEADER_SIZE,
+           (size_t)RF_QUEUE_ENTRY_ALIGN);
+    printf("  firmware queue (2 x %u + 2 bytes): %zu bytes on this host\n",
+           RANGING_PACKET_SIZE,
+           (size_t)RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(2, RANGING_PACKET_SIZE, 2));
+
+    /* Two queues in one image, drained at their own pace */
+    radioInit(&ranging, 4, 32);
+    radioInit(&control, 7, 13);
+    srand(1);
+    for (i = 0; i < numPackets; i++) {
+        radioReceive((rand() % 3) ? &ranging : &control);
+        if (rand() % 3 == 0) {
+            appRead(&ranging, (uint32_t)(rand() % 6));
+        }
+        if (rand() % 4 == 0) {
+            appRead(&control, (uint32_t)(rand() % 9));
+        }
+    }
+    appRead(&ranging, MAX_ENTRIES);
+    appRead(&control, MAX_ENTRIES);
+    for (i = 0; i < 2; i++) {
+        Radio *radio = i ? &control : &ranging;
+
+        if (radio->read + radio->dropped != radio->sent ||
+            radio->unread != 0) {
+            printf("FAIL: %u sent, %u read, %u dropped\n", radio->sent,
+                   radio->read, radio->dropped);
+            radio->failures++;
+        }
+        printf("%s queue (%u x %u bytes): %u packets, %u read, %u dropped "
+               "on a full ring\n", i ? "Control" : "Ranging",
+               radio->queue.numEntries, radio->length, radio->sent,
+               radio->read, radio->dropped);
+        failures += radio->failures;
+    }
+
+    /* Cost of handing an entry back */
+    start = HostCycles_now();
+    for (i = 0; i < numPackets; i++) {
+        ranging.queue.readEntry->status = DATA_ENTRY_FINISHED;
+        if (RFQueue_nextEntry(&ranging.queue) == 0xFF) {
+            break;
+        }
+    }
+    cycles = HostCycles_now() - start;
+    printf("RFQueue_nextEntry: %.1f %s per entry\n",
+           (double)cycles / numPackets, HOST_CYCLES_UNIT);
+
+    free(ranging.buffer);
+    free(control.buffer);
+
+    if (failures != 0) {
+        printf("FAIL (%u)\n", failures);
+        return (1);
+    }
+    printf("OK\n");
+
+    return (0);
+}
@@ -0,0 +1,480 @@
+/*
+ *  ======== tdmaSim.c ========
+ *  Discrete-event simulation of many initiator / responder pairs in one
+ *  space: the slotted schedule (tdmaSchedule.c, ECHO_TDMA) against every
+ *  initiator ranging once a second on its own clock.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o tdmaSim host/tdmaSim.c \
+ *        host/eventQueue.c rfEchoTxFinal/tdmaSchedule.c \
+ *        rfEchoTxFinal/telemetry.c
+ *
+ *  Usage: tdmaSim [-d seconds] [-s slots] [-l beaconLoss] [-p ppm]
+ *                 [-r decayUs]
+ *    -d  simulated time per run (default 300s, the first 10s not counted)
+ *    -s  slots per frame (default: one per initiator)
+ *    -l  probability that an initiator misses a beacon (default 0.01)
+ *    -p  clock error of every device, uniform in +-ppm (default 40)
+ *    -r  how long the bursts of an exchange stay audible after its listen
+ *        window (default 5000us, half of ECHO_TDMA_GUARD_US)
+ *
+ *  Everyone hears everyone: an exchange (burst, packet, echo, burst and
+ *  listen window, then the decay) fails when it overlaps another one. Each
+ *  device runs its own RAT clock with its own offset and rate error. With
+ *  the schedule, initiator 0 sends a beacon every frame and the others run
+ *  the firmware's TdmaSchedule code on their own clocks: they sync to the
+ *  beacon's time stamp, bridge missed beacons and search again when they
+ *  lose the schedule. Without it, every initiator starts at a random time
+ *  and ranges every second plus the time its exchange takes.
+ *
+ *  Responders either filter on the ID of their initiator (ECHO_PAIR_ID,
+ *  "pair") or echo every ranging packet they hear ("any", without the
+ *  address filter): then every responder echoes every initiator's packet
+ *  at the same turnaround, so the echoes collide on air and the other
+ *  responders' bursts land in the listen window, and the exchange fails
+ *  as soon as a second pair is in range. Echoes are one byte longer than
+ *  packets and dropped by every responder's length filter, so nobody
+ *  echoes an echo.
+ *
+ *  For 10 .. 200 initiators prints the packets echoed per exchange, the
+ *  share of exchanges that collided,
+ *  the cycle time (time between successful rangings of one initiator) and
+ *  the successful rangings per second of all of them together, and for the
+ *  schedule the beacons missed and how often an initiator lost it. Exits
+ *  with 1 if a schedule with a slot for every initiator and paired
+ *  responders has a collision, or a cycle much longer than its frame while
+ *  nobody lost the schedule, or if responders echoing everything do not
+ *  collide more.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "echoConfig.h"
+#include "eventQueue.h"
+#include "tdmaSchedule.h"
+
+#define MAX_DEVICES         (256)
+#define MAX_EVENTS          (4 * MAX_DEVICES)
+#define WARMUP_US           (10e6)
+/* Free-running initiators: 1s delay, then the exchange up to the echo */
+#define FREE_PERIOD_US \
+    (1e6 + ECHO_BURST_US + ECHO_RF_AIR_US(RANGING_PACKET_SIZE) + \
+     ECHO_TDMA_ECHO_WAIT_US)
+
+/* Event types */
+#define EV_BEACON           (0)     /* Initiator 0 sends a beacon */
+#define EV_START            (1)     /* An exchange starts */
+#define EV_END              (2)     /* ... and is no longer audible */
+
+typedef struct Device {
+    TdmaSchedule_Object tdma;
+    double   rate;                  /* Local ticks per true tick */
+    uint32_t offset;                /* Local RAT time at true time 0 */
+    double   boot;
+    double   start;                 /* Of the current exchange */
+    bool     active;                /* Exchange audible */
+    bool     hit;                   /* ... and overlapped */
+    double   firstSuccess;
+    double   lastSuccess;
+    uint32_t successes;
+} Device;
+
+typedef struct Sim {
+    bool     tdma;
+    bool     paired;                /* Responders filter on their initiator */
+    uint16_t numDevices;
+    uint16_t numSlots;
+    double   duration;
+    double   beaconLoss;
+    double   ppm;
+    double   busyUs;                /* Audible part of an exchange */
+    Device   devices[MAX_DEVICES];
+    EventQueue_Event events[MAX_EVENTS];
+    EventQueue queue;               /* In true time */
+    uint32_t numActive;
+    uint32_t seed;
+    /* Counted after WARMUP_US */
+    uint32_t exchanges;
+    uint32_t echoes;
+    uint32_t collided;
+    uint32_t successes;
+    uint32_t lostSync;
+    uint32_t beaconsMissed;
+    uint32_t beacons;
+} Sim;
+
+/*
+ *  ======== uniform ========
+ *  xorshift32 in [0, 1)
+ */
+static double uniform(uint32_t *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+
+    return ((*seed >> 8) / 16777216.0);
+}
+
+/*
+ *  ======== localTime ========
+ *  The device's RAT time at true time t (us).
+ */
+static uint32_t localTime(const Device *device, double t)
+{
+    return (device->offset +
+            (uint32_t)(uint64_t)(t * TDMA_RAT_TICKS_PER_US * device->rate));
+}
+
+/*
+ *  ======== trueTime ========
+ *  True time of the device's RAT time local, seen at true time now.
+ */
+static double trueTime(const Device *device, double now, uint32_t local)
+{
+    return (now + (int32_t)(local - localTime(device, now)) /
+            (TDMA_RAT_TICKS_PER_US * device->rate));
+}
+
+/*
+ *  ======== startSlot ========
+ *  A synced initiator ranges in its slot of the current frame unless it
+ *  has already started.
+ */
+static void startSlot(Sim *sim, uint16_t id, double now)
+{
+    Device *device = &sim->devices[id];
+    double start;
+
+    if (!device->tdma.synced) {
+        return;
+    }
+    start = trueTime(device, now, TdmaSchedule_slotStart(&device->tdma));
+    if (start >= now) {
+        EventQueue_push(&sim->queue, start, EV_START, id);
+    }
+}
+
+/*
+ *  ======== beacon ========
+ *  Initiator 0 sends the beacon of a frame; the others receive or miss it
+ *  and line up their slots; initiator 0 moves on to the next frame once
+ *  its own slot is over.
+ */
+static void beacon(Sim *sim, double now)
+{
+    Device *coordinator = &sim->devices[TDMA_COORDINATOR_ID];
+    uint8_t data[TDMA_BEACON_SIZE];
+    bool counted = now >= WARMUP_US;
+    /* Lost for everyone on top of an exchange */
+    bool jammed = sim->numActive != 0;
+    uint16_t id;
+
+    TdmaSchedule_encodeBeacon(&coordinator->tdma, data);
+    if (counted) {
+        sim->beacons++;
+    }
+
+    for (id = 0; id < sim->numDevices; id++) {
+        Device *device = &sim->devices[id];
+        TdmaSchedule_Object *tdma = &device->tdma;
+        bool wasSynced = tdma->synced;
+        uint32_t rxTime;
+        bool received;
+
+        if (id == TDMA_COORDINATOR_ID || device->boot > now) {
+            continue;
+        }
+        /* RX time stamp within a microsecond */
+        rxTime = localTime(device, now + TDMA_BEACON_SYNC_US +
+                           uniform(&sim->seed) * 2 - 1);
+        received = !jammed && uniform(&sim->seed) >= sim->beaconLoss;
+        /* Synced initiators listen around where they expect it */
+        if (wasSynced &&
+            abs((int32_t)(rxTime - TdmaSchedule_nextBeacon(tdma) -
+                          TDMA_BEACON_SYNC_US * TDMA_RAT_TICKS_PER_US)) >
+            TDMA_BEACON_WINDOW_US * TDMA_RAT_TICKS_PER_US) {
+            received = false;
+        }
+        if (received) {
+            TdmaSchedule_receiveBeacon(tdma, data, sizeof(data), rxTime);
+        }
+        else {
+            TdmaSchedule_missBeacon(tdma);
+            if (counted) {
+                sim->beaconsMissed++;
+            }
+        }
+        if (wasSynced && !tdma->synced && counted) {
+            sim->lostSync++;
+        }
+        startSlot(sim, id, now);
+    }
+
+    startSlot(sim, TDMA_COORDINATOR_ID, now);
+    TdmaSchedule_startFrame(&coordinator->tdma,
+        localTime(coordinator,
+                  trueTime(coordinator, now,
+                           TdmaSchedule_slotStart(&coordinator->tdma)) +
+                  ECHO_TDMA_SLOT_US));
+    EventQueue_push(&sim->queue,
+                    trueTime(coordinator, now, coordinator->tdma.frameStart),
+                    EV_BEACON, TDMA_COORDINATOR_ID);
+}
+
+/*
+ *  ======== run ========
+ */
+static void run(Sim *sim)
+{
+    EventQueue_Event event;
+    uint16_t id;
+
+    EventQueue_init(&sim->queue, sim->events, MAX_EVENTS);
+    sim->numActive = 0;
+    sim->exchanges = 0;
+    sim->echoes = 0;
+    sim->collided = 0;
+    sim->successes = 0;
+    sim->lostSync = 0;
+    sim->beaconsMissed = 0;
+    sim->beacons = 0;
+
+    for (id = 0; id < sim->numDevices; id++) {
+        Device *device = &sim->devices[id];
+
+        device->rate = 1 + (uniform(&sim->seed) * 2 - 1) * sim->ppm * 1e-6;
+        device->offset = (uint32_t)(uniform(&sim->seed) * 4294967296.0);
+        device->boot = uniform(&sim->seed) * 1e6;
+        device->active = false;
+        device->successes = 0;
+        TdmaSchedule_init(&device->tdma, (uint8_t)id, sim->numSlots,
+                          ECHO_TDMA_SLOT_US);
+        if (!sim->tdma) {
+            EventQueue_push(&sim->queue, device->boot, EV_START, id);
+        }
+    }
+    if (sim->tdma) {
+        Device *coordinator = &sim->devices[TDMA_COORDINATOR_ID];
+
+        coordinator->boot = 0;
+        TdmaSchedule_startFrame(&coordinator->tdma,
+                                localTime(coordinator, 0));
+        EventQueue_push(&sim->queue,
+                        trueTime(coordinator, 0, coordinator->tdma.frameStart),
+                        EV_BEACON, TDMA_COORDINATOR_ID);
+    }
+
+    while (EventQueue_pop(&sim->queue, &event)) {
+        Device *device = &sim->devices[event.id];
+
+        if (event.time > sim->duration) {
+            break;
+        }
+        switch (event.type) {
+            case EV_BEACON:
+                beacon(sim, event.time);
+                break;
+
+            case EV_START:
+                /* Overlaps everything still audible, and the echoes and
+                 * bursts of the other responders if they all answer */
+                device->hit = sim->numActive != 0 ||
+                              (!sim->paired && sim->numDevices > 1);
+                for (id = 0; id < sim->numDevices && sim->numActive != 0;
+                     id++) {
+                    if (sim->devices[id].active) {
+                        sim->devices[id].hit = true;
+                    }
+                }
+                device->active = true;
+                device->start = event.time;
+                sim->numActive++;
+                EventQueue_push(&sim->queue, event.time + sim->busyUs,
+                                EV_END, event.id);
+                break;
+
+            case EV_END:
+                device->active = false;
+                sim->numActive--;
+                if (device->start >= WARMUP_US) {
+                    sim->exchanges++;
+                    sim->echoes += sim->paired ? 1 : sim->numDevices;
+                    if (device->hit) {
+                        sim->collided++;
+                    }
+                    else {
+                        sim->successes++;
+                        if (device->successes++ == 0) {
+                            device->firstSuccess = device->start;
+                        }
+                        device->lastSuccess = device->start;
+                    }
+                }
+                if (!sim->tdma) {
+                    EventQueue_push(&sim->queue,
+                                    device->start +
+                                    FREE_PERIOD_US / device->rate,
+                                    EV_START, event.id);
+                }
+                break;
+        }
+    }
+}
+
+/*
+ *  ======== cycleTime ========
+ *  Mean time between successful rangings of one initiator, in seconds, or
+ *  0 if none ranged twice.
+ */
+static double cycleTime(const Sim *sim)
+{
+    double sum = 0;
+    uint32_t intervals = 0;
+    uint16_t id;
+
+    for (id = 0; id < sim->numDevices; id++) {
+        const Device *device = &sim->devices[id];
+
+        if (device->successes > 1) {
+            sum += device->lastSuccess - device->firstSuccess;
+            intervals += device->successes - 1;
+        }
+    }
+
+    return ((intervals != 0) ? sum / intervals / 1e6 : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint16_t counts[] = {10, 20, 50, 100, 150, 200};
+    static Sim sim;
+    uint16_t fixedSlots = 0;
+    double decayUs = ECHO_TDMA_GUARD_US / 2;
+    uint32_t failures = 0;
+    uint32_t c;
+    int opt;
+
+    sim.duration = 300e6;
+    sim.beaconLoss = 0.01;
+    sim.ppm = 40;
+    while ((opt = getopt(argc, argv, "d:s:l:p:r:")) != -1) {
+        switch (opt) {
+            case 'd':
+                sim.duration = atof(optarg) * 1e6;
+                break;
+            case 's':
+                fixedSlots = (uint16_t)atoi(optarg);
+                break;
+            case 'l':
+                sim.beaconLoss = atof(optarg);
+                break;
+            case 'p':
+                sim.ppm = atof(optarg);
+                break;
+            case 'r':
+                decayUs = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-s slots] "
+                        "[-l beaconLoss] [-p ppm] [-r decayUs]\n", argv[0]);
+                return (2);
+        }
+    }
+    if (sim.duration <= WARMUP_US) {
+        fprintf(stderr, "need more than %.0fs\n", WARMUP_US / 1e6);
+        return (2);
+    }
+    sim.busyUs = ECHO_TDMA_SLOT_US - ECHO_TDMA_GUARD_US + decayUs;
+
+    printf("Slot %uus (audible %.0fus), beacon slot %uus, %.0fs simulated, "
+           "beacon loss %.3f, +-%.0fppm\n", ECHO_TDMA_SLOT_US, sim.busyUs,
+           TDMA_BEACON_SLOT_US, sim.duration / 1e6, sim.beaconLoss, sim.ppm);
+    printf("%-6s %-10s %-5s %6s %10s %7s %9s %9s %10s %9s %9s\n", "pairs",
+           "schedule", "echo", "slots", "exchanges", "echoes", "collided",
+           "cycle s", "ranging/s", "missed", "lostSync");
+
+    for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        double collided[3];
+        uint32_t mode;
+
+        /* Free running, slotted, slotted with responders echoing all */
+        for (mode = 0; mode < 3; mode++) {
+            double frameUs;
+            double cycle;
+
+            sim.tdma = mode != 0;
+            sim.paired = mode != 2;
+            sim.numDevices = counts[c];
+            sim.numSlots = fixedSlots ? fixedSlots : counts[c];
+            sim.seed = 0x5eed + c;
+            run(&sim);
+
+            cycle = cycleTime(&sim);
+            printf("%-6u %-10s %-5s ", sim.numDevices,
+                   sim.tdma ? "slotted" : "free 1s",
+                   sim.paired ? "pair" : "any");
+            if (sim.tdma) {
+                printf("%6u ", sim.numSlots);
+            }
+            else {
+                printf("%6s ", "-");
+            }
+            collided[mode] = sim.exchanges ?
+                             100.0 * sim.collided / sim.exchanges : 0;
+            printf("%10u %7.1f %8.2f%% ", sim.exchanges, sim.exchanges ?
+                   (double)sim.echoes / sim.exchanges : 0, collided[mode]);
+            /* Nobody ranged twice */
+            if (cycle != 0) {
+                printf("%9.3f ", cycle);
+            }
+            else {
+                printf("%9s ", "-");
+            }
+            printf("%10.2f ",
+                   sim.successes / ((sim.duration - WARMUP_US) / 1e6));
+            /* Beacons the others missed, and times one lost the schedule */
+            if (sim.tdma) {
+                printf("%8.2f%% %9u\n", (sim.beacons != 0) ?
+                       100.0 * sim.beaconsMissed /
+                       ((double)sim.beacons * (sim.numDevices - 1)) : 0,
+                       sim.lostSync);
+            }
+            else {
+                printf("%9s %9s\n", "-", "-");
+            }
+
+            frameUs = TDMA_BEACON_SLOT_US +
+                      (double)sim.numSlots * ECHO_TDMA_SLOT_US;
+            /* Missed beacons are bridged: one frame per ranging until an
+             * initiator loses the schedule */
+            if (sim.tdma && sim.paired && sim.numSlots >= sim.numDevices &&
+                (sim.collided != 0 ||
+                 (sim.lostSync == 0 && cycle > 1.05 * frameUs / 1e6))) {
+                printf("FAIL: %u pairs in %u slots: %u collisions, cycle "
+                       "%.3fs for %.3fs frames\n", sim.numDevices,
+                       sim.numSlots, sim.collided, cycle, frameUs / 1e6);
+                failures++;
+            }
+        }
+
+        if (collided[2] <= collided[1]) {
+            printf("FAIL: %u pairs: responders echoing everything collide "
+                   "%.2f%%, paired %.2f%%\n", counts[c], collided[2],
+                   collided[1]);
+            failures++;
+        }
+    }
+
+    if (failures != 0) {
+        printf("FAIL (%u)\n", failures);
+        return (1);
+    }
+    printf("OK\n");
+
+    return (0);
+}
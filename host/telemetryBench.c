@@ -0,0 +1,329 @@
+/*
+ *  ======== telemetryBench.c ========
+ *  Host benchmark of the binary UART telemetry (telemetry.c) against the
+ *  per-sample snprintf text it replaces, and round trip check of the host
+ *  decoder (telemetryDecode.c) on a corrupted stream.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal \
+ *        -o telemetryBench host/telemetryBench.c \
+ *        host/telemetryDecode.c host/echoSynth.c rfEchoTxFinal/telemetry.c \
+ *        rfEchoTxFinal/deltaCodec.c -lm
+ *
+ *  Encoding: bytes and cycles per listen window report for the old text
+ *  (the 500-byte uartTxBuffer, and what the whole buffer would take as
+ *  text) and for one binary frame with raw and with delta coded samples
+ *  (deltaCodec.c), and the time each takes on the 115200 baud link.
+ *
+ *  Round trip: frames are streamed with random bit errors, dropped bytes
+ *  and garbage between them, and fed to the decoder in random chunks.
+ *  Every intact frame has to come out unchanged, no damaged frame may be
+ *  accepted and every damaged one has to be counted as lost. Exits with 1
+ *  otherwise.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deltaCodec.h"
+#include "echoConfig.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+#include "telemetryDecode.h"
+
+#define NUM_SAMPLES         (ECHO_BUFFER_SAMPLES)
+#define OLD_UART_BUFFER     (500)
+#define NUM_BUFFERS         (200)
+#define NUM_FRAMES          (20000)
+#define INTACT_TAIL \
+    (TELEMETRY_FRAME_SIZE(TELEMETRY_MAX_PAYLOAD) / FRAME_SIZE + 2)
+#define BAUD_RATE           (115200)
+/* 8N1: 10 bits on the line per byte */
+#define BYTE_US             (10 * 1000000.0 / BAUD_RATE)
+
+#define FRAME_SIZE \
+    TELEMETRY_FRAME_SIZE(TELEMETRY_ECHO_REPORT_SIZE + NUM_SAMPLES * 2)
+
+static uint16_t codes[NUM_BUFFERS][NUM_SAMPLES];
+static volatile uint32_t sink;
+
+/*
+ *  ======== formatText ========
+ *  The report of the old analyzeBuffer, into a buffer of bufferSize bytes.
+ */
+static uint32_t formatText(char *text, uint32_t bufferSize,
+                           const Telemetry_EchoReport *report,
+                           const uint16_t *samples, uint32_t *numWritten)
+{
+    uint32_t offset;
+    uint32_t i;
+
+    offset = snprintf(text, bufferSize, "\r\nBuffer %u finished.",
+                      (unsigned int)report->buffersCompleted);
+    if (report->flags & TELEMETRY_FLAG_TOF_VALID) {
+        offset += snprintf(text + offset, bufferSize - offset,
+                           " Echo at %u us.", (unsigned int)report->arrivalUs);
+    }
+    if (offset < bufferSize) {
+        offset += snprintf(text + offset, bufferSize - offset,
+                           "\r\nMicrovolts: ");
+        for (i = 0; i < NUM_SAMPLES && offset < bufferSize; i++) {
+            offset += snprintf(text + offset, bufferSize - offset, "%u,",
+                (unsigned int)TelemetryDecode_microVolts(samples[i]));
+        }
+    }
+    /* The last value may have been cut */
+    *numWritten = (offset < bufferSize) ? i : i - 1;
+    if (offset < bufferSize) {
+        text[offset++] = '\n';
+    }
+    else {
+        offset = bufferSize;
+        text[bufferSize - 1] = '\n';
+    }
+
+    return (offset);
+}
+
+/*
+ *  ======== fillReport ========
+ */
+static void fillReport(Telemetry_EchoReport *report, uint32_t n)
+{
+    memset(report, 0, sizeof(*report));
+    report->buffersCompleted = n * ECHO_WINDOW_BUFFERS;
+    report->peakValue = 1000 + n % 5000;
+    report->arrivalUs = 500 + n % 5000;
+    report->peakBin = n % 28;
+    report->buffersDone = ECHO_WINDOW_BUFFERS;
+    report->binSize = ECHO_BIN_SIZE;
+    report->numSamples = NUM_SAMPLES;
+    report->flags = TELEMETRY_FLAG_TOF_VALID |
+        ((n & 1) ? TELEMETRY_FLAG_DETECTED : 0);
+}
+
+/*
+ *  ======== benchEncode ========
+ */
+static void benchEncode(void)
+{
+    static char text[NUM_SAMPLES * 10 + 100];
+    static uint8_t frame[TELEMETRY_FRAME_SIZE(TELEMETRY_ECHO_REPORT_SIZE +
+                         DELTA_CODEC_MAX_SIZE(NUM_SAMPLES))];
+    Telemetry_Object telemetry;
+    Telemetry_EchoReport report;
+    uint64_t start;
+    uint64_t cycles[4] = { 0, 0, 0, 0 };
+    uint64_t bytes[4] = { 0, 0, 0, 0 };
+    uint32_t samples[4] = { 0, 0, NUM_SAMPLES, NUM_SAMPLES };
+    const char *names[4] = { "text, 500-byte buffer", "text, whole buffer",
+                             "binary frame", "binary frame, delta" };
+    uint32_t b;
+    int k;
+
+    Telemetry_init(&telemetry);
+
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        fillReport(&report, b);
+
+        start = HostCycles_now();
+        bytes[0] += formatText(text, OLD_UART_BUFFER, &report, codes[b],
+                               &samples[0]);
+        cycles[0] += HostCycles_now() - start;
+        sink += text[10];
+
+        start = HostCycles_now();
+        bytes[1] += formatText(text, sizeof(text), &report, codes[b],
+                               &samples[1]);
+        cycles[1] += HostCycles_now() - start;
+        sink += text[10];
+
+        start = HostCycles_now();
+        bytes[2] += Telemetry_encode(&telemetry, TELEMETRY_TYPE_ECHO_REPORT,
+                                     &report, sizeof(report), codes[b],
+                                     NUM_SAMPLES * sizeof(uint16_t), frame);
+        cycles[2] += HostCycles_now() - start;
+        sink += frame[10];
+
+        /* As the firmware does with ECHO_TELEMETRY_DELTA */
+        start = HostCycles_now();
+        memcpy(&frame[TELEMETRY_HEADER_SIZE], &report, sizeof(report));
+        bytes[3] += Telemetry_finish(&telemetry,
+            TELEMETRY_TYPE_ECHO_REPORT_DELTA, sizeof(report) +
+            DeltaCodec_encode(codes[b], NUM_SAMPLES,
+                              &frame[TELEMETRY_HEADER_SIZE + sizeof(report)]),
+            frame);
+        cycles[3] += HostCycles_now() - start;
+        sink += frame[10];
+    }
+
+    printf("report of a %u-sample buffer, %u buffers\n", NUM_SAMPLES,
+           NUM_BUFFERS);
+    printf("%-24s %8s %9s %10s %9s\n", "format", "samples", "bytes",
+           HOST_CYCLES_UNIT, "link ms");
+    for (k = 0; k < 4; k++) {
+        double perBuffer = (double)bytes[k] / NUM_BUFFERS;
+
+        /* Samples of the last buffer that fit */
+        printf("%-24s %8u %9.0f %10.0f %9.1f\n", names[k], samples[k],
+               perBuffer,
+               (double)cycles[k] / NUM_BUFFERS, perBuffer * BYTE_US / 1000);
+    }
+}
+
+/*
+ *  ======== roundTrip ========
+ */
+static int roundTrip(void)
+{
+    static uint8_t frame[FRAME_SIZE];
+    static uint16_t decoded[NUM_SAMPLES];
+    static bool damaged[NUM_FRAMES];
+    uint8_t *stream;
+    size_t streamSize = 0;
+    size_t offset = 0;
+    Telemetry_Object telemetry;
+    TelemetryDecode_Object decoder;
+    TelemetryDecode_Frame out;
+    Telemetry_EchoReport report;
+    Telemetry_EchoReport got;
+    uint32_t seed = 0x2468ace1;
+    uint32_t numDamaged = 0;
+    uint32_t intactOut = 0;
+    uint32_t wrong = 0;
+    uint32_t n;
+    uint32_t size;
+    uint32_t i;
+    double seconds;
+    int failed = 0;
+
+    stream = malloc((size_t)NUM_FRAMES * (FRAME_SIZE + 32));
+    if (stream == NULL) {
+        return (1);
+    }
+
+    Telemetry_init(&telemetry);
+    for (n = 0; n < NUM_FRAMES; n++) {
+        double u = EchoSynth_uniform(&seed);
+
+        fillReport(&report, n);
+        size = Telemetry_encode(&telemetry, TELEMETRY_TYPE_ECHO_REPORT,
+                                &report, sizeof(report),
+                                codes[n % NUM_BUFFERS],
+                                NUM_SAMPLES * sizeof(uint16_t), frame);
+
+        /* The first and last frames stay intact: losses are only counted
+         * between two decoded frames, and a damaged length can hold up to
+         * TELEMETRY_MAX_PAYLOAD bytes back */
+        damaged[n] = n > 0 && n + INTACT_TAIL < NUM_FRAMES && u < 0.15;
+        if (damaged[n] && u < 0.10) {
+            /* Bit error anywhere, including the sync word and length */
+            i = (uint32_t)(EchoSynth_uniform(&seed) * size);
+            frame[i] ^= (uint8_t)(1u << (uint32_t)(EchoSynth_uniform(&seed) *
+                                                   8));
+        }
+        else if (damaged[n]) {
+            /* Dropped byte */
+            i = (uint32_t)(EchoSynth_uniform(&seed) * size);
+            memmove(&frame[i], &frame[i + 1], size - i - 1);
+            size--;
+        }
+        numDamaged += damaged[n];
+
+        memcpy(&stream[streamSize], frame, size);
+        streamSize += size;
+
+        /* Line noise between frames, sometimes with a stray sync byte */
+        if (EchoSynth_uniform(&seed) < 0.05) {
+            uint32_t noise = 1 + (uint32_t)(EchoSynth_uniform(&seed) * 20);
+
+            for (i = 0; i < noise; i++) {
+                stream[streamSize++] = (EchoSynth_uniform(&seed) < 0.3) ?
+                    TELEMETRY_SYNC0 :
+                    (uint8_t)(EchoSynth_uniform(&seed) * 256);
+            }
+        }
+    }
+
+    TelemetryDecode_init(&decoder);
+    seconds = HostCycles_seconds();
+    while (offset < streamSize) {
+        const uint8_t *data = &stream[offset];
+        size_t chunk = 1 + (size_t)(EchoSynth_uniform(&seed) * 2048);
+
+        if (chunk > streamSize - offset) {
+            chunk = streamSize - offset;
+        }
+        offset += chunk;
+
+        while (TelemetryDecode_next(&decoder, &data, &chunk, &out)) {
+            if (out.sequence >= NUM_FRAMES || damaged[out.sequence] ||
+                TelemetryDecode_echoReport(&out, &got, decoded,
+                                           NUM_SAMPLES) != NUM_SAMPLES) {
+                wrong++;
+                continue;
+            }
+            fillReport(&report, out.sequence);
+            if (memcmp(&got, &report, sizeof(report)) != 0 ||
+                memcmp(decoded, codes[out.sequence % NUM_BUFFERS],
+                       sizeof(decoded)) != 0) {
+                wrong++;
+                continue;
+            }
+            intactOut++;
+        }
+    }
+    seconds = HostCycles_seconds() - seconds;
+
+    printf("\nround trip: %u frames, %u damaged, %zu bytes\n", NUM_FRAMES,
+           numDamaged, streamSize);
+    printf("decoded     %u intact of %u, %u wrong\n", intactOut,
+           NUM_FRAMES - numDamaged, wrong);
+    printf("counters    frames %llu, crc errors %llu, lost %llu, "
+           "skipped %llu bytes\n", (unsigned long long)decoder.frames,
+           (unsigned long long)decoder.crcErrors,
+           (unsigned long long)decoder.lostFrames,
+           (unsigned long long)decoder.skippedBytes);
+    printf("throughput  %.0f MB/s (including the check above)\n",
+           streamSize / seconds * 1e-6);
+
+    if (intactOut != NUM_FRAMES - numDamaged || wrong != 0 ||
+        decoder.lostFrames != numDamaged) {
+        failed = 1;
+    }
+    free(stream);
+
+    return (failed);
+}
+
+int main(void)
+{
+    EchoSynth_Params params;
+    uint32_t microVolts[NUM_SAMPLES];
+    uint32_t seed = 0x1234567;
+    uint32_t b;
+    uint32_t i;
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = 100000;
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        params.echoUv = (b & 1) ? 50000 : 0;
+        params.echoStart = EchoSynth_uniform(&seed) * (NUM_SAMPLES - 200);
+        EchoSynth_microVolts(&params, &seed, microVolts, NUM_SAMPLES);
+        for (i = 0; i < NUM_SAMPLES; i++) {
+            codes[b][i] = EchoSynth_microVoltsToCode(microVolts[i]);
+        }
+    }
+
+    benchEncode();
+    if (roundTrip() != 0) {
+        printf("FAIL\n");
+        return (1);
+    }
+    printf("OK\n");
+
+    return (0);
+}
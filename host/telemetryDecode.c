@@ -0,0 +1,251 @@
+/*
+ *  ======== telemetryDecode.c ========
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "deltaCodec.h"
+#include "telemetryDecode.h"
+
+#define FULL_SCALE_UV   (4300000u)
+
+typedef enum Verdict {
+    NEED_MORE,
+    FRAME,
+    BAD
+} Verdict;
+
+/*
+ *  ======== readLe16 ========
+ */
+static uint16_t readLe16(const uint8_t *bytes)
+{
+    return ((uint16_t)(bytes[0] | (bytes[1] << 8)));
+}
+
+/*
+ *  ======== examine ========
+ *  Checks what has been received so far.
+ */
+static Verdict examine(TelemetryDecode_Object *decoder)
+{
+    const uint8_t *buffer = decoder->buffer;
+    uint16_t payloadSize;
+    uint16_t crc;
+
+    if (decoder->fill >= 1 && buffer[0] != TELEMETRY_SYNC0) {
+        return (BAD);
+    }
+    if (decoder->fill >= 2 && buffer[1] != TELEMETRY_SYNC1) {
+        return (BAD);
+    }
+    if (decoder->fill < TELEMETRY_HEADER_SIZE) {
+        return (NEED_MORE);
+    }
+
+    payloadSize = readLe16(&buffer[2]);
+    if (payloadSize > TELEMETRY_MAX_PAYLOAD) {
+        return (BAD);
+    }
+    if (decoder->fill < (uint32_t)TELEMETRY_FRAME_SIZE(payloadSize)) {
+        return (NEED_MORE);
+    }
+
+    crc = Telemetry_crc16(0xFFFF, &buffer[2],
+                          TELEMETRY_HEADER_SIZE - 2 + payloadSize);
+    if (crc != readLe16(&buffer[TELEMETRY_HEADER_SIZE + payloadSize])) {
+        decoder->crcErrors++;
+        return (BAD);
+    }
+
+    return (FRAME);
+}
+
+/*
+ *  ======== resync ========
+ *  Drops the first byte and everything up to the next possible sync word.
+ */
+static void resync(TelemetryDecode_Object *decoder)
+{
+    const uint8_t *next = NULL;
+    uint32_t drop;
+
+    if (decoder->fill > 1) {
+        next = memchr(&decoder->buffer[1], TELEMETRY_SYNC0, decoder->fill - 1);
+    }
+    drop = (next != NULL) ? (uint32_t)(next - decoder->buffer) : decoder->fill;
+
+    memmove(decoder->buffer, &decoder->buffer[drop], decoder->fill - drop);
+    decoder->fill -= drop;
+    decoder->skippedBytes += drop;
+}
+
+/*
+ *  ======== TelemetryDecode_init ========
+ */
+void TelemetryDecode_init(TelemetryDecode_Object *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+/*
+ *  ======== TelemetryDecode_next ========
+ */
+bool TelemetryDecode_next(TelemetryDecode_Object *decoder,
+                          const uint8_t **data, size_t *size,
+                          TelemetryDecode_Frame *frame)
+{
+    /* A resync can leave bytes after the frame handed out last time */
+    if (decoder->emitted) {
+        memmove(decoder->buffer, &decoder->buffer[decoder->frameSize],
+                decoder->fill - decoder->frameSize);
+        decoder->fill -= decoder->frameSize;
+        decoder->emitted = false;
+    }
+
+    for (;;) {
+        Verdict verdict = examine(decoder);
+        size_t needed;
+
+        if (verdict == FRAME) {
+            break;
+        }
+        if (verdict == BAD) {
+            resync(decoder);
+            continue;
+        }
+
+        if (*size == 0) {
+            return (false);
+        }
+
+        /* Only take what the next check needs, never past the frame */
+        if (decoder->fill < TELEMETRY_HEADER_SIZE) {
+            needed = TELEMETRY_HEADER_SIZE - decoder->fill;
+        }
+        else {
+            needed = TELEMETRY_FRAME_SIZE(readLe16(&decoder->buffer[2])) -
+                decoder->fill;
+        }
+        if (needed > *size) {
+            needed = *size;
+        }
+        memcpy(&decoder->buffer[decoder->fill], *data, needed);
+        decoder->fill += (uint32_t)needed;
+        *data += needed;
+        *size -= needed;
+    }
+
+    frame->payloadSize = readLe16(&decoder->buffer[2]);
+    frame->sequence = readLe16(&decoder->buffer[4]);
+    frame->type = decoder->buffer[6];
+    frame->payload = &decoder->buffer[TELEMETRY_HEADER_SIZE];
+
+    if (decoder->synced) {
+        decoder->lostFrames += (uint16_t)(frame->sequence -
+                                          decoder->nextSequence);
+    }
+    decoder->synced = true;
+    decoder->nextSequence = frame->sequence + 1;
+    decoder->frames++;
+    decoder->frameSize = TELEMETRY_FRAME_SIZE(frame->payloadSize);
+    decoder->emitted = true;
+
+    return (true);
+}
+
+/*
+ *  ======== TelemetryDecode_echoReport ========
+ */
+int TelemetryDecode_echoReport(const TelemetryDecode_Frame *frame,
+                               Telemetry_EchoReport *report,
+                               uint16_t *codes, uint32_t maxCodes)
+{
+    const uint8_t *bytes = frame->payload + TELEMETRY_ECHO_REPORT_SIZE;
+    uint32_t size = frame->payloadSize - TELEMETRY_ECHO_REPORT_SIZE;
+    uint32_t i;
+
+    if ((frame->type != TELEMETRY_TYPE_ECHO_REPORT &&
+         frame->type != TELEMETRY_TYPE_ECHO_REPORT_DELTA) ||
+        frame->payloadSize < TELEMETRY_ECHO_REPORT_SIZE) {
+        return (-1);
+    }
+
+    /* Little endian like the firmware */
+    memcpy(report, frame->payload, TELEMETRY_ECHO_REPORT_SIZE);
+
+    if (frame->type == TELEMETRY_TYPE_ECHO_REPORT_DELTA) {
+        /* The whole buffer has to be decoded to get any of it */
+        if (report->numSamples > maxCodes ||
+            DeltaCodec_decode(bytes, size, codes, report->numSamples) !=
+            (int32_t)size) {
+            return (-1);
+        }
+        return (report->numSamples);
+    }
+
+    if (size != report->numSamples * 2u) {
+        return (-1);
+    }
+    for (i = 0; i < report->numSamples && i < maxCodes; i++) {
+        codes[i] = readLe16(&bytes[2 * i]);
+    }
+
+    return (report->numSamples);
+}
+
+/*
+ *  ======== TelemetryDecode_cycleSummary ========
+ */
+int TelemetryDecode_cycleSummary(const TelemetryDecode_Frame *frame,
+                                 Telemetry_CycleSummary *summary)
+{
+    if (frame->type != TELEMETRY_TYPE_CYCLE_SUMMARY ||
+        frame->payloadSize != TELEMETRY_CYCLE_SUMMARY_SIZE) {
+        return (-1);
+    }
+
+    memcpy(summary, frame->payload, TELEMETRY_CYCLE_SUMMARY_SIZE);
+
+    return (0);
+}
+
+/*
+ *  ======== TelemetryDecode_radioTrace ========
+ */
+int TelemetryDecode_radioTrace(const TelemetryDecode_Frame *frame,
+                               Telemetry_RadioTrace *trace,
+                               Telemetry_RadioEvent *events,
+                               uint32_t maxEvents)
+{
+    uint32_t copy;
+
+    if (frame->type != TELEMETRY_TYPE_RADIO_TRACE ||
+        frame->payloadSize < TELEMETRY_RADIO_TRACE_SIZE) {
+        return (-1);
+    }
+    memcpy(trace, frame->payload, TELEMETRY_RADIO_TRACE_SIZE);
+    if (frame->payloadSize != TELEMETRY_RADIO_TRACE_SIZE +
+        (uint32_t)trace->numEvents * TELEMETRY_RADIO_EVENT_SIZE) {
+        return (-1);
+    }
+
+    copy = trace->numEvents < maxEvents ? trace->numEvents : maxEvents;
+    memcpy(events, &frame->payload[TELEMETRY_RADIO_TRACE_SIZE],
+           copy * TELEMETRY_RADIO_EVENT_SIZE);
+
+    return (trace->numEvents);
+}
+
+/*
+ *  ======== TelemetryDecode_microVolts ========
+ *  driverlib AUXADCValueToMicrovolts, as used by the firmware for its old
+ *  text output.
+ */
+uint32_t TelemetryDecode_microVolts(uint16_t code)
+{
+    return (((code * (FULL_SCALE_UV >> 4) + 2047) / 4095) << 4);
+}
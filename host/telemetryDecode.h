@@ -0,0 +1,87 @@
+/*
+ *  ======== telemetryDecode.h ========
+ *  Decoder for the binary UART telemetry frames of the firmware
+ *  (rfEchoTxFinal/telemetry.h).
+ *
+ *  Bytes are fed in chunks of any size, as they come from the serial port
+ *  or a file. The decoder finds the sync word, checks the length and the
+ *  CRC and hands out complete frames; anything else is skipped and
+ *  counted, and gaps in the sequence numbers are counted as lost frames.
+ */
+
+#ifndef TELEMETRY_DECODE_H
+#define TELEMETRY_DECODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry.h"
+
+typedef struct TelemetryDecode_Frame {
+    uint8_t         type;           /* TELEMETRY_TYPE_... */
+    uint16_t        sequence;
+    uint16_t        payloadSize;
+    const uint8_t  *payload;        /* Valid until the next call */
+} TelemetryDecode_Frame;
+
+typedef struct TelemetryDecode_Object {
+    uint8_t  buffer[TELEMETRY_FRAME_SIZE(TELEMETRY_MAX_PAYLOAD)];
+    uint32_t fill;                  /* Bytes of the frame being received */
+    uint32_t frameSize;             /* Size of the last frame handed out */
+    bool     emitted;               /* buffer holds the last frame handed out */
+    bool     synced;                /* A frame has been decoded */
+    uint16_t nextSequence;
+    uint64_t frames;                /* Frames decoded */
+    uint64_t crcErrors;             /* Frames dropped on a CRC mismatch */
+    uint64_t skippedBytes;          /* Bytes outside any valid frame */
+    uint64_t lostFrames;            /* Sequence numbers never seen */
+} TelemetryDecode_Object;
+
+extern void TelemetryDecode_init(TelemetryDecode_Object *decoder);
+
+/*
+ *  ======== TelemetryDecode_next ========
+ *  Consumes bytes from *data / *size (both are advanced) until a frame is
+ *  complete and returns true with the frame, or returns false once the
+ *  input is used up; the partial frame is kept for the next call.
+ */
+extern bool TelemetryDecode_next(TelemetryDecode_Object *decoder,
+                                 const uint8_t **data, size_t *size,
+                                 TelemetryDecode_Frame *frame);
+
+/*
+ *  ======== TelemetryDecode_echoReport ========
+ *  Unpacks a TELEMETRY_TYPE_ECHO_REPORT frame (up to maxCodes ADC codes
+ *  are copied to codes) or a TELEMETRY_TYPE_ECHO_REPORT_DELTA frame (all
+ *  codes are decompressed; more than maxCodes is an error). Returns the
+ *  number of codes in the frame, or -1 if the frame is not a well-formed
+ *  echo report.
+ */
+extern int TelemetryDecode_echoReport(const TelemetryDecode_Frame *frame,
+                                      Telemetry_EchoReport *report,
+                                      uint16_t *codes, uint32_t maxCodes);
+
+/*
+ *  ======== TelemetryDecode_cycleSummary ========
+ *  Unpacks a TELEMETRY_TYPE_CYCLE_SUMMARY frame. Returns 0, or -1 if the
+ *  frame is not a well-formed summary.
+ */
+extern int TelemetryDecode_cycleSummary(const TelemetryDecode_Frame *frame,
+                                        Telemetry_CycleSummary *summary);
+
+/*
+ *  ======== TelemetryDecode_radioTrace ========
+ *  Unpacks a TELEMETRY_TYPE_RADIO_TRACE frame; up to maxEvents events are
+ *  copied to events. Returns the number of events in the frame, or -1 if
+ *  the frame is not a well-formed radio trace.
+ */
+extern int TelemetryDecode_radioTrace(const TelemetryDecode_Frame *frame,
+                                      Telemetry_RadioTrace *trace,
+                                      Telemetry_RadioEvent *events,
+                                      uint32_t maxEvents);
+
+/* ADCBuf_convertAdjustedToMicroVolts of one code (4.3V fixed reference) */
+extern uint32_t TelemetryDecode_microVolts(uint16_t code);
+
+#endif /* TELEMETRY_DECODE_H */
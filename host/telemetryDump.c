@@ -0,0 +1,131 @@
+/*
+ *  ======== telemetryDump.c ========
+ *  Decodes the binary UART telemetry of the firmware into the text the
+ *  firmware used to print, so captures can still be read by eye and by
+ *  the tools that load "Microvolts: ..." dumps (captureFile.c).
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -IrfEchoTxFinal -o telemetryDump host/telemetryDump.c \
+ *        host/telemetryDecode.c rfEchoTxFinal/telemetry.c \
+ *        rfEchoTxFinal/deltaCodec.c
+ *
+ *  Usage: telemetryDump [capture.bin]
+ *  Reads the raw serial stream from the file (or stdin), e.g. after
+ *    stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 > capture.bin
+ *  Unlike the old text output every dump holds the whole buffer. Cycle
+ *  summaries (summary mode, telemetryMode.h) print as one "Cycle ..." line
+ *  each. Decoder counters go to stderr at the end.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "telemetryDecode.h"
+
+#define MAX_CODES   (TELEMETRY_MAX_PAYLOAD / 2)
+
+/*
+ *  ======== printSummary ========
+ */
+static void printSummary(const Telemetry_CycleSummary *summary)
+{
+    printf("\r\nCycle at buffer %u, packet %u %s, RSSI %d dBm, rx %u ok "
+           "%u bad.", (unsigned int)summary->buffersCompleted,
+           (unsigned int)summary->rfSequence,
+           (summary->flags & TELEMETRY_FLAG_RF_OK) ? "ok" : "missed",
+           (int)summary->lastRssi, (unsigned int)summary->rxOk,
+           (unsigned int)summary->rxNok);
+    if (summary->flags & TELEMETRY_FLAG_TOF_VALID) {
+        printf(" Echo at %u us.", (unsigned int)summary->arrivalUs);
+    }
+    if (summary->overruns != 0) {
+        printf(" Lost %u.", (unsigned int)summary->overruns);
+    }
+    printf(" Peak %u in bin %u%s.", (unsigned int)summary->peakValue,
+           (unsigned int)summary->peakBin,
+           (summary->flags & TELEMETRY_FLAG_DETECTED) ? ", detected" : "");
+    if (summary->framesDropped != 0) {
+        printf(" Dropped %u frames.", (unsigned int)summary->framesDropped);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static TelemetryDecode_Object decoder;
+    static uint8_t chunk[4096];
+    static uint16_t codes[MAX_CODES];
+    FILE *input = stdin;
+    size_t chunkSize;
+
+    if (argc > 1 && (input = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return (1);
+    }
+
+    TelemetryDecode_init(&decoder);
+
+    while ((chunkSize = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+        const uint8_t *data = chunk;
+        size_t size = chunkSize;
+        TelemetryDecode_Frame frame;
+
+        while (TelemetryDecode_next(&decoder, &data, &size, &frame)) {
+            Telemetry_EchoReport report;
+            Telemetry_CycleSummary summary;
+            int numCodes;
+            int i;
+
+            if (TelemetryDecode_cycleSummary(&frame, &summary) == 0) {
+                printSummary(&summary);
+                continue;
+            }
+
+            numCodes = TelemetryDecode_echoReport(&frame, &report, codes,
+                                                  MAX_CODES);
+            if (numCodes < 0) {
+                continue;
+            }
+
+            printf("\r\nBuffer %u finished.",
+                   (unsigned int)report.buffersCompleted);
+            if (report.flags & TELEMETRY_FLAG_TOF_VALID) {
+                printf(" Echo at %u us.", (unsigned int)report.arrivalUs);
+            }
+            if (report.overruns != 0) {
+                printf(" Lost %u.", (unsigned int)report.overruns);
+            }
+            printf(" Peak %u in bin %u%s.", (unsigned int)report.peakValue,
+                   (unsigned int)report.peakBin,
+                   (report.flags & TELEMETRY_FLAG_DETECTED) ?
+                   ", detected" : "");
+            if (report.samplesDropped != 0 || report.summariesDropped != 0) {
+                printf(" Dropped %u sample dumps, %u reports.",
+                       (unsigned int)report.samplesDropped,
+                       (unsigned int)report.summariesDropped);
+            }
+
+            /* Summary frames have no codes */
+            if (numCodes > 0) {
+                printf("\r\nMicrovolts: ");
+                for (i = 0; i < numCodes; i++) {
+                    printf("%u,", (unsigned int)TelemetryDecode_microVolts(
+                        codes[i]));
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    fprintf(stderr, "frames %llu, crc errors %llu, lost %llu, skipped %llu "
+            "bytes\n", (unsigned long long)decoder.frames,
+            (unsigned long long)decoder.crcErrors,
+            (unsigned long long)decoder.lostFrames,
+            (unsigned long long)decoder.skippedBytes);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    return (0);
+}
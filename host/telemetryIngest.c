@@ -0,0 +1,365 @@
+/*
+ *  ======== telemetryIngest.c ========
+ *  Captures the binary UART telemetry of the firmware into a columnar
+ *  store (columnStore.h) that analysis tools can map instead of parsing
+ *  text.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -pthread -Ihost -Icommon -IrfEchoTxFinal -o telemetryIngest \
+ *        host/telemetryIngest.c host/columnStore.c host/telemetryDecode.c \
+ *        rfEchoTxFinal/telemetry.c rfEchoTxFinal/deltaCodec.c
+ *
+ *  Usage: telemetryIngest [-o dir] [-n samples] [-b baud] [input]
+ *    input  serial device (set to raw mode at the baud rate), capture file
+ *           or pipe; stdin if missing or "-"
+ *    -o     store directory (default: capture.col), replaced if it exists
+ *    -n     codes kept per report (default: ECHO_BUFFER_SAMPLES)
+ *    -b     baud rate of a serial device (default: 115200)
+ *
+ *  The main thread only reads: chunks of input are stamped with the time
+ *  they arrived and handed to a parser thread through a ring of chunk
+ *  buffers, so a slow disk never holds up the serial port. The parser
+ *  decodes frames (telemetryDecode.c) and appends one row per echo report,
+ *  and per cycle summary of summary mode (telemetryMode.h) unless the
+ *  window's report follows it; the rows are published after every chunk, so the store can be read
+ *  while the capture runs. Stops at the end of the input or on Ctrl-C and
+ *  prints the decoder counters and throughput to stderr.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "columnStore.h"
+#include "echoConfig.h"
+#include "telemetryDecode.h"
+
+#define CHUNK_SIZE      (64 * 1024)
+/* Chunks between the reader and the parser */
+#define NUM_CHUNKS      (16)
+#define MAX_CODES       (TELEMETRY_MAX_PAYLOAD / 2)
+
+typedef struct Chunk {
+    uint8_t  data[CHUNK_SIZE];
+    size_t   size;
+    uint64_t timeNs;            /* When the first byte was read */
+} Chunk;
+
+typedef struct Ingest {
+    Chunk           chunks[NUM_CHUNKS];
+    uint32_t        head;       /* Chunks read (reader only) */
+    uint32_t        tail;       /* Chunks parsed (parser only) */
+    bool            done;       /* No more chunks */
+    pthread_mutex_t lock;
+    pthread_cond_t  filled;
+    pthread_cond_t  emptied;
+
+    TelemetryDecode_Object decoder;
+    ColumnStore     store;
+    uint64_t        bytes;
+    int             status;
+} Ingest;
+
+static Ingest ingest;
+static volatile sig_atomic_t stopRequested;
+
+/*
+ *  ======== nowNs ========
+ */
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+/*
+ *  ======== onSignal ========
+ */
+static void onSignal(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
+
+/*
+ *  ======== baudToSpeed ========
+ */
+static speed_t baudToSpeed(long baud)
+{
+    switch (baud) {
+        case 9600:      return (B9600);
+        case 19200:     return (B19200);
+        case 38400:     return (B38400);
+        case 57600:     return (B57600);
+        case 115200:    return (B115200);
+        case 230400:    return (B230400);
+        case 460800:    return (B460800);
+        case 921600:    return (B921600);
+        default:        return (0);
+    }
+}
+
+/*
+ *  ======== setupSerial ========
+ *  Raw 8N1 at baud for a tty; anything else is left alone.
+ */
+static int setupSerial(int fd, long baud)
+{
+    struct termios tio;
+    speed_t speed = baudToSpeed(baud);
+
+    if (!isatty(fd)) {
+        return (0);
+    }
+    if (speed == 0) {
+        fprintf(stderr, "unsupported baud rate %ld\n", baud);
+        return (-1);
+    }
+    if (tcgetattr(fd, &tio) != 0) {
+        return (-1);
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+
+    return (tcsetattr(fd, TCSANOW, &tio));
+}
+
+/*
+ *  ======== summaryToReport ========
+ *  The row of a window that only has a cycle summary.
+ */
+static void summaryToReport(const Telemetry_CycleSummary *summary,
+                            Telemetry_EchoReport *report)
+{
+    memset(report, 0, sizeof(*report));
+    report->buffersCompleted = summary->buffersCompleted;
+    report->peakValue = summary->peakValue;
+    report->arrivalUs = summary->arrivalUs;
+    report->peakBin = summary->peakBin;
+    report->overruns = summary->overruns;
+    report->flags = summary->flags;
+}
+
+/*
+ *  ======== parseChunk ========
+ */
+static void parseChunk(const Chunk *chunk)
+{
+    static uint16_t codes[MAX_CODES];
+    const uint8_t *data = chunk->data;
+    size_t size = chunk->size;
+    TelemetryDecode_Frame frame;
+
+    while (TelemetryDecode_next(&ingest.decoder, &data, &size, &frame)) {
+        Telemetry_EchoReport report;
+        Telemetry_CycleSummary summary;
+        int numCodes;
+
+        if (TelemetryDecode_cycleSummary(&frame, &summary) == 0) {
+            if (summary.flags & TELEMETRY_FLAG_CODES) {
+                continue;
+            }
+            summaryToReport(&summary, &report);
+            numCodes = 0;
+        }
+        else {
+            numCodes = TelemetryDecode_echoReport(&frame, &report, codes,
+                                                  MAX_CODES);
+            if (numCodes < 0) {
+                continue;
+            }
+        }
+        if (ColumnStore_append(&ingest.store, &report, frame.sequence, codes,
+                               (uint32_t)numCodes, chunk->timeNs) != 0) {
+            perror("append");
+            ingest.status = 1;
+            return;
+        }
+    }
+    ingest.bytes += chunk->size;
+    ColumnStore_sync(&ingest.store);
+}
+
+/*
+ *  ======== parserThread ========
+ */
+static void *parserThread(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        const Chunk *chunk;
+
+        pthread_mutex_lock(&ingest.lock);
+        while (ingest.tail == ingest.head && !ingest.done) {
+            pthread_cond_wait(&ingest.filled, &ingest.lock);
+        }
+        if (ingest.tail == ingest.head) {
+            pthread_mutex_unlock(&ingest.lock);
+            break;
+        }
+        chunk = &ingest.chunks[ingest.tail % NUM_CHUNKS];
+        pthread_mutex_unlock(&ingest.lock);
+
+        /* The reader does not touch the chunk until tail moves past it */
+        if (ingest.status == 0) {
+            parseChunk(chunk);
+        }
+
+        pthread_mutex_lock(&ingest.lock);
+        ingest.tail++;
+        pthread_cond_signal(&ingest.emptied);
+        pthread_mutex_unlock(&ingest.lock);
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== readInput ========
+ *  Fills chunks until the end of the input or a signal.
+ */
+static void readInput(int fd)
+{
+    while (!stopRequested) {
+        Chunk *chunk;
+        ssize_t got;
+
+        pthread_mutex_lock(&ingest.lock);
+        while (ingest.head - ingest.tail == NUM_CHUNKS) {
+            pthread_cond_wait(&ingest.emptied, &ingest.lock);
+        }
+        chunk = &ingest.chunks[ingest.head % NUM_CHUNKS];
+        pthread_mutex_unlock(&ingest.lock);
+
+        got = read(fd, chunk->data, CHUNK_SIZE);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            if (got < 0) {
+                perror("read");
+            }
+            break;
+        }
+        chunk->size = (size_t)got;
+        chunk->timeNs = nowNs();
+
+        pthread_mutex_lock(&ingest.lock);
+        ingest.head++;
+        pthread_cond_signal(&ingest.filled);
+        pthread_mutex_unlock(&ingest.lock);
+    }
+
+    pthread_mutex_lock(&ingest.lock);
+    ingest.done = true;
+    pthread_cond_signal(&ingest.filled);
+    pthread_mutex_unlock(&ingest.lock);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = "capture.col";
+    const char *input = "-";
+    uint32_t samplesPerRow = ECHO_BUFFER_SAMPLES;
+    long baud = 115200;
+    struct sigaction action;
+    struct timespec start;
+    struct timespec end;
+    pthread_t parser;
+    double seconds;
+    int fd = STDIN_FILENO;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:n:b:")) != -1) {
+        switch (opt) {
+            case 'o':
+                dir = optarg;
+                break;
+            case 'n':
+                samplesPerRow = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                baud = strtol(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-o dir] [-n samples] [-b baud] "
+                        "[input]\n", argv[0]);
+                return (2);
+        }
+    }
+    if (optind < argc) {
+        input = argv[optind];
+    }
+
+    if (strcmp(input, "-") != 0) {
+        fd = open(input, O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            perror(input);
+            return (1);
+        }
+    }
+    if (setupSerial(fd, baud) != 0) {
+        perror(input);
+        return (1);
+    }
+    if (ColumnStore_create(&ingest.store, dir, samplesPerRow) != 0) {
+        perror(dir);
+        return (1);
+    }
+
+    /* No SA_RESTART: Ctrl-C ends a blocking read */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    TelemetryDecode_init(&ingest.decoder);
+    pthread_mutex_init(&ingest.lock, NULL);
+    pthread_cond_init(&ingest.filled, NULL);
+    pthread_cond_init(&ingest.emptied, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (pthread_create(&parser, NULL, parserThread, NULL) != 0) {
+        perror("pthread_create");
+        return (1);
+    }
+    readInput(fd);
+    pthread_join(parser, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    fprintf(stderr, "%s: %llu rows of %u samples\n", dir,
+            (unsigned long long)ingest.store.numRows, samplesPerRow);
+    fprintf(stderr, "frames %llu, crc errors %llu, lost %llu, skipped %llu "
+            "bytes\n", (unsigned long long)ingest.decoder.frames,
+            (unsigned long long)ingest.decoder.crcErrors,
+            (unsigned long long)ingest.decoder.lostFrames,
+            (unsigned long long)ingest.decoder.skippedBytes);
+    fprintf(stderr, "%llu bytes in %.2f s (%.1f MB/s)\n",
+            (unsigned long long)ingest.bytes, seconds,
+            seconds > 0 ? ingest.bytes / seconds * 1e-6 : 0.0);
+
+    ColumnStore_close(&ingest.store);
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+
+    return (ingest.status);
+}
@@ -0,0 +1,395 @@
+/*
+ *  ======== telemetryIngestBench.c ========
+ *  Parser throughput of the telemetry ingester (telemetryIngest.c): frame
+ *  decoding alone, decoding plus appending to the columnar store
+ *  (columnStore.c), and scanning the store afterwards, against loading
+ *  the same reports from the old "Microvolts: ..." text (captureFile.c).
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o telemetryIngestBench \
+ *        host/telemetryIngestBench.c host/columnStore.c \
+ *        host/telemetryDecode.c host/captureFile.c host/echoSynth.c \
+ *        rfEchoTxFinal/telemetry.c rfEchoTxFinal/deltaCodec.c -lm
+ *
+ *  Usage: telemetryIngestBench [frames]
+ *  Builds a stream of frames as the firmware sends them (mostly delta
+ *  coded, some raw, some summaries without codes, line noise now and
+ *  then) in memory and feeds it to the parser in 64KB chunks, as the
+ *  ingester's reader thread hands them over. The store goes to a
+ *  temporary directory under $TMPDIR (or /tmp) and is removed afterwards.
+ *  Exits with 1 if the store does not hold exactly the reports that were
+ *  sent. The threaded ingester itself reports its throughput at the end
+ *  of a run, e.g. on a capture file.
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "captureFile.h"
+#include "columnStore.h"
+#include "deltaCodec.h"
+#include "echoConfig.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+#include "telemetryDecode.h"
+
+#define NUM_SAMPLES     (ECHO_BUFFER_SAMPLES)
+#define NUM_FRAMES      (200000)
+/* The text is slow to load; a share of the frames is enough */
+#define TEXT_FRAMES     (20000)
+#define NUM_BUFFERS     (64)
+#define CHUNK_SIZE      (64 * 1024)
+#define MAX_CODES       (TELEMETRY_MAX_PAYLOAD / 2)
+#define FRAME_SIZE \
+    TELEMETRY_FRAME_SIZE(TELEMETRY_ECHO_REPORT_SIZE + \
+                         DELTA_CODEC_MAX_SIZE(NUM_SAMPLES))
+
+static uint16_t codes[NUM_BUFFERS][NUM_SAMPLES];
+static volatile uint64_t sink;
+
+/*
+ *  ======== hasCodes ========
+ *  Every 10th report goes out as a summary, as when the link falls behind.
+ */
+static int hasCodes(uint32_t n)
+{
+    return (n % 10 != 9);
+}
+
+/*
+ *  ======== fillReport ========
+ */
+static void fillReport(Telemetry_EchoReport *report, uint32_t n)
+{
+    memset(report, 0, sizeof(*report));
+    report->buffersCompleted = n * ECHO_WINDOW_BUFFERS;
+    report->peakValue = 1000 + n * 7;
+    report->arrivalUs = 500 + n % 5000;
+    report->peakBin = n % 28;
+    report->buffersDone = ECHO_WINDOW_BUFFERS;
+    report->binSize = ECHO_BIN_SIZE;
+    report->numSamples = hasCodes(n) ? NUM_SAMPLES : 0;
+    report->flags = TELEMETRY_FLAG_TOF_VALID |
+        ((n & 1) ? TELEMETRY_FLAG_DETECTED : 0);
+}
+
+/*
+ *  ======== buildStream ========
+ */
+static uint8_t *buildStream(uint32_t numFrames, size_t *streamSize)
+{
+    Telemetry_Object telemetry;
+    Telemetry_EchoReport report;
+    uint8_t *stream = malloc((size_t)numFrames * (FRAME_SIZE + 8));
+    uint32_t seed = 0x600d;
+    size_t size = 0;
+    uint32_t n;
+
+    if (stream == NULL) {
+        return (NULL);
+    }
+
+    Telemetry_init(&telemetry);
+    for (n = 0; n < numFrames; n++) {
+        uint8_t *frame = &stream[size];
+        const uint16_t *samples = codes[n % NUM_BUFFERS];
+
+        fillReport(&report, n);
+        if (!hasCodes(n)) {
+            size += Telemetry_encode(&telemetry, TELEMETRY_TYPE_ECHO_REPORT,
+                                     &report, sizeof(report), NULL, 0, frame);
+        }
+        else if (n % 7 == 0) {
+            size += Telemetry_encode(&telemetry, TELEMETRY_TYPE_ECHO_REPORT,
+                                     &report, sizeof(report), samples,
+                                     NUM_SAMPLES * sizeof(uint16_t), frame);
+        }
+        else {
+            memcpy(&frame[TELEMETRY_HEADER_SIZE], &report, sizeof(report));
+            size += Telemetry_finish(&telemetry,
+                TELEMETRY_TYPE_ECHO_REPORT_DELTA, sizeof(report) +
+                DeltaCodec_encode(samples, NUM_SAMPLES,
+                                  &frame[TELEMETRY_HEADER_SIZE +
+                                         sizeof(report)]),
+                frame);
+        }
+
+        /* Line noise */
+        if (EchoSynth_uniform(&seed) < 0.01) {
+            uint32_t i;
+
+            for (i = 0; i < 8; i++) {
+                stream[size++] = (uint8_t)(EchoSynth_uniform(&seed) * 256);
+            }
+        }
+    }
+
+    *streamSize = size;
+
+    return (stream);
+}
+
+/*
+ *  ======== parse ========
+ *  Decodes the stream in chunks, into the store if there is one.
+ */
+static uint64_t parse(const uint8_t *stream, size_t streamSize,
+                      ColumnStore *store)
+{
+    static TelemetryDecode_Object decoder;
+    static uint16_t decoded[MAX_CODES];
+    size_t offset;
+    uint64_t reports = 0;
+
+    TelemetryDecode_init(&decoder);
+    for (offset = 0; offset < streamSize; offset += CHUNK_SIZE) {
+        const uint8_t *data = &stream[offset];
+        size_t size = streamSize - offset;
+        TelemetryDecode_Frame frame;
+
+        if (size > CHUNK_SIZE) {
+            size = CHUNK_SIZE;
+        }
+        while (TelemetryDecode_next(&decoder, &data, &size, &frame)) {
+            Telemetry_EchoReport report;
+            int numCodes = TelemetryDecode_echoReport(&frame, &report,
+                                                      decoded, MAX_CODES);
+
+            if (numCodes < 0) {
+                continue;
+            }
+            reports++;
+            if (store != NULL) {
+                /* The chunk offset stands in for the arrival time */
+                ColumnStore_append(store, &report, frame.sequence, decoded,
+                                   (uint32_t)numCodes, offset);
+            }
+            else {
+                sink += decoded[0] + report.peakValue;
+            }
+        }
+        if (store != NULL) {
+            ColumnStore_sync(store);
+        }
+    }
+
+    return (reports);
+}
+
+/*
+ *  ======== writeText ========
+ *  The first numFrames reports as the old firmware printed them (the way
+ *  telemetryDump prints them); returns the file size.
+ */
+static size_t writeText(const char *path, uint32_t numFrames)
+{
+    FILE *file = fopen(path, "w");
+    Telemetry_EchoReport report;
+    size_t size;
+    uint32_t n;
+    uint32_t i;
+
+    if (file == NULL) {
+        return (0);
+    }
+    for (n = 0; n < numFrames; n++) {
+        fillReport(&report, n);
+        fprintf(file, "\r\nBuffer %u finished. Echo at %u us. Peak %u in "
+                "bin %u%s.", (unsigned int)report.buffersCompleted,
+                (unsigned int)report.arrivalUs,
+                (unsigned int)report.peakValue, (unsigned int)report.peakBin,
+                (report.flags & TELEMETRY_FLAG_DETECTED) ? ", detected" : "");
+        if (report.numSamples != 0) {
+            fprintf(file, "\r\nMicrovolts: ");
+            for (i = 0; i < NUM_SAMPLES; i++) {
+                fprintf(file, "%u,", (unsigned int)TelemetryDecode_microVolts(
+                    codes[n % NUM_BUFFERS][i]));
+            }
+        }
+        fprintf(file, "\n");
+    }
+    size = (size_t)ftell(file);
+    fclose(file);
+
+    return (size);
+}
+
+/*
+ *  ======== check ========
+ *  Returns the number of rows that differ from what was sent.
+ */
+static uint64_t check(const ColumnStore *store, uint32_t numFrames)
+{
+    Telemetry_EchoReport report;
+    uint64_t bad = 0;
+    uint64_t row;
+
+    if (store->numRows != numFrames) {
+        return ((store->numRows > numFrames) ? store->numRows : numFrames);
+    }
+    for (row = 0; row < store->numRows; row++) {
+        const uint16_t *samples = &store->samples[row * NUM_SAMPLES];
+        uint32_t n = (uint32_t)row;
+
+        fillReport(&report, n);
+        if (store->sequence[row] != (uint16_t)n ||
+            store->peakValue[row] != report.peakValue ||
+            store->buffersCompleted[row] != report.buffersCompleted ||
+            store->arrivalUs[row] != report.arrivalUs ||
+            store->peakBin[row] != report.peakBin ||
+            store->flags[row] != report.flags ||
+            store->numSamples[row] != report.numSamples ||
+            (report.numSamples != 0 &&
+             memcmp(samples, codes[n % NUM_BUFFERS],
+                    NUM_SAMPLES * sizeof(uint16_t)) != 0)) {
+            bad++;
+        }
+    }
+
+    return (bad);
+}
+
+/*
+ *  ======== removeStore ========
+ */
+static void removeStore(const char *dir)
+{
+    char path[PATH_MAX + NAME_MAX + 2];
+    struct dirent *entry;
+    DIR *handle = opendir(dir);
+
+    while (handle != NULL && (entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+        }
+    }
+    if (handle != NULL) {
+        closedir(handle);
+    }
+    rmdir(dir);
+}
+
+int main(int argc, char *argv[])
+{
+    EchoSynth_Params params;
+    uint32_t microVolts[NUM_SAMPLES];
+    uint32_t numFrames = (argc > 1) ? (uint32_t)atoi(argv[1]) : NUM_FRAMES;
+    uint32_t textFrames = (numFrames < TEXT_FRAMES) ? numFrames : TEXT_FRAMES;
+    uint32_t seed = 0x1234567;
+    const char *tmp = getenv("TMPDIR");
+    char dir[PATH_MAX];
+    char textPath[PATH_MAX + 8];
+    ColumnStore store;
+    CaptureFile capture;
+    uint8_t *stream;
+    size_t streamSize;
+    size_t textSize;
+    uint64_t reports;
+    uint64_t detected = 0;
+    uint64_t peakSum = 0;
+    uint64_t sampleSum = 0;
+    uint64_t bad;
+    uint64_t row;
+    double seconds;
+    uint32_t b;
+    uint32_t i;
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = 100000;
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        params.echoUv = (b & 1) ? 50000 : 0;
+        params.echoStart = EchoSynth_uniform(&seed) * (NUM_SAMPLES - 200);
+        EchoSynth_microVolts(&params, &seed, microVolts, NUM_SAMPLES);
+        for (i = 0; i < NUM_SAMPLES; i++) {
+            codes[b][i] = EchoSynth_microVoltsToCode(microVolts[i]);
+        }
+    }
+
+    stream = buildStream(numFrames, &streamSize);
+    if (stream == NULL || numFrames == 0) {
+        return (1);
+    }
+    snprintf(dir, sizeof(dir), "%s/ingestBenchXXXXXX", tmp ? tmp : "/tmp");
+    if (mkdtemp(dir) == NULL) {
+        perror(dir);
+        return (1);
+    }
+    snprintf(textPath, sizeof(textPath), "%s.txt", dir);
+
+    printf("%u reports of %u samples, %.1f MB of telemetry\n", numFrames,
+           NUM_SAMPLES, streamSize * 1e-6);
+    printf("%-30s %10s %12s\n", "", "MB/s", "reports/s");
+
+    seconds = HostCycles_seconds();
+    reports = parse(stream, streamSize, NULL);
+    seconds = HostCycles_seconds() - seconds;
+    printf("%-30s %10.0f %12.0f\n", "decode frames", streamSize / seconds *
+           1e-6, reports / seconds);
+
+    if (ColumnStore_create(&store, dir, NUM_SAMPLES) != 0) {
+        perror(dir);
+        return (1);
+    }
+    seconds = HostCycles_seconds();
+    parse(stream, streamSize, &store);
+    ColumnStore_close(&store);
+    seconds = HostCycles_seconds() - seconds;
+    printf("%-30s %10.0f %12.0f\n", "decode and append to store",
+           streamSize / seconds * 1e-6, reports / seconds);
+
+    textSize = writeText(textPath, textFrames);
+    seconds = HostCycles_seconds();
+    if (CaptureFile_load(textPath, NUM_SAMPLES, &capture) != 0) {
+        perror(textPath);
+        return (1);
+    }
+    seconds = HostCycles_seconds() - seconds;
+    printf("%-30s %10.0f %12.0f  (%.1f MB for %u reports)\n",
+           "load old text (captureFile)", textSize / seconds * 1e-6,
+           textFrames / seconds, textSize * 1e-6, textFrames);
+    CaptureFile_free(&capture);
+    unlink(textPath);
+
+    /* What an analysis tool does with the store: one pass over the report
+     * columns, one over the samples */
+    if (ColumnStore_open(&store, dir) != 0) {
+        perror(dir);
+        return (1);
+    }
+    seconds = HostCycles_seconds();
+    for (row = 0; row < store.numRows; row++) {
+        detected += (store.flags[row] & TELEMETRY_FLAG_DETECTED) != 0;
+        peakSum += store.peakValue[row];
+    }
+    seconds = HostCycles_seconds() - seconds;
+    printf("%-30s %10.0f %12.0f\n", "scan flags and peaks",
+           store.numRows * 5 / seconds * 1e-6, store.numRows / seconds);
+
+    seconds = HostCycles_seconds();
+    for (row = 0; row < store.numRows * store.samplesPerRow; row++) {
+        sampleSum += store.samples[row];
+    }
+    seconds = HostCycles_seconds() - seconds;
+    printf("%-30s %10.0f %12.0f\n", "scan samples",
+           store.numRows * store.samplesPerRow * 2 / seconds * 1e-6,
+           store.numRows / seconds);
+    sink += detected + peakSum + sampleSum;
+
+    bad = check(&store, numFrames);
+    ColumnStore_close(&store);
+    removeStore(dir);
+    free(stream);
+
+    printf("\nstore: %llu rows, %llu detected, %llu differ from the sent "
+           "reports\n", (unsigned long long)reports,
+           (unsigned long long)detected, (unsigned long long)bad);
+    printf(bad == 0 ? "OK\n" : "FAIL\n");
+
+    return (bad == 0 ? 0 : 1);
+}
@@ -0,0 +1,364 @@
+/*
+ *  ======== telemetryModeBench.c ========
+ *  UART bytes and encoding cycles per listen window of the summary mode
+ *  (telemetryMode.c) against the full report with codes every window, and
+ *  a check of the host's mode commands as the firmware parses them.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o telemetryModeBench \
+ *        host/telemetryModeBench.c host/telemetryDecode.c host/echoSynth.c \
+ *        rfEchoTxFinal/telemetryMode.c rfEchoTxFinal/telemetry.c \
+ *        rfEchoTxFinal/deltaCodec.c -lm
+ *
+ *  Windows: a synthetic run where the buzzer state changes now and then,
+ *  1% of the packets go missing and a few buffers are lost. Every window
+ *  builds its frames the way analyzeBuffer does; the stream goes through
+ *  the host decoder, which has to find a summary for every window, a
+ *  report with codes for every anomaly and at least one every rawEvery
+ *  windows.
+ *
+ *  Commands: TELEMETRY_TYPE_SET_MODE frames between line noise, some with
+ *  bit errors, fed to TelemetryMode_receive a byte at a time. Every intact
+ *  command has to be applied in order and no damaged one. Exits with 1 if
+ *  either check fails.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deltaCodec.h"
+#include "echoConfig.h"
+#include "echoSynth.h"
+#include "hostCycles.h"
+#include "telemetryDecode.h"
+#include "telemetryMode.h"
+
+#define NUM_SAMPLES     (ECHO_BUFFER_SAMPLES)
+#define NUM_WINDOWS     (20000)
+#define NUM_BUFFERS     (64)
+#define NUM_COMMANDS    (5000)
+#define BAUD_RATE       (115200)
+/* 8N1: 10 bits on the line per byte */
+#define BYTE_US         (10 * 1000000.0 / BAUD_RATE)
+#define FRAME_SIZE \
+    TELEMETRY_FRAME_SIZE(TELEMETRY_ECHO_REPORT_SIZE + \
+                         DELTA_CODEC_MAX_SIZE(NUM_SAMPLES))
+#define COMMAND_SIZE    TELEMETRY_FRAME_SIZE(TELEMETRY_SET_MODE_SIZE)
+
+typedef struct Window {
+    bool     detected;
+    bool     rfOk;
+    uint8_t  overruns;
+} Window;
+
+typedef struct Config {
+    const char *name;
+    uint8_t     mode;
+    uint16_t    rawEvery;
+} Config;
+
+static const Config configs[] = {
+    { "full",              TELEMETRY_MODE_FULL,    0 },
+    { "summary, every 16", TELEMETRY_MODE_SUMMARY, 16 },
+    { "summary, every 64", TELEMETRY_MODE_SUMMARY, 64 },
+    { "summary, every 256", TELEMETRY_MODE_SUMMARY, 256 },
+    { "summary, anomalies", TELEMETRY_MODE_SUMMARY, 0 },
+};
+#define NUM_CONFIGS     (sizeof(configs) / sizeof(configs[0]))
+
+static uint16_t codes[NUM_BUFFERS][NUM_SAMPLES];
+static Window windows[NUM_WINDOWS];
+
+/*
+ *  ======== isAnomaly ========
+ *  As analyzeBuffer; the buzzer change is found by TelemetryMode_cycle.
+ */
+static bool isAnomaly(uint32_t n)
+{
+    return (windows[n].overruns != 0 || !windows[n].rfOk);
+}
+
+/*
+ *  ======== buildWindow ========
+ *  The frames of window n, as analyzeBuffer sends them; returns their size.
+ */
+static uint32_t buildWindow(TelemetryMode_Object *telemetryMode,
+                            Telemetry_Object *telemetry, uint32_t n,
+                            uint8_t *out)
+{
+    const Window *window = &windows[n];
+    Telemetry_EchoReport report;
+    Telemetry_CycleSummary summary;
+    uint32_t size = 0;
+    uint8_t send;
+    uint8_t flags;
+
+    send = TelemetryMode_cycle(telemetryMode, window->detected,
+                               isAnomaly(n));
+    flags = (window->detected ? TELEMETRY_FLAG_DETECTED : 0) |
+        TELEMETRY_FLAG_TOF_VALID;
+
+    if (send & TELEMETRY_MODE_SEND_SUMMARY) {
+        memset(&summary, 0, sizeof(summary));
+        summary.buffersCompleted = n * ECHO_WINDOW_BUFFERS;
+        summary.peakValue = 1000 + n;
+        summary.arrivalUs = 500 + n % 5000;
+        summary.peakBin = n % 28;
+        summary.rfSequence = (uint16_t)n;
+        summary.rxOk = (uint16_t)n;
+        summary.lastRssi = -60;
+        summary.flags = flags |
+            (window->rfOk ? TELEMETRY_FLAG_RF_OK : 0) |
+            ((send & TELEMETRY_MODE_SEND_REPORT) ? TELEMETRY_FLAG_CODES : 0);
+        summary.overruns = window->overruns;
+        size += Telemetry_encode(telemetry, TELEMETRY_TYPE_CYCLE_SUMMARY,
+                                 &summary, sizeof(summary), NULL, 0, out);
+    }
+    if (send & TELEMETRY_MODE_SEND_REPORT) {
+        uint8_t *frame = &out[size];
+
+        memset(&report, 0, sizeof(report));
+        report.buffersCompleted = n * ECHO_WINDOW_BUFFERS;
+        report.peakValue = 1000 + n;
+        report.buffersDone = ECHO_WINDOW_BUFFERS;
+        report.overruns = window->overruns;
+        report.binSize = ECHO_BIN_SIZE;
+        report.numSamples = NUM_SAMPLES;
+        report.flags = flags;
+        memcpy(&frame[TELEMETRY_HEADER_SIZE], &report, sizeof(report));
+        size += Telemetry_finish(telemetry, TELEMETRY_TYPE_ECHO_REPORT_DELTA,
+            sizeof(report) + DeltaCodec_encode(codes[n % NUM_BUFFERS],
+                NUM_SAMPLES, &frame[TELEMETRY_HEADER_SIZE + sizeof(report)]),
+            frame);
+    }
+
+    return (size);
+}
+
+/*
+ *  ======== checkStream ========
+ *  Decodes the frames of a run; returns the number of windows whose frames
+ *  are not what the mode asks for.
+ */
+static uint32_t checkStream(const Config *config, const uint8_t *stream,
+                            size_t streamSize)
+{
+    static TelemetryDecode_Object decoder;
+    static uint16_t decoded[NUM_SAMPLES];
+    static bool summaryOf[NUM_WINDOWS];
+    static bool reportOf[NUM_WINDOWS];
+    TelemetryDecode_Frame frame;
+    Telemetry_EchoReport report;
+    Telemetry_CycleSummary summary;
+    uint32_t lastReport = 0;
+    uint32_t bad = 0;
+    uint32_t n;
+
+    memset(summaryOf, 0, sizeof(summaryOf));
+    memset(reportOf, 0, sizeof(reportOf));
+    TelemetryDecode_init(&decoder);
+    while (TelemetryDecode_next(&decoder, &stream, &streamSize, &frame)) {
+        if (TelemetryDecode_cycleSummary(&frame, &summary) == 0) {
+            summaryOf[summary.buffersCompleted / ECHO_WINDOW_BUFFERS] = true;
+        }
+        else if (TelemetryDecode_echoReport(&frame, &report, decoded,
+                                            NUM_SAMPLES) == NUM_SAMPLES) {
+            n = report.buffersCompleted / ECHO_WINDOW_BUFFERS;
+            reportOf[n] = memcmp(decoded, codes[n % NUM_BUFFERS],
+                                 sizeof(decoded)) == 0;
+        }
+    }
+    if (decoder.crcErrors != 0 || decoder.lostFrames != 0) {
+        return (NUM_WINDOWS);
+    }
+
+    for (n = 0; n < NUM_WINDOWS; n++) {
+        bool changed = n > 0 && windows[n].detected != windows[n - 1].detected;
+
+        if (config->mode == TELEMETRY_MODE_FULL) {
+            bad += summaryOf[n] || !reportOf[n];
+            continue;
+        }
+        if (!summaryOf[n] ||
+            ((isAnomaly(n) || changed) && !reportOf[n]) ||
+            (config->rawEvery != 0 && n - lastReport > config->rawEvery)) {
+            bad++;
+        }
+        if (reportOf[n]) {
+            lastReport = n;
+        }
+    }
+
+    return (bad);
+}
+
+/*
+ *  ======== benchModes ========
+ */
+static int benchModes(void)
+{
+    static TelemetryMode_Object telemetryMode;
+    uint8_t *stream = malloc((size_t)NUM_WINDOWS * (FRAME_SIZE + 64));
+    Telemetry_Object telemetry;
+    double fullBytes = 0;
+    int failed = 0;
+    size_t c;
+
+    if (stream == NULL) {
+        return (1);
+    }
+
+    printf("%u windows of %u samples, %u baud\n", NUM_WINDOWS, NUM_SAMPLES,
+           BAUD_RATE);
+    printf("%-20s %9s %9s %10s %9s %8s %6s\n", "mode", "bytes", "link ms",
+           HOST_CYCLES_UNIT, "codes", "less", "bad");
+
+    for (c = 0; c < NUM_CONFIGS; c++) {
+        const Config *config = &configs[c];
+        size_t streamSize = 0;
+        uint64_t cycles = 0;
+        uint32_t withCodes = 0;
+        uint32_t bad;
+        uint32_t n;
+        double perWindow;
+
+        TelemetryMode_init(&telemetryMode, config->mode, config->rawEvery);
+        Telemetry_init(&telemetry);
+        for (n = 0; n < NUM_WINDOWS; n++) {
+            uint64_t start = HostCycles_now();
+            uint32_t size = buildWindow(&telemetryMode, &telemetry, n,
+                                        &stream[streamSize]);
+
+            cycles += HostCycles_now() - start;
+            withCodes += size > TELEMETRY_FRAME_SIZE(
+                TELEMETRY_CYCLE_SUMMARY_SIZE);
+            streamSize += size;
+        }
+
+        bad = checkStream(config, stream, streamSize);
+        perWindow = (double)streamSize / NUM_WINDOWS;
+        if (c == 0) {
+            fullBytes = perWindow;
+        }
+        printf("%-20s %9.1f %9.2f %10.0f %8.1f%% %7.1fx %6u\n", config->name,
+               perWindow, perWindow * BYTE_US / 1000,
+               (double)cycles / NUM_WINDOWS, 100.0 * withCodes / NUM_WINDOWS,
+               fullBytes / perWindow, bad);
+        failed |= bad != 0;
+    }
+    free(stream);
+
+    return (failed);
+}
+
+/*
+ *  ======== checkCommands ========
+ */
+static int checkCommands(void)
+{
+    static TelemetryMode_Object telemetryMode;
+    uint8_t frame[COMMAND_SIZE];
+    Telemetry_Object host;
+    Telemetry_SetMode command;
+    uint32_t seed = 0xc0ffee;
+    uint32_t intact = 0;
+    uint32_t applied = 0;
+    uint32_t wrong = 0;
+    uint32_t n;
+    uint32_t i;
+
+    TelemetryMode_init(&telemetryMode, TELEMETRY_MODE_FULL, 0);
+    Telemetry_init(&host);
+    for (n = 0; n < NUM_COMMANDS; n++) {
+        double u = EchoSynth_uniform(&seed);
+        bool damaged = u < 0.2;
+        uint32_t size;
+
+        memset(&command, 0, sizeof(command));
+        command.mode = (n & 1) ? TELEMETRY_MODE_SUMMARY : TELEMETRY_MODE_FULL;
+        command.rawEvery = (uint16_t)(n * 7);
+        size = Telemetry_encode(&host, TELEMETRY_TYPE_SET_MODE, &command,
+                                sizeof(command), NULL, 0, frame);
+        if (damaged) {
+            i = (uint32_t)(EchoSynth_uniform(&seed) * size);
+            frame[i] ^= (uint8_t)(1u << (uint32_t)(EchoSynth_uniform(&seed) *
+                                                   8));
+        }
+        intact += !damaged;
+
+        /* Line noise before the command, sometimes with stray sync bytes */
+        if (EchoSynth_uniform(&seed) < 0.3) {
+            uint32_t noise = 1 + (uint32_t)(EchoSynth_uniform(&seed) * 20);
+
+            for (i = 0; i < noise; i++) {
+                uint8_t byte = (EchoSynth_uniform(&seed) < 0.3) ?
+                    TELEMETRY_SYNC0 :
+                    (uint8_t)(EchoSynth_uniform(&seed) * 256);
+
+                if (TelemetryMode_receive(&telemetryMode, byte)) {
+                    wrong++;
+                }
+            }
+        }
+
+        for (i = 0; i < size; i++) {
+            if (!TelemetryMode_receive(&telemetryMode, frame[i])) {
+                continue;
+            }
+            applied++;
+            if (damaged || i != size - 1 ||
+                telemetryMode.setting !=
+                    ((uint32_t)command.mode |
+                     ((uint32_t)command.rawEvery << 16))) {
+                wrong++;
+            }
+        }
+    }
+
+    printf("\ncommands: %u sent, %u intact, %u applied, %u wrong, %u "
+           "rejected\n", NUM_COMMANDS, intact, applied, wrong,
+           telemetryMode.rejected);
+
+    return (applied != intact || wrong != 0);
+}
+
+int main(void)
+{
+    EchoSynth_Params params;
+    uint32_t microVolts[NUM_SAMPLES];
+    uint32_t seed = 0x1234567;
+    bool detected = false;
+    uint32_t n;
+    uint32_t i;
+    int failed;
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = 100000;
+    for (n = 0; n < NUM_BUFFERS; n++) {
+        params.echoUv = (n & 1) ? 50000 : 0;
+        params.echoStart = EchoSynth_uniform(&seed) * (NUM_SAMPLES - 200);
+        EchoSynth_microVolts(&params, &seed, microVolts, NUM_SAMPLES);
+        for (i = 0; i < NUM_SAMPLES; i++) {
+            codes[n][i] = EchoSynth_microVoltsToCode(microVolts[i]);
+        }
+    }
+
+    /* Someone walks in and out of range now and then */
+    for (n = 0; n < NUM_WINDOWS; n++) {
+        if (EchoSynth_uniform(&seed) < 0.01) {
+            detected = !detected;
+        }
+        windows[n].detected = detected;
+        windows[n].rfOk = EchoSynth_uniform(&seed) >= 0.01;
+        windows[n].overruns = EchoSynth_uniform(&seed) < 0.002;
+    }
+
+    failed = benchModes();
+    failed |= checkCommands();
+    printf(failed ? "FAIL\n" : "OK\n");
+
+    return (failed);
+}
@@ -0,0 +1,71 @@
+/*
+ *  ======== telemetrySetMode.c ========
+ *  Switches the telemetry of a running board between full and summary mode
+ *  (rfEchoTxFinal/telemetryMode.h) with a TELEMETRY_TYPE_SET_MODE frame.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o telemetrySetMode \
+ *        host/telemetrySetMode.c rfEchoTxFinal/telemetry.c
+ *
+ *  Usage: telemetrySetMode full|summary [rawEvery] [device]
+ *    rawEvery  summary mode: send the codes every rawEvery windows as well
+ *              (default: ECHO_TELEMETRY_RAW_EVERY, 0 for anomalies only)
+ *    device    the board's serial port, e.g. after
+ *                stty -F /dev/ttyACM0 115200 raw
+ *              or stdout if missing
+ *  The firmware answers with the next window's frames; telemetryDump shows
+ *  which mode they are in.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "echoConfig.h"
+#include "telemetry.h"
+
+int main(int argc, char *argv[])
+{
+    uint8_t frame[TELEMETRY_FRAME_SIZE(TELEMETRY_SET_MODE_SIZE)];
+    Telemetry_Object telemetry;
+    Telemetry_SetMode command;
+    FILE *output = stdout;
+    uint16_t size;
+
+    memset(&command, 0, sizeof(command));
+    command.rawEvery = ECHO_TELEMETRY_RAW_EVERY;
+    if (argc > 1 && strcmp(argv[1], "full") == 0) {
+        command.mode = TELEMETRY_MODE_FULL;
+    }
+    else if (argc > 1 && strcmp(argv[1], "summary") == 0) {
+        command.mode = TELEMETRY_MODE_SUMMARY;
+    }
+    else {
+        fprintf(stderr, "usage: %s full|summary [rawEvery] [device]\n",
+                argv[0]);
+        return (2);
+    }
+    if (argc > 2) {
+        command.rawEvery = (uint16_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3 && (output = fopen(argv[3], "wb")) == NULL) {
+        perror(argv[3]);
+        return (1);
+    }
+
+    /* The firmware does not check the sequence number of commands */
+    Telemetry_init(&telemetry);
+    size = Telemetry_encode(&telemetry, TELEMETRY_TYPE_SET_MODE, &command,
+                            sizeof(command), NULL, 0, frame);
+    if (fwrite(frame, 1, size, output) != size || fflush(output) != 0) {
+        perror("write");
+        return (1);
+    }
+
+    if (output != stdout) {
+        fclose(output);
+    }
+
+    return (0);
+}
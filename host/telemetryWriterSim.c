@@ -0,0 +1,405 @@
+/*
+ *  ======== telemetryWriterSim.c ========
+ *  Simulation of the UART telemetry (telemetryWriter.c) when listen windows
+ *  come faster than the 115200 baud link can carry their frames, against
+ *  the single uartTxBuffer it replaced.
+ *
+ *  Build (from the repository root):
+ *    gcc -O2 -Ihost -Icommon -IrfEchoTxFinal -o telemetryWriterSim \
+ *        host/telemetryWriterSim.c host/telemetryDecode.c host/echoSynth.c \
+ *        rfEchoTxFinal/telemetryWriter.c rfEchoTxFinal/telemetry.c \
+ *        rfEchoTxFinal/deltaCodec.c -lm
+ *
+ *  Every window builds its frame the way analyzeBuffer does: report and
+ *  delta coded codes if the writer has a free buffer, otherwise the report
+ *  alone. The link takes 10 bit times per byte and calls
+ *  TelemetryWriter_complete at the end of each frame. The bytes on the
+ *  link go through the host decoder (telemetryDecode.c).
+ *
+ *  The old firmware wrote every frame into one buffer and called UART_write
+ *  without waiting: a write while the previous frame was still on the
+ *  link failed, and the new frame overwrote the bytes not yet sent.
+ *
+ *  For every window period and number of frame buffers prints what reached
+ *  the host, what was dropped, and the longest time from the end of a
+ *  window to the end of its frame. Exits with 1 if a writer run sends a
+ *  corrupted frame or its counters do not account for every window.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deltaCodec.h"
+#include "echoConfig.h"
+#include "echoSynth.h"
+#include "telemetryDecode.h"
+#include "telemetryWriter.h"
+
+#define NUM_SAMPLES     (ECHO_BUFFER_SAMPLES)
+#define NUM_WINDOWS     (2000)
+#define NUM_BUFFERS     (64)
+#define BAUD_RATE       (115200)
+/* 8N1: 10 bits on the line per byte */
+#define BYTE_US         (10 * 1000000.0 / BAUD_RATE)
+#define FRAME_SIZE \
+    TELEMETRY_FRAME_SIZE(TELEMETRY_ECHO_REPORT_SIZE + \
+                         DELTA_CODEC_MAX_SIZE(NUM_SAMPLES))
+
+/* Milliseconds between listen windows; the firmware pings once a second */
+static const double periodsMs[] = { 1000, 50, 25, 20, 15, 10, 5 };
+#define NUM_PERIODS     (sizeof(periodsMs) / sizeof(periodsMs[0]))
+
+typedef struct Link {
+    uint8_t       *stream;      /* Bytes on the wire */
+    size_t         streamSize;
+    const uint8_t *frame;       /* Being sent, NULL when idle */
+    uint16_t       size;
+    uint16_t       window;      /* Window the frame belongs to */
+    double         start;
+    double         now;
+} Link;
+
+typedef struct Result {
+    uint32_t samplesOut;        /* Frames with codes decoded by the host */
+    uint32_t summariesOut;
+    uint32_t crcErrors;
+    uint32_t lostFrames;        /* Sequence gaps seen by the host */
+    uint32_t samplesDropped;    /* Writer counters, or failed writes */
+    uint32_t summariesDropped;
+    uint32_t evicted;
+    double   worstLatencyMs;
+    bool     countersOk;
+} Result;
+
+static uint16_t codes[NUM_BUFFERS][NUM_SAMPLES];
+static uint16_t frameWindow[TELEMETRY_WRITER_MAX_BUFFERS];
+
+/*
+ *  ======== linkWrite ========
+ *  TelemetryWriter_WriteFxn of the simulated UART.
+ */
+static void linkWrite(void *arg, const uint8_t *frame, uint16_t size)
+{
+    Link *link = arg;
+
+    link->frame = frame;
+    link->size = size;
+    link->start = link->now;
+}
+
+/*
+ *  ======== linkFinish ========
+ *  Puts the frame on the wire; returns the time it was done.
+ */
+static double linkFinish(Link *link)
+{
+    memcpy(&link->stream[link->streamSize], link->frame, link->size);
+    link->streamSize += link->size;
+    link->frame = NULL;
+
+    return (link->start + link->size * BYTE_US);
+}
+
+/*
+ *  ======== buildReport ========
+ */
+static void buildReport(Telemetry_EchoReport *report, uint32_t window)
+{
+    memset(report, 0, sizeof(*report));
+    report->buffersCompleted = window * ECHO_WINDOW_BUFFERS;
+    report->peakValue = window;
+    report->buffersDone = ECHO_WINDOW_BUFFERS;
+    report->binSize = ECHO_BIN_SIZE;
+    report->numSamples = NUM_SAMPLES;
+}
+
+/*
+ *  ======== decodeStream ========
+ *  What the host gets out of the bytes on the wire.
+ */
+static void decodeStream(const Link *link, Result *result,
+                         Telemetry_EchoReport *last)
+{
+    static TelemetryDecode_Object decoder;
+    static uint16_t decoded[TELEMETRY_MAX_PAYLOAD / 2];
+    const uint8_t *data = link->stream;
+    size_t size = link->streamSize;
+    TelemetryDecode_Frame frame;
+
+    memset(last, 0, sizeof(*last));
+    TelemetryDecode_init(&decoder);
+    while (TelemetryDecode_next(&decoder, &data, &size, &frame)) {
+        int numCodes = TelemetryDecode_echoReport(&frame, last, decoded,
+                                                  TELEMETRY_MAX_PAYLOAD / 2);
+
+        if (numCodes > 0) {
+            result->samplesOut++;
+        }
+        else if (numCodes == 0) {
+            result->summariesOut++;
+        }
+    }
+    result->crcErrors = (uint32_t)decoder.crcErrors;
+    result->lostFrames = (uint32_t)decoder.lostFrames;
+}
+
+/*
+ *  ======== runWriter ========
+ */
+static void runWriter(double periodMs, uint16_t numBuffers, Link *link,
+                      Result *result)
+{
+    static uint8_t storage[TELEMETRY_WRITER_MAX_BUFFERS][FRAME_SIZE];
+    TelemetryWriter_Object writer;
+    Telemetry_Object telemetry;
+    Telemetry_EchoReport report;
+    Telemetry_EchoReport last;
+    uint32_t window;
+    uint32_t windowsOut;
+
+    memset(result, 0, sizeof(*result));
+    link->streamSize = 0;
+    link->frame = NULL;
+    link->now = 0;
+
+    Telemetry_init(&telemetry);
+    TelemetryWriter_init(&writer, storage[0], numBuffers, FRAME_SIZE,
+                         linkWrite, link);
+
+    for (window = 0; window < NUM_WINDOWS; window++) {
+        double windowEnd = window * periodMs * 1000;
+        uint16_t frameSize;
+        uint8_t *frame;
+        uint16_t i;
+
+        /* Frames that finish before the window is over */
+        while (link->frame != NULL) {
+            double done = link->start + link->size * BYTE_US;
+            double latency;
+
+            if (done > windowEnd) {
+                break;
+            }
+            for (i = 0; i < numBuffers; i++) {
+                if (writer.buffers[i] == link->frame) {
+                    break;
+                }
+            }
+            latency = done - frameWindow[i] * periodMs * 1000;
+            if (latency / 1000 > result->worstLatencyMs) {
+                result->worstLatencyMs = latency / 1000;
+            }
+            link->now = linkFinish(link);
+            TelemetryWriter_complete(&writer);
+        }
+        link->now = windowEnd;
+
+        /* As analyzeBuffer */
+        buildReport(&report, window);
+        frame = TelemetryWriter_acquire(&writer, TELEMETRY_WRITER_SAMPLES);
+        if (frame == NULL) {
+            frame = TelemetryWriter_acquire(&writer,
+                                            TELEMETRY_WRITER_SUMMARY);
+            report.numSamples = 0;
+        }
+        if (frame == NULL) {
+            continue;
+        }
+        report.samplesDropped = (uint16_t)(writer.evicted +
+            writer.dropped[TELEMETRY_WRITER_SAMPLES]);
+        report.summariesDropped =
+            (uint16_t)writer.dropped[TELEMETRY_WRITER_SUMMARY];
+
+        if (report.numSamples == 0) {
+            frameSize = Telemetry_encode(&telemetry,
+                TELEMETRY_TYPE_ECHO_REPORT, &report, sizeof(report), NULL, 0,
+                frame);
+        }
+        else {
+            memcpy(&frame[TELEMETRY_HEADER_SIZE], &report, sizeof(report));
+            frameSize = Telemetry_finish(&telemetry,
+                TELEMETRY_TYPE_ECHO_REPORT_DELTA, sizeof(report) +
+                DeltaCodec_encode(codes[window % NUM_BUFFERS], NUM_SAMPLES,
+                                  &frame[TELEMETRY_HEADER_SIZE +
+                                         sizeof(report)]),
+                frame);
+        }
+        for (i = 0; i < numBuffers; i++) {
+            if (writer.buffers[i] == frame) {
+                frameWindow[i] = (uint16_t)window;
+            }
+        }
+        TelemetryWriter_submit(&writer, frame, frameSize);
+    }
+
+    /* Drain the link */
+    while (link->frame != NULL) {
+        link->now = linkFinish(link);
+        TelemetryWriter_complete(&writer);
+    }
+
+    result->samplesDropped = writer.dropped[TELEMETRY_WRITER_SAMPLES];
+    result->summariesDropped = writer.dropped[TELEMETRY_WRITER_SUMMARY];
+    result->evicted = writer.evicted;
+    decodeStream(link, result, &last);
+
+    /* Every window is on the host or in a counter: a samples frame that
+     * went out or was evicted, a summary, or a dropped summary. The host
+     * sees the evicted frames as sequence gaps, and the last report
+     * carries the counters up to its own window. */
+    windowsOut = result->samplesOut + result->summariesOut;
+    result->countersOk = result->crcErrors == 0 &&
+        writer.framesSent == windowsOut &&
+        windowsOut + result->evicted + result->summariesDropped ==
+            NUM_WINDOWS &&
+        result->summariesOut + result->summariesDropped ==
+            result->samplesDropped &&
+        result->lostFrames == result->evicted &&
+        last.samplesDropped <= result->samplesDropped + result->evicted &&
+        last.summariesDropped <= result->summariesDropped;
+}
+
+/*
+ *  ======== runSingleBuffer ========
+ *  The old analyzeBuffer: one buffer, UART_write without waiting.
+ */
+static void runSingleBuffer(double periodMs, Link *link, Result *result)
+{
+    static uint8_t uartTxBuffer[FRAME_SIZE];
+    Telemetry_Object telemetry;
+    Telemetry_EchoReport report;
+    Telemetry_EchoReport last;
+    uint32_t window;
+
+    memset(result, 0, sizeof(*result));
+    link->streamSize = 0;
+    link->frame = NULL;
+
+    Telemetry_init(&telemetry);
+    for (window = 0; window < NUM_WINDOWS; window++) {
+        double windowEnd = window * periodMs * 1000;
+        uint16_t frameSize;
+        bool busy;
+
+        busy = link->frame != NULL &&
+            link->start + link->size * BYTE_US > windowEnd;
+        if (link->frame != NULL && !busy) {
+            double latency = link->start + link->size * BYTE_US -
+                             link->window * periodMs * 1000;
+
+            if (latency / 1000 > result->worstLatencyMs) {
+                result->worstLatencyMs = latency / 1000;
+            }
+            linkFinish(link);
+        }
+
+        if (busy) {
+            uint16_t sent = (uint16_t)((windowEnd - link->start) / BYTE_US);
+
+            memcpy(&link->stream[link->streamSize], link->frame, sent);
+            link->streamSize += sent;
+            link->frame += sent;
+            link->size -= sent;
+            link->start += sent * BYTE_US;
+        }
+
+        buildReport(&report, window);
+        memcpy(&uartTxBuffer[TELEMETRY_HEADER_SIZE], &report, sizeof(report));
+        frameSize = Telemetry_finish(&telemetry,
+            TELEMETRY_TYPE_ECHO_REPORT_DELTA, sizeof(report) +
+            DeltaCodec_encode(codes[window % NUM_BUFFERS], NUM_SAMPLES,
+                              &uartTxBuffer[TELEMETRY_HEADER_SIZE +
+                                            sizeof(report)]),
+            uartTxBuffer);
+
+        if (busy) {
+            /* UART_write fails, and the bytes of the frame on the link that
+             * have not gone out yet are now the new frame's */
+            result->samplesDropped++;
+            continue;
+        }
+        link->now = windowEnd;
+        link->window = (uint16_t)window;
+        linkWrite(link, uartTxBuffer, frameSize);
+    }
+    if (link->frame != NULL) {
+        linkFinish(link);
+    }
+
+    decodeStream(link, result, &last);
+    result->countersOk = true;
+}
+
+/*
+ *  ======== printResult ========
+ */
+static void printResult(const char *name, double periodMs,
+                        const Result *result)
+{
+    printf("%-14s %6.0f %8u %9u %8u %8u %8u %8u %8u %9.1f\n", name, periodMs,
+           result->samplesOut, result->summariesOut, result->samplesDropped,
+           result->evicted, result->summariesDropped, result->crcErrors,
+           result->lostFrames, result->worstLatencyMs);
+}
+
+int main(void)
+{
+    EchoSynth_Params params;
+    uint32_t microVolts[NUM_SAMPLES];
+    uint32_t seed = 0x5eed;
+    Link link;
+    Result result;
+    uint16_t numBuffers;
+    uint32_t b;
+    uint32_t i;
+    size_t p;
+    int failed = 0;
+
+    EchoSynth_Params_init(&params);
+    params.biasUv = 100000;
+    for (b = 0; b < NUM_BUFFERS; b++) {
+        params.echoUv = (b & 1) ? 50000 : 0;
+        params.echoStart = EchoSynth_uniform(&seed) * (NUM_SAMPLES - 200);
+        EchoSynth_microVolts(&params, &seed, microVolts, NUM_SAMPLES);
+        for (i = 0; i < NUM_SAMPLES; i++) {
+            codes[b][i] = EchoSynth_microVoltsToCode(microVolts[i]);
+        }
+    }
+
+    link.stream = malloc((size_t)NUM_WINDOWS * FRAME_SIZE);
+    if (link.stream == NULL) {
+        return (1);
+    }
+
+    printf("%u windows, %u baud, %u-sample delta coded frames\n",
+           NUM_WINDOWS, BAUD_RATE, NUM_SAMPLES);
+    printf("%-14s %6s %8s %9s %8s %8s %8s %8s %8s %9s\n", "writer",
+           "ms", "samples", "summaries", "no room", "evicted", "sum drop",
+           "crc err", "lost seq", "worst ms");
+
+    for (p = 0; p < NUM_PERIODS; p++) {
+        runSingleBuffer(periodsMs[p], &link, &result);
+        printResult("single buffer", periodsMs[p], &result);
+
+        for (numBuffers = 2; numBuffers <= TELEMETRY_WRITER_MAX_BUFFERS;
+             numBuffers++) {
+            char name[32];
+
+            runWriter(periodsMs[p], numBuffers, &link, &result);
+            snprintf(name, sizeof(name), "%u buffers", numBuffers);
+            printResult(name, periodsMs[p], &result);
+            if (!result.countersOk) {
+                printf("  counters do not add up\n");
+                failed = 1;
+            }
+        }
+    }
+
+    free(link.stream);
+    printf(failed ? "FAIL\n" : "OK\n");
+
+    return (failed);
+}
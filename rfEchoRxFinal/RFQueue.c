@@ -37,97 +37,105 @@
 *
 ******************************************************************************/
 /* Standard C Libraries */
+#include <stddef.h>
 #include <stdint.h>
-#include <stdlib.h>
 
-/* Application Header files */ 
+/* Application Header files */
 #include "RFQueue.h"
-#include <ti/devices/DeviceFamily.h>
-#include DeviceFamily_constructPath(driverlib/rf_data_entry.h)
-
-/* Receive entry pointer to keep track of read items */
-rfc_dataEntryGeneral_t* readEntry;
 
 //*****************************************************************************
 //
-//! Get the current dataEntry
+//! Get the current dataEntry of a queue
+//!
+//! \param queue is the queue to read
 //!
 //! \return rfc_dataEntry*
 //
 //*****************************************************************************
 rfc_dataEntryGeneral_t*
-RFQueue_getDataEntry()
+RFQueue_getDataEntry(RFQueue_Object *queue)
 {
-  return (readEntry);
+  return (queue->readEntry);
 }
 
 //*****************************************************************************
 //
-//! Move to next dataEntry
+//! Hand the current dataEntry back to the RF core and move to the next one
 //!
-//! \return None
+//! \param queue is the queue to read
+//!
+//! \return the status of the next dataEntry
 //
 //*****************************************************************************
 uint8_t
-RFQueue_nextEntry()
+RFQueue_nextEntry(RFQueue_Object *queue)
 {
   /* Set status to pending */
-  readEntry->status = DATA_ENTRY_PENDING;
+  queue->readEntry->status = DATA_ENTRY_PENDING;
 
   /* Move read entry pointer to next entry */
-  readEntry = (rfc_dataEntryGeneral_t*)readEntry->pNextEntry;
+  queue->readEntry = (rfc_dataEntryGeneral_t*)queue->readEntry->pNextEntry;
 
-  return (readEntry->status);
+  return (queue->readEntry->status);
 }
 
 //*****************************************************************************
 //
 //! Define a queue
 //!
-//! \param dataQueue is a pointer to the queue to use
-//! \param buf is the prealocated byte buffer to use
+//! \param queue is the queue object to set up
+//! \param buf is the prealocated byte buffer to use, aligned to
+//!        RF_QUEUE_ENTRY_ALIGN
 //! \param buf_len is the number of preallocated bytes
 //! \param numEntries are the number of dataEntries to split the buffer into
 //! \param length is the length of data in every dataEntry
 //!
-//! \return uint8_t
+//! \return 0, or 1 if the entries do not fit or buf is not aligned
 //
 //*****************************************************************************
 uint8_t
-RFQueue_defineQueue(dataQueue_t *dataQueue, uint8_t *buf, uint16_t buf_len, uint8_t numEntries, uint16_t length)
+RFQueue_defineQueue(RFQueue_Object *queue, uint8_t *buf, uint16_t buf_len, uint16_t numEntries, uint16_t length)
 {
+  uint32_t entrySize = RF_QUEUE_ENTRY_SIZE((uint32_t)length);
 
-  if (buf_len < (numEntries * (length + RF_QUEUE_DATA_ENTRY_HEADER_SIZE + RF_QUEUE_QUEUE_ALIGN_PADDING(length))))
+  if (numEntries == 0 || (uint32_t)buf_len < numEntries * entrySize)
   {
     /* queue does not fit into buffer */
     return (1);
   }
+  if (((uintptr_t)buf % RF_QUEUE_ENTRY_ALIGN) != 0)
+  {
+    /* the RF core cannot use the entries */
+    return (1);
+  }
 
-  /* Padding needed for 4-byte alignment? */
-  uint8_t pad = 4-((length + RF_QUEUE_DATA_ENTRY_HEADER_SIZE)%4);
-
-  /* Set the Data Entries common configuration */
+  /* Set the Data Entries common configuration; every entry points to the
+   * next one, which starts entrySize bytes later */
   uint8_t *first_entry = buf;
-  int i;
+  uint16_t i;
   for (i = 0; i < numEntries; i++)
   {
-    buf = first_entry + i * (RF_QUEUE_DATA_ENTRY_HEADER_SIZE + length + pad);
+    buf = first_entry + i * entrySize;
     ((rfc_dataEntry_t*)buf)->status        = DATA_ENTRY_PENDING;        // Pending - starting state
     ((rfc_dataEntry_t*)buf)->config.type   = DATA_ENTRY_TYPE_GEN;       // General Data Entry
     ((rfc_dataEntry_t*)buf)->config.lenSz  = 0;                         // No length indicator byte in data
+    ((rfc_dataEntry_t*)buf)->config.irqIntv = 0;
     ((rfc_dataEntry_t*)buf)->length        = length;                    // Total length of data field
 
-    ((rfc_dataEntryGeneral_t*)buf)->pNextEntry = &(((rfc_dataEntryGeneral_t*)buf)->data)+length+pad;
+    ((rfc_dataEntryGeneral_t*)buf)->pNextEntry = buf + entrySize;
   }
   /* Make circular Last.Next -> First */
   ((rfc_dataEntry_t*)buf)->pNextEntry = first_entry;
 
   /* Create Data Entry Queue and configure for circular buffer Data Entries */
-  dataQueue->pCurrEntry = first_entry;
-  dataQueue->pLastEntry = NULL;
+  queue->dataQueue.pCurrEntry = first_entry;
+  queue->dataQueue.pLastEntry = NULL;
 
   /* Set read pointer to first entry */
-  readEntry = (rfc_dataEntryGeneral_t*)first_entry;
+  queue->readEntry = (rfc_dataEntryGeneral_t*)first_entry;
+  queue->firstEntry = first_entry;
+  queue->numEntries = numEntries;
+  queue->entrySize = (uint16_t)entrySize;
 
   return (0);
 }
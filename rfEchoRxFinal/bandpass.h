@@ -0,0 +1,55 @@
+/*
+ *  ======== bandpass.h ========
+ *  40kHz tone detector for bandpass (under)sampling of the ultrasonic
+ *  channel at 32kHz.
+ *
+ *  The burst occupies roughly 38-42kHz, which lies inside the 32-48kHz
+ *  Nyquist zone of a 32kHz ADC, so it folds onto 0-16kHz without overlapping
+ *  itself: the carrier shows up at an 8kHz IF, a quarter of the sampling
+ *  rate. Quadrature demodulation at fs/4 needs no multiplies, the in-phase
+ *  reference is 1, 0, -1, 0 and the quadrature reference 0, 1, 0, -1, and
+ *  the DC bias of the receiver cancels in the differences. Summing I and Q
+ *  over a bin and squaring gives the same tone power as Goertzel_process
+ *  gives at 200kHz, from 6.25x fewer samples.
+ *
+ *  Everything else the receiver passes folds into 0-16kHz as well, so
+ *  this relies on the narrowband transducer; see host/bandpassSim.c.
+ */
+
+#ifndef BANDPASS_H
+#define BANDPASS_H
+
+#include <stdint.h>
+
+#define BANDPASS_SAMPLE_RATE_HZ     (32000)
+#define BANDPASS_TONE_HZ            (40000)
+
+/* Alias of the carrier and samples per alias period */
+#define BANDPASS_IF_HZ      (BANDPASS_TONE_HZ - BANDPASS_SAMPLE_RATE_HZ)
+#define BANDPASS_PERIOD     (BANDPASS_SAMPLE_RATE_HZ / BANDPASS_IF_HZ)
+
+/* Longest supported bin; keeps I^2 and Q^2 inside 32 bits for full-scale
+ * 12-bit input */
+#define BANDPASS_MAX_BIN_SIZE   (64)
+
+/* Tone power is reported as |X|^2 >> BANDPASS_POWER_SHIFT */
+#define BANDPASS_POWER_SHIFT    (4)
+
+/* Power of a 40kHz tone with the given peak amplitude (in ADC codes) over a
+ * bin of binSize samples; for turning amplitudes into thresholds */
+#define BANDPASS_TONE_POWER(amplitude, binSize) \
+    ((uint32_t)((((uint64_t)(amplitude) * (binSize) / 2) * \
+                 ((uint64_t)(amplitude) * (binSize) / 2)) >> BANDPASS_POWER_SHIFT))
+
+/*
+ *  ======== Bandpass_process ========
+ *  Writes the tone power of every whole bin of numSamples ADC codes taken
+ *  at BANDPASS_SAMPLE_RATE_HZ to powers[]. binSize must be a multiple of
+ *  BANDPASS_PERIOD and at most BANDPASS_MAX_BIN_SIZE. Returns the number of
+ *  powers written (at most maxPowers; later bins are dropped).
+ */
+extern uint16_t Bandpass_process(const uint16_t *samples, uint16_t numSamples,
+                                 uint16_t binSize, uint32_t *powers,
+                                 uint16_t maxPowers);
+
+#endif /* BANDPASS_H */
@@ -0,0 +1,72 @@
+/*
+ *  ======== bufferQueue.c ========
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bufferQueue.h"
+
+#if (BUFFER_QUEUE_LENGTH & (BUFFER_QUEUE_LENGTH - 1)) != 0
+#error "BUFFER_QUEUE_LENGTH must be a power of two"
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__TI_COMPILER_VERSION__)
+#define LOAD_ACQUIRE(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+/* Single core: volatile accesses are not reordered against each other */
+#define LOAD_ACQUIRE(p)         (*(p))
+#define STORE_RELEASE(p, v)     (*(p) = (v))
+#endif
+
+/*
+ *  ======== BufferQueue_init ========
+ */
+void BufferQueue_init(BufferQueue_Object *queue)
+{
+    queue->head = 0;
+    queue->tail = 0;
+}
+
+/*
+ *  ======== BufferQueue_put ========
+ */
+bool BufferQueue_put(BufferQueue_Object *queue, const BufferQueue_Entry *entry)
+{
+    uint32_t head = queue->head;
+    volatile BufferQueue_Entry *slot;
+
+    if (head - LOAD_ACQUIRE(&queue->tail) >= BUFFER_QUEUE_LENGTH) {
+        return (false);
+    }
+
+    slot = &queue->entries[head & (BUFFER_QUEUE_LENGTH - 1)];
+    slot->samples = entry->samples;
+    slot->position = entry->position;
+    slot->window = entry->window;
+    STORE_RELEASE(&queue->head, head + 1);
+
+    return (true);
+}
+
+/*
+ *  ======== BufferQueue_get ========
+ */
+bool BufferQueue_get(BufferQueue_Object *queue, BufferQueue_Entry *entry)
+{
+    uint32_t tail = queue->tail;
+    volatile BufferQueue_Entry *slot;
+
+    if (LOAD_ACQUIRE(&queue->head) == tail) {
+        return (false);
+    }
+
+    slot = &queue->entries[tail & (BUFFER_QUEUE_LENGTH - 1)];
+    entry->samples = slot->samples;
+    entry->position = slot->position;
+    entry->window = slot->window;
+    STORE_RELEASE(&queue->tail, tail + 1);
+
+    return (true);
+}
@@ -0,0 +1,56 @@
+/*
+ *  ======== bufferQueue.h ========
+ *  Lock-free single-producer / single-consumer queue of ADC buffer
+ *  handoffs.
+ *
+ *  adcBufCallback (the producer) puts each completed sample buffer in the
+ *  queue and analysisThread (the consumer) takes it out; neither side
+ *  disables interrupts or takes a lock. Only the producer writes head and
+ *  only the consumer writes tail. An entry is filled in before head moves
+ *  past it (release) and read after head has been seen to move (acquire),
+ *  so the consumer never sees a half-written entry.
+ *
+ *  On the single-core Cortex-M3 ordering the volatile accesses is enough;
+ *  gcc/clang builds (host/bufferQueueStress.c runs the producer and the
+ *  consumer on different cores) use acquire/release atomics.
+ */
+
+#ifndef BUFFER_QUEUE_H
+#define BUFFER_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Entries in the queue; a power of two */
+#define BUFFER_QUEUE_LENGTH     (8)
+
+typedef struct BufferQueue_Entry {
+    uint16_t *samples;          /* Completed sample buffer */
+    uint16_t  position;         /* Its position in the listen window */
+    uint16_t  window;           /* Listen window it belongs to */
+} BufferQueue_Entry;
+
+typedef struct BufferQueue_Object {
+    volatile BufferQueue_Entry entries[BUFFER_QUEUE_LENGTH];
+    volatile uint32_t head;     /* Entries put (producer only) */
+    volatile uint32_t tail;     /* Entries taken (consumer only) */
+} BufferQueue_Object;
+
+/* Empties the queue; neither side may be using it */
+extern void BufferQueue_init(BufferQueue_Object *queue);
+
+/*
+ *  ======== BufferQueue_put ========
+ *  Producer side. Returns false (and drops the entry) if the queue is full.
+ */
+extern bool BufferQueue_put(BufferQueue_Object *queue,
+                            const BufferQueue_Entry *entry);
+
+/*
+ *  ======== BufferQueue_get ========
+ *  Consumer side. Returns false if the queue is empty.
+ */
+extern bool BufferQueue_get(BufferQueue_Object *queue,
+                            BufferQueue_Entry *entry);
+
+#endif /* BUFFER_QUEUE_H */
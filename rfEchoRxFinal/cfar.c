@@ -0,0 +1,86 @@
+/*
+ *  ======== cfar.c ========
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cfar.h"
+
+/*
+ *  ======== Cfar_init ========
+ */
+void Cfar_init(Cfar_Object *cfar, uint16_t scaleQ4, uint16_t averageShift,
+               uint32_t minMargin)
+{
+    cfar->floor = 0;
+    cfar->deviation = 0;
+    cfar->threshold = UINT32_MAX;
+    cfar->minMargin = (minMargin < CFAR_MAX_VALUE) ?
+        minMargin : CFAR_MAX_VALUE;
+    cfar->maxDeviation = (scaleQ4 != 0) ? UINT32_MAX / scaleQ4 : UINT32_MAX;
+    cfar->scaleQ4 = scaleQ4;
+    cfar->averageShift = averageShift;
+    cfar->training = (uint16_t)1 << averageShift;
+    cfar->started = false;
+}
+
+/*
+ *  ======== Cfar_update ========
+ */
+bool Cfar_update(Cfar_Object *cfar, uint32_t value)
+{
+    int32_t sample = (int32_t)((value < CFAR_MAX_VALUE) ?
+        value : CFAR_MAX_VALUE) << CFAR_FRAC_BITS;
+    int32_t minMargin = (int32_t)cfar->minMargin << CFAR_FRAC_BITS;
+    bool detected = false;
+    int32_t error;
+    int32_t step;
+    uint32_t deviation;
+    uint32_t margin;
+
+    if (!cfar->started) {
+        cfar->floor = sample;
+        cfar->started = true;
+    }
+
+    if (cfar->training != 0) {
+        cfar->training--;
+    }
+    else {
+        detected = value > cfar->threshold;
+    }
+
+    /* Streaming median and median absolute deviation: step towards the
+     * value by a fraction of the current spread */
+    step = ((cfar->deviation > minMargin) ? cfar->deviation : minMargin) >>
+        cfar->averageShift;
+    error = sample - cfar->floor;
+    if (error > 0) {
+        cfar->floor += step;
+    }
+    else if (error < 0) {
+        cfar->floor -= step;
+        error = -error;
+    }
+    if (error > cfar->deviation) {
+        cfar->deviation += step;
+    }
+    else {
+        cfar->deviation = (cfar->deviation > step) ?
+            cfar->deviation - step : 0;
+    }
+
+    /* Saturating: a spread this large puts the threshold out of reach of
+     * the estimates anyway */
+    deviation = ((uint32_t)cfar->deviation < cfar->maxDeviation) ?
+        (uint32_t)cfar->deviation : cfar->maxDeviation;
+    margin = (deviation * cfar->scaleQ4) >> 4;
+    if (margin < (uint32_t)minMargin) {
+        margin = (uint32_t)minMargin;
+    }
+    /* The floor is at most a step below 0, so the sum is positive */
+    cfar->threshold = ((uint32_t)cfar->floor + margin) >> CFAR_FRAC_BITS;
+
+    return (detected);
+}
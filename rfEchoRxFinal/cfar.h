@@ -0,0 +1,58 @@
+/*
+ *  ======== cfar.h ========
+ *  Constant false alarm rate (CFAR) threshold for the per-bin detector
+ *  output.
+ *
+ *  A running noise floor (median of the bin values) and its median absolute
+ *  deviation are kept across listen windows, so the threshold follows the
+ *  room instead of being tuned for it. Both are tracked with fixed-size
+ *  steps towards each new value (a streaming median), which costs a few
+ *  compares and adds per bin and, unlike a running mean, is not pulled up
+ *  by the echo bins that every listen window contains.
+ */
+
+#ifndef CFAR_H
+#define CFAR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Fractional bits of the floor and deviation estimates */
+#define CFAR_FRAC_BITS      (8)
+/* Largest bin value the estimates take in. In Q8 it stays below 2^30, so
+ * the estimates, their steps and the threshold fit in 32 bits. Larger
+ * values (the tone power of a strong echo) saturate for the estimates only
+ * and are still compared in full with the threshold. */
+#define CFAR_MAX_VALUE      ((1ul << 22) - 1)
+
+typedef struct Cfar_Object {
+    int32_t  floor;         /* Running median of the bin values, Q8 */
+    int32_t  deviation;     /* Running median absolute deviation, Q8 */
+    uint32_t threshold;     /* Current threshold in bin value units */
+    uint32_t minMargin;     /* Smallest allowed threshold - floor */
+    uint32_t maxDeviation;  /* Largest deviation whose margin fits, Q8 */
+    uint16_t scaleQ4;       /* Threshold distance in deviations, Q4 */
+    uint16_t averageShift;  /* Step is 1/2^averageShift of the deviation */
+    uint16_t training;      /* Bins left before detections are reported */
+    bool     started;
+} Cfar_Object;
+
+/*
+ *  ======== Cfar_init ========
+ *  threshold = floor + max(scaleQ4 / 16 * deviation, minMargin). The
+ *  estimates move by max(deviation, minMargin) / 2^averageShift per bin;
+ *  the first 2^averageShift bins only train them. minMargin is at most
+ *  CFAR_MAX_VALUE; the deviation saturates where scaleQ4 times it would
+ *  leave 32 bits.
+ */
+extern void Cfar_init(Cfar_Object *cfar, uint16_t scaleQ4,
+                      uint16_t averageShift, uint32_t minMargin);
+
+/*
+ *  ======== Cfar_update ========
+ *  Tests one bin value against the current threshold, then folds it into
+ *  the noise estimates. Returns true if the bin is above the threshold.
+ */
+extern bool Cfar_update(Cfar_Object *cfar, uint32_t value);
+
+#endif /* CFAR_H */
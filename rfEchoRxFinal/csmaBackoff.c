@@ -0,0 +1,86 @@
+/*
+ *  ======== csmaBackoff.c ========
+ *  Listen-before-talk backoff, see csmaBackoff.h.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "csmaBackoff.h"
+
+/*
+ *  ======== CsmaBackoff_init ========
+ */
+void CsmaBackoff_init(CsmaBackoff_Object *backoff, uint32_t seed,
+                      uint32_t unitUs, uint8_t maxExponent,
+                      uint8_t maxAttempts)
+{
+    backoff->seed = (seed != 0) ? seed : 0x5eed;
+    backoff->unitUs = unitUs;
+    backoff->maxExponent = maxExponent;
+    backoff->maxAttempts = maxAttempts;
+    backoff->attempt = 0;
+    backoff->clear = 0;
+    backoff->deferrals = 0;
+    backoff->dropped = 0;
+    backoff->collisions = 0;
+}
+
+/*
+ *  ======== draw ========
+ *  1 .. 2^exponent backoff units, in microseconds
+ */
+static uint32_t draw(CsmaBackoff_Object *backoff, uint8_t exponent)
+{
+    uint32_t seed = backoff->seed;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    backoff->seed = seed;
+
+    return ((1 + (seed >> 8) % (1u << exponent)) * backoff->unitUs);
+}
+
+/*
+ *  ======== CsmaBackoff_busy ========
+ */
+uint32_t CsmaBackoff_busy(CsmaBackoff_Object *backoff)
+{
+    uint8_t exponent;
+
+    if (backoff->attempt >= backoff->maxAttempts) {
+        backoff->attempt = 0;
+        backoff->dropped++;
+        return (0);
+    }
+    backoff->attempt++;
+    backoff->deferrals++;
+
+    exponent = (backoff->attempt < backoff->maxExponent) ?
+               backoff->attempt : backoff->maxExponent;
+
+    return (draw(backoff, exponent));
+}
+
+/*
+ *  ======== CsmaBackoff_clear ========
+ */
+void CsmaBackoff_clear(CsmaBackoff_Object *backoff)
+{
+    backoff->attempt = 0;
+    backoff->clear++;
+}
+
+/*
+ *  ======== CsmaBackoff_result ========
+ */
+uint32_t CsmaBackoff_result(CsmaBackoff_Object *backoff, bool echoOk)
+{
+    if (echoOk) {
+        return (0);
+    }
+    backoff->collisions++;
+
+    return (draw(backoff, backoff->maxExponent));
+}
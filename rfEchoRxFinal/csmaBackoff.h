@@ -0,0 +1,64 @@
+/*
+ *  ======== csmaBackoff.h ========
+ *  Randomized exponential backoff for listen-before-talk.
+ *
+ *  Before each ranging burst the initiator senses the channel. When it is
+ *  busy, CsmaBackoff_busy draws a wait of 1 .. 2^n units, n being the
+ *  number of busy channels in a row (up to maxExponent); when it is still
+ *  busy after maxAttempts backoffs the cycle is given up. A clear channel
+ *  resets the window. An exchange that went ahead but collided anyway
+ *  (the sense only hears RF) moves the next cycle by 1 .. 2^maxExponent
+ *  units, so that two pairs on the same cycle do not collide again a
+ *  cycle later. The counters run since startup (modulo 2^32).
+ */
+
+#ifndef CSMA_BACKOFF_H
+#define CSMA_BACKOFF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct CsmaBackoff_Object {
+    uint32_t seed;              /* xorshift32 state, never 0 */
+    uint32_t unitUs;
+    uint8_t  maxExponent;
+    uint8_t  maxAttempts;
+    uint8_t  attempt;           /* Busy channels in a row */
+    uint32_t clear;             /* Channel clear, the ranging went ahead */
+    uint32_t deferrals;         /* Channel busy, backed off */
+    uint32_t dropped;           /* Cycles given up after maxAttempts */
+    uint32_t collisions;        /* No valid echo after a clear channel:
+                                 * a collision, or no responder in range */
+} CsmaBackoff_Object;
+
+/*
+ *  ======== CsmaBackoff_init ========
+ *  seed should differ between initiators (e.g. device ID and RAT time).
+ */
+extern void CsmaBackoff_init(CsmaBackoff_Object *backoff, uint32_t seed,
+                             uint32_t unitUs, uint8_t maxExponent,
+                             uint8_t maxAttempts);
+
+/*
+ *  ======== CsmaBackoff_busy ========
+ *  The channel is busy. Returns how long to wait before sensing again in
+ *  microseconds, or 0 to give up the cycle.
+ */
+extern uint32_t CsmaBackoff_busy(CsmaBackoff_Object *backoff);
+
+/*
+ *  ======== CsmaBackoff_clear ========
+ *  The channel is clear and the ranging goes ahead.
+ */
+extern void CsmaBackoff_clear(CsmaBackoff_Object *backoff);
+
+/*
+ *  ======== CsmaBackoff_result ========
+ *  Outcome of a ranging that went ahead: echoOk if the echo came back
+ *  valid. Returns how much later than usual to start the next cycle in
+ *  microseconds, 0 after a valid echo.
+ */
+extern uint32_t CsmaBackoff_result(CsmaBackoff_Object *backoff,
+                                   bool echoOk);
+
+#endif /* CSMA_BACKOFF_H */
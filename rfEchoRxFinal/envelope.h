@@ -0,0 +1,61 @@
+/*
+ *  ======== envelope.h ========
+ *  Rectify-and-envelope echo detector with early exit.
+ *
+ *  Each ADC code has a slowly tracked DC level removed, is rectified and
+ *  smoothed by a first-order fixed-point IIR low-pass. The first sample
+ *  where the envelope rises above the threshold is the crossing; once the
+ *  envelope has stayed up for confirmSamples samples the echo is confirmed
+ *  and the rest of the buffer is skipped. An envelope dip below half the
+ *  threshold ends a run, so the 40kHz ripple does not break one up.
+ *
+ *  Outside a run, blocks of ENVELOPE_BLOCK samples that all stay within the
+ *  threshold of the DC level are only checked (min, max and sum) and skip
+ *  the filter; only the DC level follows them. The envelope is held over
+ *  such a block, so env->peak is the largest envelope outside them.
+ */
+
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Low-pass time constant of 2^3 samples (40us at 200kHz, 1.6 carrier
+ * periods) */
+#define ENVELOPE_SHIFT      (3)
+/* DC tracking time constant of 2^10 samples (~5ms) */
+#define ENVELOPE_DC_SHIFT   (10)
+/* Samples checked at once for a quiet stretch the filter can skip */
+#define ENVELOPE_BLOCK      (32)
+
+typedef struct Envelope_Object {
+    int32_t  dc;              /* DC level, Q8 ADC codes */
+    int32_t  envelope;        /* Envelope, Q4 ADC codes */
+    int32_t  threshold;       /* Q4 */
+    uint32_t crossing;        /* Window index of the first crossing */
+    uint32_t peak;            /* Largest envelope of the window, ADC codes */
+    uint16_t above;           /* Samples in the current run above threshold */
+    uint16_t confirmSamples;
+    bool     started;
+    bool     confirmed;
+} Envelope_Object;
+
+/* threshold is in ADC codes above the DC level */
+extern void Envelope_init(Envelope_Object *env, uint16_t threshold,
+                          uint16_t confirmSamples);
+
+/* Starts a new listen window; the DC level is kept */
+extern void Envelope_reset(Envelope_Object *env);
+
+/*
+ *  ======== Envelope_process ========
+ *  Runs numSamples ADC codes through the envelope. firstIndex is the window
+ *  index of samples[0], used for env->crossing. Returns true once the echo
+ *  is confirmed; the remaining samples, and all later calls until
+ *  Envelope_reset, are skipped.
+ */
+extern bool Envelope_process(Envelope_Object *env, const uint16_t *samples,
+                             uint16_t numSamples, uint32_t firstIndex);
+
+#endif /* ENVELOPE_H */
@@ -0,0 +1,55 @@
+/*
+ *  ======== goertzel.h ========
+ *  Streaming Goertzel (single-bin DFT) detector for the 40kHz carrier.
+ *
+ *  Samples are pushed as each ADC ping-pong half completes; the filter
+ *  state carries over between calls so windows may straddle the two
+ *  halves. One tone power value is produced per window. Energy outside the
+ *  40kHz bin (audio-band noise, the DC bias of the receiver) does not show
+ *  up in the power as long as the window is a whole number of carrier
+ *  periods.
+ */
+
+#ifndef GOERTZEL_H
+#define GOERTZEL_H
+
+#include <stdint.h>
+
+/* 2 * cos(2 * pi * 40kHz / 200kHz) in Q14 */
+#define GOERTZEL_COEFF_Q14      (10126)
+
+/* Longest supported window; keeps the scaled power inside 32 bits for
+ * full-scale 12-bit input */
+#define GOERTZEL_MAX_WINDOW     (200)
+
+/* Tone power is reported as |X|^2 >> GOERTZEL_POWER_SHIFT */
+#define GOERTZEL_POWER_SHIFT    (4)
+
+/* Power of a 40kHz tone with the given peak amplitude (in ADC codes) over a
+ * window of windowLength samples; for turning amplitudes into thresholds */
+#define GOERTZEL_TONE_POWER(amplitude, windowLength) \
+    ((uint32_t)((((uint64_t)(amplitude) * (windowLength) / 2) * \
+                 ((uint64_t)(amplitude) * (windowLength) / 2)) >> GOERTZEL_POWER_SHIFT))
+
+typedef struct Goertzel_Object {
+    int32_t  s1;
+    int32_t  s2;
+    uint16_t windowLength;
+    uint16_t count;             /* Samples in the current window */
+} Goertzel_Object;
+
+/* windowLength should be a multiple of 5 samples (one carrier period) and
+ * at most GOERTZEL_MAX_WINDOW */
+extern void Goertzel_init(Goertzel_Object *object, uint16_t windowLength);
+
+/*
+ *  ======== Goertzel_process ========
+ *  Runs numSamples ADC codes through the filter and writes the power of
+ *  every window completed during the call to powers[]. Returns the number
+ *  of powers written (at most maxPowers; later windows are dropped).
+ */
+extern uint16_t Goertzel_process(Goertzel_Object *object,
+                                 const uint16_t *samples, uint16_t numSamples,
+                                 uint32_t *powers, uint16_t maxPowers);
+
+#endif /* GOERTZEL_H */
@@ -46,9 +46,14 @@
 #include "Board.h"
 
 extern void *mainThread(void *arg0);
+extern void *analysisThread(void *arg0);
 
 /* Stack size in bytes */
 #define THREADSTACKSIZE    1024
+/* Echo analysis of the ADC buffers; above mainThread so it preempts its
+ * busy waits */
+#define ANALYSISSTACKSIZE  1024
+#define ANALYSISPRIORITY   2
 
 /*
  *  ======== main ========
@@ -89,6 +94,21 @@ int main(void)
         while (1);
     }
 
+    priParam.sched_priority = ANALYSISPRIORITY;
+    pthread_attr_setschedparam(&attrs, &priParam);
+
+    retc = pthread_attr_setstacksize(&attrs, ANALYSISSTACKSIZE);
+    if (retc != 0) {
+        /* pthread_attr_setstacksize() failed */
+        while (1);
+    }
+
+    retc = pthread_create(&thread, &attrs, analysisThread, NULL);
+    if (retc != 0) {
+        /* pthread_create() failed */
+        while (1);
+    }
+
     BIOS_start();
 
     return (0);
@@ -0,0 +1,71 @@
+/*
+ *  ======== matchedFilter.h ========
+ *  Matched-filter time-of-flight estimator for the 40kHz ultrasonic burst.
+ *
+ *  The template is the burst produced by PWM_setDuty(pwm2, ...): a 25us
+ *  period carrier held for 1ms. At 200kHz that is 5 samples per period and
+ *  200 samples per burst. The filter correlates the ADC stream against an
+ *  in-phase and a quadrature copy of the template (so the echo phase does
+ *  not matter) using a sliding window, which costs O(1) per sample. The
+ *  correlation peak is refined to a fraction of a sample with a parabolic
+ *  fit through the peak and its two neighbours.
+ */
+
+#ifndef MATCHED_FILTER_H
+#define MATCHED_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MATCHED_FILTER_SAMPLE_RATE_HZ  (200000)
+#define MATCHED_FILTER_TONE_HZ         (40000)
+#define MATCHED_FILTER_BURST_US        (1000)
+
+/* Samples per carrier period and per burst */
+#define MATCHED_FILTER_PERIOD   (MATCHED_FILTER_SAMPLE_RATE_HZ / MATCHED_FILTER_TONE_HZ)
+#define MATCHED_FILTER_LENGTH   (MATCHED_FILTER_SAMPLE_RATE_HZ / 1000 * MATCHED_FILTER_BURST_US / 1000)
+
+/* Fractional bits of MatchedFilter_Result.arrival */
+#define MATCHED_FILTER_FRAC_BITS   (8)
+
+typedef struct MatchedFilter_Object {
+    uint16_t history[MATCHED_FILTER_LENGTH]; /* Samples inside the window */
+    int32_t  iSum;              /* In-phase correlation of the window */
+    int32_t  qSum;              /* Quadrature correlation of the window */
+    uint32_t sampleCount;       /* Samples seen since MatchedFilter_reset */
+    uint16_t historyIndex;
+    uint8_t  phase;             /* Carrier phase of the next sample */
+    bool     afterPending;      /* Waiting for the sample after the peak */
+    uint64_t lastPower;
+    uint64_t peakPower;
+    uint64_t beforePeakPower;
+    uint64_t afterPeakPower;
+    uint32_t peakIndex;         /* Window end (sample index) at the peak */
+} MatchedFilter_Object;
+
+typedef struct MatchedFilter_Result {
+    /* First echo sample relative to the first sample processed, in units of
+     * 1/2^MATCHED_FILTER_FRAC_BITS samples */
+    uint32_t arrival;
+    /* Same in microseconds */
+    uint32_t arrivalUs;
+    /* Squared correlation magnitude at the peak */
+    uint64_t peakPower;
+    /* False until a full burst length of samples has been processed */
+    bool     valid;
+} MatchedFilter_Result;
+
+/* Clears the window; the next sample processed is sample 0 */
+extern void MatchedFilter_reset(MatchedFilter_Object *object);
+
+/* Runs the filter over numSamples 12-bit ADC codes. Can be called once per
+ * ADC buffer; the window carries over between calls. */
+extern void MatchedFilter_process(MatchedFilter_Object *object,
+                                  const uint16_t *samples,
+                                  uint16_t numSamples);
+
+/* Interpolated arrival of the strongest correlation peak so far */
+extern void MatchedFilter_getResult(const MatchedFilter_Object *object,
+                                    MatchedFilter_Result *result);
+
+#endif /* MATCHED_FILTER_H */
@@ -0,0 +1,109 @@
+/*
+ *  ======== radioTrace.c ========
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "radioTrace.h"
+
+#if defined(__TI_COMPILER_VERSION__) || defined(DeviceFamily_CC26X0R2)
+#include <ti/drivers/dpl/HwiP.h>
+
+#define LOCK(key)       ((key) = HwiP_disable())
+#define UNLOCK(key)     HwiP_restore(key)
+#else
+/* Host builds record and drain from one thread */
+#define LOCK(key)       ((void)(key))
+#define UNLOCK(key)     ((void)(key))
+#endif
+
+#define MASK            (RADIO_TRACE_EVENTS - 1)
+
+typedef char RadioTrace_sizeCheck[
+    ((RADIO_TRACE_EVENTS & MASK) == 0) ? 1 : -1];
+
+/*
+ *  ======== RadioTrace_init ========
+ */
+void RadioTrace_init(RadioTrace_Object *trace)
+{
+    memset(trace, 0, sizeof(*trace));
+}
+
+/*
+ *  ======== RadioTrace_startCycle ========
+ */
+void RadioTrace_startCycle(RadioTrace_Object *trace)
+{
+    trace->cycle++;
+}
+
+/*
+ *  ======== RadioTrace_record ========
+ */
+void RadioTrace_record(RadioTrace_Object *trace, uint8_t source,
+                       uint32_t ratTime, int16_t cmdHandle, uint64_t events,
+                       uint16_t commandNo, uint16_t status)
+{
+    Telemetry_RadioEvent *event;
+    uintptr_t key = 0;
+
+    LOCK(key);
+
+    if (trace->head - trace->tail == RADIO_TRACE_EVENTS) {
+        trace->tail++;
+        trace->overwritten++;
+    }
+    event = &trace->events[trace->head & MASK];
+    event->ratTime = ratTime;
+    event->eventsLow = (uint32_t)events;
+    event->eventsHigh = (uint32_t)(events >> 32);
+    event->cycle = trace->cycle;
+    event->cmdHandle = cmdHandle;
+    event->commandNo = commandNo;
+    event->status = status;
+    event->source = source;
+    event->reserved[0] = 0;
+    event->reserved[1] = 0;
+    event->reserved[2] = 0;
+    trace->head++;
+
+    UNLOCK(key);
+}
+
+/*
+ *  ======== RadioTrace_pending ========
+ */
+uint32_t RadioTrace_pending(const RadioTrace_Object *trace)
+{
+    return (trace->head - trace->tail);
+}
+
+/*
+ *  ======== RadioTrace_drain ========
+ *  One event at a time, so interrupts are never off for longer than a
+ *  record takes.
+ */
+uint16_t RadioTrace_drain(RadioTrace_Object *trace, uint8_t *out,
+                          uint16_t maxEvents)
+{
+    uint16_t drained = 0;
+    uintptr_t key = 0;
+
+    while (drained < maxEvents) {
+        LOCK(key);
+        if (trace->head == trace->tail) {
+            UNLOCK(key);
+            break;
+        }
+        memcpy(&out[(uint32_t)drained * sizeof(Telemetry_RadioEvent)],
+               &trace->events[trace->tail & MASK],
+               sizeof(Telemetry_RadioEvent));
+        trace->tail++;
+        UNLOCK(key);
+        drained++;
+    }
+
+    return (drained);
+}
@@ -0,0 +1,72 @@
+/*
+ *  ======== radioTrace.h ========
+ *  Ring of time-stamped radio events.
+ *
+ *  Every RF callback, every end of a radio command and the time stamp of
+ *  every received packet is recorded with the RAT time, the command
+ *  handle, the event mask and the command and its status
+ *  (Telemetry_RadioEvent), so the timing of each ping / echo cycle can be
+ *  looked at after the fact. Recording is a copy of 24 bytes with
+ *  interrupts disabled, so the trace is always on. When the ring is full
+ *  the oldest events are overwritten and counted.
+ *
+ *  The analysis task drains the ring into TELEMETRY_TYPE_RADIO_TRACE
+ *  frames when the UART has nothing else to send;
+ *  host/radioTraceHist.c turns them into latency histograms.
+ *
+ *  Record is called from RF callbacks and tasks, drain from one task. On
+ *  the device the ring is protected by disabling interrupts; host builds
+ *  are single threaded.
+ */
+
+#ifndef RADIO_TRACE_H
+#define RADIO_TRACE_H
+
+#include <stdint.h>
+
+#include "telemetry.h"
+
+/* Events in the ring, a power of 2 */
+#define RADIO_TRACE_EVENTS      (64)
+
+typedef struct RadioTrace_Object {
+    Telemetry_RadioEvent events[RADIO_TRACE_EVENTS];
+    uint32_t head;              /* Events recorded */
+    uint32_t tail;              /* Events drained or overwritten */
+    uint32_t overwritten;       /* Events lost to a full ring */
+    uint16_t cycle;             /* Stamped on every event */
+} RadioTrace_Object;
+
+extern void RadioTrace_init(RadioTrace_Object *trace);
+
+/*
+ *  ======== RadioTrace_startCycle ========
+ *  Events recorded from now on belong to the next ping / echo cycle.
+ */
+extern void RadioTrace_startCycle(RadioTrace_Object *trace);
+
+/*
+ *  ======== RadioTrace_record ========
+ *  Adds an event (TELEMETRY_RADIO_... source) to the ring.
+ */
+extern void RadioTrace_record(RadioTrace_Object *trace, uint8_t source,
+                              uint32_t ratTime, int16_t cmdHandle,
+                              uint64_t events, uint16_t commandNo,
+                              uint16_t status);
+
+/*
+ *  ======== RadioTrace_pending ========
+ *  Events recorded and not drained yet.
+ */
+extern uint32_t RadioTrace_pending(const RadioTrace_Object *trace);
+
+/*
+ *  ======== RadioTrace_drain ========
+ *  Moves up to maxEvents of the oldest events to out (byte aligned, as
+ *  they follow the Telemetry_RadioTrace header in a frame) and returns
+ *  how many.
+ */
+extern uint16_t RadioTrace_drain(RadioTrace_Object *trace, uint8_t *out,
+                                 uint16_t maxEvents);
+
+#endif /* RADIO_TRACE_H */
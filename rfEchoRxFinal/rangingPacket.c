@@ -0,0 +1,62 @@
+/*
+ *  ======== rangingPacket.c ========
+ *  The ranging packet, see rangingPacket.h.
+ */
+
+#include <stdint.h>
+
+#include "rangingPacket.h"
+#include "telemetry.h"
+
+/* Bytes covered by the CRC */
+#define RANGING_PACKET_CRC_OFFSET   (RANGING_PACKET_SIZE - 2)
+
+/*
+ *  ======== RangingPacket_encode ========
+ */
+void RangingPacket_encode(const RangingPacket *packet, uint8_t *data)
+{
+    uint16_t crc;
+
+    data[0] = packet->deviceId;
+    data[1] = RANGING_PACKET_VERSION;
+    data[2] = (uint8_t)packet->sequence;
+    data[3] = (uint8_t)(packet->sequence >> 8);
+    data[4] = (uint8_t)packet->ratTime;
+    data[5] = (uint8_t)(packet->ratTime >> 8);
+    data[6] = (uint8_t)(packet->ratTime >> 16);
+    data[7] = (uint8_t)(packet->ratTime >> 24);
+
+    crc = Telemetry_crc16(0xFFFF, data, RANGING_PACKET_CRC_OFFSET);
+    data[8] = (uint8_t)(crc >> 8);
+    data[9] = (uint8_t)crc;
+}
+
+/*
+ *  ======== RangingPacket_decode ========
+ */
+int8_t RangingPacket_decode(const uint8_t *data, uint16_t length,
+                            RangingPacket *packet)
+{
+    uint16_t crc;
+
+    if (length != RANGING_PACKET_SIZE && length != RANGING_ECHO_SIZE) {
+        return (RANGING_PACKET_E_LENGTH);
+    }
+    /* Before the version, so a corrupted version byte counts as corrupted */
+    crc = Telemetry_crc16(0xFFFF, data, RANGING_PACKET_CRC_OFFSET);
+    if (data[8] != (uint8_t)(crc >> 8) || data[9] != (uint8_t)crc) {
+        return (RANGING_PACKET_E_CRC);
+    }
+    if (data[1] != RANGING_PACKET_VERSION) {
+        return (RANGING_PACKET_E_VERSION);
+    }
+
+    packet->deviceId = data[0];
+    packet->sequence = (uint16_t)(data[2] | (data[3] << 8));
+    packet->ratTime = (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+                      ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    packet->echo = (length == RANGING_ECHO_SIZE);
+
+    return (RANGING_PACKET_OK);
+}
@@ -35,8 +35,11 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 /* For sleep() */
 #include <unistd.h>
+/* POSIX Header files */
+#include <semaphore.h>
 
 /* TI Drivers */
 #include <ti/drivers/rf/RF.h>
@@ -54,45 +57,166 @@
 
 /* Application Header files */
 #include "RFQueue.h"
+#include "bandpass.h"
+#include "bufferQueue.h"
+#include "cfar.h"
+#include "deltaCodec.h"
+#include "echoCapture.h"
+#include "echoConfig.h"
+#include "envelope.h"
+#include "goertzel.h"
+#include "matchedFilter.h"
+#include "radioTrace.h"
+#include "rangingPacket.h"
+#include "telemetry.h"
+#include "telemetryMode.h"
+#include "telemetryWriter.h"
 #include "smartrf_settings/smartrf_settings.h"
 
 /***** Definitions for ADC Sampling *****/
-#define ADCBUFFERSIZE    (500)
-#define UARTBUFFERSIZE   (500)
+/* One buffer of the range-gated listen window (see echoConfig.h) */
+#define ADCBUFFERSIZE    (ECHO_BUFFER_SAMPLES)
+/* One telemetry frame: the window report and the codes of a buffer */
+#ifdef ECHO_TELEMETRY_DELTA
+#define UARTBUFFERSIZE \
+    (TELEMETRY_FRAME_SIZE(TELEMETRY_ECHO_REPORT_SIZE + \
+                          DELTA_CODEC_MAX_SIZE(ADCBUFFERSIZE)))
+#else
+#define UARTBUFFERSIZE \
+    (TELEMETRY_FRAME_SIZE(TELEMETRY_ECHO_REPORT_SIZE + ADCBUFFERSIZE * 2))
+#endif // ECHO_TELEMETRY_DELTA
+/* Every buffer of a listen window, plus the one the ADC may start on before
+ * the window is cancelled, has its own memory, so a buffer handed to
+ * analysisThread is not overwritten while it is being analysed */
+#define SAMPLE_BUFFERS   (ECHO_WINDOW_BUFFERS + 1)
+
+#if ECHO_WINDOW_BUFFERS < 3
+#error "The first four buffers of a window are lined up when it starts"
+#endif
 
-uint16_t sampleBufferOne[ADCBUFFERSIZE];
-uint16_t sampleBufferTwo[ADCBUFFERSIZE];
-uint32_t microVoltBuffer[ADCBUFFERSIZE];
+uint16_t sampleBuffers[SAMPLE_BUFFERS][ADCBUFFERSIZE];
 uint32_t buffersCompletedCounter = 0;
-char uartTxBuffer[UARTBUFFERSIZE];
+/* Windows that ended without a report because their last buffer was lost
+ * (adcBufCallback); counted as dropped frames */
+static volatile uint16_t windowsLost;
+/* Frames of the telemetry writer: one on the UART, one being built or
+ * waiting */
+#define TELEMETRY_FRAMES (2)
+uint8_t uartTxBuffers[TELEMETRY_FRAMES][UARTBUFFERSIZE];
+/* Radio events per trace frame */
+#define RADIO_TRACE_FRAME_EVENTS \
+    ((UARTBUFFERSIZE - TELEMETRY_FRAME_SIZE(TELEMETRY_RADIO_TRACE_SIZE)) / \
+     TELEMETRY_RADIO_EVENT_SIZE)
+
+/***** Definitions for echo detection *****/
+/* Thresholds, detector switches and the range gate are in echoConfig.h */
+#ifdef ECHO_DETECT_TONE
+static Goertzel_Object goertzel;
+#endif // ECHO_DETECT_TONE
+#if defined(ECHO_DETECT_TONE) || defined(ECHO_BANDPASS_SAMPLING)
+static uint32_t tonePower[ECHO_DETECT_MAX_BINS];
+#endif // ECHO_DETECT_TONE || ECHO_BANDPASS_SAMPLING
+#ifdef ECHO_CFAR_MIN_MARGIN_UV
+/* Bin energy detector of the responder, built for the buffer length and with
+ * its own fixed echo level in ADC codes */
+#define ECHO_DETECT_TEMPLATE_NAME       EchoBins
+#define ECHO_DETECT_TEMPLATE_SAMPLE     uint16_t
+#define ECHO_DETECT_TEMPLATE_BIN_SIZE   ECHO_BIN_SIZE
+#define ECHO_DETECT_TEMPLATE_NUM_BINS   (ADCBUFFERSIZE / ECHO_BIN_SIZE)
+#define ECHO_DETECT_TEMPLATE_THRESHOLD \
+    ECHO_UV_TO_CODES(ECHO_RX_ECHO_LEVEL_UV * ECHO_BIN_SIZE)
+#include "echoDetectTemplate.h"
+static EchoBins_Result echoResult;
+#endif // ECHO_CFAR_MIN_MARGIN_UV
+static EchoCapture_Object echoCapture;
+static Cfar_Object cfar;
+#ifdef ECHO_DETECT_ENVELOPE
+static Envelope_Object envelope;
+#endif // ECHO_DETECT_ENVELOPE
+
+/* Completed buffers, from adcBufCallback to analysisThread */
+static BufferQueue_Object filledBuffers;
+static sem_t buffersFilled;
+/* Listen window the ADC runs for; every handoff is stamped with it */
+static volatile uint16_t listenWindow;
+/* Buffers of the listen window completed so far; only adcBufCallback
+ * counts them once the window is started */
+static uint16_t windowBuffersDone;
+/* Packet that started the listen window */
+static uint16_t listenSequence;
+static bool listenRfOk;
+/* The ADC's double-buffered conversion; echoCallback starts it on the
+ * packet, adcBufCallback lines up the buffers after the first four */
+static ADCBuf_Conversion continuousConversion;
+
+/* Sub-sample time of flight of the echo burst */
+static MatchedFilter_Object matchedFilter;
+static MatchedFilter_Result tofResult;
+#ifndef ECHO_BANDPASS_SAMPLING
+/* The end of the last buffer analyzed (a burst long), so the matched filter
+ * sees a whole echo that starts in the buffer before the detection */
+#if ADCBUFFERSIZE < MATCHED_FILTER_LENGTH
+#define FILTER_TAIL_SIZE    (ADCBUFFERSIZE)
+#else
+#define FILTER_TAIL_SIZE    (MATCHED_FILTER_LENGTH)
+#endif
+static uint16_t filterTail[FILTER_TAIL_SIZE];
+/* Position of that buffer in the listen window, UINT16_MAX for none */
+static uint16_t filterTailBuffer;
+#endif // ECHO_BANDPASS_SAMPLING
+
+/* Binary UART frames, one per listen window */
+static Telemetry_Object telemetry;
+static TelemetryWriter_Object telemetryWriter;
+/* Full or summary telemetry, switched by commands from the host */
+static TelemetryMode_Object telemetryMode;
+static uint8_t uartRxByte;
+/* Every RF callback and command end, sent when the UART is idle */
+static RadioTrace_Object radioTrace;
 
 /***** Definitions for RF *****/
 /* Packet RX/TX Configuration */
 /* Max length byte the radio will accept */
-#define PAYLOAD_LENGTH         30
+#define PAYLOAD_LENGTH         RANGING_PACKET_SIZE
 /* Set Transmit (echo) delay to 100ms */
 #define TX_DELAY             (uint32_t)(4000000*0.1f)
-/* NOTE: Only two data entries supported at the moment */
+/* Entries of the receive queue (any number, see RFQueue.h) */
 #define NUM_DATA_ENTRIES       2
 /* The Data Entries data field will contain:
  * 1 Header byte (RF_cmdPropRx.rxConf.bIncludeHdr = 0x1)
- * Max 30 payload bytes
+ * Max PAYLOAD_LENGTH payload bytes
  * 1 status byte (RF_cmdPropRx.rxConf.bAppendStatus = 0x1) */
 #define NUM_APPENDED_BYTES     2
 
-/* Log radio events in the callback */
-//#define LOG_RADIO_EVENTS
+/* Events that end a radio command (as RF_runCmd waits for) */
+#define RF_TERMINATION_EVENTS \
+    (RF_EventLastCmdDone | RF_EventCmdCancelled | RF_EventCmdAborted | \
+     RF_EventCmdStopped | RF_EventCmdError)
 
 /***** Prototypes *****/
 static void echoCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e);
 void adcBufCallback(ADCBuf_Handle handle, ADCBuf_Conversion *conversion,
     void *completedADCBuffer, uint32_t completedChannel);
 void uartCallback(UART_Handle handle, void *buf, size_t count);
+void uartReadCallback(UART_Handle handle, void *buf, size_t count);
+static void uartWriteFrame(void *arg, const uint8_t *frame, uint16_t size);
+void *analysisThread(void *arg0);
+static void analyzeBuffer(const BufferQueue_Entry *entry);
+#ifndef ECHO_BANDPASS_SAMPLING
+static void refineArrival(const uint16_t *samples, uint16_t bufferIndex);
+#endif // ECHO_BANDPASS_SAMPLING
+static void sendCycleSummary(uint8_t flags);
+static void startListenWindow(uint16_t rfSequence, bool rfOk);
+static void startCapture(const uint8_t *packet);
+static void sendRadioTrace(void);
+static void traceRadio(uint8_t source, RF_CmdHandle ch, RF_EventMask e,
+    RF_Op *op);
 
 /***** Variable declarations *****/
 static RF_Object rfObject;
 static RF_Handle rfHandle;
 UART_Handle uart; /* Driver handle shared between the task and the callback function */
+ADCBuf_Handle adcBuf; /* Driver handle shared between the tasks */
 
 /* Pin driver handle */
 static PIN_Handle pinHandle;
@@ -128,19 +252,11 @@ rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
 /* Receive Statistics */
 static rfc_propRxOutput_t rxStatistics;
 
-/* Receive dataQueue for RF Core to fill in data */
-static dataQueue_t dataQueue;
-static rfc_dataEntryGeneral_t* currentDataEntry;
-static uint8_t packetLength;
-static uint8_t* packetDataPointer;
-
-
-static uint8_t txPacket[PAYLOAD_LENGTH];
-
-#ifdef LOG_RADIO_EVENTS
-static volatile RF_EventMask eventLog[32];
-static volatile uint8_t evIndex = 0;
-#endif // LOG_RADIO_EVENTS
+/* Receive queue for RF Core to fill in data, with its read cursor */
+static RFQueue_Object rxQueue;
+/* Entry of the received packet. The echo is sent straight out of it, so it
+ * is held (not handed back to the RF core) until the TX command is done */
+static rfc_dataEntryGeneral_t* volatile echoEntry;
 
 /*
  * Application LED pin configuration table:
@@ -169,9 +285,7 @@ void *mainThread(void *arg0)
 
     /***** Added ADC Sampling Params *****/
     UART_Params uartParams;
-    ADCBuf_Handle adcBuf;
     ADCBuf_Params adcBufParams;
-    ADCBuf_Conversion continuousConversion;
 
     /* Open LED pins */
     pinHandle = PIN_open(&pinState, pinTable);
@@ -190,6 +304,11 @@ void *mainThread(void *arg0)
     uartParams.writeDataMode = UART_DATA_BINARY;
     uartParams.writeMode = UART_MODE_CALLBACK;
     uartParams.writeCallback = uartCallback;
+    uartParams.readDataMode = UART_DATA_BINARY;
+    uartParams.readMode = UART_MODE_CALLBACK;
+    uartParams.readCallback = uartReadCallback;
+    uartParams.readReturnMode = UART_RETURN_FULL;
+    uartParams.readEcho = UART_ECHO_OFF;
     uartParams.baudRate = 115200;
     uart = UART_open(Board_UART0, &uartParams);
 
@@ -203,15 +322,38 @@ void *mainThread(void *arg0)
 //        adcBufParams.recurrenceMode = ADCBuf_RECURRENCE_MODE_ONE_SHOT;
 //        adcBufParams.returnMode = ADCBuf_RETURN_MODE_BLOCKING;
 
-    adcBufParams.samplingFrequency = 200000; // 200kHz
+    adcBufParams.samplingFrequency = ECHO_SAMPLE_RATE_HZ;
     adcBuf = ADCBuf_open(Board_ADCBUF0, &adcBufParams);
 
     /* Configure the conversion struct */
     continuousConversion.arg = NULL;
     continuousConversion.adcChannel = Board_ADCBUF0CHANNEL0;
-    continuousConversion.sampleBuffer = sampleBufferOne;
-    continuousConversion.sampleBufferTwo = sampleBufferTwo;
+    continuousConversion.sampleBuffer = sampleBuffers[0];
+    continuousConversion.sampleBufferTwo = sampleBuffers[1];
     continuousConversion.samplesRequestedCount = ADCBUFFERSIZE;
+
+    Telemetry_init(&telemetry);
+    RadioTrace_init(&radioTrace);
+    TelemetryWriter_init(&telemetryWriter, uartTxBuffers[0], TELEMETRY_FRAMES,
+        UARTBUFFERSIZE, uartWriteFrame, NULL);
+#ifdef ECHO_TELEMETRY_SUMMARY
+    TelemetryMode_init(&telemetryMode, TELEMETRY_MODE_SUMMARY,
+        ECHO_TELEMETRY_RAW_EVERY);
+#else
+    TelemetryMode_init(&telemetryMode, TELEMETRY_MODE_FULL,
+        ECHO_TELEMETRY_RAW_EVERY);
+#endif // ECHO_TELEMETRY_SUMMARY
+    /* Mode commands from the host come in a byte at a time */
+    UART_read(uart, &uartRxByte, 1);
+
+    /* The noise floor is tracked across listen windows */
+    Cfar_init(&cfar, ECHO_CFAR_SCALE_Q4, ECHO_CFAR_AVERAGE_SHIFT,
+        ECHO_CFAR_MIN_MARGIN);
+#ifdef ECHO_DETECT_ENVELOPE
+    Envelope_init(&envelope,
+        ECHO_UV_TO_CODES(ECHO_ENVELOPE_THRESHOLD_UV),
+        ECHO_ENVELOPE_CONFIRM);
+#endif // ECHO_DETECT_ENVELOPE
     /******************************/
 
     /******************** Setup for PWM code to create 40kHz square-wave burst for 1ms ********************/
@@ -243,7 +385,7 @@ void *mainThread(void *arg0)
         PWM_start(pwm2);
         /******************************/
 
-    if( RFQueue_defineQueue(&dataQueue,
+    if( RFQueue_defineQueue(&rxQueue,
                             rxDataEntryBuffer,
                             sizeof(rxDataEntryBuffer),
                             NUM_DATA_ENTRIES,
@@ -257,13 +399,20 @@ void *mainThread(void *arg0)
 
     /* Modify CMD_PROP_TX and CMD_PROP_RX commands for application needs */
     /* Set the Data Entity queue for received data */
-    RF_cmdPropRx.pQueue = &dataQueue;
+    RF_cmdPropRx.pQueue = &rxQueue.dataQueue;
     /* Discard ignored packets from Rx queue */
     RF_cmdPropRx.rxConf.bAutoFlushIgnored = 1;
     /* Discard packets with CRC error from Rx queue */
     RF_cmdPropRx.rxConf.bAutoFlushCrcErr = 1;
-    /* Implement packet length filtering to avoid PROP_ERROR_RXBUF */
+    /* Implement packet length filtering to avoid PROP_ERROR_RXBUF; it also
+     * drops the echoes of other responders, one byte longer */
     RF_cmdPropRx.maxPktLen = PAYLOAD_LENGTH;
+    /* Only accept packets of the paired initiator: the first payload byte
+     * is its ID (rangingPacket.h). Others are ignored, flushed and do not
+     * run the chained echo; the RX goes on (bRepeatNok) */
+    RF_cmdPropRx.pktConf.bChkAddress = 1;
+    RF_cmdPropRx.address0 = ECHO_PAIR_ID;
+    RF_cmdPropRx.address1 = ECHO_PAIR_ID;
     /* End RX operation when a packet is received correctly and move on to the
      * next command in the chain */
     RF_cmdPropRx.pktConf.bRepeatOk = 0;
@@ -277,8 +426,20 @@ void *mainThread(void *arg0)
 
     RF_cmdPropRx.pOutput = (uint8_t *)&rxStatistics;
 
-    RF_cmdPropTx.pktLen = PAYLOAD_LENGTH;
-    RF_cmdPropTx.pPkt = txPacket;
+    /* RF_cmdPropTx.pPkt / pktLen point at each received packet in turn */
+#ifdef ECHO_RF_CHAINED_ECHO
+    /* The RF core sends the echo itself, ECHO_RF_TURNAROUND_US after the end
+     * of a correctly received packet. The TX is set up before the packet
+     * arrives, so the echo has the fixed length of an echo: the packet and
+     * the status byte the RF core appended after it (rangingPacket.h). */
+    RF_cmdPropRx.pNextOp = (rfc_radioOp_t *)&RF_cmdPropTx;
+    RF_cmdPropRx.condition.rule = COND_STOP_ON_FALSE;
+    RF_cmdPropTx.startTrigger.triggerType = TRIG_REL_PREVEND;
+    RF_cmdPropTx.startTrigger.pastTrig = 1;
+    RF_cmdPropTx.startTime = (uint32_t)ECHO_RF_TURNAROUND_US * 4;
+    RF_cmdPropTx.pktLen = RANGING_ECHO_SIZE;
+    RF_cmdPropTx.condition.rule = COND_NEVER;
+#endif // ECHO_RF_CHAINED_ECHO
 
 
     /* Request access to the radio */
@@ -293,6 +454,16 @@ void *mainThread(void *arg0)
 
     while(1)
     {
+        RadioTrace_startCycle(&radioTrace);
+
+#ifdef ECHO_RF_CHAINED_ECHO
+        /* Every entry has been handed back, so the packet lands in the one at
+         * the read cursor; the chained TX echoes it from there (after its
+         * length byte) */
+        RF_cmdPropTx.pPkt =
+            (uint8_t *)(&(RFQueue_getDataEntry(&rxQueue)->data) + 1);
+#endif // ECHO_RF_CHAINED_ECHO
+
         /* Wait for a packet
          * - When the first of the two chained commands (RX) completes, the
          * RF_EventCmdDone and RF_EventRxEntryDone events are raised on a
@@ -303,10 +474,15 @@ void *mainThread(void *arg0)
          * error condition
          * - If the RF core successfully echos the received packet the RF core
          * should raise the RF_EventLastCmdDone event
+         * Posted and pended instead of RF_runCmd so the trace has the handle.
          */
+        RF_CmdHandle rxHandle =
+                RF_postCmd(rfHandle, (RF_Op*)&RF_cmdPropRx, RF_PriorityNormal,
+                           echoCallback, (RF_EventRxEntryDone | RF_EventLastCmdDone));
         RF_EventMask terminationReason =
-                RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropRx, RF_PriorityNormal,
-                          echoCallback, (RF_EventRxEntryDone | RF_EventLastCmdDone));
+                RF_pendCmd(rfHandle, rxHandle, RF_TERMINATION_EVENTS);
+        traceRadio(TELEMETRY_RADIO_COMMAND, rxHandle, terminationReason,
+                   (RF_Op*)&RF_cmdPropRx);
 
 
         /********** Mapping RF signals to GPIO for debugging **********/
@@ -348,17 +524,8 @@ void *mainThread(void *arg0)
 
                 /******************  Added ADC code *******************/
 
-                if (adcBuf == NULL){
-                    /* ADCBuf failed to open. */
-                    while(1);
-                }
-
-                /* Start converting. */
-                if (ADCBuf_convert(adcBuf, &continuousConversion, 1) !=
-                    ADCBuf_STATUS_SUCCESS) {
-                    /* Did not start conversion process correctly. */
-                    while(1);
-                }
+                /* The listen window was started by echoCallback when the
+                 * packet came in (startCapture) */
 
 //                ADCBuf_convertCancel(adcBuf);
 
@@ -424,15 +591,39 @@ void *mainThread(void *arg0)
                 while(1);
         }
 
+        /* Nothing received, nothing to echo: listen again */
+        if (echoEntry == NULL) {
+            continue;
+        }
+
+#ifdef ECHO_RF_CHAINED_ECHO
+        /* The echo went out with the RX command; the entry is free again */
+        echoEntry = NULL;
+        RFQueue_nextEntry(&rxQueue);
+#else
         /******* Added code for execution of unchained Tx command *******/
 
+       /* Echo the payload from where the RF core received it: the entry
+        * holds the length byte, then the payload (zero copy) and the
+        * appended status byte, which makes it an echo (rangingPacket.h) */
+       RF_cmdPropTx.pktLen = RANGING_ECHO_SIZE;
+       RF_cmdPropTx.pPkt = (uint8_t *)(&(echoEntry->data) + 1);
+
        RF_cmdPropTx.startTrigger.triggerType = TRIG_ABSTIME;   // CHANGED TO TRIG_ABS so Tx can trigger at absolute time defined by Tx.startTime
 
        RF_cmdPropTx.startTime = rxStatistics.timeStamp + TX_DELAY; // ADDED rxStatistics.timeStamp
 
-       terminationReason = RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropTx, RF_PriorityNormal,
-                                                  NULL, RF_EventLastCmdDone);
+       RF_CmdHandle txHandle = RF_postCmd(rfHandle, (RF_Op*)&RF_cmdPropTx,
+                                          RF_PriorityNormal, NULL, RF_EventLastCmdDone);
+       terminationReason = RF_pendCmd(rfHandle, txHandle, RF_TERMINATION_EVENTS);
+       traceRadio(TELEMETRY_RADIO_COMMAND, txHandle, terminationReason,
+                  (RF_Op*)&RF_cmdPropTx);
+
+       /* The RF core is done with the packet; the entry is free again */
+       echoEntry = NULL;
+       RFQueue_nextEntry(&rxQueue);
        /******************************************/
+#endif // ECHO_RF_CHAINED_ECHO
 
 
        /* Set PWM duty to 50% then back to 0 to generate a burst (right after echo signal)*/
@@ -446,33 +637,42 @@ void *mainThread(void *arg0)
 
 static void echoCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e)
 {
-#ifdef LOG_RADIO_EVENTS
-    eventLog[evIndex++ & 0x1F] = e;
-#endif// LOG_RADIO_EVENTS
+#ifdef ECHO_RF_CHAINED_ECHO
+    /* The chain ends with the echo if the packet was received */
+    traceRadio(TELEMETRY_RADIO_CALLBACK, ch, e,
+               ((e & RF_EventLastCmdDone) &&
+                ((volatile RF_Op*)&RF_cmdPropRx)->status == PROP_DONE_OK) ?
+               (RF_Op*)&RF_cmdPropTx : (RF_Op*)&RF_cmdPropRx);
+#else
+    traceRadio(TELEMETRY_RADIO_CALLBACK, ch, e, (RF_Op*)&RF_cmdPropRx);
+#endif // ECHO_RF_CHAINED_ECHO
 
     if (e & RF_EventRxEntryDone)
     {
+        /* The RF core's time stamp of the packet: where the turnaround to
+         * the echo starts */
+        RadioTrace_record(&radioTrace, TELEMETRY_RADIO_PACKET,
+            rxStatistics.timeStamp, ch, e, RF_cmdPropRx.commandNo,
+            ((volatile RF_Op*)&RF_cmdPropRx)->status);
+
         /* Successful RX */
         /* Toggle LED2, clear LED1 to indicate RX */
         PIN_setOutputValue(pinHandle, Board_PIN_LED1, 0);
         PIN_setOutputValue(pinHandle, Board_PIN_LED2,
                            !PIN_getOutputValue(Board_PIN_LED2));
 
-        /* Get current unhandled data entry */
-        currentDataEntry = RFQueue_getDataEntry();
-
-        /* Handle the packet data, located at &currentDataEntry->data:
+        /* Hold the current unhandled data entry for the echo; mainThread
+         * sends it and hands it back once the TX command is done. The
+         * packet data is located at &echoEntry->data:
          * - Length is the first byte with the current configuration
          * - Data starts from the second byte */
-        packetLength      = *(uint8_t *)(&(currentDataEntry->data));
-        packetDataPointer = (uint8_t *)(&(currentDataEntry->data) + 1);
-
-        /* Copy the payload + status byte to the rxPacket variable, and then
-         * over to the txPacket
-         */
-        memcpy(txPacket, packetDataPointer, packetLength);
-
-        RFQueue_nextEntry();
+        if (echoEntry == NULL) {
+            echoEntry = RFQueue_getDataEntry(&rxQueue);
+            /* The window starts at the packet, not when the RX command (and
+             * a chained echo after it) returns to mainThread: the ADC runs
+             * while the RF core turns around and sends the echo */
+            startCapture((const uint8_t *)(&(echoEntry->data)));
+        }
     }
     else if (e & RF_EventLastCmdDone)
     {
@@ -493,136 +693,460 @@ static void echoCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e)
 
 /*
  * This function is called whenever an ADC buffer is full.
- * The content of the buffer is then converted into human-readable format and
- * sent to the PC via UART.
+ * The ADC keeps filling the next buffer of the window meanwhile. The
+ * callback only hands the completed buffer to analysisThread, lines up
+ * fresh memory for the next reload of its half and stops the ADC at the
+ * window deadline; detection and the UART report run in analysisThread.
  */
 void adcBufCallback(ADCBuf_Handle handle, ADCBuf_Conversion *conversion,
     void *completedADCBuffer, uint32_t completedChannel) {
 
-    uint_fast16_t i;
-    uint_fast16_t uartTxBufferOffset = 0;
+    BufferQueue_Entry entry;
+    /* The buffers complete in order, alternating between the two halves.
+     * completedADCBuffer is not used: the driver takes it from the same
+     * conversion struct fields that are rewritten below. */
+    uint16_t position = windowBuffersDone;
 
-    /* Adjust raw ADC values and convert them to microvolts */
-    ADCBuf_adjustRawValues(handle, completedADCBuffer, ADCBUFFERSIZE,
-        completedChannel);
-    ADCBuf_convertAdjustedToMicroVolts(handle, completedChannel,
-        completedADCBuffer, microVoltBuffer, ADCBUFFERSIZE);
+    if (position >= ECHO_WINDOW_BUFFERS) {
+        /* Past the deadline, the window is already over */
+        return;
+    }
+    windowBuffersDone = position + 1;
+
+    /* This half has already been reloaded with buffer position + 2; the
+     * reload after that gets buffer position + 4 if it is still part of the
+     * window */
+    if (position + 4 <= ECHO_WINDOW_BUFFERS) {
+        if (position & 1) {
+            conversion->sampleBufferTwo = sampleBuffers[position + 4];
+        }
+        else {
+            conversion->sampleBuffer = sampleBuffers[position + 4];
+        }
+    }
 
-    //**************************  added code for calculations **************************//
+    /* Window deadline */
+    if (position + 1 >= ECHO_WINDOW_BUFFERS) {
+        ADCBuf_convertCancel(handle);
+    }
 
-    uint16_t a = 0;
-    uint16_t b = 0;
-    uint64_t sum = 0;
-    uint32_t bin_average = 0;
+    entry.samples = sampleBuffers[position];
+    entry.position = position;
+    entry.window = listenWindow;
+    if (BufferQueue_put(&filledBuffers, &entry)) {
+        sem_post(&buffersFilled);
+    }
+    else if (position + 1 >= ECHO_WINDOW_BUFFERS) {
+        /* analysisThread only ends a window on its last buffer; without
+         * it the window ends here, unreported, so the next one can start */
+        echoCapture.active = false;
+        windowsLost++;
+    }
+}
 
-    uint16_t run_number = 0;
-    uint32_t run_max = 0;
+/*
+ * Runs the echo detection on every buffer adcBufCallback hands over and
+ * reports the listen window over UART. It is created in main_tirtos.c at a
+ * higher priority than mainThread, so it preempts mainThread's busy waits
+ * as soon as a buffer is ready, and it runs first: the queue is ready
+ * before mainThread opens the radio, so before a packet can start the ADC.
+ */
+void *analysisThread(void *arg0)
+{
+    BufferQueue_Entry entry;
 
-    uint16_t bin_number = 0; // 0-39 bins, does not get reset
-    uint16_t saved_bin_number = 0; // keep track of which bin the peak average occurs in
-    uint32_t total_max = 0;
+    BufferQueue_init(&filledBuffers);
+    sem_init(&buffersFilled, 0, 0);
 
-    // loop through 2.5 ms data four times to get 10 ms data
-    while (run_number < 4) { // this loop does not actually do anything, it's just repeating the same data (from the microcontroller
-        // output buffer) 4 times. Ignore this loop. We are actually only sampling for 2.5 ms
-        // loop through the 10 bins
-        while (a < (ADCBUFFERSIZE/50)) {
-            // loop through the 50 microvoltbuffer values associated with each bin (b<50, 50<b<100, 100<b<150, etc.)
-            while (b < (ADCBUFFERSIZE/10 + 50*a)) {
-                sum = sum + abs(microVoltBuffer[b]);
-                b++; // increment sample number (will do 50 samples for each bin)
-
-                // printf("%u\n", (unsigned int) microVoltBuffer[b]);
-            }
-            bin_average = sum / 500; // calculate average of the bin
-            // to find max average value among the 10 bins
-            if (bin_average > run_max) {
-                run_max = bin_average;
-                saved_bin_number = bin_number;
+    while (1) {
+        sem_wait(&buffersFilled);
+
+        while (BufferQueue_get(&filledBuffers, &entry)) {
+            /* Skip buffers that arrive after their window is over */
+            if (entry.window == listenWindow && echoCapture.active) {
+                analyzeBuffer(&entry);
+                /* The radio events go out behind the window's report */
+                if (!echoCapture.active) {
+                    sendRadioTrace();
+                }
             }
-            a++; // increment bin number that gets reset after each run
-            bin_number++;
+        }
+    }
+}
 
+/*
+ * Detection on one buffer of the listen window. Once the window is over
+ * (echo found or ECHO_WINDOW_BUFFERS done) the result is sent to the PC via
+ * UART as a binary telemetry frame.
+ */
+static void analyzeBuffer(const BufferQueue_Entry *entry)
+{
+    uint16_t *samples = entry->samples;
+    uint_fast16_t frameSize;
+    uint8_t *frame;
+    uint8_t send;
+    Telemetry_EchoReport report;
+
+    /* Position of this buffer in the listen window; bins keep counting
+     * across buffers */
+    uint16_t bufferIndex = EchoCapture_nextBuffer(&echoCapture,
+                                                  entry->position);
+    uint16_t binOffset = bufferIndex * (ADCBUFFERSIZE / ECHO_BIN_SIZE);
+
+    /* Adjust raw ADC values; detection runs on the codes and the telemetry
+     * frame carries them */
+    ADCBuf_adjustRawValues(adcBuf, samples, ADCBUFFERSIZE,
+        Board_ADCBUF0CHANNEL0);
+
+    //**************************  added code for calculations **************************//
+
+#ifdef ECHO_DETECT_ENVELOPE
+    /* Rectified envelope; the rest of the buffer is skipped once the echo is
+     * confirmed */
+    bool detected = Envelope_process(&envelope, samples,
+        ADCBUFFERSIZE, (uint32_t)binOffset * ECHO_BIN_SIZE) &&
+        envelope.crossing < (ECHO_MAX_BIN + 1) * ECHO_BIN_SIZE;
+    uint32_t total_max = envelope.peak;
+    uint16_t saved_bin_number = envelope.crossing / ECHO_BIN_SIZE;
+#else
+#if defined(ECHO_DETECT_TONE)
+    /* 40kHz tone power of every bin, straight from the adjusted ADC codes */
+    uint16_t numBins = Goertzel_process(&goertzel, samples,
+        ADCBUFFERSIZE, tonePower, ECHO_DETECT_MAX_BINS);
+    const uint32_t *binValue = tonePower;
+    uint32_t overBins = ~(uint32_t)0;
+#elif defined(ECHO_BANDPASS_SAMPLING)
+    /* 40kHz tone power of every bin from its 8kHz alias */
+    uint16_t numBins = Bandpass_process(samples, ADCBUFFERSIZE,
+        ECHO_BIN_SIZE, tonePower, ECHO_DETECT_MAX_BINS);
+    const uint32_t *binValue = tonePower;
+    uint32_t overBins = ~(uint32_t)0;
+#else
+    /* Bin energies, bins above the echo level, peak bin and buffer average
+     * in a single pass */
+    EchoBins_process(samples, &echoResult);
+
+    uint16_t numBins = echoResult.numBins;
+    const uint32_t *binValue = echoResult.binEnergy;
+    uint32_t overBins = echoResult.overBins;
+#endif // ECHO_DETECT_TONE
+    uint32_t total_max = 0;
+    uint16_t saved_bin_number = 0; // keep track of which bin the peak occurs in
+    bool detected = false;
+    uint_fast16_t i;
+
+    // an echo is a bin above the CFAR threshold and the echo level
+    // that occurs within 6ms of transmission
+    for (i = 0; i < numBins; i++) {
+        if (Cfar_update(&cfar, binValue[i]) && ((overBins >> i) & 1) &&
+            binOffset + i <= ECHO_MAX_BIN) {
+            detected = true;
         }
-        // reset values for the new run
-        a = 0; // bin #
-        b = 0; // sample #
-        sum = 0;
-        bin_average = 0;
-        if (run_max > total_max) {
-            total_max = run_max;
+        if (binValue[i] > total_max) {
+            total_max = binValue[i];
+            saved_bin_number = binOffset + i;
         }
-        run_number++; // increment run # (does 4 runs for 10ms of data)
-//       printf("%d %d\n", total_max, saved_bin_number);
+    }
+#endif // ECHO_DETECT_ENVELOPE
+
+    if (!EchoCapture_bufferDone(&echoCapture, total_max, saved_bin_number,
+            detected)) {
+#ifndef ECHO_BANDPASS_SAMPLING
+        memcpy(filterTail, &samples[ADCBUFFERSIZE - FILTER_TAIL_SIZE],
+            sizeof(filterTail));
+        filterTailBuffer = bufferIndex;
+#endif // ECHO_BANDPASS_SAMPLING
+        /* Keep listening, the next buffer is already filling */
+        return;
     }
 
+    /* Early exit on a detection (adcBufCallback stops the ADC at the
+     * deadline) */
+    ADCBuf_convertCancel(adcBuf);
 
-     // make pin go high if peak average value over the 10 ms sampling interval is greater than a threshold value
-     // AND it occurs within 6ms of transmission
-    if (total_max > 15000 && saved_bin_number <= 23) {
-//         digital pin 15 goes high
+    // make pin go high if an echo was found in the listen window
+    if (echoCapture.detected) {
+//         digital pin 15 (buzzer) goes high
              PIN_setOutputValue(pinHandle, Board_DIO15, 1);
     }
     else {
-       // digital pin 15 goes low
+       // digital pin 15 (buzzer) goes low
              PIN_setOutputValue(pinHandle, Board_DIO15, 0);
     }
 
-//    ADC_close(handle);
-
-    ADCBuf_convertCancel(handle);
-
-    /* Start with a header message. */
-    uartTxBufferOffset = snprintf(uartTxBuffer,
-        UARTBUFFERSIZE - uartTxBufferOffset, "\r\nBuffer %u finished.",
-        (unsigned int)buffersCompletedCounter++);
-
-//    /* Write raw adjusted values to the UART buffer if there is room. */
-//    uartTxBufferOffset += snprintf(uartTxBuffer + uartTxBufferOffset,
-//        UARTBUFFERSIZE - uartTxBufferOffset, "\r\nRaw Buffer: ");
-//
-//    for (i = 0; i < ADCBUFFERSIZE && uartTxBufferOffset < UARTBUFFERSIZE; i++) {
-//        uartTxBufferOffset += snprintf(uartTxBuffer + uartTxBufferOffset,
-//            UARTBUFFERSIZE - uartTxBufferOffset, "%u,",
-//        *(((uint16_t *)completedADCBuffer) + i));
-//    }
-
-    /* Write microvolt values to the UART buffer if there is room. */
-    if (uartTxBufferOffset < UARTBUFFERSIZE) {
-        uartTxBufferOffset += snprintf(uartTxBuffer + uartTxBufferOffset,
-            UARTBUFFERSIZE - uartTxBufferOffset, "\r\nMicrovolts: ");
-
-        for (i = 0; i < ADCBUFFERSIZE && uartTxBufferOffset < UARTBUFFERSIZE; i++) {
-            uartTxBufferOffset += snprintf(uartTxBuffer + uartTxBufferOffset,
-                UARTBUFFERSIZE - uartTxBufferOffset, "%u,",
-                (unsigned int)microVoltBuffer[i]);
-        }
+#ifdef ECHO_BANDPASS_SAMPLING
+    /* No matched filter at 32kHz; the echo time is the start of the peak
+     * bin */
+    tofResult.valid = echoCapture.detected;
+    tofResult.arrivalUs = (uint32_t)echoCapture.peakBin * ECHO_BIN_US;
+#else
+    /* The matched filter only refines a detection */
+    if (echoCapture.detected) {
+        refineArrival(samples, bufferIndex);
+    }
+    else {
+        tofResult.valid = false;
+    }
+#endif // ECHO_BANDPASS_SAMPLING
 
-//        for (i = 0; i < ADCBUFFERSIZE/50 && uartTxBufferOffset < UARTBUFFERSIZE/50; i++) {
-//                    uartTxBufferOffset += snprintf(uartTxBuffer + uartTxBufferOffset,
-//                        UARTBUFFERSIZE/50 - uartTxBufferOffset, " Max is %u,",
-//                        (unsigned int) max);
-//        }
+    buffersCompletedCounter += echoCapture.buffersDone;
+
+    /* In summary mode every window gets a short summary and only some get
+     * the report with codes as well (see telemetryMode.h) */
+    send = TelemetryMode_cycle(&telemetryMode, echoCapture.detected,
+        echoCapture.overruns != 0 || !listenRfOk);
+    if (send & TELEMETRY_MODE_SEND_SUMMARY) {
+        sendCycleSummary((send & TELEMETRY_MODE_SEND_REPORT) ?
+            TELEMETRY_FLAG_CODES : 0);
+    }
+    if (!(send & TELEMETRY_MODE_SEND_REPORT)) {
+        return;
+    }
+
+    /* One binary frame per window: the outcome and the codes of the last
+     * buffer (see telemetry.h). If the UART is still busy with earlier
+     * frames the codes are left out; the report alone may take the place
+     * of a frame with codes that has not gone out yet. After a summary the
+     * report is only worth sending with its codes. */
+    frame = TelemetryWriter_acquire(&telemetryWriter,
+        TELEMETRY_WRITER_SAMPLES);
+    report.numSamples = ADCBUFFERSIZE;
+    if (frame == NULL && !(send & TELEMETRY_MODE_SEND_SUMMARY)) {
+        frame = TelemetryWriter_acquire(&telemetryWriter,
+            TELEMETRY_WRITER_SUMMARY);
+        report.numSamples = 0;
+    }
+    if (frame == NULL) {
+        /* Counted in the drop counters of the next frame */
+        return;
     }
 
-    /*
-     * Ensure we don't write outside the buffer.
-     * Append a newline after the data.
-     */
-    if (uartTxBufferOffset < UARTBUFFERSIZE) {
-        uartTxBuffer[uartTxBufferOffset++] = '\n';
+    report.buffersCompleted = buffersCompletedCounter;
+    report.peakValue = echoCapture.peakValue;
+    report.arrivalUs = tofResult.arrivalUs;
+    report.peakBin = echoCapture.peakBin;
+    report.buffersDone = echoCapture.buffersDone;
+    report.overruns = echoCapture.overruns;
+    report.binSize = ECHO_BIN_SIZE;
+    report.flags = (echoCapture.detected ? TELEMETRY_FLAG_DETECTED : 0) |
+        (tofResult.valid ? TELEMETRY_FLAG_TOF_VALID : 0);
+    report.reserved = 0;
+    report.samplesDropped = (uint16_t)(telemetryWriter.evicted +
+        telemetryWriter.dropped[TELEMETRY_WRITER_SAMPLES]);
+    report.summariesDropped = (uint16_t)(windowsLost +
+        telemetryWriter.dropped[TELEMETRY_WRITER_SUMMARY]);
+
+    if (report.numSamples == 0) {
+        frameSize = Telemetry_encode(&telemetry, TELEMETRY_TYPE_ECHO_REPORT,
+            &report, sizeof(report), NULL, 0, frame);
     }
     else {
-        uartTxBuffer[UARTBUFFERSIZE-1] = '\n';
+#ifdef ECHO_TELEMETRY_DELTA
+        /* The codes are compressed straight into the frame, after the
+         * report */
+        memcpy(&frame[TELEMETRY_HEADER_SIZE], &report, sizeof(report));
+        frameSize = Telemetry_finish(&telemetry,
+            TELEMETRY_TYPE_ECHO_REPORT_DELTA, sizeof(report) +
+            DeltaCodec_encode(samples, ADCBUFFERSIZE,
+                &frame[TELEMETRY_HEADER_SIZE + sizeof(report)]),
+            frame);
+#else
+        frameSize = Telemetry_encode(&telemetry, TELEMETRY_TYPE_ECHO_REPORT,
+            &report, sizeof(report), samples,
+            ADCBUFFERSIZE * sizeof(uint16_t), frame);
+#endif // ECHO_TELEMETRY_DELTA
+    }
+
+    /* Goes out via UART once the frames before it are sent */
+    TelemetryWriter_submit(&telemetryWriter, frame, frameSize);
+}
+
+#ifndef ECHO_BANDPASS_SAMPLING
+/*
+ * Sub-sample echo time of the buffer with the detection. The matched filter
+ * (some 11k cycles a buffer) runs on it and on the end of the buffer before
+ * it, if that one was analyzed, instead of on every buffer of the window.
+ * The arrival counts from the start of the window.
+ */
+static void refineArrival(const uint16_t *samples, uint16_t bufferIndex)
+{
+    uint32_t origin = (uint32_t)bufferIndex * ADCBUFFERSIZE;
+
+    MatchedFilter_reset(&matchedFilter);
+    if (filterTailBuffer + 1 == bufferIndex) {
+        MatchedFilter_process(&matchedFilter, filterTail, FILTER_TAIL_SIZE);
+        origin -= FILTER_TAIL_SIZE;
+    }
+    MatchedFilter_process(&matchedFilter, samples, ADCBUFFERSIZE);
+    MatchedFilter_getResult(&matchedFilter, &tofResult);
+
+    tofResult.arrival += origin << MATCHED_FILTER_FRAC_BITS;
+    tofResult.arrivalUs += origin * (1000000 / ECHO_SAMPLE_RATE_HZ);
+}
+#endif // ECHO_BANDPASS_SAMPLING
+
+/*
+ * Sends the summary of the listen window that just ended (summary mode).
+ */
+static void sendCycleSummary(uint8_t flags)
+{
+    Telemetry_CycleSummary summary;
+    uint8_t *frame = TelemetryWriter_acquire(&telemetryWriter,
+        TELEMETRY_WRITER_SUMMARY);
+
+    if (frame == NULL) {
+        /* Counted in framesDropped of the next summary */
+        return;
+    }
+
+    summary.buffersCompleted = buffersCompletedCounter;
+    summary.peakValue = echoCapture.peakValue;
+    summary.arrivalUs = tofResult.arrivalUs;
+    summary.peakBin = echoCapture.peakBin;
+    summary.rfSequence = listenSequence;
+    summary.rxOk = rxStatistics.nRxOk;
+    summary.rxNok = rxStatistics.nRxNok;
+    summary.rxIgnored = rxStatistics.nRxIgnored;
+    summary.rxStopped = rxStatistics.nRxStopped;
+    summary.rxBufFull = rxStatistics.nRxBufFull;
+    summary.lastRssi = rxStatistics.lastRssi;
+    summary.flags = flags |
+        (echoCapture.detected ? TELEMETRY_FLAG_DETECTED : 0) |
+        (tofResult.valid ? TELEMETRY_FLAG_TOF_VALID : 0) |
+        (listenRfOk ? TELEMETRY_FLAG_RF_OK : 0);
+    summary.overruns = (uint8_t)echoCapture.overruns;
+    summary.framesDropped = (uint16_t)(windowsLost +
+        telemetryWriter.evicted +
+        telemetryWriter.dropped[TELEMETRY_WRITER_SUMMARY] +
+        telemetryWriter.dropped[TELEMETRY_WRITER_SAMPLES]);
+
+    TelemetryWriter_submit(&telemetryWriter, frame,
+        Telemetry_encode(&telemetry, TELEMETRY_TYPE_CYCLE_SUMMARY, &summary,
+            sizeof(summary), NULL, 0, frame));
+}
+
+/*
+ * Sends the radio events recorded so far if the UART has nothing else to
+ * send; otherwise they wait in the ring for the next window.
+ */
+static void sendRadioTrace(void)
+{
+    Telemetry_RadioTrace header;
+    uint8_t *frame;
+
+    if (RadioTrace_pending(&radioTrace) == 0) {
+        return;
+    }
+    frame = TelemetryWriter_acquireIdle(&telemetryWriter);
+    if (frame == NULL) {
+        return;
     }
 
-    /* Display the data via UART */
-    UART_write(uart, uartTxBuffer, uartTxBufferOffset);
+    header.overwritten = radioTrace.overwritten;
+    header.numEvents = RadioTrace_drain(&radioTrace,
+        &frame[TELEMETRY_HEADER_SIZE + TELEMETRY_RADIO_TRACE_SIZE],
+        RADIO_TRACE_FRAME_EVENTS);
+    header.reserved = 0;
+    memcpy(&frame[TELEMETRY_HEADER_SIZE], &header, sizeof(header));
+
+    TelemetryWriter_submit(&telemetryWriter, frame,
+        Telemetry_finish(&telemetry, TELEMETRY_TYPE_RADIO_TRACE,
+            TELEMETRY_RADIO_TRACE_SIZE +
+            header.numEvents * TELEMETRY_RADIO_EVENT_SIZE, frame));
 }
 
 /*
- * Callback function to use the UART in callback mode. It does nothing.
+ * Records a radio event of the command op with the current RAT time.
+ */
+static void traceRadio(uint8_t source, RF_CmdHandle ch, RF_EventMask e,
+    RF_Op *op)
+{
+    RadioTrace_record(&radioTrace, source, RF_getCurrentTime(), ch, e,
+        op->commandNo, ((volatile RF_Op*)op)->status);
+}
+
+/*
+ * Resets the per-window detector state before the ADC is started and notes
+ * the packet that started the window.
+ */
+static void startListenWindow(uint16_t rfSequence, bool rfOk)
+{
+    listenWindow++;
+    windowBuffersDone = 0;
+    listenSequence = rfSequence;
+    listenRfOk = rfOk;
+    EchoCapture_start(&echoCapture, ECHO_WINDOW_BUFFERS);
+#ifndef ECHO_BANDPASS_SAMPLING
+    filterTailBuffer = UINT16_MAX;
+#endif // ECHO_BANDPASS_SAMPLING
+#ifdef ECHO_DETECT_TONE
+    Goertzel_init(&goertzel, ECHO_DETECT_BIN_SIZE);
+#endif // ECHO_DETECT_TONE
+#ifdef ECHO_DETECT_ENVELOPE
+    Envelope_reset(&envelope);
+#endif // ECHO_DETECT_ENVELOPE
+}
+
+/*
+ * Starts a listen window on the packet just received (its length byte,
+ * then the packet), unless the previous window is still running. The ADC
+ * then free-runs over the window's buffers until it ends. Called from
+ * echoCallback; ADCBuf_convert may be called from a Swi in callback mode.
+ */
+static void startCapture(const uint8_t *packet)
+{
+    RangingPacket ranging;
+    bool rfOk;
+
+    if (adcBuf == NULL){
+        /* ADCBuf failed to open. */
+        while(1);
+    }
+    if (echoCapture.active) {
+        return;
+    }
+
+    /* The packet is echoed as is; a corrupted one only marks the window */
+    rfOk = RangingPacket_decode(&packet[1], packet[0], &ranging) ==
+           RANGING_PACKET_OK && !ranging.echo;
+    startListenWindow(rfOk ? ranging.sequence : 0, rfOk);
+    continuousConversion.sampleBuffer = sampleBuffers[0];
+    continuousConversion.sampleBufferTwo = sampleBuffers[1];
+    if (ADCBuf_convert(adcBuf, &continuousConversion, 1) !=
+        ADCBuf_STATUS_SUCCESS) {
+        /* Did not start conversion process correctly. */
+        while(1);
+    }
+    /* The driver reloads a completed half from the conversion struct, so
+     * the third and fourth buffers come from here; the first reload is a
+     * whole buffer away */
+    continuousConversion.sampleBuffer = sampleBuffers[2];
+    continuousConversion.sampleBufferTwo = sampleBuffers[3];
+}
+
+/*
+ * Callback function to use the UART in callback mode. The frame is out; its
+ * buffer is free again and the next waiting frame is started.
  */
 void uartCallback(UART_Handle handle, void *buf, size_t count) {
-   return;
+   TelemetryWriter_complete(&telemetryWriter);
+}
+
+/*
+ * Starts a telemetry frame on the UART for the telemetry writer.
+ */
+static void uartWriteFrame(void *arg, const uint8_t *frame, uint16_t size)
+{
+    UART_write(uart, frame, size);
+}
+
+/*
+ * Callback of the UART reads: one byte of a command from the host, then
+ * the read of the next one.
+ */
+void uartReadCallback(UART_Handle handle, void *buf, size_t count) {
+   if (count == 1) {
+       TelemetryMode_receive(&telemetryMode, uartRxByte);
+   }
+   UART_read(handle, &uartRxByte, 1);
 }
@@ -206,6 +206,42 @@ rfc_CMD_PROP_RX_t RF_cmdPropRx =
     .pOutput = 0, // INSERT APPLICABLE POINTER: (uint8_t*)&xxx
 };
 
+// CMD_PROP_CS
+// Proprietary Mode Carrier Sense Command
+rfc_CMD_PROP_CS_t RF_cmdPropCs =
+{
+    .commandNo = 0x3805,
+    .status = 0x0000,
+    .pNextOp = 0, // INSERT APPLICABLE POINTER: (uint8_t*)&xxx
+    .startTime = 0x00000000,
+    .startTrigger.triggerType = 0x0,
+    .startTrigger.bEnaCmd = 0x0,
+    .startTrigger.triggerNo = 0x0,
+    .startTrigger.pastTrig = 0x0,
+    .condition.rule = 0x1,
+    .condition.nSkip = 0x0,
+    .csFsConf.bFsOffIdle = 0x0,
+    .csFsConf.bFsOffBusy = 0x0,
+    .__dummy0 = 0x00,
+    .csConf.bEnaRssi = 0x1,
+    .csConf.bEnaCorr = 0x0,
+    .csConf.operation = 0x0,
+    .csConf.busyOp = 0x1,
+    .csConf.idleOp = 0x0,
+    .csConf.timeoutRes = 0x0,
+    .rssiThr = 0xA6, // SET APPLICATION THRESHOLD (-90 dBm)
+    .numRssiIdle = 0x1,
+    .numRssiBusy = 0x1,
+    .corrPeriod = 0x0000,
+    .corrConfig.numCorrInv = 0x0,
+    .corrConfig.numCorrBusy = 0x0,
+    .csEndTrigger.triggerType = 0x4,
+    .csEndTrigger.bEnaCmd = 0x0,
+    .csEndTrigger.triggerNo = 0x0,
+    .csEndTrigger.pastTrig = 0x0,
+    .csEndTime = 0x00000000, // SET APPLICATION SENSE TIME
+};
+
 // CMD_TX_TEST
 // Proprietary Mode Transmit Test Command
 rfc_CMD_TX_TEST_t RF_cmdTxTest =
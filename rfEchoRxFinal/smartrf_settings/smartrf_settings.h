@@ -23,6 +23,7 @@ extern rfc_CMD_PROP_RADIO_SETUP_t RF_cmdPropRadioSetup;
 extern rfc_CMD_FS_t RF_cmdFs;
 extern rfc_CMD_PROP_TX_t RF_cmdPropTx;
 extern rfc_CMD_PROP_RX_t RF_cmdPropRx;
+extern rfc_CMD_PROP_CS_t RF_cmdPropCs;
 extern rfc_CMD_TX_TEST_t RF_cmdTxTest;
 
 // RF Core API Overrides
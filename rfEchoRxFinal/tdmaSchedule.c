@@ -0,0 +1,156 @@
+/*
+ *  ======== tdmaSchedule.c ========
+ *  Slotted schedule for several initiators, see tdmaSchedule.h.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tdmaSchedule.h"
+#include "telemetry.h"
+
+/* Bytes covered by the CRC */
+#define TDMA_BEACON_CRC_OFFSET  (TDMA_BEACON_SIZE - 2)
+
+#define TDMA_BEACON_SLOT_TICKS  (TDMA_BEACON_SLOT_US * TDMA_RAT_TICKS_PER_US)
+
+/*
+ *  ======== setSchedule ========
+ */
+static void setSchedule(TdmaSchedule_Object *tdma, uint16_t numSlots,
+                        uint32_t slotUs)
+{
+    tdma->numSlots = numSlots;
+    tdma->slotTicks = slotUs * TDMA_RAT_TICKS_PER_US;
+    tdma->frameTicks = TDMA_BEACON_SLOT_TICKS +
+                       (uint32_t)numSlots * tdma->slotTicks;
+}
+
+/*
+ *  ======== TdmaSchedule_init ========
+ */
+void TdmaSchedule_init(TdmaSchedule_Object *tdma, uint8_t deviceId,
+                       uint16_t numSlots, uint32_t slotUs)
+{
+    setSchedule(tdma, numSlots, slotUs);
+    tdma->frameStart = 0;
+    tdma->frame = 0;
+    tdma->deviceId = deviceId;
+    tdma->coordinatorId = TDMA_COORDINATOR_ID;
+    tdma->missedBeacons = 0;
+    tdma->synced = false;
+}
+
+/*
+ *  ======== TdmaSchedule_startFrame ========
+ */
+void TdmaSchedule_startFrame(TdmaSchedule_Object *tdma, uint32_t now)
+{
+    uint32_t lead = TDMA_START_LEAD_US * TDMA_RAT_TICKS_PER_US;
+
+    if (!tdma->synced) {
+        tdma->frameStart = now + lead;
+        tdma->synced = true;
+    }
+    else {
+        do {
+            tdma->frameStart += tdma->frameTicks;
+            tdma->frame++;
+        } while ((int32_t)(tdma->frameStart - now) < (int32_t)lead);
+    }
+    tdma->coordinatorId = tdma->deviceId;
+}
+
+/*
+ *  ======== TdmaSchedule_encodeBeacon ========
+ */
+void TdmaSchedule_encodeBeacon(const TdmaSchedule_Object *tdma, uint8_t *data)
+{
+    uint32_t slotUs = tdma->slotTicks / TDMA_RAT_TICKS_PER_US;
+    uint16_t crc;
+
+    data[0] = TDMA_BEACON_VERSION;
+    data[1] = tdma->deviceId;
+    data[2] = (uint8_t)tdma->frame;
+    data[3] = (uint8_t)(tdma->frame >> 8);
+    data[4] = (uint8_t)tdma->numSlots;
+    data[5] = (uint8_t)(tdma->numSlots >> 8);
+    data[6] = (uint8_t)slotUs;
+    data[7] = (uint8_t)(slotUs >> 8);
+    data[8] = (uint8_t)(slotUs >> 16);
+    data[9] = (uint8_t)(slotUs >> 24);
+
+    crc = Telemetry_crc16(0xFFFF, data, TDMA_BEACON_CRC_OFFSET);
+    data[10] = (uint8_t)(crc >> 8);
+    data[11] = (uint8_t)crc;
+}
+
+/*
+ *  ======== TdmaSchedule_receiveBeacon ========
+ */
+int8_t TdmaSchedule_receiveBeacon(TdmaSchedule_Object *tdma,
+                                  const uint8_t *data, uint16_t length,
+                                  uint32_t rxTime)
+{
+    uint16_t numSlots;
+    uint32_t slotUs;
+    uint16_t crc;
+
+    if (length != TDMA_BEACON_SIZE) {
+        return (TDMA_BEACON_E_LENGTH);
+    }
+    crc = Telemetry_crc16(0xFFFF, data, TDMA_BEACON_CRC_OFFSET);
+    if (data[10] != (uint8_t)(crc >> 8) || data[11] != (uint8_t)crc) {
+        return (TDMA_BEACON_E_CRC);
+    }
+    if (data[0] != TDMA_BEACON_VERSION) {
+        return (TDMA_BEACON_E_VERSION);
+    }
+    numSlots = (uint16_t)(data[4] | (data[5] << 8));
+    slotUs = (uint32_t)data[6] | ((uint32_t)data[7] << 8) |
+             ((uint32_t)data[8] << 16) | ((uint32_t)data[9] << 24);
+    if (numSlots == 0 || slotUs == 0) {
+        return (TDMA_BEACON_E_SCHEDULE);
+    }
+
+    setSchedule(tdma, numSlots, slotUs);
+    tdma->coordinatorId = data[1];
+    tdma->frame = (uint16_t)(data[2] | (data[3] << 8));
+    tdma->frameStart = rxTime - TDMA_BEACON_SYNC_US * TDMA_RAT_TICKS_PER_US;
+    tdma->missedBeacons = 0;
+    tdma->synced = true;
+
+    return (TDMA_BEACON_OK);
+}
+
+/*
+ *  ======== TdmaSchedule_missBeacon ========
+ */
+void TdmaSchedule_missBeacon(TdmaSchedule_Object *tdma)
+{
+    if (!tdma->synced) {
+        return;
+    }
+    tdma->frameStart += tdma->frameTicks;
+    tdma->frame++;
+    if (++tdma->missedBeacons > TDMA_MAX_MISSED_BEACONS) {
+        tdma->synced = false;
+    }
+}
+
+/*
+ *  ======== TdmaSchedule_slotStart ========
+ */
+uint32_t TdmaSchedule_slotStart(const TdmaSchedule_Object *tdma)
+{
+    return (tdma->frameStart + TDMA_BEACON_SLOT_TICKS +
+            (uint32_t)(tdma->deviceId % tdma->numSlots) * tdma->slotTicks);
+}
+
+/*
+ *  ======== TdmaSchedule_nextBeacon ========
+ */
+uint32_t TdmaSchedule_nextBeacon(const TdmaSchedule_Object *tdma)
+{
+    return (tdma->frameStart + tdma->frameTicks);
+}
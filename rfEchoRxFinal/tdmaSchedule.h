@@ -0,0 +1,132 @@
+/*
+ *  ======== tdmaSchedule.h ========
+ *  Slotted schedule for several initiators in one space.
+ *
+ *  Time is split into frames. A frame starts with a beacon from the
+ *  coordinator (the initiator with ID TDMA_COORDINATOR_ID), followed by
+ *  numSlots ranging slots; the initiator with ID deviceId ranges only in
+ *  slot deviceId % numSlots:
+ *
+ *    | beacon | slot 0 | slot 1 | ... | slot numSlots - 1 | beacon | ...
+ *
+ *  so the RF packets and ultrasound bursts of different pairs do not
+ *  overlap. The other initiators take the frame start from the RAT time
+ *  stamp of the beacon and the schedule (slot count and length) from its
+ *  contents; when they miss a beacon they keep going on their own clock for
+ *  up to TDMA_MAX_MISSED_BEACONS frames, then stop ranging until they
+ *  receive one again.
+ *
+ *  Every beacon is
+ *
+ *    offset  size  field
+ *    0       1     format version (TDMA_BEACON_VERSION)
+ *    1       1     coordinator ID
+ *    2       2     frame number, +1 per frame (little endian)
+ *    4       2     slots per frame (little endian)
+ *    6       4     slot length in microseconds (little endian)
+ *    10      2     CRC-16/CCITT-FALSE of bytes 0 .. 9 (big endian, as in
+ *                  rangingPacket.h)
+ *
+ *  It is longer than a ranging packet, so responders, which only accept
+ *  packets up to RANGING_PACKET_SIZE bytes, never echo it.
+ *
+ *  All times are RAT ticks (4MHz) and wrap around at 32 bits.
+ */
+
+#ifndef TDMA_SCHEDULE_H
+#define TDMA_SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TDMA_RAT_TICKS_PER_US       (4)
+
+#define TDMA_BEACON_VERSION         (1)
+#define TDMA_BEACON_SIZE            (12)
+#define TDMA_COORDINATOR_ID         (0)
+
+/* Beacon at the start of every frame: its air time (736us at 250 kbps)
+ * plus time for the others to handle it before slot 0 */
+#define TDMA_BEACON_SLOT_US         (2000)
+/* From the start of the beacon TX to the RX time stamp: preamble and sync
+ * word (8 bytes at 250 kbps) */
+#define TDMA_BEACON_SYNC_US         (256)
+/* The others listen from this long before the expected beacon to this long
+ * after; covers TDMA_MAX_MISSED_BEACONS frames of 4s at 40ppm each */
+#define TDMA_BEACON_WINDOW_US       (1000)
+#define TDMA_MAX_MISSED_BEACONS     (3)
+/* The coordinator schedules a beacon at least this far ahead */
+#define TDMA_START_LEAD_US          (1000)
+
+/* TdmaSchedule_receiveBeacon results */
+#define TDMA_BEACON_OK              (0)
+#define TDMA_BEACON_E_LENGTH        (-1)    /* Not TDMA_BEACON_SIZE bytes */
+#define TDMA_BEACON_E_CRC           (-2)    /* Corrupted */
+#define TDMA_BEACON_E_VERSION       (-3)    /* Another format */
+#define TDMA_BEACON_E_SCHEDULE      (-4)    /* No slots */
+
+typedef struct TdmaSchedule_Object {
+    uint32_t frameStart;        /* RAT time the frame's beacon starts */
+    uint32_t slotTicks;
+    uint32_t frameTicks;
+    uint16_t numSlots;
+    uint16_t frame;             /* Number of the current frame */
+    uint8_t  deviceId;
+    uint8_t  coordinatorId;     /* From the last beacon */
+    uint8_t  missedBeacons;     /* In a row */
+    bool     synced;            /* frameStart is valid */
+} TdmaSchedule_Object;
+
+/*
+ *  ======== TdmaSchedule_init ========
+ *  Not synced; the coordinator's schedule is numSlots slots of slotUs.
+ */
+extern void TdmaSchedule_init(TdmaSchedule_Object *tdma, uint8_t deviceId,
+                              uint16_t numSlots, uint32_t slotUs);
+
+/*
+ *  ======== TdmaSchedule_startFrame ========
+ *  Coordinator: moves to the next frame that starts at least
+ *  TDMA_START_LEAD_US after now (skipping frames it was too late for), or
+ *  starts the first one.
+ */
+extern void TdmaSchedule_startFrame(TdmaSchedule_Object *tdma, uint32_t now);
+
+/*
+ *  ======== TdmaSchedule_encodeBeacon ========
+ *  Coordinator: writes the TDMA_BEACON_SIZE bytes of the current frame's
+ *  beacon to data.
+ */
+extern void TdmaSchedule_encodeBeacon(const TdmaSchedule_Object *tdma,
+                                      uint8_t *data);
+
+/*
+ *  ======== TdmaSchedule_receiveBeacon ========
+ *  Others: a beacon of length bytes was received with RX time stamp
+ *  rxTime. Returns TDMA_BEACON_OK and syncs to it, or the first check it
+ *  failed (TDMA_BEACON_E_...) without changing the schedule.
+ */
+extern int8_t TdmaSchedule_receiveBeacon(TdmaSchedule_Object *tdma,
+                                         const uint8_t *data, uint16_t length,
+                                         uint32_t rxTime);
+
+/*
+ *  ======== TdmaSchedule_missBeacon ========
+ *  Others: no beacon where the next one was expected. Moves on by one
+ *  frame on the local clock, or loses sync after TDMA_MAX_MISSED_BEACONS.
+ */
+extern void TdmaSchedule_missBeacon(TdmaSchedule_Object *tdma);
+
+/*
+ *  ======== TdmaSchedule_slotStart ========
+ *  Start of this device's slot in the current frame.
+ */
+extern uint32_t TdmaSchedule_slotStart(const TdmaSchedule_Object *tdma);
+
+/*
+ *  ======== TdmaSchedule_nextBeacon ========
+ *  Start of the next frame.
+ */
+extern uint32_t TdmaSchedule_nextBeacon(const TdmaSchedule_Object *tdma);
+
+#endif /* TDMA_SCHEDULE_H */
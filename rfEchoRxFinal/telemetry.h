@@ -0,0 +1,195 @@
+/*
+ *  ======== telemetry.h ========
+ *  Binary UART telemetry frames.
+ *
+ *  Every frame is
+ *
+ *    offset  size  field
+ *    0       2     sync word 0xA5 0x5A
+ *    2       2     payload length N (little endian)
+ *    4       2     sequence number, +1 per frame (little endian)
+ *    6       1     frame type (TELEMETRY_TYPE_...)
+ *    7       N     payload
+ *    7+N     2     CRC-16/CCITT-FALSE of bytes 2 .. 6+N (little endian)
+ *
+ *  so a receiver can find frames in a byte stream, drop corrupted ones and
+ *  count lost ones. Payloads are little-endian structs laid out without
+ *  padding (the CC2640R2 is little endian, so they are copied as is).
+ *  host/telemetryDecode.c is the matching decoder. Commands from the host
+ *  (TELEMETRY_TYPE_SET_MODE, see telemetryMode.h) use the same framing.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+#define TELEMETRY_SYNC0             (0xA5)
+#define TELEMETRY_SYNC1             (0x5A)
+#define TELEMETRY_HEADER_SIZE       (7)
+#define TELEMETRY_CRC_SIZE          (2)
+#define TELEMETRY_FRAME_SIZE(payloadSize) \
+    (TELEMETRY_HEADER_SIZE + (payloadSize) + TELEMETRY_CRC_SIZE)
+/* Largest payload a decoder has to accept */
+#define TELEMETRY_MAX_PAYLOAD       (2048)
+
+/* Frame types */
+#define TELEMETRY_TYPE_ECHO_REPORT          (1)
+/* Echo report with the codes compressed by deltaCodec.h */
+#define TELEMETRY_TYPE_ECHO_REPORT_DELTA    (2)
+/* Fixed-size record of a listen window (summary mode) */
+#define TELEMETRY_TYPE_CYCLE_SUMMARY        (3)
+/* Events of the radio trace (radioTrace.h) */
+#define TELEMETRY_TYPE_RADIO_TRACE          (4)
+/* Host to device: Telemetry_SetMode */
+#define TELEMETRY_TYPE_SET_MODE             (0x80)
+
+/* Telemetry_EchoReport.flags */
+#define TELEMETRY_FLAG_DETECTED     (0x01)  /* Echo found in the window */
+#define TELEMETRY_FLAG_TOF_VALID    (0x02)  /* arrivalUs is valid */
+#define TELEMETRY_FLAG_RF_OK        (0x04)  /* Window's packet received */
+#define TELEMETRY_FLAG_CODES        (0x08)  /* Summary: a report with codes
+                                             * of the window follows */
+
+/*
+ *  Payload of a TELEMETRY_TYPE_ECHO_REPORT frame, sent once per listen
+ *  window: the outcome of the window, followed by numSamples adjusted ADC
+ *  codes (uint16_t) of its last buffer. Codes convert to microvolts with
+ *  the fixed 4.3V full scale. A TELEMETRY_TYPE_ECHO_REPORT_DELTA frame has
+ *  the same report, followed by the codes compressed with DeltaCodec_encode.
+ */
+typedef struct Telemetry_EchoReport {
+    uint32_t buffersCompleted;  /* Buffers since startup */
+    uint32_t peakValue;         /* Largest detector output of the window */
+    uint32_t arrivalUs;         /* Echo time from the window start */
+    uint16_t peakBin;           /* Window-relative bin of peakValue */
+    uint16_t buffersDone;       /* Buffers of this window */
+    uint16_t overruns;          /* Buffers of this window that were lost */
+    uint16_t binSize;           /* Samples per bin */
+    uint16_t numSamples;        /* Codes that follow the report */
+    uint8_t  flags;             /* TELEMETRY_FLAG_... */
+    uint8_t  reserved;
+    /* Reports since startup that went out without their codes, and that
+     * did not go out at all (the link fell behind; modulo 2^16) */
+    uint16_t samplesDropped;
+    uint16_t summariesDropped;
+} Telemetry_EchoReport;
+
+#define TELEMETRY_ECHO_REPORT_SIZE  (28)
+
+/*
+ *  Payload of a TELEMETRY_TYPE_CYCLE_SUMMARY frame, sent once per listen
+ *  window in summary mode instead of the echo report: the outcome of the
+ *  window and the state of the radio link, without any codes.
+ */
+typedef struct Telemetry_CycleSummary {
+    uint32_t buffersCompleted;  /* Buffers since startup */
+    uint32_t peakValue;         /* Largest detector output of the window */
+    uint32_t arrivalUs;         /* Echo time from the window start */
+    uint16_t peakBin;           /* Window-relative bin of peakValue */
+    uint16_t rfSequence;        /* Sequence number of the window's packet */
+    /* rfc_propRxOutput_t of the RX command */
+    uint16_t rxOk;
+    uint16_t rxNok;
+    uint8_t  rxIgnored;
+    uint8_t  rxStopped;
+    uint8_t  rxBufFull;
+    int8_t   lastRssi;          /* dBm */
+    uint8_t  flags;             /* TELEMETRY_FLAG_... */
+    uint8_t  overruns;          /* Buffers of this window that were lost */
+    /* Frames since startup that did not go out (modulo 2^16) */
+    uint16_t framesDropped;
+} Telemetry_CycleSummary;
+
+#define TELEMETRY_CYCLE_SUMMARY_SIZE    (28)
+
+/* Telemetry_RadioEvent.source */
+#define TELEMETRY_RADIO_CALLBACK    (0)     /* RF driver callback */
+#define TELEMETRY_RADIO_COMMAND     (1)     /* RF_pendCmd returned */
+#define TELEMETRY_RADIO_PACKET      (2)     /* ratTime is the RF core's time
+                                             * stamp of a received packet */
+
+/*
+ *  One radio event: an RF callback, or the end of a radio command as the
+ *  task saw it. commandNo / status are those of the command the event
+ *  belongs to (rfc_radioOp_t) at the time it was recorded.
+ */
+typedef struct Telemetry_RadioEvent {
+    uint32_t ratTime;           /* RF_getCurrentTime, 4MHz ticks */
+    uint32_t eventsLow;         /* RF_EventMask, bits 0 .. 31 */
+    uint32_t eventsHigh;        /* and 32 .. 63 */
+    uint16_t cycle;             /* Ping / echo cycle of the event */
+    int16_t  cmdHandle;         /* RF_CmdHandle */
+    uint16_t commandNo;         /* CMD_PROP_TX, CMD_PROP_RX, ... */
+    uint16_t status;            /* PROP_DONE_OK, ... */
+    uint8_t  source;            /* TELEMETRY_RADIO_... */
+    uint8_t  reserved[3];
+} Telemetry_RadioEvent;
+
+#define TELEMETRY_RADIO_EVENT_SIZE  (24)
+
+/*
+ *  Payload of a TELEMETRY_TYPE_RADIO_TRACE frame: the header followed by
+ *  numEvents Telemetry_RadioEvent, oldest first.
+ */
+typedef struct Telemetry_RadioTrace {
+    uint32_t overwritten;       /* Events since startup that never went out */
+    uint16_t numEvents;
+    uint16_t reserved;
+} Telemetry_RadioTrace;
+
+#define TELEMETRY_RADIO_TRACE_SIZE  (8)
+
+/* Telemetry_SetMode.mode */
+#define TELEMETRY_MODE_FULL         (0)     /* Report and codes per window */
+#define TELEMETRY_MODE_SUMMARY      (1)     /* Cycle summary per window */
+
+/*
+ *  Payload of a TELEMETRY_TYPE_SET_MODE frame from the host. In summary
+ *  mode the report with codes follows the summary every rawEvery windows
+ *  (never for 0) and after an anomaly.
+ */
+typedef struct Telemetry_SetMode {
+    uint8_t  mode;              /* TELEMETRY_MODE_... */
+    uint8_t  reserved;
+    uint16_t rawEvery;
+} Telemetry_SetMode;
+
+#define TELEMETRY_SET_MODE_SIZE     (4)
+
+typedef struct Telemetry_Object {
+    uint16_t sequence;          /* Sequence number of the next frame */
+} Telemetry_Object;
+
+extern void Telemetry_init(Telemetry_Object *telemetry);
+
+/*
+ *  ======== Telemetry_encode ========
+ *  Writes one frame of the given type into frame, whose payload is
+ *  headerSize bytes from header followed by dataSize bytes from data
+ *  (either may be 0), and returns the frame size. frame must hold
+ *  TELEMETRY_FRAME_SIZE(headerSize + dataSize) bytes.
+ */
+extern uint16_t Telemetry_encode(Telemetry_Object *telemetry, uint8_t type,
+                                 const void *header, uint16_t headerSize,
+                                 const void *data, uint16_t dataSize,
+                                 uint8_t *frame);
+
+/*
+ *  ======== Telemetry_finish ========
+ *  Same as Telemetry_encode for a payload of payloadSize bytes that has
+ *  already been written at frame + TELEMETRY_HEADER_SIZE, so large
+ *  payloads can be built in place.
+ */
+extern uint16_t Telemetry_finish(Telemetry_Object *telemetry, uint8_t type,
+                                 uint16_t payloadSize, uint8_t *frame);
+
+/*
+ *  ======== Telemetry_crc16 ========
+ *  CRC-16/CCITT-FALSE (polynomial 0x1021) of size bytes, continuing from
+ *  crc; start with 0xFFFF.
+ */
+extern uint16_t Telemetry_crc16(uint16_t crc, const uint8_t *data,
+                                uint32_t size);
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,232 @@
+/*
+ *  ======== telemetryWriter.c ========
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetryWriter.h"
+
+#if defined(__TI_COMPILER_VERSION__) || defined(DeviceFamily_CC26X0R2)
+#include <ti/drivers/dpl/HwiP.h>
+
+#define LOCK(key)       ((key) = HwiP_disable())
+#define UNLOCK(key)     HwiP_restore(key)
+#else
+/* Host builds drive the writer from one thread */
+#define LOCK(key)       ((void)(key))
+#define UNLOCK(key)     ((void)(key))
+#endif
+
+/* TelemetryWriter_Object.states */
+#define FREE        (0)
+#define FILLING     (1)     /* Acquired by the task */
+#define WAITING     (2)     /* Submitted */
+#define SENDING     (3)
+
+/*
+ *  ======== oldest ========
+ *  Index of the waiting buffer submitted first (of the given priority, or
+ *  any for priority < 0), -1 if none. Call with interrupts disabled.
+ */
+static int16_t oldest(const TelemetryWriter_Object *writer, int16_t priority)
+{
+    int16_t found = -1;
+    uint16_t i;
+
+    for (i = 0; i < writer->numBuffers; i++) {
+        if (writer->states[i] != WAITING ||
+            (priority >= 0 && writer->priorities[i] != priority)) {
+            continue;
+        }
+        /* Stamps wrap; compare their distance */
+        if (found < 0 ||
+            (int32_t)(writer->order[i] - writer->order[found]) < 0) {
+            found = (int16_t)i;
+        }
+    }
+
+    return (found);
+}
+
+/*
+ *  ======== startNext ========
+ *  Puts the oldest waiting frame on the link if it is idle. Returns the
+ *  buffer to write, -1 for none. Call with interrupts disabled.
+ */
+static int16_t startNext(TelemetryWriter_Object *writer)
+{
+    int16_t next;
+
+    if (writer->sending >= 0) {
+        return (-1);
+    }
+
+    next = oldest(writer, -1);
+    if (next >= 0) {
+        writer->states[next] = SENDING;
+        writer->sending = next;
+    }
+
+    return (next);
+}
+
+/*
+ *  ======== TelemetryWriter_init ========
+ */
+void TelemetryWriter_init(TelemetryWriter_Object *writer, uint8_t *storage,
+                          uint16_t numBuffers, uint16_t bufferSize,
+                          TelemetryWriter_WriteFxn write, void *writeArg)
+{
+    uint16_t i;
+
+    if (numBuffers > TELEMETRY_WRITER_MAX_BUFFERS) {
+        numBuffers = TELEMETRY_WRITER_MAX_BUFFERS;
+    }
+
+    for (i = 0; i < numBuffers; i++) {
+        writer->buffers[i] = &storage[(uint32_t)i * bufferSize];
+        writer->sizes[i] = 0;
+        writer->order[i] = 0;
+        writer->states[i] = FREE;
+        writer->priorities[i] = TELEMETRY_WRITER_SAMPLES;
+    }
+    writer->numBuffers = numBuffers;
+    writer->bufferSize = bufferSize;
+    writer->sending = -1;
+    writer->stamp = 0;
+    writer->write = write;
+    writer->writeArg = writeArg;
+
+    writer->framesSent = 0;
+    writer->bytesSent = 0;
+    for (i = 0; i < TELEMETRY_WRITER_PRIORITIES; i++) {
+        writer->dropped[i] = 0;
+    }
+    writer->evicted = 0;
+}
+
+/*
+ *  ======== TelemetryWriter_acquire ========
+ */
+uint8_t *TelemetryWriter_acquire(TelemetryWriter_Object *writer,
+                                 uint8_t priority)
+{
+    uint8_t *buffer = NULL;
+    uintptr_t key = 0;
+    int16_t found = -1;
+    uint16_t i;
+
+    LOCK(key);
+
+    for (i = 0; i < writer->numBuffers; i++) {
+        if (writer->states[i] == FREE) {
+            found = (int16_t)i;
+            break;
+        }
+    }
+    if (found < 0 && priority == TELEMETRY_WRITER_SUMMARY) {
+        /* Take over the samples frame that would go out next */
+        found = oldest(writer, TELEMETRY_WRITER_SAMPLES);
+        if (found >= 0) {
+            writer->evicted++;
+        }
+    }
+
+    if (found >= 0) {
+        writer->states[found] = FILLING;
+        writer->priorities[found] = priority;
+        buffer = writer->buffers[found];
+    }
+    else {
+        writer->dropped[priority]++;
+    }
+
+    UNLOCK(key);
+
+    return (buffer);
+}
+
+/*
+ *  ======== TelemetryWriter_acquireIdle ========
+ */
+uint8_t *TelemetryWriter_acquireIdle(TelemetryWriter_Object *writer)
+{
+    uint8_t *buffer = NULL;
+    uintptr_t key = 0;
+    uint16_t i;
+
+    LOCK(key);
+
+    if (oldest(writer, -1) < 0) {
+        for (i = 0; i < writer->numBuffers; i++) {
+            if (writer->states[i] == FREE) {
+                writer->states[i] = FILLING;
+                writer->priorities[i] = TELEMETRY_WRITER_BACKGROUND;
+                buffer = writer->buffers[i];
+                break;
+            }
+        }
+    }
+
+    UNLOCK(key);
+
+    return (buffer);
+}
+
+/*
+ *  ======== TelemetryWriter_submit ========
+ */
+void TelemetryWriter_submit(TelemetryWriter_Object *writer, uint8_t *frame,
+                            uint16_t size)
+{
+    uintptr_t key = 0;
+    int16_t next;
+    uint16_t i;
+
+    LOCK(key);
+
+    for (i = 0; i < writer->numBuffers; i++) {
+        if (writer->buffers[i] == frame) {
+            writer->sizes[i] = size;
+            writer->order[i] = writer->stamp++;
+            writer->states[i] = WAITING;
+            break;
+        }
+    }
+    next = startNext(writer);
+
+    UNLOCK(key);
+
+    /* Nothing else starts a frame while one is on the link */
+    if (next >= 0) {
+        writer->write(writer->writeArg, writer->buffers[next],
+                      writer->sizes[next]);
+    }
+}
+
+/*
+ *  ======== TelemetryWriter_complete ========
+ */
+void TelemetryWriter_complete(TelemetryWriter_Object *writer)
+{
+    uintptr_t key = 0;
+    int16_t next = -1;
+
+    LOCK(key);
+
+    if (writer->sending >= 0) {
+        writer->framesSent++;
+        writer->bytesSent += writer->sizes[writer->sending];
+        writer->states[writer->sending] = FREE;
+        writer->sending = -1;
+        next = startNext(writer);
+    }
+
+    UNLOCK(key);
+
+    if (next >= 0) {
+        writer->write(writer->writeArg, writer->buffers[next],
+                      writer->sizes[next]);
+    }
+}
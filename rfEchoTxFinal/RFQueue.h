@@ -47,19 +47,52 @@
 #ifndef RF_QUEUE_H
 #define RF_QUEUE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__TI_COMPILER_VERSION__) || defined(DeviceFamily_CC26X0R2)
 #include <ti/devices/DeviceFamily.h>
 #include DeviceFamily_constructPath(driverlib/rf_data_entry.h)
+#else
+/* Host builds (host/rfQueueTest.c) */
+#include "rfDataEntry.h"
+#endif
+
+// Constant header size of a Generic Data Entry (8 bytes on the device)
+#define RF_QUEUE_DATA_ENTRY_HEADER_SIZE  (offsetof(rfc_dataEntryGeneral_t, data))
+
+// Alignment of every entry: 4 bytes on the device, as the RF core requires
+// (the pointer size of a host build)
+#define RF_QUEUE_ENTRY_ALIGN  (sizeof(uint8_t *))
+
+#define RF_QUEUE_QUEUE_ALIGN_PADDING(length)                                    \
+((RF_QUEUE_ENTRY_ALIGN - ((length) + RF_QUEUE_DATA_ENTRY_HEADER_SIZE) % RF_QUEUE_ENTRY_ALIGN) % RF_QUEUE_ENTRY_ALIGN) // Padding offset
 
-#define RF_QUEUE_DATA_ENTRY_HEADER_SIZE  8 // Contant header size of a Generic Data Entry
+// Bytes from one entry to the next for length bytes of data
+#define RF_QUEUE_ENTRY_SIZE(length)                                             \
+(RF_QUEUE_DATA_ENTRY_HEADER_SIZE + (length) + RF_QUEUE_QUEUE_ALIGN_PADDING(length))
 
-#define RF_QUEUE_QUEUE_ALIGN_PADDING(length)  (4-((length + RF_QUEUE_DATA_ENTRY_HEADER_SIZE)%4)) // Padding offset
+#define RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(numEntries, dataSize, appendedBytes)    \
+((numEntries) * RF_QUEUE_ENTRY_SIZE((dataSize) + (appendedBytes)))
 
-#define RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(numEntries, dataSize, appendedBytes)                                                    \
-(numEntries*(RF_QUEUE_DATA_ENTRY_HEADER_SIZE + dataSize + appendedBytes + RF_QUEUE_QUEUE_ALIGN_PADDING(dataSize + appendedBytes)))
+//*****************************************************************************
+//
+//! A receive queue: a circular chain of numEntries general data entries in
+//! a caller's buffer, and the read cursor of the application. Every queue
+//! has its own cursor, so an image can have several (one per RX command).
+//
+//*****************************************************************************
+typedef struct RFQueue_Object {
+    dataQueue_t             dataQueue;   // pQueue of the RX command
+    rfc_dataEntryGeneral_t *readEntry;   // Oldest entry not handed back yet
+    uint8_t                *firstEntry;
+    uint16_t                numEntries;
+    uint16_t                entrySize;   // Bytes from one entry to the next
+} RFQueue_Object;
 
-extern uint8_t RFQueue_nextEntry();
-extern rfc_dataEntryGeneral_t* RFQueue_getDataEntry();
-extern uint8_t RFQueue_defineQueue(dataQueue_t *queue ,uint8_t *buf, uint16_t buf_len, uint8_t numEntries, uint16_t length);
+extern uint8_t RFQueue_nextEntry(RFQueue_Object *queue);
+extern rfc_dataEntryGeneral_t* RFQueue_getDataEntry(RFQueue_Object *queue);
+extern uint8_t RFQueue_defineQueue(RFQueue_Object *queue, uint8_t *buf, uint16_t buf_len, uint16_t numEntries, uint16_t length);
 
 #endif
 
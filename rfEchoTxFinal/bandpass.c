@@ -0,0 +1,53 @@
+/*
+ *  ======== bandpass.c ========
+ */
+
+#include <stdint.h>
+
+#include "bandpass.h"
+
+#if (BANDPASS_PERIOD != 4) || (BANDPASS_IF_HZ * 4 != BANDPASS_SAMPLE_RATE_HZ)
+#error "Bandpass_process assumes the carrier aliases to a quarter of the sampling rate"
+#endif
+
+/*
+ *  ======== Bandpass_process ========
+ */
+uint16_t Bandpass_process(const uint16_t *samples, uint16_t numSamples,
+                          uint16_t binSize, uint32_t *powers,
+                          uint16_t maxPowers)
+{
+    uint_fast16_t numBins;
+    uint_fast16_t bin;
+    uint_fast16_t i;
+
+    if (binSize > BANDPASS_MAX_BIN_SIZE) {
+        binSize = BANDPASS_MAX_BIN_SIZE;
+    }
+    binSize -= binSize % BANDPASS_PERIOD;
+    if (binSize == 0) {
+        return (0);
+    }
+
+    numBins = numSamples / binSize;
+    if (numBins > maxPowers) {
+        numBins = maxPowers;
+    }
+
+    for (bin = 0; bin < numBins; bin++) {
+        int32_t iSum = 0;
+        int32_t qSum = 0;
+
+        for (i = 0; i < binSize; i += BANDPASS_PERIOD) {
+            iSum += (int32_t)samples[i] - (int32_t)samples[i + 2];
+            qSum += (int32_t)samples[i + 1] - (int32_t)samples[i + 3];
+        }
+        samples += binSize;
+
+        /* |iSum| < 2^16, so the squares fit in 32 unsigned bits */
+        powers[bin] = (((uint32_t)iSum * (uint32_t)iSum) >> BANDPASS_POWER_SHIFT) +
+            (((uint32_t)qSum * (uint32_t)qSum) >> BANDPASS_POWER_SHIFT);
+    }
+
+    return ((uint16_t)numBins);
+}
@@ -0,0 +1,132 @@
+/*
+ *  ======== deltaCodec.c ========
+ */
+
+#include <stdint.h>
+
+#include "deltaCodec.h"
+
+/*
+ *  ======== DeltaCodec_encode ========
+ */
+uint16_t DeltaCodec_encode(const uint16_t *samples, uint16_t numSamples,
+                           uint8_t *out)
+{
+    uint16_t zigzag[DELTA_CODEC_BLOCK_SIZE];
+    uint8_t *start = out;
+    uint16_t previous;
+    uint16_t i;
+
+    if (numSamples == 0) {
+        return (0);
+    }
+
+    previous = samples[0];
+    *out++ = (uint8_t)previous;
+    *out++ = (uint8_t)(previous >> 8);
+
+    for (i = 1; i < numSamples; ) {
+        uint_fast16_t count = numSamples - i;
+        uint_fast16_t k;
+        uint_fast16_t width = 0;
+        uint_fast16_t held = 0;
+        uint32_t bits = 0;
+        uint16_t all = 0;
+
+        if (count > DELTA_CODEC_BLOCK_SIZE) {
+            count = DELTA_CODEC_BLOCK_SIZE;
+        }
+
+        /* Zigzag differences of the block and the bits they need */
+        for (k = 0; k < count; k++) {
+            uint16_t delta = samples[i + k] - previous;
+
+            previous = samples[i + k];
+            zigzag[k] = (uint16_t)(delta << 1) ^ (uint16_t)(0 - (delta >> 15));
+            all |= zigzag[k];
+        }
+        while (width < 16 && (all >> width) != 0) {
+            width++;
+        }
+        *out++ = (uint8_t)width;
+
+        /* At most 7 + 16 bits are held between bytes */
+        for (k = 0; k < count; k++) {
+            bits |= (uint32_t)zigzag[k] << held;
+            held += width;
+            while (held >= 8) {
+                *out++ = (uint8_t)bits;
+                bits >>= 8;
+                held -= 8;
+            }
+        }
+        if (held != 0) {
+            *out++ = (uint8_t)bits;
+        }
+
+        i += count;
+    }
+
+    return ((uint16_t)(out - start));
+}
+
+/*
+ *  ======== DeltaCodec_decode ========
+ */
+int32_t DeltaCodec_decode(const uint8_t *in, uint32_t size,
+                          uint16_t *samples, uint16_t numSamples)
+{
+    uint32_t used = 2;
+    uint16_t previous;
+    uint16_t i;
+
+    if (numSamples == 0) {
+        return (0);
+    }
+    if (size < 2) {
+        return (-1);
+    }
+
+    previous = (uint16_t)(in[0] | (in[1] << 8));
+    samples[0] = previous;
+
+    for (i = 1; i < numSamples; ) {
+        uint_fast16_t count = numSamples - i;
+        uint_fast16_t width;
+        uint_fast16_t held = 0;
+        uint_fast16_t k;
+        uint32_t bits = 0;
+        uint16_t mask;
+
+        if (count > DELTA_CODEC_BLOCK_SIZE) {
+            count = DELTA_CODEC_BLOCK_SIZE;
+        }
+        if (used >= size || in[used] > 16) {
+            return (-1);
+        }
+        width = in[used++];
+        if (size - used < (count * width + 7) / 8) {
+            return (-1);
+        }
+        mask = (uint16_t)((1u << width) - 1);
+
+        for (k = 0; k < count; k++) {
+            uint16_t zigzag;
+
+            while (held < width) {
+                bits |= (uint32_t)in[used++] << held;
+                held += 8;
+            }
+            zigzag = (uint16_t)bits & mask;
+            bits >>= width;
+            held -= width;
+
+            previous += (uint16_t)(zigzag >> 1) ^ (uint16_t)(0 - (zigzag & 1));
+            samples[i + k] = previous;
+        }
+
+        i += count;
+    }
+
+    return ((int32_t)used);
+}
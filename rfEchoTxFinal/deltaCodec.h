@@ -0,0 +1,55 @@
+/*
+ *  ======== deltaCodec.h ========
+ *  Lossless compression of ADC sample buffers for the UART telemetry.
+ *
+ *  Neighbouring samples at 200kHz differ by a few codes, so each sample is
+ *  sent as the difference to the one before it (modulo 2^16, so any
+ *  uint16_t buffer round trips), zigzag mapped to an unsigned value
+ *  (0, -1, 1, -2, ... become 0, 1, 2, 3, ...). The values are bit-packed in
+ *  blocks of DELTA_CODEC_BLOCK_SIZE with the width of the largest one in
+ *  the block:
+ *
+ *    size  field
+ *    2     first sample (little endian)
+ *    1     width w of block 0 (0..16 bits)
+ *    *     its values, w bits each, LSB first, padded to a whole byte
+ *    1     width of block 1
+ *    ...
+ *
+ *  A 16-value block is exactly 2w bytes. Quiet stretches pack into a few
+ *  bits per sample and an echo only widens its own blocks; a block never
+ *  takes more than its raw size, so the output is bounded by
+ *  DELTA_CODEC_MAX_SIZE (host/deltaCodecBench.c compares it with a
+ *  per-value varint).
+ */
+
+#ifndef DELTA_CODEC_H
+#define DELTA_CODEC_H
+
+#include <stdint.h>
+
+/* Differences per block */
+#define DELTA_CODEC_BLOCK_SIZE      (16)
+/* Largest output for numSamples (>= 1) samples: the raw samples plus one
+ * width byte per block */
+#define DELTA_CODEC_MAX_SIZE(numSamples) \
+    (2 * (numSamples) + ((numSamples) + DELTA_CODEC_BLOCK_SIZE - 2) / \
+     DELTA_CODEC_BLOCK_SIZE)
+
+/*
+ *  ======== DeltaCodec_encode ========
+ *  Compresses numSamples samples into out, which must hold
+ *  DELTA_CODEC_MAX_SIZE(numSamples) bytes, and returns the bytes written.
+ */
+extern uint16_t DeltaCodec_encode(const uint16_t *samples,
+                                  uint16_t numSamples, uint8_t *out);
+
+/*
+ *  ======== DeltaCodec_decode ========
+ *  Restores numSamples samples from the size bytes at in. Returns the bytes
+ *  used, or -1 if the input is too short or malformed.
+ */
+extern int32_t DeltaCodec_decode(const uint8_t *in, uint32_t size,
+                                 uint16_t *samples, uint16_t numSamples);
+
+#endif /* DELTA_CODEC_H */
@@ -0,0 +1,61 @@
+/*
+ *  ======== echoCapture.c ========
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "echoCapture.h"
+
+/*
+ *  ======== EchoCapture_start ========
+ */
+void EchoCapture_start(EchoCapture_Object *capture, uint16_t windowBuffers)
+{
+    capture->peakValue = 0;
+    capture->peakBin = 0;
+    capture->windowBuffers = windowBuffers;
+    capture->buffersDone = 0;
+    capture->overruns = 0;
+    capture->detected = false;
+    capture->active = true;
+}
+
+/*
+ *  ======== EchoCapture_nextBuffer ========
+ */
+uint16_t EchoCapture_nextBuffer(EchoCapture_Object *capture,
+                                uint16_t position)
+{
+    if (position > capture->buffersDone) {
+        /* The buffers in between never arrived */
+        capture->overruns += position - capture->buffersDone;
+        capture->buffersDone = position;
+    }
+
+    return (capture->buffersDone);
+}
+
+/*
+ *  ======== EchoCapture_bufferDone ========
+ */
+bool EchoCapture_bufferDone(EchoCapture_Object *capture, uint32_t peakValue,
+                            uint16_t peakBin, bool detected)
+{
+    if (peakValue > capture->peakValue) {
+        capture->peakValue = peakValue;
+        capture->peakBin = peakBin;
+    }
+    capture->buffersDone++;
+
+    if (detected) {
+        capture->detected = true;
+    }
+
+    if (capture->detected || capture->buffersDone >= capture->windowBuffers) {
+        capture->active = false;
+        return (true);
+    }
+
+    return (false);
+}
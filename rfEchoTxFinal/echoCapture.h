@@ -0,0 +1,56 @@
+/*
+ *  ======== echoCapture.h ========
+ *  Bookkeeping for a continuous, double-buffered ADCBuf listen window.
+ *
+ *  ADCBuf runs in ADCBuf_RECURRENCE_MODE_CONTINUOUS and fills the buffers
+ *  of the window one after the other; adcBufCallback hands each completed
+ *  buffer to analysisThread together with its position in the window.
+ *  This module, run by analysisThread, counts the buffers of the window,
+ *  keeps the bin numbering continuous across them, tracks the window peak
+ *  and tells the caller when to stop: on the first detection or when the
+ *  window deadline is reached.
+ */
+
+#ifndef ECHO_CAPTURE_H
+#define ECHO_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct EchoCapture_Object {
+    uint32_t       peakValue;      /* Largest detector output of the window */
+    uint16_t       peakBin;        /* Window-relative bin of peakValue */
+    uint16_t       windowBuffers;  /* Buffers in a full listen window */
+    uint16_t       buffersDone;    /* Buffers of the window so far */
+    uint16_t       overruns;       /* Buffers that never arrived */
+    bool           detected;       /* An echo was found in the window */
+    volatile bool  active;         /* Window running (cleared when it is over) */
+} EchoCapture_Object;
+
+/* Arms a new window of windowBuffers buffers; call before ADCBuf_convert */
+extern void EchoCapture_start(EchoCapture_Object *capture,
+                              uint16_t windowBuffers);
+
+/*
+ *  ======== EchoCapture_nextBuffer ========
+ *  Call first for every buffer of the window, with the position the
+ *  callback gave it (0 for the first buffer). Returns the position, which
+ *  the caller uses to offset its bin numbers. Buffers that never arrived
+ *  (the callback missed them or the queue was full) are counted in
+ *  overruns, so bin numbers stay aligned with time.
+ */
+extern uint16_t EchoCapture_nextBuffer(EchoCapture_Object *capture,
+                                       uint16_t position);
+
+/*
+ *  ======== EchoCapture_bufferDone ========
+ *  Records the detector output for the buffer (peakBin is window-relative)
+ *  and returns true when the window is over, i.e. detected is true or the
+ *  window deadline has been reached. The caller then cancels the
+ *  conversion (if still running); active is cleared.
+ */
+extern bool EchoCapture_bufferDone(EchoCapture_Object *capture,
+                                   uint32_t peakValue, uint16_t peakBin,
+                                   bool detected);
+
+#endif /* ECHO_CAPTURE_H */
@@ -0,0 +1,204 @@
+/*
+ *  ======== echoDetectTemplate.h ========
+ *  Header-only bin energy detector with every dimension fixed at compile
+ *  time.
+ *
+ *  The sample type, bin size, number of bins and threshold are template
+ *  parameters. <NAME>_process is the detector the firmwares run: its bin
+ *  loop and the loop over the samples of a bin have constant trip counts
+ *  and are both unrolled, every bin is compared with the constant
+ *  threshold, and the average divides by a constant (a multiply and a
+ *  shift). <NAME>_sweep is the same sweep with a bin count known only at
+ *  run time and no threshold, for the run-time length kernels of the host
+ *  tools (host/echoDetect.c, host/echoDetectVariant.h). The sum of a bin
+ *  (<NAME>_binEnergy) is shared by both.
+ *
+ *  Define the parameters and include this file; it may be included any
+ *  number of times with different names:
+ *
+ *    ECHO_DETECT_TEMPLATE_NAME       prefix of the generated names
+ *    ECHO_DETECT_TEMPLATE_SAMPLE     unsigned sample type (ADC codes or
+ *                                    microvolts)
+ *    ECHO_DETECT_TEMPLATE_BIN_SIZE   samples per bin, even
+ *    ECHO_DETECT_TEMPLATE_NUM_BINS   bins per buffer (at most, for sweep)
+ *    ECHO_DETECT_TEMPLATE_THRESHOLD  smallest bin energy of an echo (a bin
+ *                                    has to be above it); without it only
+ *                                    <NAME>_sweep is generated
+ *
+ *  which generates, for NAME = EchoBins:
+ *
+ *    EchoBins_NUM_SAMPLES, EchoBins_NUM_BINS, EchoBins_THRESHOLD (enum)
+ *    EchoBins_Result
+ *    static inline void EchoBins_process(const SAMPLE *samples,
+ *                                        EchoBins_Result *result);
+ *    static inline uint32_t EchoBins_sweep(const SAMPLE *samples,
+ *        uint_fast16_t numBins, uint32_t *binEnergy, uint32_t *peakEnergy,
+ *        uint16_t *peakBin);
+ *
+ *  The sum of a buffer has to fit in 32 bits (12-bit codes, or up to 500
+ *  microvolt samples below 4.3V), and a detector with a threshold has at
+ *  most 32 bins (one bit each in EchoBins_Result.overBins).
+ */
+
+#include <stdint.h>
+
+#if !defined(ECHO_DETECT_TEMPLATE_NAME) || \
+    !defined(ECHO_DETECT_TEMPLATE_SAMPLE) || \
+    !defined(ECHO_DETECT_TEMPLATE_BIN_SIZE) || \
+    !defined(ECHO_DETECT_TEMPLATE_NUM_BINS)
+#error "Define the ECHO_DETECT_TEMPLATE_ parameters before the include"
+#endif
+
+#if (ECHO_DETECT_TEMPLATE_BIN_SIZE) % 2 != 0
+#error "ECHO_DETECT_TEMPLATE_BIN_SIZE has to be even"
+#endif
+
+#if defined(ECHO_DETECT_TEMPLATE_THRESHOLD) && \
+    (ECHO_DETECT_TEMPLATE_NUM_BINS) > 32
+#error "A detector with a threshold has at most 32 bins"
+#endif
+
+#ifndef ECHO_DETECT_TEMPLATE_CAT
+
+#define ECHO_DETECT_TEMPLATE_CAT2(a, b)     a##b
+#define ECHO_DETECT_TEMPLATE_CAT(a, b)      ECHO_DETECT_TEMPLATE_CAT2(a, b)
+
+/* gcc and clang do not unroll constant trip counts this long at -O2 on
+ * their own; the TI compiler does with --opt_for_speed */
+#if defined(__clang__)
+#define ECHO_DETECT_TEMPLATE_UNROLL         _Pragma("unroll")
+#elif defined(__GNUC__) && (__GNUC__ >= 8) && \
+    !defined(__TI_COMPILER_VERSION__)
+#define ECHO_DETECT_TEMPLATE_UNROLL         _Pragma("GCC unroll 64")
+#else
+#define ECHO_DETECT_TEMPLATE_UNROLL
+#endif
+
+#endif /* ECHO_DETECT_TEMPLATE_CAT */
+
+#define ECHO_DETECT_TEMPLATE_ID(suffix) \
+    ECHO_DETECT_TEMPLATE_CAT(ECHO_DETECT_TEMPLATE_NAME, suffix)
+
+enum {
+    ECHO_DETECT_TEMPLATE_ID(_NUM_SAMPLES) =
+        (ECHO_DETECT_TEMPLATE_BIN_SIZE) * (ECHO_DETECT_TEMPLATE_NUM_BINS),
+    ECHO_DETECT_TEMPLATE_ID(_NUM_BINS) = (ECHO_DETECT_TEMPLATE_NUM_BINS)
+};
+
+/*
+ *  ======== <NAME>_binEnergy ========
+ *  Sum of the BIN_SIZE samples of one bin.
+ */
+static inline uint32_t ECHO_DETECT_TEMPLATE_ID(_binEnergy)(
+    const ECHO_DETECT_TEMPLATE_SAMPLE *samples)
+{
+    /* Two accumulators per iteration keep the M3 pipeline busy and let the
+     * host compiler vectorize */
+    uint32_t sumEven = 0;
+    uint32_t sumOdd = 0;
+    uint_fast16_t i;
+
+    ECHO_DETECT_TEMPLATE_UNROLL
+    for (i = 0; i < (ECHO_DETECT_TEMPLATE_BIN_SIZE); i += 2) {
+        sumEven += samples[i];
+        sumOdd += samples[i + 1];
+    }
+
+    return (sumEven + sumOdd);
+}
+
+/*
+ *  ======== <NAME>_sweep ========
+ *  Energies of the first numBins bins into binEnergy, the largest one and
+ *  its index; returns the sum of all their samples.
+ */
+static inline uint32_t ECHO_DETECT_TEMPLATE_ID(_sweep)(
+    const ECHO_DETECT_TEMPLATE_SAMPLE *samples, uint_fast16_t numBins,
+    uint32_t *binEnergy, uint32_t *peakEnergy, uint16_t *peakBin)
+{
+    uint_fast16_t bin;
+    uint32_t total = 0;
+    uint32_t peak = 0;
+    uint_fast16_t peakIndex = 0;
+
+    for (bin = 0; bin < numBins; bin++) {
+        uint32_t energy = ECHO_DETECT_TEMPLATE_ID(_binEnergy)(samples);
+
+        samples += (ECHO_DETECT_TEMPLATE_BIN_SIZE);
+        binEnergy[bin] = energy;
+        total += energy;
+        if (energy > peak) {
+            peak = energy;
+            peakIndex = bin;
+        }
+    }
+
+    *peakEnergy = peak;
+    *peakBin = peakIndex;
+
+    return (total);
+}
+
+#ifdef ECHO_DETECT_TEMPLATE_THRESHOLD
+
+enum {
+    ECHO_DETECT_TEMPLATE_ID(_THRESHOLD) = (ECHO_DETECT_TEMPLATE_THRESHOLD)
+};
+
+typedef struct ECHO_DETECT_TEMPLATE_ID(_Result) {
+    uint32_t binEnergy[ECHO_DETECT_TEMPLATE_NUM_BINS]; /* Sum of each bin */
+    uint32_t peakEnergy;                      /* Largest entry of binEnergy */
+    uint32_t overBins;                        /* Bit i: bin i > THRESHOLD */
+    uint16_t peakBin;                         /* Index of peakEnergy */
+    uint16_t numBins;                         /* Always NUM_BINS */
+    uint32_t average;                         /* Mean sample value */
+} ECHO_DETECT_TEMPLATE_ID(_Result);
+
+/*
+ *  ======== <NAME>_process ========
+ *  Bin energies, bins above the threshold, peak bin and average of one
+ *  buffer of NUM_SAMPLES samples, in a single sweep.
+ */
+static inline void ECHO_DETECT_TEMPLATE_ID(_process)(
+    const ECHO_DETECT_TEMPLATE_SAMPLE *samples,
+    ECHO_DETECT_TEMPLATE_ID(_Result) *result)
+{
+    uint_fast16_t bin;
+    uint32_t total = 0;
+    uint32_t peak = 0;
+    uint32_t over = 0;
+    uint_fast16_t peakIndex = 0;
+
+    ECHO_DETECT_TEMPLATE_UNROLL
+    for (bin = 0; bin < (ECHO_DETECT_TEMPLATE_NUM_BINS); bin++) {
+        uint32_t energy = ECHO_DETECT_TEMPLATE_ID(_binEnergy)(
+            &samples[bin * (ECHO_DETECT_TEMPLATE_BIN_SIZE)]);
+
+        result->binEnergy[bin] = energy;
+        total += energy;
+        /* Constant compare, no branch */
+        over |= (uint32_t)(energy > (uint32_t)(ECHO_DETECT_TEMPLATE_THRESHOLD))
+                << bin;
+        if (energy > peak) {
+            peak = energy;
+            peakIndex = bin;
+        }
+    }
+
+    result->peakEnergy = peak;
+    result->peakBin = peakIndex;
+    result->overBins = over;
+    result->numBins = (ECHO_DETECT_TEMPLATE_NUM_BINS);
+    /* Constant divisor */
+    result->average = total / ((uint32_t)(ECHO_DETECT_TEMPLATE_BIN_SIZE) *
+                               (ECHO_DETECT_TEMPLATE_NUM_BINS));
+}
+
+#endif /* ECHO_DETECT_TEMPLATE_THRESHOLD */
+
+#undef ECHO_DETECT_TEMPLATE_ID
+#undef ECHO_DETECT_TEMPLATE_NAME
+#undef ECHO_DETECT_TEMPLATE_SAMPLE
+#undef ECHO_DETECT_TEMPLATE_BIN_SIZE
+#undef ECHO_DETECT_TEMPLATE_NUM_BINS
+#undef ECHO_DETECT_TEMPLATE_THRESHOLD
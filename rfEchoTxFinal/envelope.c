@@ -0,0 +1,149 @@
+/*
+ *  ======== envelope.c ========
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "envelope.h"
+
+/*
+ *  ======== Envelope_init ========
+ */
+void Envelope_init(Envelope_Object *env, uint16_t threshold,
+                   uint16_t confirmSamples)
+{
+    env->dc = 0;
+    env->threshold = (int32_t)threshold << 4;
+    env->confirmSamples = confirmSamples;
+    env->started = false;
+    Envelope_reset(env);
+}
+
+/*
+ *  ======== Envelope_reset ========
+ */
+void Envelope_reset(Envelope_Object *env)
+{
+    env->envelope = 0;
+    env->crossing = 0;
+    env->peak = 0;
+    env->above = 0;
+    env->confirmed = false;
+}
+
+/*
+ *  ======== quietBlock ========
+ *  True when no code of the ENVELOPE_BLOCK samples is further than the
+ *  threshold from the DC level, so the envelope cannot cross it there. The
+ *  min / max / sum loop has no dependency from one sample to the next and
+ *  is much cheaper than the filter.
+ */
+static inline bool quietBlock(const uint16_t *samples, int32_t dc,
+                              int32_t threshold, uint32_t *sum)
+{
+    uint16_t lo = samples[0];
+    uint16_t hi = samples[0];
+    uint32_t total = 0;
+    uint_fast16_t n;
+
+    for (n = 0; n < ENVELOPE_BLOCK; n++) {
+        uint16_t x = samples[n];
+
+        lo = (x < lo) ? x : lo;
+        hi = (x > hi) ? x : hi;
+        total += x;
+    }
+
+    *sum = total;
+
+    /* threshold is Q4 and dc Q8 */
+    return (((int32_t)hi << 8) - dc <= threshold << 4 &&
+            dc - ((int32_t)lo << 8) <= threshold << 4);
+}
+
+/*
+ *  ======== Envelope_process ========
+ */
+bool Envelope_process(Envelope_Object *env, const uint16_t *samples,
+                      uint16_t numSamples, uint32_t firstIndex)
+{
+    int32_t dc = env->dc;
+    int32_t envelope = env->envelope;
+    int32_t peak = (int32_t)env->peak << 4;
+    int32_t threshold = env->threshold;
+    int32_t release = threshold >> 1;
+    uint_fast16_t above = env->above;
+    uint_fast16_t n = 0;
+
+    if (env->confirmed) {
+        return (true);
+    }
+
+    if (!env->started && numSamples != 0) {
+        dc = (int32_t)samples[0] << 8;
+        env->started = true;
+    }
+
+    /* Signed right shifts are arithmetic on the TI ARM compiler and on gcc,
+     * so the filters shift instead of dividing */
+    while (n < numSamples) {
+        uint_fast16_t end = n + ENVELOPE_BLOCK;
+        uint32_t sum;
+
+        /* The last, partial block always goes through the filter */
+        if (end > numSamples) {
+            end = numSamples;
+        }
+        /* Outside a run, a quiet block only moves the DC level: the envelope
+         * is a weighted mean of itself and the rectified codes, so it stays
+         * at or below the threshold, and it is held instead of filtered */
+        else if (above == 0 && envelope <= threshold &&
+                 quietBlock(&samples[n], dc, threshold, &sum)) {
+            dc += ((int32_t)(sum << 8) - dc * ENVELOPE_BLOCK) >>
+                  ENVELOPE_DC_SHIFT;
+            n = end;
+            continue;
+        }
+
+        for (; n < end; n++) {
+            int32_t x = (int32_t)samples[n] << 8;
+            int32_t rectified;
+
+            dc += (x - dc) >> ENVELOPE_DC_SHIFT;
+            rectified = (x - dc) >> 4;
+            rectified = (rectified < 0) ? -rectified : rectified;
+            envelope += (rectified - envelope) >> ENVELOPE_SHIFT;
+
+            if (envelope > peak) {
+                peak = envelope;
+            }
+
+            if (envelope > threshold) {
+                if (above == 0) {
+                    env->crossing = firstIndex + n;
+                }
+                if (++above >= env->confirmSamples) {
+                    env->confirmed = true;
+                    break;
+                }
+            }
+            else if (envelope < release) {
+                above = 0;
+            }
+            else if (above != 0) {
+                above++;
+            }
+        }
+        if (env->confirmed) {
+            break;
+        }
+    }
+
+    env->dc = dc;
+    env->envelope = envelope;
+    env->peak = (uint32_t)peak >> 4;
+    env->above = above;
+
+    return (env->confirmed);
+}
@@ -0,0 +1,65 @@
+/*
+ *  ======== goertzel.c ========
+ */
+
+#include <stdint.h>
+
+#include "goertzel.h"
+
+/*
+ *  ======== Goertzel_init ========
+ */
+void Goertzel_init(Goertzel_Object *object, uint16_t windowLength)
+{
+    object->s1 = 0;
+    object->s2 = 0;
+    object->windowLength = (windowLength > GOERTZEL_MAX_WINDOW) ?
+        GOERTZEL_MAX_WINDOW : windowLength;
+    object->count = 0;
+}
+
+/*
+ *  ======== Goertzel_process ========
+ */
+uint16_t Goertzel_process(Goertzel_Object *object, const uint16_t *samples,
+                          uint16_t numSamples, uint32_t *powers,
+                          uint16_t maxPowers)
+{
+    int32_t s1 = object->s1;
+    int32_t s2 = object->s2;
+    uint_fast16_t count = object->count;
+    uint_fast16_t windowLength = object->windowLength;
+    uint16_t numPowers = 0;
+    uint_fast16_t n;
+
+    for (n = 0; n < numSamples; n++) {
+        /* s[n] = x[n] + 2cos(w) * s[n-1] - s[n-2]; the product needs more
+         * than 32 bits for long windows (a single SMULL on the M3) */
+        int32_t s0 = (int32_t)samples[n] +
+            (int32_t)(((int64_t)GOERTZEL_COEFF_Q14 * s1) >> 14) - s2;
+
+        s2 = s1;
+        s1 = s0;
+
+        if (++count == windowLength) {
+            /* |X|^2 = s1^2 + s2^2 - 2cos(w) * s1 * s2 */
+            int64_t power = (int64_t)s1 * s1 + (int64_t)s2 * s2 -
+                (((int64_t)GOERTZEL_COEFF_Q14 * s1) >> 14) * s2;
+
+            if (numPowers < maxPowers) {
+                powers[numPowers++] = (power > 0) ?
+                    (uint32_t)((uint64_t)power >> GOERTZEL_POWER_SHIFT) : 0;
+            }
+
+            s1 = 0;
+            s2 = 0;
+            count = 0;
+        }
+    }
+
+    object->s1 = s1;
+    object->s2 = s2;
+    object->count = count;
+
+    return (numPowers);
+}
@@ -0,0 +1,171 @@
+/*
+ *  ======== matchedFilter.c ========
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "matchedFilter.h"
+
+#if (MATCHED_FILTER_PERIOD != 5)
+#error The carrier tables below assume 5 samples per carrier period
+#endif
+
+#if ((MATCHED_FILTER_LENGTH % MATCHED_FILTER_PERIOD) != 0)
+#error The burst must be a whole number of carrier periods
+#endif
+
+/* cos/sin(2*pi*k/5) in Q8, rounded so each table sums to exactly zero and a
+ * DC offset on the ADC input cancels over every carrier period */
+static const int16_t cosTable[MATCHED_FILTER_PERIOD] = {
+    256, 79, -207, -207, 79
+};
+static const int16_t sinTable[MATCHED_FILTER_PERIOD] = {
+    0, 243, 150, -150, -243
+};
+
+/*
+ *  ======== MatchedFilter_reset ========
+ */
+void MatchedFilter_reset(MatchedFilter_Object *object)
+{
+    object->iSum = 0;
+    object->qSum = 0;
+    object->sampleCount = 0;
+    object->historyIndex = 0;
+    object->phase = 0;
+    object->afterPending = false;
+    object->lastPower = 0;
+    object->peakPower = 0;
+    object->beforePeakPower = 0;
+    object->afterPeakPower = 0;
+    object->peakIndex = 0;
+}
+
+/*
+ *  ======== MatchedFilter_process ========
+ */
+void MatchedFilter_process(MatchedFilter_Object *object,
+                           const uint16_t *samples, uint16_t numSamples)
+{
+    uint16_t *history = object->history;
+    int32_t iSum = object->iSum;
+    int32_t qSum = object->qSum;
+    uint32_t index = object->sampleCount;
+    uint_fast16_t h = object->historyIndex;
+    uint_fast8_t phase = object->phase;
+    uint64_t lastPower = object->lastPower;
+    uint64_t peakPower = object->peakPower;
+    uint_fast16_t n;
+
+    if (numSamples == 0) {
+        return;
+    }
+
+    if (index == 0) {
+        /* Pretend the window was full of the first sample so the start of
+         * the capture does not look like a step */
+        for (n = 0; n < MATCHED_FILTER_LENGTH; n++) {
+            history[n] = samples[0];
+        }
+    }
+
+    for (n = 0; n < numSamples; n++, index++) {
+        uint16_t x = samples[n];
+        int32_t diff = (int32_t)x - (int32_t)history[h];
+        uint64_t power;
+
+        /* The sample leaving the window has the same carrier phase as the
+         * one entering it, so only their difference needs mixing */
+        history[h] = x;
+        if (++h == MATCHED_FILTER_LENGTH) {
+            h = 0;
+        }
+
+        iSum += diff * cosTable[phase];
+        qSum += diff * sinTable[phase];
+        if (++phase == MATCHED_FILTER_PERIOD) {
+            phase = 0;
+        }
+
+        power = (uint64_t)((int64_t)iSum * iSum) +
+                (uint64_t)((int64_t)qSum * qSum);
+
+        if (power > peakPower) {
+            peakPower = power;
+            object->beforePeakPower = lastPower;
+            object->peakIndex = index;
+            object->afterPending = true;
+        }
+        else if (object->afterPending) {
+            object->afterPeakPower = power;
+            object->afterPending = false;
+        }
+        lastPower = power;
+    }
+
+    object->iSum = iSum;
+    object->qSum = qSum;
+    object->sampleCount = index;
+    object->historyIndex = h;
+    object->phase = phase;
+    object->lastPower = lastPower;
+    object->peakPower = peakPower;
+}
+
+/*
+ *  ======== MatchedFilter_getResult ========
+ */
+void MatchedFilter_getResult(const MatchedFilter_Object *object,
+                             MatchedFilter_Result *result)
+{
+    int32_t offset = 0;
+    int32_t arrival;
+
+    result->peakPower = object->peakPower;
+    result->valid = (object->sampleCount >= MATCHED_FILTER_LENGTH) &&
+                    (object->peakPower != 0);
+
+    /* Parabolic fit through the peak and its neighbours:
+     *   offset = (before - after) / (2 * (before - 2 * peak + after))
+     * The powers are scaled down to 23 bits first so the fit only needs
+     * 32-bit arithmetic. */
+    if (!object->afterPending) {
+        uint64_t peak = object->peakPower;
+        uint_fast8_t shift = 0;
+        int32_t before;
+        int32_t after;
+        int32_t curvature;
+
+        while ((peak >> shift) >= ((uint64_t)1 << 22)) {
+            shift++;
+        }
+        before = (int32_t)(object->beforePeakPower >> shift);
+        after = (int32_t)(object->afterPeakPower >> shift);
+        curvature = before - 2 * (int32_t)(peak >> shift) + after;
+
+        if (curvature < 0) {
+            offset = ((before - after) * (1 << (MATCHED_FILTER_FRAC_BITS - 1))) /
+                     curvature;
+            if (offset > (1 << (MATCHED_FILTER_FRAC_BITS - 1))) {
+                offset = 1 << (MATCHED_FILTER_FRAC_BITS - 1);
+            }
+            else if (offset < -(1 << (MATCHED_FILTER_FRAC_BITS - 1))) {
+                offset = -(1 << (MATCHED_FILTER_FRAC_BITS - 1));
+            }
+        }
+    }
+
+    /* The window sum peaks when the window is centred on the echo, i.e.
+     * half a sample before its last sample lines up with the echo end */
+    arrival = ((int32_t)object->peakIndex - (MATCHED_FILTER_LENGTH - 1)) *
+              (1 << MATCHED_FILTER_FRAC_BITS) -
+              (1 << (MATCHED_FILTER_FRAC_BITS - 1)) + offset;
+    if (arrival < 0) {
+        arrival = 0;
+    }
+
+    result->arrival = (uint32_t)arrival;
+    result->arrivalUs = ((uint32_t)arrival *
+        (1000000 / MATCHED_FILTER_SAMPLE_RATE_HZ)) >> MATCHED_FILTER_FRAC_BITS;
+}
@@ -0,0 +1,75 @@
+/*
+ *  ======== rangingPacket.h ========
+ *  The packet the initiator sends every cycle and the responder echoes.
+ *
+ *  Every packet is
+ *
+ *    offset  size  field
+ *    0       1     device ID of the initiator (ECHO_DEVICE_ID)
+ *    1       1     format version (RANGING_PACKET_VERSION)
+ *    2       2     sequence number, +1 per cycle (little endian)
+ *    4       4     RAT time the initiator's TX started (little endian)
+ *    8       2     CRC-16/CCITT-FALSE of bytes 0 .. 7 (big endian)
+ *
+ *  The ID comes first so that a radio can filter on it (the RX command's
+ *  address check compares the first payload byte): a responder only
+ *  echoes the initiator it is paired with.
+ *
+ *  The responder sends the packet back unchanged, so the initiator checks
+ *  the echo by decoding it and comparing the fields with what it sent. The
+ *  echo is one byte longer (RANGING_ECHO_SIZE, the extra byte is not
+ *  checked): the direction is in the length byte the responder's TX
+ *  command writes, so the RF core can echo straight out of the received
+ *  packet with nothing to change in it, and a responder never takes an
+ *  echo for a request. The radio's CRC covers the length byte on air.
+ *
+ *  The packet CRC covers the packet from end to end: the radio's own CRC
+ *  is recomputed by the responder when it echoes, so it does not catch a
+ *  packet changed in between. It goes out high byte first, so the packet
+ *  and its CRC are one codeword in the order the radio sends them (most
+ *  significant bit first): every error burst of up to 16 bits is caught,
+ *  which a little endian CRC does not guarantee across its two bytes. A
+ *  packet of another length or version is refused.
+ */
+
+#ifndef RANGING_PACKET_H
+#define RANGING_PACKET_H
+
+#include <stdint.h>
+
+#define RANGING_PACKET_VERSION      (2)
+#define RANGING_PACKET_SIZE         (10)
+/* Length of an echo: the request and one byte more */
+#define RANGING_ECHO_SIZE           (RANGING_PACKET_SIZE + 1)
+
+/* RangingPacket_decode results */
+#define RANGING_PACKET_OK           (0)
+#define RANGING_PACKET_E_LENGTH     (-1)    /* Neither a request nor an echo */
+#define RANGING_PACKET_E_CRC        (-2)    /* Corrupted */
+#define RANGING_PACKET_E_VERSION    (-3)    /* Another format */
+
+typedef struct RangingPacket {
+    uint8_t  deviceId;
+    uint16_t sequence;
+    uint32_t ratTime;
+    uint8_t  echo;          /* 1 for an echo, 0 for a request */
+} RangingPacket;
+
+/*
+ *  ======== RangingPacket_encode ========
+ *  Writes the RANGING_PACKET_SIZE bytes of packet to data, as a request
+ *  (packet->echo is not used).
+ */
+extern void RangingPacket_encode(const RangingPacket *packet, uint8_t *data);
+
+/*
+ *  ======== RangingPacket_decode ========
+ *  Reads a packet of length bytes from data: RANGING_PACKET_SIZE for a
+ *  request, RANGING_ECHO_SIZE for an echo. Returns RANGING_PACKET_OK or
+ *  the first check it failed (RANGING_PACKET_E_...); packet is only
+ *  written when the packet is valid.
+ */
+extern int8_t RangingPacket_decode(const uint8_t *data, uint16_t length,
+                                   RangingPacket *packet);
+
+#endif /* RANGING_PACKET_H */
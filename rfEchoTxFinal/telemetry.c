@@ -0,0 +1,93 @@
+/*
+ *  ======== telemetry.c ========
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+/* The report is copied as is; it must have no padding */
+typedef char Telemetry_reportSizeCheck[
+    (sizeof(Telemetry_EchoReport) == TELEMETRY_ECHO_REPORT_SIZE) ? 1 : -1];
+typedef char Telemetry_summarySizeCheck[
+    (sizeof(Telemetry_CycleSummary) == TELEMETRY_CYCLE_SUMMARY_SIZE) ? 1 : -1];
+typedef char Telemetry_radioEventSizeCheck[
+    (sizeof(Telemetry_RadioEvent) == TELEMETRY_RADIO_EVENT_SIZE) ? 1 : -1];
+typedef char Telemetry_radioTraceSizeCheck[
+    (sizeof(Telemetry_RadioTrace) == TELEMETRY_RADIO_TRACE_SIZE) ? 1 : -1];
+typedef char Telemetry_setModeSizeCheck[
+    (sizeof(Telemetry_SetMode) == TELEMETRY_SET_MODE_SIZE) ? 1 : -1];
+
+/* CRC of a nibble, two lookups per byte: 32 bytes of table instead of 512 */
+static const uint16_t crcTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*
+ *  ======== Telemetry_init ========
+ */
+void Telemetry_init(Telemetry_Object *telemetry)
+{
+    telemetry->sequence = 0;
+}
+
+/*
+ *  ======== Telemetry_crc16 ========
+ */
+uint16_t Telemetry_crc16(uint16_t crc, const uint8_t *data, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        crc = (uint16_t)(crc << 4) ^ crcTable[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (uint16_t)(crc << 4) ^ crcTable[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+
+    return (crc);
+}
+
+/*
+ *  ======== Telemetry_encode ========
+ */
+uint16_t Telemetry_encode(Telemetry_Object *telemetry, uint8_t type,
+                          const void *header, uint16_t headerSize,
+                          const void *data, uint16_t dataSize,
+                          uint8_t *frame)
+{
+    if (headerSize != 0) {
+        memcpy(&frame[TELEMETRY_HEADER_SIZE], header, headerSize);
+    }
+    if (dataSize != 0) {
+        memcpy(&frame[TELEMETRY_HEADER_SIZE + headerSize], data, dataSize);
+    }
+
+    return (Telemetry_finish(telemetry, type, headerSize + dataSize, frame));
+}
+
+/*
+ *  ======== Telemetry_finish ========
+ */
+uint16_t Telemetry_finish(Telemetry_Object *telemetry, uint8_t type,
+                          uint16_t payloadSize, uint8_t *frame)
+{
+    uint16_t crc;
+
+    frame[0] = TELEMETRY_SYNC0;
+    frame[1] = TELEMETRY_SYNC1;
+    frame[2] = (uint8_t)payloadSize;
+    frame[3] = (uint8_t)(payloadSize >> 8);
+    frame[4] = (uint8_t)telemetry->sequence;
+    frame[5] = (uint8_t)(telemetry->sequence >> 8);
+    frame[6] = type;
+    telemetry->sequence++;
+
+    /* Everything after the sync word */
+    crc = Telemetry_crc16(0xFFFF, &frame[2],
+                          TELEMETRY_HEADER_SIZE - 2 + payloadSize);
+    frame[TELEMETRY_HEADER_SIZE + payloadSize] = (uint8_t)crc;
+    frame[TELEMETRY_HEADER_SIZE + payloadSize + 1] = (uint8_t)(crc >> 8);
+
+    return (TELEMETRY_FRAME_SIZE(payloadSize));
+}
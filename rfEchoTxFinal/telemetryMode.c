@@ -0,0 +1,136 @@
+/*
+ *  ======== telemetryMode.c ========
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetryMode.h"
+
+#define SETTING(mode, rawEvery) \
+    ((uint32_t)(mode) | ((uint32_t)(rawEvery) << 16))
+
+/*
+ *  ======== plausible ========
+ *  Whether the fill bytes received so far can start a command. Only one
+ *  command is known, so its size and type are fixed.
+ */
+static bool plausible(const uint8_t *command, uint8_t fill)
+{
+    return ((fill < 1 || command[0] == TELEMETRY_SYNC0) &&
+            (fill < 2 || command[1] == TELEMETRY_SYNC1) &&
+            (fill < TELEMETRY_HEADER_SIZE ||
+             (command[2] == TELEMETRY_SET_MODE_SIZE && command[3] == 0 &&
+              command[6] == TELEMETRY_TYPE_SET_MODE)));
+}
+
+/*
+ *  ======== resync ========
+ *  Drops bytes from the front until the rest can start a command, so a
+ *  command right after noise or a damaged one is not missed.
+ */
+static void resync(TelemetryMode_Object *telemetryMode)
+{
+    do {
+        telemetryMode->fill--;
+        memmove(telemetryMode->command, &telemetryMode->command[1],
+                telemetryMode->fill);
+    } while (!plausible(telemetryMode->command, telemetryMode->fill));
+}
+
+/*
+ *  ======== TelemetryMode_init ========
+ */
+void TelemetryMode_init(TelemetryMode_Object *telemetryMode, uint8_t mode,
+                        uint16_t rawEvery)
+{
+    telemetryMode->setting = SETTING(mode, rawEvery);
+    telemetryMode->sinceReport = 0;
+    telemetryMode->detected = false;
+    telemetryMode->fill = 0;
+    telemetryMode->commands = 0;
+    telemetryMode->rejected = 0;
+}
+
+/*
+ *  ======== TelemetryMode_set ========
+ */
+void TelemetryMode_set(TelemetryMode_Object *telemetryMode, uint8_t mode,
+                       uint16_t rawEvery)
+{
+    telemetryMode->setting = SETTING(mode, rawEvery);
+}
+
+/*
+ *  ======== TelemetryMode_receive ========
+ */
+bool TelemetryMode_receive(TelemetryMode_Object *telemetryMode, uint8_t byte)
+{
+    uint8_t *command = telemetryMode->command;
+    uint16_t crc;
+
+    command[telemetryMode->fill++] = byte;
+    if (!plausible(command, telemetryMode->fill)) {
+        if (telemetryMode->fill >= TELEMETRY_HEADER_SIZE) {
+            telemetryMode->rejected++;
+        }
+        resync(telemetryMode);
+        return (false);
+    }
+    if (telemetryMode->fill < sizeof(telemetryMode->command)) {
+        return (false);
+    }
+
+    crc = Telemetry_crc16(0xFFFF, &command[2],
+                          TELEMETRY_HEADER_SIZE - 2 + TELEMETRY_SET_MODE_SIZE);
+    if (command[TELEMETRY_HEADER_SIZE + TELEMETRY_SET_MODE_SIZE] !=
+            (uint8_t)crc ||
+        command[TELEMETRY_HEADER_SIZE + TELEMETRY_SET_MODE_SIZE + 1] !=
+            (uint8_t)(crc >> 8) ||
+        command[TELEMETRY_HEADER_SIZE] > TELEMETRY_MODE_SUMMARY) {
+        telemetryMode->rejected++;
+        resync(telemetryMode);
+        return (false);
+    }
+    telemetryMode->fill = 0;
+
+    /* Telemetry_SetMode, little endian */
+    TelemetryMode_set(telemetryMode, command[TELEMETRY_HEADER_SIZE],
+        (uint16_t)(command[TELEMETRY_HEADER_SIZE + 2] |
+                   (command[TELEMETRY_HEADER_SIZE + 3] << 8)));
+    telemetryMode->commands++;
+
+    return (true);
+}
+
+/*
+ *  ======== TelemetryMode_cycle ========
+ */
+uint8_t TelemetryMode_cycle(TelemetryMode_Object *telemetryMode,
+                            bool detected, bool anomaly)
+{
+    uint32_t setting = telemetryMode->setting;
+    uint16_t rawEvery = (uint16_t)(setting >> 16);
+    uint8_t send = TELEMETRY_MODE_SEND_SUMMARY;
+
+    /* A buzzer change is worth a look at the codes */
+    if (detected != telemetryMode->detected) {
+        anomaly = true;
+    }
+    telemetryMode->detected = detected;
+
+    if ((uint8_t)setting == TELEMETRY_MODE_FULL) {
+        telemetryMode->sinceReport = 0;
+        return (TELEMETRY_MODE_SEND_REPORT);
+    }
+
+    telemetryMode->sinceReport++;
+    if (anomaly ||
+        (rawEvery != 0 && telemetryMode->sinceReport >= rawEvery)) {
+        telemetryMode->sinceReport = 0;
+        send |= TELEMETRY_MODE_SEND_REPORT;
+    }
+
+    return (send);
+}
@@ -0,0 +1,66 @@
+/*
+ *  ======== telemetryMode.h ========
+ *  Chooses the telemetry frames of every listen window, and takes mode
+ *  changes from the host.
+ *
+ *  In TELEMETRY_MODE_FULL every window sends its echo report with the codes
+ *  of its last buffer. In TELEMETRY_MODE_SUMMARY every window sends a
+ *  fixed-size Telemetry_CycleSummary instead, and the report with codes
+ *  only follows every rawEvery windows or after an anomaly: lost buffers,
+ *  no RF packet, or the buzzer changing state. That is a few dozen bytes
+ *  per window instead of several hundred.
+ *
+ *  The host switches modes with a TELEMETRY_TYPE_SET_MODE frame
+ *  (host/telemetrySetMode.c), fed in here a byte at a time from the UART
+ *  read callback. The setting is a single word, so it can change between
+ *  windows without a lock.
+ */
+
+#ifndef TELEMETRY_MODE_H
+#define TELEMETRY_MODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telemetry.h"
+
+/* TelemetryMode_cycle results */
+#define TELEMETRY_MODE_SEND_SUMMARY     (0x01)
+#define TELEMETRY_MODE_SEND_REPORT      (0x02)
+
+typedef struct TelemetryMode_Object {
+    volatile uint32_t setting;  /* mode | rawEvery << 16 */
+    uint16_t  sinceReport;      /* Windows since the last report */
+    bool      detected;         /* Buzzer state of the last window */
+
+    /* Command being received */
+    uint8_t   command[TELEMETRY_FRAME_SIZE(TELEMETRY_SET_MODE_SIZE)];
+    uint8_t   fill;
+    uint16_t  commands;         /* Accepted */
+    uint16_t  rejected;         /* Bad length, type or CRC */
+} TelemetryMode_Object;
+
+extern void TelemetryMode_init(TelemetryMode_Object *telemetryMode,
+                               uint8_t mode, uint16_t rawEvery);
+
+/* Any context; takes effect with the next window */
+extern void TelemetryMode_set(TelemetryMode_Object *telemetryMode,
+                              uint8_t mode, uint16_t rawEvery);
+
+/*
+ *  ======== TelemetryMode_receive ========
+ *  Feeds one byte from the host. Returns true if it completed a valid
+ *  TELEMETRY_TYPE_SET_MODE frame, which is then applied.
+ */
+extern bool TelemetryMode_receive(TelemetryMode_Object *telemetryMode,
+                                  uint8_t byte);
+
+/*
+ *  ======== TelemetryMode_cycle ========
+ *  Called once per listen window with its buzzer state and whether it had
+ *  an anomaly; returns the frames to send (TELEMETRY_MODE_SEND_...).
+ */
+extern uint8_t TelemetryMode_cycle(TelemetryMode_Object *telemetryMode,
+                                   bool detected, bool anomaly);
+
+#endif /* TELEMETRY_MODE_H */
@@ -0,0 +1,108 @@
+/*
+ *  ======== telemetryWriter.h ========
+ *  Non-blocking writer for the UART telemetry frames.
+ *
+ *  The writer owns a few frame buffers. The analysis task acquires a free
+ *  buffer, builds a frame in it and submits it; submitted frames are sent
+ *  one at a time and each buffer is freed again from the UART write
+ *  callback (TelemetryWriter_complete), which also starts the next frame.
+ *  A buffer is never written while it is being sent, and nothing waits
+ *  on the link.
+ *
+ *  When the link falls behind there is no free buffer and frames are
+ *  dropped instead. Frames have a priority: a TELEMETRY_WRITER_SUMMARY
+ *  frame (the detection result alone) may take the buffer of the oldest
+ *  TELEMETRY_WRITER_SAMPLES frame (result plus ADC codes) that is still
+ *  waiting. Frames go out in the order they were submitted, so sequence
+ *  numbers stay in order on the link. Every frame that does not make it
+ *  out is counted.
+ *
+ *  Acquire and submit are called from one task; complete from the UART
+ *  callback. On the device the shared state is protected by disabling
+ *  interrupts for a few instructions; host builds (host/telemetryWriterSim.c)
+ *  are single threaded.
+ */
+
+#ifndef TELEMETRY_WRITER_H
+#define TELEMETRY_WRITER_H
+
+#include <stdint.h>
+
+/* Most frame buffers a writer can have */
+#define TELEMETRY_WRITER_MAX_BUFFERS    (4)
+
+/* Frame priorities, highest first */
+#define TELEMETRY_WRITER_SUMMARY        (0)
+#define TELEMETRY_WRITER_SAMPLES        (1)
+#define TELEMETRY_WRITER_PRIORITIES     (2)
+/* Frames of TelemetryWriter_acquireIdle */
+#define TELEMETRY_WRITER_BACKGROUND     (TELEMETRY_WRITER_PRIORITIES)
+
+/* Starts sending size bytes of frame; completion is reported with
+ * TelemetryWriter_complete */
+typedef void (*TelemetryWriter_WriteFxn)(void *arg, const uint8_t *frame,
+                                         uint16_t size);
+
+typedef struct TelemetryWriter_Object {
+    uint8_t  *buffers[TELEMETRY_WRITER_MAX_BUFFERS];
+    uint16_t  sizes[TELEMETRY_WRITER_MAX_BUFFERS];
+    uint32_t  order[TELEMETRY_WRITER_MAX_BUFFERS];  /* Submission stamp */
+    uint8_t   states[TELEMETRY_WRITER_MAX_BUFFERS];
+    uint8_t   priorities[TELEMETRY_WRITER_MAX_BUFFERS];
+    uint16_t  numBuffers;
+    uint16_t  bufferSize;       /* Bytes of every buffer */
+    int16_t   sending;          /* Buffer on the link, -1 if idle */
+    uint32_t  stamp;
+    TelemetryWriter_WriteFxn write;
+    void     *writeArg;
+
+    /* Counters since init */
+    uint32_t  framesSent;
+    uint32_t  bytesSent;
+    uint32_t  dropped[TELEMETRY_WRITER_PRIORITIES];  /* No buffer free */
+    uint32_t  evicted;          /* Waiting samples frames given to a summary */
+} TelemetryWriter_Object;
+
+/*
+ *  ======== TelemetryWriter_init ========
+ *  Splits storage into numBuffers (2 .. TELEMETRY_WRITER_MAX_BUFFERS)
+ *  buffers of bufferSize bytes.
+ */
+extern void TelemetryWriter_init(TelemetryWriter_Object *writer,
+                                 uint8_t *storage, uint16_t numBuffers,
+                                 uint16_t bufferSize,
+                                 TelemetryWriter_WriteFxn write,
+                                 void *writeArg);
+
+/*
+ *  ======== TelemetryWriter_acquire ========
+ *  Returns a buffer of bufferSize bytes for a frame of the given priority,
+ *  or NULL (and counts the frame as dropped) if there is none.
+ */
+extern uint8_t *TelemetryWriter_acquire(TelemetryWriter_Object *writer,
+                                        uint8_t priority);
+
+/*
+ *  ======== TelemetryWriter_acquireIdle ========
+ *  Returns a buffer for a background frame only if one is free and no
+ *  submitted frame is waiting, NULL otherwise. Background frames are never
+ *  evicted and not counted when they cannot go out, so they hold up the
+ *  frames of the two priorities by at most their own link time.
+ */
+extern uint8_t *TelemetryWriter_acquireIdle(TelemetryWriter_Object *writer);
+
+/*
+ *  ======== TelemetryWriter_submit ========
+ *  Queues the size-byte frame built in an acquired buffer; it is sent as
+ *  soon as the link is free.
+ */
+extern void TelemetryWriter_submit(TelemetryWriter_Object *writer,
+                                   uint8_t *frame, uint16_t size);
+
+/*
+ *  ======== TelemetryWriter_complete ========
+ *  The frame on the link has been sent (UART write callback).
+ */
+extern void TelemetryWriter_complete(TelemetryWriter_Object *writer);
+
+#endif /* TELEMETRY_WRITER_H */